@@ -10,7 +10,16 @@ typedef enum gmError {
   gmError_GlLoadingFailed,
   gmError_StatusCheckFailed,
   gmError_IncompleteFrameBuffer,
-  gmError_ImageWriteFailed
+  gmError_ImageWriteFailed,
+  gmError_ThreadCreationFailed,
+  gmError_ProfileWriteFailed,
+  gmError_UnsupportedImageFormat,
+  gmError_JobSubmissionFailed,
+  gmError_ListenFailed,
+  gmError_WorkersFailed,
+  gmError_FrameSizeMismatch,
+  gmError_Canceled,
+  gmError_TraceWriteFailed
 } gmError;
 
 /**
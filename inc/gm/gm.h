@@ -10,23 +10,723 @@ typedef struct gmIntSize {
   int h;
 } gmIntSize;
 
+typedef struct gmIntRect {
+  int x;
+  int y;
+  int w;
+  int h;
+} gmIntRect;
+
 /**
  * Wrapper for `unsigned int`. Low-level type aliases use the snake-case naming
  * format.
  */
 typedef unsigned int gm_uint;
 
+/**
+ * Receives the image of a progressive render after each of its passes.  The
+ * image is upscaled to the full image size and laid out as the image data
+ * written to the output file.
+ */
+typedef void (*gmPreviewFunc)(const unsigned char *image_data,
+                              const gmIntSize *size, gm_uint pass_index,
+                              gm_uint pass_count, void *user_data);
+
+/**
+ * Setting a preview function renders the image progressively: a first pass
+ * computes one pixel out of 8 in each direction, then each pass halves that
+ * step, only computing the pixels the previous passes did not.
+ */
+typedef struct gmPreviewConfig {
+  gmPreviewFunc func;
+  void *user_data;
+} gmPreviewConfig;
+
+/**
+ * Region of the complex plane covered by the image.  Leaving the size at 0
+ * uses the default viewport, which shows the whole set.
+ */
+typedef struct gmViewport {
+  double center_x;
+  double center_y;
+  double width;
+  double height;
+} gmViewport;
+
+typedef enum gmBackend {
+  /**
+   * Resolves to the OpenGL backend.
+   */
+  gmBackend_Default,
+
+  gmBackend_Gl,
+  gmBackend_Cpu
+} gmBackend;
+
+typedef enum gmCpuAlgorithm {
+  /**
+   * Resolves to the per-pixel algorithm.
+   */
+  gmCpuAlgorithm_Default,
+
+  /**
+   * Computes every pixel of the image.
+   */
+  gmCpuAlgorithm_PerPixel,
+
+  /**
+   * Mariani-Silver algorithm: only the border of a rectangle is computed, its
+   * inside is filled when the whole border has the same iteration count and
+   * the rectangle is subdivided otherwise.
+   */
+  gmCpuAlgorithm_BoundaryTracing,
+
+  /**
+   * Boundary tracing which also computes a grid of pixels inside the rectangles
+   * about to be filled, subdividing them instead when any of these pixels
+   * differs from the border.
+   */
+  gmCpuAlgorithm_CheckedBoundaryTracing
+} gmCpuAlgorithm;
+
+typedef struct gmCpuConfig {
+  gmCpuAlgorithm algorithm;
+
+  /**
+   * Leaving the thread count at 0 uses one thread per online processor.
+   */
+  gm_uint thread_count;
+} gmCpuConfig;
+
+typedef enum gmGlAlgorithm {
+  /**
+   * Resolves to the per-pixel algorithm.
+   */
+  gmGlAlgorithm_Default,
+
+  /**
+   * Runs the kernel on every pixel of the image.
+   */
+  gmGlAlgorithm_PerPixel,
+
+  /**
+   * Computes the corners of 8x8 pixel blocks at 1/8 of the image resolution,
+   * then samples the edges of the blocks whose corners agree.  Blocks whose
+   * corners and edges all agree are filled in a single instanced draw, marking
+   * them in the stencil buffer, and the kernel only runs on the other blocks.
+   */
+  gmGlAlgorithm_Hierarchical
+} gmGlAlgorithm;
+
+/**
+ * Receives the share of the image rendered, from 0 to 1, after each chunk of a
+ * chunked render.
+ */
+typedef void (*gmProgressFunc)(double progress, void *user_data);
+
+typedef struct gmGlConfig {
+  gmGlAlgorithm algorithm;
+
+  /**
+   * Seconds each draw should keep the GPU busy.  The per-pixel algorithm then
+   * draws the image in bands of rows sized to take about that long, waiting
+   * for each band before drawing the next one, so that long renders don't
+   * trip the watchdog of the driver or stall the other users of the GPU.
+   * Leaving it at 0 draws the whole image at once.
+   */
+  double chunk_time;
+
+  /**
+   * Only called by chunked renders, Deep Zoom images and tiled renders
+   * reporting the progress of each of their strips or tiles.
+   */
+  gmProgressFunc progress_func;
+  void *progress_user_data;
+
+  /**
+   * When not NULL, chunked renders stop after the band being drawn once the
+   * flag is set, failing with `gmError_Canceled`.  The flag is read atomically
+   * and may be set from any thread.
+   */
+  const int *cancel_flag;
+
+  /**
+   * Bytes of GPU memory the resources of a render may take.  Images whose
+   * resources would not fit are rendered in tiles, or at a lower sample count
+   * when they need all of their pixels at once.  Leaving it at 0 queries the
+   * memory available from `GL_NVX_gpu_memory_info` or `GL_ATI_meminfo`, and
+   * assumes 1 GiB when the driver supports neither, as with llvmpipe.
+   */
+  unsigned long long memory_budget;
+} gmGlConfig;
+
+typedef enum gmEngine {
+  /**
+   * Resolves to the escape-time engine.
+   */
+  gmEngine_Default,
+
+  /**
+   * Colors each point of the viewport with the number of iterations its orbit
+   * takes to escape.
+   */
+  gmEngine_EscapeTime,
+
+  /**
+   * Plots the density of the orbits of randomly sampled escaping points.  This
+   * engine always runs on the CPU.
+   */
+  gmEngine_Buddhabrot
+} gmEngine;
+
+typedef enum gmColoringMode {
+  /**
+   * Resolves to the cyclic coloring.
+   */
+  gmColoringMode_Default,
+
+  /**
+   * The hue goes around the color wheel every 360 iterations.
+   */
+  gmColoringMode_Cyclic,
+
+  /**
+   * The hue goes around the color wheel once over the image, following the
+   * share of the escaping pixels which escape in as many iterations or fewer,
+   * so that the colors spread evenly whatever the max iteration count.
+   * Progressive renders and Deep Zoom images use the cyclic coloring.
+   */
+  gmColoringMode_Equalized
+} gmColoringMode;
+
+typedef struct gmBuddhabrotConfig {
+  /**
+   * Number of sampled points.  Leaving it at 0 samples 64 points per pixel.
+   */
+  unsigned long long point_count;
+
+  /**
+   * Orbits escaping in fewer iterations are not plotted.
+   */
+  gm_uint min_iteration_count;
+
+  /**
+   * Renders with the same seed and config produce the same image, whatever
+   * the number of threads.
+   */
+  unsigned long long seed;
+} gmBuddhabrotConfig;
+
+/**
+ * Pixels of the image to render, the other pixels being filled with the
+ * background color.  Rows are counted in the order they are written, from the
+ * first row of the image file.
+ */
+typedef struct gmRegionConfig {
+  /**
+   * Rectangles of pixels to render, clipped to the image.
+   */
+  const gmIntRect *rects;
+  gm_uint rect_count;
+
+  /**
+   * When not NULL, the pixels whose bit is set are rendered too.  One bit per
+   * pixel, the most significant bit of each byte first, each row starting on a
+   * new byte like in PBM images.
+   */
+  const unsigned char *mask;
+
+  /**
+   * RGB color of the pixels outside of the region.
+   */
+  unsigned char background_color[3];
+} gmRegionConfig;
+
 typedef struct gmImageConfig {
   gm_uint sample_count;
   gmIntSize size;
+  gmPreviewConfig preview;
+  gmViewport viewport;
+
+  /**
+   * Leaving the max iteration count at 0 uses 100 iterations.
+   */
+  gm_uint max_iteration_count;
+
+  gmEngine engine;
+
+  /**
+   * Only used by the escape-time engine.
+   */
+  gmColoringMode coloring_mode;
+
+  /**
+   * Only used by the escape-time engine, the whole image is rendered when the
+   * region has neither rectangle nor mask.  Progressive renders, iteration
+   * files and Deep Zoom images ignore it, and images with a region keep their
+   * size under a time budget.  The CPU backend computes the pixels of the
+   * region one by one whatever its algorithm.
+   */
+  gmRegionConfig region;
+
+  /**
+   * Only used by the Buddhabrot engine.
+   */
+  gmBuddhabrotConfig buddhabrot;
+
+  gmBackend backend;
+
+  /**
+   * Only used by the OpenGL backend, progressive renders always use the
+   * per-pixel algorithm.
+   */
+  gmGlConfig gl;
+
+  /**
+   * Only used by the CPU backend, which ignores the sample count and renders
+   * progressive images in a single pass.  It computes the pixels smaller than
+   * about 1e-12 with fixed-point numbers of 128 to 320 bits, deep enough for
+   * viewports about 1e-70 wide, though iteration files stay in double
+   * precision.
+   */
+  gmCpuConfig cpu;
 } gmImageConfig;
 
+/**
+ * Bins of the histogram of `gmCostStats`.
+ */
+#define GM_COST_HISTOGRAM_BIN_COUNT 32
+
+/**
+ * Summary of the iterations executed for the pixels of a render, after the
+ * pixels skipped by the algorithm.
+ */
+typedef struct gmCostStats {
+  unsigned long long total_iteration_count;
+
+  /**
+   * Share of the pixels whose iteration count reached the max iteration count.
+   */
+  double limit_pixel_share;
+
+  /**
+   * Pixel counts by iterations executed.  The first bin counts the pixels
+   * which were not iterated, the bin of index `i` the pixels which took from
+   * `2^(i - 1)` to `2^i - 1` iterations, the last bin taking the larger costs.
+   */
+  unsigned long long histogram[GM_COST_HISTOGRAM_BIN_COUNT];
+} gmCostStats;
+
+/**
+ * Describes how the image was rendered.
+ */
+typedef struct gmReport {
+  /**
+   * Settings the image was rendered with, lower than the requested ones when
+   * they did not fit in the time budget or in GPU memory.  Images rendered at
+   * a lower size are upscaled to the requested size.
+   */
+  gm_uint max_iteration_count;
+  gm_uint sample_count;
+  gmIntSize render_size;
+
+  /**
+   * Size of the tiles the image was rendered in, the render size when it was
+   * rendered whole.
+   */
+  gmIntSize tile_size;
+
+  /**
+   * Bytes of GPU memory the resources of a tile were estimated to take, and
+   * the bytes they were planned to fit in.  Both are 0 when no memory was
+   * planned, for the CPU backend, iteration files and Deep Zoom images.
+   */
+  unsigned long long estimated_gpu_memory;
+  unsigned long long available_gpu_memory;
+
+  /**
+   * Seconds the render was estimated to take, 0 without time budget.
+   */
+  double estimated_render_time;
+
+  /**
+   * Seconds the render took, not including writing the image file unless it
+   * is written while rendering.
+   */
+  double render_time;
+
+  /**
+   * Only filled when the cost of the render is recorded, set to 0 otherwise.
+   */
+  gmCostStats cost_stats;
+} gmReport;
+
+typedef enum gmImageFormat {
+  /**
+   * Resolves to PNG.
+   */
+  gmImageFormat_Default,
+
+  gmImageFormat_Png,
+
+  /**
+   * Raw iteration counts and orbit magnitudes laid out in tiles, described in
+   * `gm/iterations.h`.  Tiles are written as soon as they are rendered, so
+   * that large images stream to the disk.  Only the escape-time engine can
+   * write them, progressive renders skip the preview.
+   */
+  gmImageFormat_Iterations,
+
+  /**
+   * Deep Zoom pyramid of 256x256 PNG tiles: the output path receives the DZI
+   * manifest, "image.dzi" storing its tiles in "image_files".  The finest
+   * level is rendered tile by tile at the requested quality, ignoring the
+   * time budget, the coarser levels are downsampled from it.  Only the
+   * escape-time engine can write them, progressive renders skip the preview.
+   */
+  gmImageFormat_DeepZoom,
+
+  /**
+   * Uncompressed formats, whose files are created at their final size and
+   * mapped so that the pixels are read back from the GPU, or rendered on the
+   * CPU, straight into the file.  TGA files are limited to 65535x65535.
+   */
+  gmImageFormat_Ppm,
+  gmImageFormat_Pam,
+  gmImageFormat_Bmp,
+  gmImageFormat_Tga,
+
+  /**
+   * Quite OK Image format, lossless like PNG but encoded several times
+   * faster, for the outputs read back by tools rather than published.
+   */
+  gmImageFormat_Qoi
+} gmImageFormat;
+
+typedef enum gmStreamFormat {
+  /**
+   * Resolves to Y4M.
+   */
+  gmStreamFormat_Default,
+
+  /**
+   * YUV4MPEG2 stream of 4:2:0 frames in full range BT.601, which video
+   * encoders read directly.
+   */
+  gmStreamFormat_Y4m,
+
+  /**
+   * Tightly packed RGB frames after a 32-byte text header, "RGB24 W H FPS"
+   * padded with spaces and ending with a newline.
+   */
+  gmStreamFormat_Rgb24
+} gmStreamFormat;
+
+typedef struct gmStreamConfig {
+  gmStreamFormat format;
+
+  /**
+   * Leaving the frame rate at 0 uses 30 frames per second.
+   */
+  gm_uint frame_rate;
+} gmStreamConfig;
+
+/**
+ * Frames of the same size written one after the other to a file or a pipe,
+ * the header being written with the first frame.  Rows are written in the same
+ * order as in PNG images.
+ */
+typedef struct gmFrameStream gmFrameStream;
+
+/**
+ * Opens a stream on the specified file, or on the standard output when the
+ * path is NULL.  Leaving the config at NULL opens a Y4M stream.
+ */
+gmError gmOpenFrameStream(gmFrameStream **stream, const char *filepath,
+                          const gmStreamConfig *config);
+
+/**
+ * Flushes the frames and closes the stream.
+ */
+gmError gmCloseFrameStream(gmFrameStream *stream);
+
+/**
+ * Timeline of the stages of the renders recording into it, from the context
+ * setup to the file writes, with the threads running them and the GPU time of
+ * the draws.  It is written as Chrome trace events, which Perfetto opens.  A
+ * trace can be shared by concurrent renders.
+ */
+typedef struct gmTrace gmTrace;
+
+/**
+ * Creates the file of the trace, its events being written when it is closed.
+ */
+gmError gmOpenTrace(gmTrace **trace, const char *filepath);
+
+/**
+ * Writes the events of the trace to its file and deletes the trace.
+ */
+gmError gmCloseTrace(gmTrace *trace);
+
+/**
+ * Additional output of a render, such as a preview or a thumbnail, scaled
+ * from the rendered image rather than rendered again.
+ */
+typedef struct gmOutputTarget {
+  const char *filepath;
+
+  /**
+   * Iteration files and Deep Zoom images are not supported.
+   */
+  gmImageFormat format;
+
+  /**
+   * Leaving the size at 0 uses the size of the image, leaving only one side
+   * at 0 keeps the aspect ratio of the image.
+   */
+  gmIntSize size;
+} gmOutputTarget;
+
 typedef struct gmConfig {
   const char *image_output_filepath;
+  gmImageFormat image_format;
   gmImageConfig image_config;
+
+  /**
+   * Seconds the render should fit in.  The escape-time engine estimates the
+   * cost of the image with a low resolution probe, then lowers the max
+   * iteration count and the resolution until the estimate fits.  The sample
+   * count is kept, since the kernel runs once per pixel whatever the sample
+   * count.  Leaving it at 0 renders at the requested quality.
+   */
+  double time_budget;
+
+  /**
+   * Receives the report of the render when not NULL.
+   */
+  gmReport *report;
+
+  /**
+   * Profile written by `gmTune`, leaving it at NULL uses the default one.  The
+   * settings left at their default value take the fastest values measured on
+   * the host, when the profile contains them.
+   */
+  const char *profile_filepath;
+
+  /**
+   * When not NULL, the iterations executed for each pixel of the render are
+   * recorded and written there as a PNG heatmap at the render size, their
+   * summary being added to the report.  Only escape-time images are recorded,
+   * not iteration files.
+   */
+  const char *cost_output_filepath;
+
+  /**
+   * When not NULL, the image is written to the stream as its next frame
+   * instead of being written to the output file, the image format being left
+   * to PNG.  A stream cannot be shared by concurrent renders.
+   */
+  gmFrameStream *frame_stream;
+
+  /**
+   * Outputs written along with the image, downsampled from it and encoded on
+   * worker threads while the image is written.  Iteration files and Deep
+   * Zoom images have no outputs.  The thread count of the CPU config sets the
+   * number of workers.
+   */
+  const gmOutputTarget *output_targets;
+  gm_uint output_target_count;
+
+  /**
+   * When not NULL, the stages of the render are recorded in the trace.
+   * Nothing is recorded otherwise.
+   */
+  gmTrace *trace;
 } gmConfig;
 
+#define GM_DEFAULT_PROFILE_FILEPATH "gm-profile.txt"
+
 /**
  * Renders the Mandelbrot set image using the specified config.
  */
 gmError gmRun(const gmConfig *config);
+
+/**
+ * Image of a batch, rendered with the size and max iteration count shared by
+ * the images of the batch.
+ */
+typedef struct gmBatchImage {
+  const char *output_filepath;
+
+  /**
+   * Leaving the size at 0 uses the default viewport, which is centered on 0
+   * and 4 wide for Julia sets.
+   */
+  gmViewport viewport;
+
+  /**
+   * When set, the image shows the Julia set of the constant `julia_c` instead
+   * of the Mandelbrot set.
+   */
+  int is_julia;
+  double julia_c_x;
+  double julia_c_y;
+} gmBatchImage;
+
+typedef struct gmBatchConfig {
+  const gmBatchImage *images;
+  gm_uint image_count;
+
+  /**
+   * Only the size and the max iteration count are used, along with the thread
+   * count of the CPU config for the threads encoding the PNG files.
+   */
+  gmImageConfig image_config;
+} gmBatchConfig;
+
+/**
+ * Renders many small images, such as parameter sweeps or atlases of Julia
+ * sets, as PNG files with the OpenGL backend.  Up to 256 images are rendered
+ * by a single instanced draw into the layers of an array texture, which is
+ * read back in one transfer.  The images are then encoded on a thread pool
+ * while the GPU renders the next ones.
+ */
+gmError gmRunBatch(const gmBatchConfig *config);
+
+/**
+ * Benchmarks the backends, algorithms and thread counts on representative
+ * viewports, then saves the fastest settings for this host to the specified
+ * profile, the default one when NULL.  Profiles are keyed by CPU model and
+ * OpenGL renderer, several hosts can share the same file.
+ */
+gmError gmTune(const char *profile_filepath);
+
+/**
+ * Runs the submitted renders on its workers, each worker running its renders
+ * one after the other on its own thread.  A worker owns an OpenGL context and
+ * the resources of its last render, which are reused by the next renders of
+ * the same size, sample count and algorithm.  Queues, `gmRun`, `gmRunBatch`
+ * and `gmTune` each render with their own contexts, so they can run at the
+ * same time.
+ */
+typedef struct gmRenderQueue gmRenderQueue;
+
+typedef struct gmRenderQueueConfig {
+  /**
+   * 0 creates a single worker.  Drivers rendering on the CPU, like llvmpipe,
+   * render faster with one worker per core.
+   */
+  gm_uint worker_count;
+
+  /**
+   * When not NULL, the worker of index `i` only runs on the processor of index
+   * `worker_processors[i]`, the array holding one index per worker.
+   */
+  const int *worker_processors;
+} gmRenderQueueConfig;
+
+/**
+ * Render submitted to a render queue.
+ */
+typedef struct gmJob gmJob;
+
+/**
+ * Called on the thread of the worker which ran the job once it is done, it
+ * must not wait for jobs.
+ */
+typedef void (*gmCompletionFunc)(gmJob *job, gmError error, void *user_data);
+
+/**
+ * Leaving the config at NULL creates the default queue.
+ */
+gmError gmCreateRenderQueue(gmRenderQueue **queue,
+                            const gmRenderQueueConfig *config);
+
+/**
+ * Waits for the submitted jobs to be done, then deletes the queue and its
+ * context.  The jobs still have to be waited for.
+ */
+void gmDeleteRenderQueue(gmRenderQueue *queue);
+
+/**
+ * Queues a render on the worker with the fewest pending renders and returns
+ * right away.  Every submitted job must be waited for with `gmWait`, which
+ * releases it.
+ *
+ * Only the config itself is copied, the worker reads what it points to while
+ * it renders.  The filepaths, the report, the frame stream, the output
+ * targets and the trace, along with the region rects and mask, the cancel
+ * flag and the user data of the preview and progress functions of the image
+ * config, must stay valid until the job is done, that is until `gmWait`
+ * returns or the completion function is called.
+ *
+ * @param on_completion Called once the job is done, may be NULL.
+ */
+gmError gmSubmit(gmRenderQueue *queue, const gmConfig *config,
+                 gmCompletionFunc on_completion, void *user_data, gmJob **job);
+
+/**
+ * Checks whether the job is done without blocking.
+ *
+ * @param error Receives the error of the job once done, may be NULL.
+ * @return Whether the job is done.
+ */
+int gmPoll(const gmJob *job, gmError *error);
+
+/**
+ * Eventfd becoming readable once the job is done, to be watched by event
+ * loops.  It is closed by `gmWait`.
+ */
+int gmGetJobFd(const gmJob *job);
+
+/**
+ * Blocks until the job is done, then releases it.
+ *
+ * @return The error of the job.
+ */
+gmError gmWait(gmJob *job);
+
+/**
+ * Work done by a distributed worker during a render.
+ */
+typedef struct gmWorkerReport {
+  gm_uint tile_count;
+
+  /**
+   * Tiles also requested from another worker because this one was slow, the
+   * first result received is kept.
+   */
+  gm_uint duplicate_tile_count;
+
+  gm_uint failure_count;
+  double tiles_per_second;
+} gmWorkerReport;
+
+typedef struct gmDistributedConfig {
+  /**
+   * "unix:PATH" or "tcp:HOST:PORT" addresses of workers started with
+   * `gmServe`.
+   */
+  const char *const *worker_addresses;
+  gm_uint worker_count;
+
+  /**
+   * Receives one report per worker, may be NULL.
+   */
+  gmWorkerReport *worker_reports;
+} gmDistributedConfig;
+
+/**
+ * Renders the image with the CPUs of remote workers, tile by tile.  Only the
+ * size, viewport and max iteration count of the image config are used, and
+ * the image format must be PNG or iterations.  Tiles of failed workers are
+ * requested again from the others.
+ */
+gmError gmRunDistributed(const gmConfig *config,
+                         const gmDistributedConfig *distributed_config);
+
+/**
+ * Computes the tiles requested by coordinators on the specified address, one
+ * coordinator at a time.  Only returns on failure.
+ */
+gmError gmServe(const char *address);
@@ -0,0 +1,45 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include <stdint.h>
+
+// Layout of the files written with `gmImageFormat_Iterations`, meant to be
+// memory-mapped by readers.  Values are stored in the byte order of the host
+// that wrote them.
+//
+// The header is followed by the index of the tiles, one 64-bit byte offset
+// per tile.  Tiles are listed row by row, starting with the bottom left one.
+// Each tile holds `tile_size * tile_size` pixels, row by row from its bottom,
+// made of `channel_count` 32-bit floats: the iteration count, then the squared
+// magnitude of the last point of the orbit.  Tile offsets are multiples of
+// `GM_ITERATION_FILE_ALIGNMENT`, and the pixels of the last tiles outside of
+// the image are set to 0.
+
+#define GM_ITERATION_FILE_MAGIC "GMITERS1"
+#define GM_ITERATION_FILE_TILE_SIZE 64
+#define GM_ITERATION_FILE_ALIGNMENT 4096
+
+typedef struct gmIterationFileHeader {
+  char magic[8];
+  uint32_t header_size;
+  uint32_t width;
+  uint32_t height;
+  uint32_t tile_size;
+  uint32_t tile_column_count;
+  uint32_t tile_row_count;
+  uint32_t channel_count;
+  uint32_t max_iteration_count;
+
+  /**
+   * Viewport of the image in the complex plane, after resolving the default
+   * one.
+   */
+  double viewport_center_x;
+  double viewport_center_y;
+  double viewport_width;
+  double viewport_height;
+
+  uint64_t index_offset;
+} gmIterationFileHeader;
@@ -0,0 +1,243 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "budget.h"
+
+#include <stdlib.h>
+#include <string.h>  // For memset.
+
+#include "clock.h"
+#include "cpu/kernel.h"
+#include "gm/gm.h"
+#include "image-config.h"
+#include "setup.h"
+
+/**
+ * Width of the probe, its height follows the aspect ratio of the image.
+ */
+#define GM_PROBE_WIDTH_ 64
+
+/**
+ * Keeps the probe cheap for deep renders.
+ */
+#define GM_PROBE_ITERATION_LIMIT_ 1024
+
+// The iteration count is first lowered down to this fraction of the requested
+// one, then the size down to this fraction of the requested one, then the
+// iteration count down to the minimum.
+#define GM_MIN_ITERATION_COUNT_FRACTION_ 4
+#define GM_MIN_SIZE_FRACTION_ 8
+#define GM_MIN_ITERATION_COUNT_ 16
+
+void gmCreateCostProbe_(GM_OUT_PARAM gmCostProbe_ *probe,
+                        const gmImageConfig *image_config) {
+  const gmIntSize *const kSize = &image_config->size;
+
+  gmImageConfig probe_image_config = *image_config;
+  probe_image_config.size.w = GM_PROBE_WIDTH_ < kSize->w ? GM_PROBE_WIDTH_
+                                                         : kSize->w;
+  probe_image_config.size.h = kSize->h * probe_image_config.size.w / kSize->w;
+  if (probe_image_config.size.h < 1) {
+    probe_image_config.size.h = 1;
+  }
+
+  const gm_uint kMaxIterationCount = gmGetMaxIterationCount_(image_config);
+  probe->iteration_limit = kMaxIterationCount < GM_PROBE_ITERATION_LIMIT_
+                               ? kMaxIterationCount
+                               : GM_PROBE_ITERATION_LIMIT_;
+
+  const gmIntSize *const kProbeSize = &probe_image_config.size;
+  probe->pixel_count = (size_t)kProbeSize->w * kProbeSize->h;
+  probe->iteration_counts = malloc(probe->pixel_count * sizeof(gm_uint));
+
+  gmPixelMapping_ mapping;
+  gmGetPixelMapping_(&mapping, &probe_image_config);
+
+  const double kStartTime = gmGetTime_();
+  unsigned long long iteration_count = 0;
+
+  for (int y = 0; y < kProbeSize->h; ++y) {
+    for (int x = 0; x < kProbeSize->w; ++x) {
+      const gm_uint kIterationCount = gmComputeIterationCount_(
+          mapping.origin_x + x * mapping.step_x,
+          mapping.origin_y + y * mapping.step_y, probe->iteration_limit);
+
+      probe->iteration_counts[(size_t)y * kProbeSize->w + x] = kIterationCount;
+      iteration_count += kIterationCount + 1;  // The last test is an iteration.
+    }
+  }
+
+  const double kElapsedTime = gmGetTime_() - kStartTime;
+
+  // Prevents dividing by 0 with coarse clocks.
+  probe->cpu_iteration_rate =
+      iteration_count / (kElapsedTime > 1e-6 ? kElapsedTime : 1e-6);
+}
+
+void gmDeleteCostProbe_(const gmCostProbe_ *probe) {
+  free(probe->iteration_counts);
+}
+
+void gmInitReport_(GM_OUT_PARAM gmReport *report,
+                   const gmImageConfig *image_config) {
+  report->max_iteration_count = gmGetMaxIterationCount_(image_config);
+  report->sample_count = image_config->sample_count;
+  report->render_size = image_config->size;
+  report->tile_size = image_config->size;
+  report->estimated_gpu_memory = 0;
+  report->available_gpu_memory = 0;
+  report->estimated_render_time = 0.0;
+  report->render_time = 0.0;
+  memset(&report->cost_stats, 0, sizeof(gmCostStats));
+}
+
+double gmEstimateRenderTime_(const gmImageConfig *image_config,
+                             const gmCostProbe_ *probe, double iteration_rate);
+
+void gmFitMaxIterationCount_(GM_OUT_PARAM gmImageConfig *image_config,
+                             const gmCostProbe_ *probe, double iteration_rate,
+                             double time_budget, gm_uint min_iteration_count);
+
+void gmFitImageConfigInTimeBudget_(GM_OUT_PARAM gmImageConfig *image_config,
+                                   GM_OUT_PARAM gmReport *report,
+                                   const gmCostProbe_ *probe,
+                                   double iteration_rate, double time_budget) {
+  const gm_uint kMaxIterationCount = gmGetMaxIterationCount_(image_config);
+  const gmIntSize kSize = image_config->size;
+
+  image_config->max_iteration_count = kMaxIterationCount;
+
+  const gm_uint kMinIterationCount =
+      kMaxIterationCount < GM_MIN_ITERATION_COUNT_ ? kMaxIterationCount
+                                                   : GM_MIN_ITERATION_COUNT_;
+
+  gm_uint iteration_count_floor =
+      kMaxIterationCount / GM_MIN_ITERATION_COUNT_FRACTION_;
+  if (iteration_count_floor < kMinIterationCount) {
+    iteration_count_floor = kMinIterationCount;
+  }
+
+  gmFitMaxIterationCount_(image_config, probe, iteration_rate, time_budget,
+                          iteration_count_floor);
+
+  // The region is given in pixels of the requested size.
+  gmIntSize *const kRenderSize = &image_config->size;
+  while (!gmHasRegion_(image_config) &&
+         (kRenderSize->w * GM_MIN_SIZE_FRACTION_ > kSize.w) &&
+         (kRenderSize->h * GM_MIN_SIZE_FRACTION_ > kSize.h) &&
+         (gmEstimateRenderTime_(image_config, probe, iteration_rate) >
+          time_budget)) {
+    kRenderSize->w = (kRenderSize->w + 1) / 2;
+    kRenderSize->h = (kRenderSize->h + 1) / 2;
+  }
+
+  gmFitMaxIterationCount_(image_config, probe, iteration_rate, time_budget,
+                          kMinIterationCount);
+
+  report->max_iteration_count = image_config->max_iteration_count;
+  report->sample_count = image_config->sample_count;
+  report->render_size = image_config->size;
+  report->tile_size = image_config->size;
+  report->estimated_render_time =
+      gmEstimateRenderTime_(image_config, probe, iteration_rate);
+}
+
+double gmEstimateRenderTime_(const gmImageConfig *image_config,
+                             const gmCostProbe_ *probe, double iteration_rate) {
+  const gm_uint kMaxIterationCount = image_config->max_iteration_count;
+
+  unsigned long long iteration_count = 0;
+  for (size_t i = 0; i < probe->pixel_count; ++i) {
+    const gm_uint kProbeCount = probe->iteration_counts[i];
+
+    const int kReachedLimit = kProbeCount >= probe->iteration_limit;
+    const gm_uint kCount = kReachedLimit || (kProbeCount > kMaxIterationCount)
+                               ? kMaxIterationCount
+                               : kProbeCount;
+
+    iteration_count += kCount + 1;
+  }
+
+  // The sample count is left out: the CPU backend ignores it, and the
+  // fragment shader runs once per pixel whatever the sample count.
+  const gmIntSize *const kSize = &image_config->size;
+  const double kPixelIterationCount =
+      (double)iteration_count / probe->pixel_count;
+
+  return kPixelIterationCount * kSize->w * kSize->h / iteration_rate;
+}
+
+/**
+ * Picks the largest max iteration count fitting in the budget, without going
+ * under the specified minimum.  The estimate grows with the max iteration
+ * count, which is found by bisection.
+ */
+void gmFitMaxIterationCount_(GM_OUT_PARAM gmImageConfig *image_config,
+                             const gmCostProbe_ *probe, double iteration_rate,
+                             double time_budget, gm_uint min_iteration_count) {
+  if ((image_config->max_iteration_count <= min_iteration_count) ||
+      (gmEstimateRenderTime_(image_config, probe, iteration_rate) <=
+       time_budget)) {
+    return;
+  }
+
+  gm_uint low = min_iteration_count;
+  gm_uint high = image_config->max_iteration_count;
+
+  while (high - low > 1) {
+    image_config->max_iteration_count = low + (high - low) / 2;
+
+    if (gmEstimateRenderTime_(image_config, probe, iteration_rate) <=
+        time_budget) {
+      low = image_config->max_iteration_count;
+    } else {
+      high = image_config->max_iteration_count;
+    }
+  }
+
+  image_config->max_iteration_count = low;
+}
+
+void gmResizeImage_(GM_OUT_PARAM unsigned char *image_data,
+                    const gmIntSize *size, const unsigned char *source_data,
+                    const gmIntSize *source_size) {
+  const double kScaleX = (double)source_size->w / size->w;
+  const double kScaleY = (double)source_size->h / size->h;
+
+  for (int y = 0; y < size->h; ++y) {
+    // Pixel centers are aligned, then clamped to the source edges.
+    double source_y = (y + 0.5) * kScaleY - 0.5;
+    source_y = source_y > 0.0 ? source_y : 0.0;
+
+    int y0 = (int)source_y;
+    y0 = y0 < source_size->h - 1 ? y0 : source_size->h - 1;
+    const int kY1 = y0 + 1 < source_size->h ? y0 + 1 : y0;
+    const double kWeightY = source_y - y0 < 1.0 ? source_y - y0 : 1.0;
+
+    for (int x = 0; x < size->w; ++x) {
+      double source_x = (x + 0.5) * kScaleX - 0.5;
+      source_x = source_x > 0.0 ? source_x : 0.0;
+
+      int x0 = (int)source_x;
+      x0 = x0 < source_size->w - 1 ? x0 : source_size->w - 1;
+      const int kX1 = x0 + 1 < source_size->w ? x0 + 1 : x0;
+      const double kWeightX = source_x - x0 < 1.0 ? source_x - x0 : 1.0;
+
+      const unsigned char *const kRow0 =
+          source_data + (size_t)y0 * source_size->w * 3;
+      const unsigned char *const kRow1 =
+          source_data + (size_t)kY1 * source_size->w * 3;
+
+      for (int c = 0; c < 3; ++c) {
+        const double kTop = kRow0[x0 * 3 + c] * (1.0 - kWeightX) +
+                            kRow0[kX1 * 3 + c] * kWeightX;
+        const double kBottom = kRow1[x0 * 3 + c] * (1.0 - kWeightX) +
+                               kRow1[kX1 * 3 + c] * kWeightX;
+
+        image_data[((size_t)y * size->w + x) * 3 + c] =
+            (unsigned char)(kTop * (1.0 - kWeightY) + kBottom * kWeightY +
+                            0.5);
+      }
+    }
+  }
+}
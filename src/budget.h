@@ -0,0 +1,60 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include <stddef.h>
+
+#include "gm/gm.h"
+#include "setup.h"
+
+/**
+ * Iteration counts of a low resolution image of the viewport, from which the
+ * cost of the full image is estimated.
+ */
+typedef struct gmCostProbe_ {
+  gm_uint *iteration_counts;
+  size_t pixel_count;
+
+  /**
+   * The probe stops iterating there, pixels reaching it are assumed to reach
+   * the max iteration count of the full image.
+   */
+  gm_uint iteration_limit;
+
+  /**
+   * Iterations per second computed by a single CPU thread while probing.
+   */
+  double cpu_iteration_rate;
+} gmCostProbe_;
+
+void gmCreateCostProbe_(GM_OUT_PARAM gmCostProbe_ *probe,
+                        const gmImageConfig *image_config);
+
+void gmDeleteCostProbe_(const gmCostProbe_ *probe);
+
+/**
+ * Fills the report with the requested settings of the image config.
+ */
+void gmInitReport_(GM_OUT_PARAM gmReport *report,
+                   const gmImageConfig *image_config);
+
+/**
+ * Lowers the max iteration count and the size of the image config, in this
+ * order, until the estimated render time fits in the budget.  The sample count
+ * is kept, the kernels running once per pixel whatever the sample count.
+ * The settings chosen are written to the report.
+ *
+ * @param iteration_rate Iterations per second of the backend.
+ */
+void gmFitImageConfigInTimeBudget_(GM_OUT_PARAM gmImageConfig *image_config,
+                                   GM_OUT_PARAM gmReport *report,
+                                   const gmCostProbe_ *probe,
+                                   double iteration_rate, double time_budget);
+
+/**
+ * Bilinearly scales tightly packed RGB data.
+ */
+void gmResizeImage_(GM_OUT_PARAM unsigned char *image_data,
+                    const gmIntSize *size, const unsigned char *source_data,
+                    const gmIntSize *source_size);
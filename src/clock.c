@@ -0,0 +1,15 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "clock.h"
+
+#include <time.h>
+
+#include "setup.h"
+
+double gmGetTime_() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+
+  return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+}
@@ -0,0 +1,12 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "setup.h"
+
+/**
+ * @return The seconds elapsed since an arbitrary point in time, from a
+ * monotonic clock.
+ */
+double gmGetTime_();
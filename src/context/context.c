@@ -7,27 +7,62 @@
 
 #include <GLFW/glfw3.h>
 #include <glad/glad.h>
+#include <pthread.h>
 
 #include "gm/error.h"
 #include "setup.h"
 
+// GLFW is initialized along with the first context of the process and
+// terminated along with its last one, the contexts of render queues living
+// alongside the contexts of the other renders.  The count is protected by the
+// mutex, which also keeps GLFW from being terminated while another thread
+// creates its contexts.
+pthread_mutex_t gmGlfwMutex_ = PTHREAD_MUTEX_INITIALIZER;
+size_t gmGlfwContextCount_ = 0;
+
 gmError gmInitGlfw_();
 gmError gmLoadGl_(GM_OUT_PARAM gmContext_ *context);
 
 void gmCleanupGlfw_();
 
 gmError gmCreateContext_(GM_OUT_PARAM gmContext_ *context) {
-  gmError error;
+  return gmCreateContexts_(context, 1);
+}
+
+void gmDeleteWindow_(const gmWindow_ *window);
+
+gmError gmCreateContexts_(GM_OUT_PARAM gmContext_ *contexts, size_t count) {
+  gmError error = gmError_Success;
+
+  pthread_mutex_lock(&gmGlfwMutex_);
+
+  if (!gmGlfwContextCount_) {
+    error = gmInitGlfw_();
+  }
 
-  // GLFW is initialized here because we're only using one context.
-  error = gmInitGlfw_();
   if (!error) {
-    error = gmLoadGl_(context);
+    size_t created_count = 0;
+    for (; created_count < count; ++created_count) {
+      error = gmLoadGl_(&contexts[created_count]);
+      if (error) {
+        break;  // The failed context already deleted its window.
+      }
+    }
+
     if (error) {
-      gmCleanupGlfw_();
+      for (size_t i = 0; i < created_count; ++i) {
+        gmDeleteWindow_(&contexts[i].window);
+      }
+
+      if (!gmGlfwContextCount_) {
+        gmCleanupGlfw_();
+      }
+    } else {
+      gmGlfwContextCount_ += count;
     }
   }
 
+  pthread_mutex_unlock(&gmGlfwMutex_);
   return error;
 }
 
@@ -38,8 +73,6 @@ gmError gmInitGlfw_() {
 gmError gmCreateWindow_(GM_OUT_PARAM gmWindow_ *output_window);
 gmError gmGladLoadGl_(const gmContext_ *context);
 
-void gmDeleteWindow_(const gmWindow_ *window);
-
 gmError gmLoadGl_(GM_OUT_PARAM gmContext_ *context) {
   gmError error;
 
@@ -92,10 +125,22 @@ void gmCleanupGlfw_() {
 }
 
 void gmDeleteContext_(const gmContext_ *context) {
-  glfwDestroyWindow(context->window);
+  gmDeleteContexts_(context, 1);
+}
 
-  // GLFW is cleaned up here because we're only using one context.
-  gmCleanupGlfw_();
+void gmDeleteContexts_(const gmContext_ *contexts, size_t count) {
+  pthread_mutex_lock(&gmGlfwMutex_);
+
+  for (size_t i = 0; i < count; ++i) {
+    gmDeleteWindow_(&contexts[i].window);
+  }
+
+  gmGlfwContextCount_ -= count;
+  if (!gmGlfwContextCount_) {
+    gmCleanupGlfw_();
+  }
+
+  pthread_mutex_unlock(&gmGlfwMutex_);
 }
 
 void gmClearCurrentContext_() {
@@ -105,3 +150,23 @@ void gmClearCurrentContext_() {
 void gmMakeContextCurrent_(const gmContext_ *context) {
   glfwMakeContextCurrent(context->window);
 }
+
+gmError gmUseLazyContext_(gmLazyContext_ *lazy_context) {
+  if (!lazy_context->is_created) {
+    const gmError kError = gmCreateContext_(&lazy_context->context);
+    if (kError) {
+      return kError;
+    }
+
+    lazy_context->is_created = 1;
+  }
+
+  gmMakeContextCurrent_(&lazy_context->context);
+  return gmError_Success;
+}
+
+void gmDeleteLazyContext_(const gmLazyContext_ *lazy_context) {
+  if (lazy_context->is_created) {
+    gmDeleteContext_(&lazy_context->context);
+  }
+}
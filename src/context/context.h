@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <stddef.h>
+
 #include "gm/error.h"
 #include "setup.h"
 
@@ -15,5 +17,32 @@ typedef struct gmContext_ {
 gmError gmCreateContext_(GM_OUT_PARAM gmContext_ *context);
 void gmDeleteContext_(const gmContext_ *context);
 
+/**
+ * Creates several contexts, which can be made current on different threads.
+ * They must be created and deleted on the same thread.  GLFW stays
+ * initialized while any context of the process exists.
+ */
+gmError gmCreateContexts_(GM_OUT_PARAM gmContext_ *contexts, size_t count);
+void gmDeleteContexts_(const gmContext_ *contexts, size_t count);
+
 void gmClearCurrentContext_();
 void gmMakeContextCurrent_(const gmContext_ *context);
+
+/**
+ * Context created by its first use and kept for the next ones, so that a
+ * thread running several renders only creates it once.
+ */
+typedef struct gmLazyContext_ {
+  gmContext_ context;
+  int is_created;
+} gmLazyContext_;
+
+/**
+ * Creates the context on the first call, then makes it current.
+ */
+gmError gmUseLazyContext_(gmLazyContext_ *lazy_context);
+
+/**
+ * Deletes the context if it was created.
+ */
+void gmDeleteLazyContext_(const gmLazyContext_ *lazy_context);
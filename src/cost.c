@@ -0,0 +1,93 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "cost.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>  // For memset.
+
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "png.h"
+#include "setup.h"
+
+size_t gmGetCostHistogramBin_(double cost);
+
+void gmComputeCostStats_(GM_OUT_PARAM gmCostStats *stats,
+                         const float *cost_data, const gmIntSize *size,
+                         gm_uint max_iteration_count) {
+  memset(stats, 0, sizeof(gmCostStats));
+
+  const size_t kPixelCount = (size_t)size->w * size->h;
+  if (!kPixelCount) {
+    return;
+  }
+
+  // Summed in double precision, the hierarchical renders spreading the cost
+  // of their blocks over fractions of iterations.
+  double total_cost = 0.0;
+  size_t limit_pixel_count = 0;
+
+  for (size_t i = 0; i < kPixelCount; ++i) {
+    const double kCost = cost_data[i * 2];
+    const double kIterationCount = cost_data[i * 2 + 1];
+
+    total_cost += kCost;
+    limit_pixel_count += kIterationCount >= max_iteration_count;
+    ++stats->histogram[gmGetCostHistogramBin_(kCost)];
+  }
+
+  stats->total_iteration_count = (unsigned long long)llround(total_cost);
+  stats->limit_pixel_share = (double)limit_pixel_count / kPixelCount;
+}
+
+size_t gmGetCostHistogramBin_(double cost) {
+  if (cost < 1.0) {
+    return 0;
+  }
+
+  const size_t kBin = (size_t)floor(log2(cost)) + 1;
+  return kBin < GM_COST_HISTOGRAM_BIN_COUNT ? kBin
+                                            : GM_COST_HISTOGRAM_BIN_COUNT - 1;
+}
+
+void gmCostToRgb_(GM_OUT_PARAM unsigned char *rgb, double cost,
+                  double max_log_cost);
+
+gmError gmWriteCostImage_(const char *filepath, const float *cost_data,
+                          const gmIntSize *size) {
+  const size_t kPixelCount = (size_t)size->w * size->h;
+
+  double max_cost = 0.0;
+  for (size_t i = 0; i < kPixelCount; ++i) {
+    max_cost = fmax(max_cost, cost_data[i * 2]);
+  }
+
+  // Costs span several orders of magnitude, the cheap pixels would be black
+  // on a linear scale.
+  const double kMaxLogCost = log1p(max_cost);
+
+  unsigned char *const kImageData = malloc(kPixelCount * 3);  // RGB.
+  for (size_t i = 0; i < kPixelCount; ++i) {
+    gmCostToRgb_(&kImageData[i * 3], cost_data[i * 2], kMaxLogCost);
+  }
+
+  const gmError kError =
+      gmWritePngImage_(filepath, kImageData, size, (size_t)size->w * 3);
+
+  free(kImageData);
+  return kError;
+}
+
+void gmCostToRgb_(GM_OUT_PARAM unsigned char *rgb, double cost,
+                  double max_log_cost) {
+  const double kT = max_log_cost > 0.0 ? log1p(cost) / max_log_cost : 0.0;
+
+  // Black to red, red to yellow, then yellow to white.
+  const double kChannels[3] = {kT * 3.0, kT * 3.0 - 1.0, kT * 3.0 - 2.0};
+
+  for (int i = 0; i < 3; ++i) {
+    rgb[i] = (unsigned char)(fmin(fmax(kChannels[i], 0.0), 1.0) * 255.0);
+  }
+}
@@ -0,0 +1,23 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "setup.h"
+
+/**
+ * Summarizes the cost data of a render, laid out like `gmReadCostData_`.
+ */
+void gmComputeCostStats_(GM_OUT_PARAM gmCostStats *stats,
+                         const float *cost_data, const gmIntSize *size,
+                         gm_uint max_iteration_count);
+
+/**
+ * Writes the cost data as a PNG heatmap, on a logarithmic scale going from
+ * black for the pixels which were not iterated to white for the most expensive
+ * pixel.  The rows are written in the same order as the image.
+ */
+gmError gmWriteCostImage_(const char *filepath, const float *cost_data,
+                          const gmIntSize *size);
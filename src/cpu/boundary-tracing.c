@@ -0,0 +1,241 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "boundary-tracing.h"
+
+#include <stdlib.h>
+
+#include "cpu.h"
+#include "gm/gm.h"
+#include "setup.h"
+#include "thread-pool.h"
+
+/**
+ * Rectangles smaller than this in either direction have their inside computed
+ * pixel by pixel.
+ */
+#define GM_MIN_TRACED_SIZE_ 8
+
+/**
+ * Distance between the pixels computed inside a rectangle by checked tracing.
+ */
+#define GM_CHECK_STEP_ 4
+
+/**
+ * Inclusive pixel bounds.
+ */
+typedef struct gmRectangle_ {
+  int x0;
+  int y0;
+  int x1;
+  int y1;
+} gmRectangle_;
+
+typedef struct gmBoundaryTracer_ {
+  const gmIterationImage_ *image;
+  gmThreadPool_ *pool;
+  int checked;
+} gmBoundaryTracer_;
+
+void gmComputeBorder_(const gmIterationImage_ *image,
+                      const gmRectangle_ *rectangle);
+
+void gmSubmitRectangle_(const gmBoundaryTracer_ *tracer,
+                        const gmRectangle_ *rectangle);
+
+void gmTraceBoundaries_(const gmIterationImage_ *image, gmThreadPool_ *pool,
+                        int checked) {
+  const gmBoundaryTracer_ kTracer = {
+      .image = image, .pool = pool, .checked = checked};
+
+  const gmRectangle_ kImageRectangle = {
+      .x0 = 0, .y0 = 0, .x1 = image->size.w - 1, .y1 = image->size.h - 1};
+
+  // Rectangles are traced with their border already computed, which lets
+  // sibling rectangles share the line they were split along without ever
+  // computing a pixel twice.
+  gmComputeBorder_(image, &kImageRectangle);
+  gmSubmitRectangle_(&kTracer, &kImageRectangle);
+
+  gmWaitForTasks_(pool);
+}
+
+void gmComputeRow_(const gmIterationImage_ *image, int y, int x0, int x1);
+void gmComputeColumn_(const gmIterationImage_ *image, int x, int y0, int y1);
+
+void gmComputeBorder_(const gmIterationImage_ *image,
+                      const gmRectangle_ *rectangle) {
+  gmComputeRow_(image, rectangle->y0, rectangle->x0, rectangle->x1);
+
+  if (rectangle->y1 > rectangle->y0) {
+    gmComputeRow_(image, rectangle->y1, rectangle->x0, rectangle->x1);
+  }
+
+  gmComputeColumn_(image, rectangle->x0, rectangle->y0 + 1, rectangle->y1 - 1);
+
+  if (rectangle->x1 > rectangle->x0) {
+    gmComputeColumn_(image, rectangle->x1, rectangle->y0 + 1,
+                     rectangle->y1 - 1);
+  }
+}
+
+void gmComputeRow_(const gmIterationImage_ *image, int y, int x0, int x1) {
+  for (int x = x0; x <= x1; ++x) {
+    gmComputePixel_(image, x, y);
+  }
+}
+
+void gmComputeColumn_(const gmIterationImage_ *image, int x, int y0, int y1) {
+  for (int y = y0; y <= y1; ++y) {
+    gmComputePixel_(image, x, y);
+  }
+}
+
+typedef struct gmTraceTask_ {
+  const gmBoundaryTracer_ *tracer;
+  gmRectangle_ rectangle;
+} gmTraceTask_;
+
+void gmTraceRectangle_(void *trace_task, size_t worker_index);
+
+void gmSubmitRectangle_(const gmBoundaryTracer_ *tracer,
+                        const gmRectangle_ *rectangle) {
+  gmTraceTask_ *const kTask = malloc(sizeof(gmTraceTask_));
+  kTask->tracer = tracer;
+  kTask->rectangle = *rectangle;
+
+  gmSubmitTask_(tracer->pool, gmTraceRectangle_, kTask);
+}
+
+void gmComputeInside_(const gmIterationImage_ *image,
+                      const gmRectangle_ *rectangle);
+
+int gmHasUniformBorder_(const gmIterationImage_ *image,
+                        const gmRectangle_ *rectangle,
+                        GM_OUT_PARAM gm_uint *iteration_count);
+
+int gmCheckInside_(const gmIterationImage_ *image,
+                   const gmRectangle_ *rectangle, gm_uint iteration_count);
+
+void gmFillInside_(const gmIterationImage_ *image,
+                   const gmRectangle_ *rectangle, gm_uint iteration_count);
+
+void gmSplitRectangle_(const gmBoundaryTracer_ *tracer,
+                       const gmRectangle_ *rectangle);
+
+void gmTraceRectangle_(void *trace_task, size_t worker_index) {
+  (void)worker_index;
+
+  const gmTraceTask_ kTask = *(const gmTraceTask_ *)trace_task;
+  free(trace_task);
+
+  const gmIterationImage_ *const kImage = kTask.tracer->image;
+  const gmRectangle_ *const kRectangle = &kTask.rectangle;
+
+  const int kIsSmall =
+      (kRectangle->x1 - kRectangle->x0 < GM_MIN_TRACED_SIZE_) ||
+      (kRectangle->y1 - kRectangle->y0 < GM_MIN_TRACED_SIZE_);
+
+  gm_uint iteration_count;
+
+  if (kIsSmall) {
+    gmComputeInside_(kImage, kRectangle);
+  } else if (gmHasUniformBorder_(kImage, kRectangle, &iteration_count) &&
+             (!kTask.tracer->checked ||
+              gmCheckInside_(kImage, kRectangle, iteration_count))) {
+    gmFillInside_(kImage, kRectangle, iteration_count);
+  } else {
+    gmSplitRectangle_(kTask.tracer, kRectangle);
+  }
+}
+
+void gmComputeInside_(const gmIterationImage_ *image,
+                      const gmRectangle_ *rectangle) {
+  for (int y = rectangle->y0 + 1; y < rectangle->y1; ++y) {
+    gmComputeRow_(image, y, rectangle->x0 + 1, rectangle->x1 - 1);
+  }
+}
+
+gm_uint gmGetIterationCount_(const gmIterationImage_ *image, int x, int y);
+
+int gmHasUniformBorder_(const gmIterationImage_ *image,
+                        const gmRectangle_ *rectangle,
+                        GM_OUT_PARAM gm_uint *iteration_count) {
+  const gm_uint kCount =
+      gmGetIterationCount_(image, rectangle->x0, rectangle->y0);
+
+  for (int x = rectangle->x0; x <= rectangle->x1; ++x) {
+    if ((gmGetIterationCount_(image, x, rectangle->y0) != kCount) ||
+        (gmGetIterationCount_(image, x, rectangle->y1) != kCount)) {
+      return 0;
+    }
+  }
+
+  for (int y = rectangle->y0; y <= rectangle->y1; ++y) {
+    if ((gmGetIterationCount_(image, rectangle->x0, y) != kCount) ||
+        (gmGetIterationCount_(image, rectangle->x1, y) != kCount)) {
+      return 0;
+    }
+  }
+
+  *iteration_count = kCount;
+  return 1;
+}
+
+gm_uint gmGetIterationCount_(const gmIterationImage_ *image, int x, int y) {
+  return image->iteration_counts[(size_t)y * image->size.w + x];
+}
+
+int gmCheckInside_(const gmIterationImage_ *image,
+                   const gmRectangle_ *rectangle, gm_uint iteration_count) {
+  // The computed pixels are kept, filling the rectangle overwrites them with
+  // the same value.
+  for (int y = rectangle->y0 + GM_CHECK_STEP_; y < rectangle->y1;
+       y += GM_CHECK_STEP_) {
+    for (int x = rectangle->x0 + GM_CHECK_STEP_; x < rectangle->x1;
+         x += GM_CHECK_STEP_) {
+      if (gmComputePixel_(image, x, y) != iteration_count) {
+        return 0;
+      }
+    }
+  }
+
+  return 1;
+}
+
+void gmFillInside_(const gmIterationImage_ *image,
+                   const gmRectangle_ *rectangle, gm_uint iteration_count) {
+  for (int y = rectangle->y0 + 1; y < rectangle->y1; ++y) {
+    gm_uint *const kRow = &image->iteration_counts[(size_t)y * image->size.w];
+
+    for (int x = rectangle->x0 + 1; x < rectangle->x1; ++x) {
+      kRow[x] = iteration_count;
+    }
+  }
+}
+
+void gmSplitRectangle_(const gmBoundaryTracer_ *tracer,
+                       const gmRectangle_ *rectangle) {
+  gmRectangle_ first = *rectangle;
+  gmRectangle_ second = *rectangle;
+
+  // Split along the longest side, the children sharing the split line.
+  if (rectangle->x1 - rectangle->x0 >= rectangle->y1 - rectangle->y0) {
+    const int kMiddle = (rectangle->x0 + rectangle->x1) / 2;
+    gmComputeColumn_(tracer->image, kMiddle, rectangle->y0 + 1,
+                     rectangle->y1 - 1);
+
+    first.x1 = kMiddle;
+    second.x0 = kMiddle;
+  } else {
+    const int kMiddle = (rectangle->y0 + rectangle->y1) / 2;
+    gmComputeRow_(tracer->image, kMiddle, rectangle->x0 + 1,
+                  rectangle->x1 - 1);
+
+    first.y1 = kMiddle;
+    second.y0 = kMiddle;
+  }
+
+  gmSubmitRectangle_(tracer, &first);
+  gmSubmitRectangle_(tracer, &second);
+}
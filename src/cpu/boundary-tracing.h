@@ -0,0 +1,17 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "cpu.h"
+#include "thread-pool.h"
+
+/**
+ * Computes the image with the Mariani-Silver algorithm, scheduling each
+ * subdivided rectangle as a task of the pool.
+ *
+ * @param checked Whether to compute a grid of pixels inside a rectangle before
+ * filling it, subdividing it instead if any of them differs from its border.
+ */
+void gmTraceBoundaries_(const gmIterationImage_ *image, gmThreadPool_ *pool,
+                        int checked);
@@ -0,0 +1,451 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "buddhabrot.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "gm/gm.h"
+#include "image-config.h"
+#include "kernel.h"
+#include "setup.h"
+#include "thread-pool.h"
+
+/**
+ * Number of points sampled with the same random number generator.  The output
+ * only depends on the seed and on this value.
+ */
+#define GM_CHUNK_POINT_COUNT_ 16384
+
+/**
+ * The sampling grid covers the region of the complex plane containing the
+ * whole set with this many cells in each direction.
+ */
+#define GM_SAMPLING_GRID_SIZE_ 256
+
+/**
+ * Iterations of the pre-pass, which only needs to tell the cells close to the
+ * set from the other ones.
+ */
+#define GM_SAMPLING_GRID_MAX_ITERATIONS_ 256
+
+typedef struct gmSamplingGrid_ {
+  /**
+   * Indices of the cells points are sampled in.
+   */
+  uint32_t *cells;
+  size_t cell_count;
+} gmSamplingGrid_;
+
+typedef struct gmBuddhabrot_ {
+  gmIntSize size;
+  gmPixelMapping_ mapping;
+  gm_uint max_iteration_count;
+  gm_uint min_iteration_count;
+  unsigned long long point_count;
+  unsigned long long seed;
+
+  gmSamplingGrid_ grid;
+
+  // One density histogram and orbit buffer per worker.
+  uint32_t **histograms;
+  double **orbits;
+
+  size_t worker_count;
+
+  /**
+   * Max density of the rows each worker summed.
+   */
+  uint32_t *max_densities;
+  uint32_t max_density;
+
+  unsigned char *image_data;
+} gmBuddhabrot_;
+
+void gmCreateBuddhabrot_(GM_OUT_PARAM gmBuddhabrot_ *buddhabrot,
+                         const gmImageConfig *image_config,
+                         size_t worker_count);
+
+void gmBuildSamplingGrid_(GM_OUT_PARAM gmSamplingGrid_ *grid,
+                          gmThreadPool_ *pool);
+
+void gmTraceChunks_(void *buddhabrot, size_t begin, size_t end,
+                    size_t worker_index);
+
+void gmSumHistograms_(void *buddhabrot, size_t begin, size_t end,
+                      size_t worker_index);
+
+void gmToneMapRows_(void *buddhabrot, size_t begin, size_t end,
+                    size_t worker_index);
+
+void gmDeleteBuddhabrot_(const gmBuddhabrot_ *buddhabrot);
+
+void gmRenderBuddhabrot_(GM_OUT_PARAM unsigned char *image_data,
+                         const gmImageConfig *image_config,
+                         gmThreadPool_ *pool) {
+  const size_t kWorkerCount = gmGetThreadPoolSize_(pool);
+
+  gmBuddhabrot_ buddhabrot;
+  gmCreateBuddhabrot_(&buddhabrot, image_config, kWorkerCount);
+  buddhabrot.image_data = image_data;
+
+  gmBuildSamplingGrid_(&buddhabrot.grid, pool);
+
+  const size_t kChunkCount = (buddhabrot.point_count + GM_CHUNK_POINT_COUNT_ -
+                              1) / GM_CHUNK_POINT_COUNT_;
+
+  gmRunParallelFor_(pool, kChunkCount, 1, gmTraceChunks_, &buddhabrot);
+
+  // The histograms are summed into the first one.
+  const size_t kRowCount = image_config->size.h;
+  gmRunParallelFor_(pool, kRowCount, 16, gmSumHistograms_, &buddhabrot);
+
+  buddhabrot.max_density = 0;
+  for (size_t i = 0; i < kWorkerCount; ++i) {
+    if (buddhabrot.max_densities[i] > buddhabrot.max_density) {
+      buddhabrot.max_density = buddhabrot.max_densities[i];
+    }
+  }
+
+  gmRunParallelFor_(pool, kRowCount, 16, gmToneMapRows_, &buddhabrot);
+
+  gmDeleteBuddhabrot_(&buddhabrot);
+}
+
+void gmCreateBuddhabrot_(GM_OUT_PARAM gmBuddhabrot_ *buddhabrot,
+                         const gmImageConfig *image_config,
+                         size_t worker_count) {
+  const gmIntSize *const kSize = &image_config->size;
+  const gmBuddhabrotConfig *const kConfig = &image_config->buddhabrot;
+
+  buddhabrot->size = *kSize;
+  gmGetPixelMapping_(&buddhabrot->mapping, image_config);
+
+  buddhabrot->max_iteration_count = gmGetMaxIterationCount_(image_config);
+  buddhabrot->min_iteration_count = kConfig->min_iteration_count;
+
+  buddhabrot->point_count = kConfig->point_count
+                                ? kConfig->point_count
+                                : 64ull * kSize->w * kSize->h;
+
+  buddhabrot->seed = kConfig->seed;
+  buddhabrot->worker_count = worker_count;
+
+  buddhabrot->histograms = malloc(worker_count * sizeof(uint32_t *));
+  buddhabrot->orbits = malloc(worker_count * sizeof(double *));
+  buddhabrot->max_densities = calloc(worker_count, sizeof(uint32_t));
+
+  for (size_t i = 0; i < worker_count; ++i) {
+    buddhabrot->histograms[i] =
+        calloc((size_t)kSize->w * kSize->h, sizeof(uint32_t));
+
+    // Real and imaginary parts of every point of the orbit.
+    buddhabrot->orbits[i] =
+        malloc(buddhabrot->max_iteration_count * 2 * sizeof(double));
+  }
+}
+
+// Region of the complex plane covered by the sampling grid, which contains
+// the whole set.
+#define GM_SAMPLING_REGION_X_ (-2.0)
+#define GM_SAMPLING_REGION_Y_ (-1.25)
+#define GM_SAMPLING_REGION_SIZE_ 2.5
+
+void gmComputeGridCorners_(void *corners, size_t begin, size_t end,
+                           size_t worker_index);
+
+int gmIsCellNearBoundary_(const gm_uint *corners, int x, int y);
+
+void gmBuildSamplingGrid_(GM_OUT_PARAM gmSamplingGrid_ *grid,
+                          gmThreadPool_ *pool) {
+  const size_t kCornerCount = GM_SAMPLING_GRID_SIZE_ + 1;
+  gm_uint *const kCorners =
+      malloc(kCornerCount * kCornerCount * sizeof(gm_uint));
+
+  gmRunParallelFor_(pool, kCornerCount, 8, gmComputeGridCorners_, kCorners);
+
+  grid->cells = malloc(GM_SAMPLING_GRID_SIZE_ * GM_SAMPLING_GRID_SIZE_ *
+                       sizeof(uint32_t));
+  grid->cell_count = 0;
+
+  for (int y = 0; y < GM_SAMPLING_GRID_SIZE_; ++y) {
+    for (int x = 0; x < GM_SAMPLING_GRID_SIZE_; ++x) {
+      if (gmIsCellNearBoundary_(kCorners, x, y)) {
+        grid->cells[grid->cell_count++] = y * GM_SAMPLING_GRID_SIZE_ + x;
+      }
+    }
+  }
+
+  free(kCorners);
+}
+
+void gmComputeGridCorners_(void *corners, size_t begin, size_t end,
+                           size_t worker_index) {
+  (void)worker_index;
+
+  const int kCornerCount = GM_SAMPLING_GRID_SIZE_ + 1;
+  const double kStep = GM_SAMPLING_REGION_SIZE_ / GM_SAMPLING_GRID_SIZE_;
+  gm_uint *const kCorners = corners;
+
+  for (size_t y = begin; y < end; ++y) {
+    for (int x = 0; x < kCornerCount; ++x) {
+      kCorners[y * kCornerCount + x] = gmComputeIterationCount_(
+          GM_SAMPLING_REGION_X_ + x * kStep, GM_SAMPLING_REGION_Y_ + y * kStep,
+          GM_SAMPLING_GRID_MAX_ITERATIONS_);
+    }
+  }
+}
+
+int gmIsCellInside_(const gm_uint *corners, int x, int y);
+
+/**
+ * A cell is near the boundary when itself or one of its neighbors has corners
+ * both inside and outside of the set at the pre-pass resolution.  Cells fully
+ * inside never produce escaping orbits, and cells far outside only produce
+ * orbits too short to be plotted.
+ */
+int gmIsCellNearBoundary_(const gm_uint *corners, int x, int y) {
+  const int kCornerCount = GM_SAMPLING_GRID_SIZE_ + 1;
+
+  const int kX0 = x > 0 ? x - 1 : 0;
+  const int kY0 = y > 0 ? y - 1 : 0;
+  const int kX1 = x + 1 < GM_SAMPLING_GRID_SIZE_ ? x + 2 : x + 1;
+  const int kY1 = y + 1 < GM_SAMPLING_GRID_SIZE_ ? y + 2 : y + 1;
+
+  // Corners of the neighborhood.
+  int inside_count = 0;
+  for (int j = kY0; j <= kY1; ++j) {
+    for (int i = kX0; i <= kX1; ++i) {
+      inside_count += corners[j * kCornerCount + i] ==
+                      GM_SAMPLING_GRID_MAX_ITERATIONS_;
+    }
+  }
+
+  const int kTotalCount = (kX1 - kX0 + 1) * (kY1 - kY0 + 1);
+  return (inside_count > 0) && (inside_count < kTotalCount);
+}
+
+typedef struct gmRandom_ {
+  uint64_t state[4];
+} gmRandom_;
+
+void gmSeedRandom_(GM_OUT_PARAM gmRandom_ *random, uint64_t seed);
+double gmGetRandomDouble_(gmRandom_ *random);
+
+void gmSamplePoint_(const gmSamplingGrid_ *grid, gmRandom_ *random,
+                    GM_OUT_PARAM double *c_x, GM_OUT_PARAM double *c_y);
+
+void gmTracePoint_(const gmBuddhabrot_ *buddhabrot, double c_x, double c_y,
+                   size_t worker_index);
+
+void gmTraceChunks_(void *buddhabrot, size_t begin, size_t end,
+                    size_t worker_index) {
+  const gmBuddhabrot_ *const kBuddhabrot = buddhabrot;
+  if (!kBuddhabrot->grid.cell_count) {
+    return;
+  }
+
+  for (size_t chunk = begin; chunk < end; ++chunk) {
+    gmRandom_ random;
+    gmSeedRandom_(&random, kBuddhabrot->seed ^
+                               (chunk * 0x9E3779B97F4A7C15ull));
+
+    const unsigned long long kFirstPoint = chunk * GM_CHUNK_POINT_COUNT_;
+    const unsigned long long kRemainingCount =
+        kBuddhabrot->point_count - kFirstPoint;
+
+    const unsigned long long kPointCount =
+        kRemainingCount < GM_CHUNK_POINT_COUNT_ ? kRemainingCount
+                                                : GM_CHUNK_POINT_COUNT_;
+
+    for (unsigned long long i = 0; i < kPointCount; ++i) {
+      double c_x, c_y;
+      gmSamplePoint_(&kBuddhabrot->grid, &random, &c_x, &c_y);
+      gmTracePoint_(kBuddhabrot, c_x, c_y, worker_index);
+    }
+  }
+}
+
+uint64_t gmSplitMix64_(GM_OUT_PARAM uint64_t *state);
+
+void gmSeedRandom_(GM_OUT_PARAM gmRandom_ *random, uint64_t seed) {
+  // Recommended seeding of xoshiro256** generators.
+  for (int i = 0; i < 4; ++i) {
+    random->state[i] = gmSplitMix64_(&seed);
+  }
+}
+
+uint64_t gmSplitMix64_(GM_OUT_PARAM uint64_t *state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+uint64_t gmRotateLeft_(uint64_t x, int k);
+
+/**
+ * @return A uniformly distributed value in [0, 1[, using the xoshiro256**
+ * generator.
+ */
+double gmGetRandomDouble_(gmRandom_ *random) {
+  uint64_t *const kState = random->state;
+
+  const uint64_t kResult = gmRotateLeft_(kState[1] * 5, 7) * 9;
+  const uint64_t kT = kState[1] << 17;
+
+  kState[2] ^= kState[0];
+  kState[3] ^= kState[1];
+  kState[1] ^= kState[2];
+  kState[0] ^= kState[3];
+  kState[2] ^= kT;
+  kState[3] = gmRotateLeft_(kState[3], 45);
+
+  // The 53 high bits fill the mantissa.
+  return (double)(kResult >> 11) * 0x1.0p-53;
+}
+
+uint64_t gmRotateLeft_(uint64_t x, int k) {
+  return (x << k) | (x >> (64 - k));
+}
+
+void gmSamplePoint_(const gmSamplingGrid_ *grid, gmRandom_ *random,
+                    GM_OUT_PARAM double *c_x, GM_OUT_PARAM double *c_y) {
+  const double kCellSize = GM_SAMPLING_REGION_SIZE_ / GM_SAMPLING_GRID_SIZE_;
+
+  size_t cell_index = (size_t)(gmGetRandomDouble_(random) * grid->cell_count);
+  if (cell_index == grid->cell_count) {
+    --cell_index;  // Rounding can reach the upper bound.
+  }
+
+  const uint32_t kCell = grid->cells[cell_index];
+  const int kX = kCell % GM_SAMPLING_GRID_SIZE_;
+  const int kY = kCell / GM_SAMPLING_GRID_SIZE_;
+
+  *c_x = GM_SAMPLING_REGION_X_ + (kX + gmGetRandomDouble_(random)) * kCellSize;
+  *c_y = GM_SAMPLING_REGION_Y_ + (kY + gmGetRandomDouble_(random)) * kCellSize;
+}
+
+int gmIsInMainBulbs_(double c_x, double c_y);
+
+void gmPlotOrbit_(const gmBuddhabrot_ *buddhabrot, const double *orbit,
+                  gm_uint length, uint32_t *histogram);
+
+void gmTracePoint_(const gmBuddhabrot_ *buddhabrot, double c_x, double c_y,
+                   size_t worker_index) {
+  // These points never escape.
+  if (gmIsInMainBulbs_(c_x, c_y)) {
+    return;
+  }
+
+  double *const kOrbit = buddhabrot->orbits[worker_index];
+
+  double z_x = 0.0;
+  double z_y = 0.0;
+
+  gm_uint i = 0;
+  for (; (i < buddhabrot->max_iteration_count) && (z_x * z_x + z_y * z_y < 4.0);
+       ++i) {
+    const double kNewZX = z_x * z_x - z_y * z_y + c_x;
+    z_y = 2.0 * z_x * z_y + c_y;
+    z_x = kNewZX;
+
+    kOrbit[i * 2] = z_x;
+    kOrbit[i * 2 + 1] = z_y;
+  }
+
+  const int kEscaped = i < buddhabrot->max_iteration_count;
+  if (kEscaped && (i >= buddhabrot->min_iteration_count)) {
+    gmPlotOrbit_(buddhabrot, kOrbit, i, buddhabrot->histograms[worker_index]);
+  }
+}
+
+int gmIsInMainBulbs_(double c_x, double c_y) {
+  // Main cardioid.
+  const double kX = c_x - 0.25;
+  const double kQ = kX * kX + c_y * c_y;
+  if (kQ * (kQ + kX) <= 0.25 * c_y * c_y) {
+    return 1;
+  }
+
+  // Period-2 bulb.
+  return (c_x + 1.0) * (c_x + 1.0) + c_y * c_y <= 0.0625;
+}
+
+void gmPlotOrbit_(const gmBuddhabrot_ *buddhabrot, const double *orbit,
+                  gm_uint length, uint32_t *histogram) {
+  const gmPixelMapping_ *const kMapping = &buddhabrot->mapping;
+
+  // The mapping origin is the center of the first pixel.
+  const double kLeft = kMapping->origin_x - kMapping->step_x / 2.0;
+  const double kBottom = kMapping->origin_y - kMapping->step_y / 2.0;
+
+  for (gm_uint i = 0; i < length; ++i) {
+    const double kX = floor((orbit[i * 2] - kLeft) / kMapping->step_x);
+    const double kY = floor((orbit[i * 2 + 1] - kBottom) / kMapping->step_y);
+
+    if ((kX >= 0.0) && (kX < buddhabrot->size.w) && (kY >= 0.0) &&
+        (kY < buddhabrot->size.h)) {
+      ++histogram[(size_t)kY * buddhabrot->size.w + (size_t)kX];
+    }
+  }
+}
+
+void gmSumHistograms_(void *buddhabrot, size_t begin, size_t end,
+                      size_t worker_index) {
+  const gmBuddhabrot_ *const kBuddhabrot = buddhabrot;
+  uint32_t *const kSum = kBuddhabrot->histograms[0];
+
+  const size_t kBeginPixel = begin * kBuddhabrot->size.w;
+  const size_t kEndPixel = end * kBuddhabrot->size.w;
+
+  uint32_t max_density = kBuddhabrot->max_densities[worker_index];
+
+  for (size_t i = kBeginPixel; i < kEndPixel; ++i) {
+    uint32_t density = kSum[i];
+    for (size_t j = 1; j < kBuddhabrot->worker_count; ++j) {
+      density += kBuddhabrot->histograms[j][i];
+    }
+
+    kSum[i] = density;
+    max_density = density > max_density ? density : max_density;
+  }
+
+  kBuddhabrot->max_densities[worker_index] = max_density;
+}
+
+void gmToneMapRows_(void *buddhabrot, size_t begin, size_t end,
+                    size_t worker_index) {
+  (void)worker_index;
+
+  const gmBuddhabrot_ *const kBuddhabrot = buddhabrot;
+  const uint32_t *const kDensities = kBuddhabrot->histograms[0];
+
+  const double kScale =
+      kBuddhabrot->max_density ? 1.0 / kBuddhabrot->max_density : 0.0;
+
+  for (size_t i = begin * kBuddhabrot->size.w;
+       i < end * kBuddhabrot->size.w; ++i) {
+    // The square root brings out the faint orbits.
+    const unsigned char kValue =
+        (unsigned char)lround(sqrt(kDensities[i] * kScale) * 255.0);
+
+    kBuddhabrot->image_data[i * 3] = kValue;
+    kBuddhabrot->image_data[i * 3 + 1] = kValue;
+    kBuddhabrot->image_data[i * 3 + 2] = kValue;
+  }
+}
+
+void gmDeleteBuddhabrot_(const gmBuddhabrot_ *buddhabrot) {
+  for (size_t i = 0; i < buddhabrot->worker_count; ++i) {
+    free(buddhabrot->histograms[i]);
+    free(buddhabrot->orbits[i]);
+  }
+
+  free(buddhabrot->histograms);
+  free(buddhabrot->orbits);
+  free(buddhabrot->max_densities);
+  free(buddhabrot->grid.cells);
+}
@@ -0,0 +1,24 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "gm/gm.h"
+#include "setup.h"
+#include "thread-pool.h"
+
+/**
+ * Renders the Buddhabrot of the specified image config.
+ *
+ * Points are sampled near the boundary of the set, found by a low resolution
+ * escape-time pre-pass.  Samples are split in chunks with their own random
+ * number generator seeded from the config seed and the chunk index, each
+ * worker plotting the orbits of its chunks in its own density histogram.  The
+ * histograms are then summed and tone-mapped in parallel.
+ *
+ * @param image_data Tightly packed RGB data, laid out like the data read back
+ * from the GPU.
+ */
+void gmRenderBuddhabrot_(GM_OUT_PARAM unsigned char *image_data,
+                         const gmImageConfig *image_config,
+                         gmThreadPool_ *pool);
@@ -0,0 +1,196 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "cpu.h"
+
+#include <stdlib.h>
+#include <string.h>  // For memcpy.
+
+#include "boundary-tracing.h"
+#include "buddhabrot.h"
+#include "equalization.h"
+#include "fixed-point.h"
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "image-config.h"
+#include "kernel.h"
+#include "per-pixel.h"
+#include "region.h"
+#include "setup.h"
+#include "thread-pool.h"
+
+gm_uint gmComputePixel_(const gmIterationImage_ *image, int x, int y) {
+  const gmPixelMapping_ *const kMapping = &image->mapping;
+
+  gm_uint iteration_count;
+  gm_uint executed_count;
+  if (image->fixed_mapping.limb_count) {
+    // The fixed-point kernel tests the escape after every iteration.
+    iteration_count = gmComputeFixedIterationCount_(
+        &image->fixed_mapping, x, y, image->max_iteration_count);
+    executed_count = iteration_count;
+  } else {
+    iteration_count = gmComputeIterationCost_(
+        kMapping->origin_x + x * kMapping->step_x,
+        kMapping->origin_y + y * kMapping->step_y, image->max_iteration_count,
+        &executed_count);
+  }
+
+  const size_t kIndex = (size_t)y * image->size.w + x;
+  image->iteration_counts[kIndex] = iteration_count;
+
+  if (image->costs) {
+    image->costs[kIndex] = executed_count;
+  }
+
+  return iteration_count;
+}
+
+void gmComputeIterationImage_(const gmIterationImage_ *image,
+                              gmThreadPool_ *pool,
+                              const gmImageConfig *image_config);
+
+void gmColorIterationImage_(GM_OUT_PARAM unsigned char *image_data,
+                            GM_OUT_PARAM float *cost_data,
+                            const gmIterationImage_ *image,
+                            const gmImageConfig *image_config,
+                            gmThreadPool_ *pool);
+
+gmError gmRenderImageOnCpu_(GM_OUT_PARAM unsigned char *image_data,
+                            GM_OUT_PARAM float *cost_data,
+                            const gmImageConfig *image_config) {
+  gmError error;
+
+  gmThreadPool_ *pool;
+  error = gmCreateThreadPool_(&pool, image_config->cpu.thread_count);
+  if (!error && (gmGetEngine_(image_config) == gmEngine_Buddhabrot)) {
+    gmRenderBuddhabrot_(image_data, image_config, pool);
+    gmDeleteThreadPool_(pool);
+  } else if (!error) {
+    const gmIntSize *const kSize = &image_config->size;
+    const size_t kPixelCount = (size_t)kSize->w * kSize->h;
+
+    unsigned char *const kCoverage =
+        gmHasRegion_(image_config) ? gmComputeRegionCoverage_(image_config)
+                                   : NULL;
+
+    // The pixels filled by boundary tracing or outside of the region are never
+    // computed, they keep a cost of 0.
+    gmIterationImage_ image = {
+        .iteration_counts = malloc(kPixelCount * sizeof(gm_uint)),
+        .costs = cost_data ? calloc(kPixelCount, sizeof(gm_uint)) : NULL,
+        .coverage = kCoverage,
+        .size = *kSize,
+        .max_iteration_count = gmGetMaxIterationCount_(image_config)};
+
+    gmGetPixelMapping_(&image.mapping, image_config);
+    gmGetFixedPixelMapping_(&image.fixed_mapping, image_config);
+
+    gmComputeIterationImage_(&image, pool, image_config);
+    gmColorIterationImage_(image_data, cost_data, &image, image_config, pool);
+
+    free(image.iteration_counts);
+    free(image.costs);
+    free(kCoverage);
+    gmDeleteThreadPool_(pool);
+  }
+
+  return error;
+}
+
+void gmComputeIterationImage_(const gmIterationImage_ *image,
+                              gmThreadPool_ *pool,
+                              const gmImageConfig *image_config) {
+  // Boundary tracing follows the boundaries across the whole image.
+  if (image->coverage) {
+    gmComputeRegionPixels_(image, pool);
+    return;
+  }
+
+  switch (gmGetCpuAlgorithm_(image_config)) {
+    case gmCpuAlgorithm_BoundaryTracing:
+      gmTraceBoundaries_(image, pool, 0);
+      break;
+    case gmCpuAlgorithm_CheckedBoundaryTracing:
+      gmTraceBoundaries_(image, pool, 1);
+      break;
+    default:
+      gmComputeAllPixels_(image, pool);
+      break;
+  }
+}
+
+typedef struct gmColoring_ {
+  unsigned char *image_data;
+  float *cost_data;
+  const gmIterationImage_ *image;
+
+  /**
+   * Hue of each iteration count of the equalized coloring, NULL for the
+   * cyclic coloring.
+   */
+  const float *hues;
+
+  const unsigned char *background_color;
+} gmColoring_;
+
+void gmColorRows_(void *coloring, size_t begin, size_t end,
+                  size_t worker_index);
+
+void gmColorIterationImage_(GM_OUT_PARAM unsigned char *image_data,
+                            GM_OUT_PARAM float *cost_data,
+                            const gmIterationImage_ *image,
+                            const gmImageConfig *image_config,
+                            gmThreadPool_ *pool) {
+  float *const kHues =
+      gmGetColoringMode_(image_config) == gmColoringMode_Equalized
+          ? gmComputeEqualizedHues_(image, image_config, pool)
+          : NULL;
+
+  gmColoring_ coloring = {.image_data = image_data,
+                          .cost_data = cost_data,
+                          .image = image,
+                          .hues = kHues,
+                          .background_color =
+                              image_config->region.background_color};
+  gmRunParallelFor_(pool, image->size.h, 16, gmColorRows_, &coloring);
+
+  free(kHues);
+}
+
+void gmColorRows_(void *coloring, size_t begin, size_t end,
+                  size_t worker_index) {
+  (void)worker_index;
+
+  const gmColoring_ *const kColoring = coloring;
+  const gmIterationImage_ *const kImage = kColoring->image;
+
+  const size_t kBeginPixel = begin * kImage->size.w;
+  const size_t kEndPixel = end * kImage->size.w;
+
+  for (size_t i = kBeginPixel; i < kEndPixel; ++i) {
+    const gm_uint kIterationCount = kImage->iteration_counts[i];
+
+    if (kImage->coverage && !kImage->coverage[i]) {
+      memcpy(&kColoring->image_data[i * 3], kColoring->background_color, 3);
+    } else if (kColoring->hues &&
+               (kIterationCount < kImage->max_iteration_count)) {
+      gmHueToRgb_(&kColoring->image_data[i * 3],
+                  kColoring->hues[kIterationCount]);
+    } else {
+      gmIterationCountToRgb_(&kColoring->image_data[i * 3], kIterationCount,
+                             kImage->max_iteration_count);
+    }
+  }
+
+  if (kColoring->cost_data) {
+    for (size_t i = kBeginPixel; i < kEndPixel; ++i) {
+      const int kIsOutside = kImage->coverage && !kImage->coverage[i];
+
+      // Like on the GPU, the pixels outside of the region have no count.
+      kColoring->cost_data[i * 2] = (float)kImage->costs[i];
+      kColoring->cost_data[i * 2 + 1] =
+          kIsOutside ? -1.0f : (float)kImage->iteration_counts[i];
+    }
+  }
+}
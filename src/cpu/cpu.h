@@ -0,0 +1,60 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "gm/error.h"
+#include "fixed-point.h"
+#include "gm/gm.h"
+#include "kernel.h"
+#include "setup.h"
+
+/**
+ * Iteration counts of the image being rendered by the CPU backend, laid out
+ * row by row from the bottom of the image.
+ */
+typedef struct gmIterationImage_ {
+  gm_uint *iteration_counts;
+
+  /**
+   * Iterations executed for each pixel, 0 for the filled pixels.  Only
+   * allocated when recording the cost of the render, NULL otherwise.
+   */
+  gm_uint *costs;
+
+  /**
+   * Whether each pixel is inside the region of the image, laid out like
+   * `gmComputeRegionCoverage_`.  NULL when the whole image is rendered.
+   */
+  const unsigned char *coverage;
+
+  gmIntSize size;
+  gmPixelMapping_ mapping;
+
+  /**
+   * Replaces the mapping when it has limbs, for pixels too small for doubles.
+   */
+  gmFixedPixelMapping_ fixed_mapping;
+
+  gm_uint max_iteration_count;
+} gmIterationImage_;
+
+/**
+ * Computes the iteration count of the specified pixel and stores it in the
+ * image, along with its cost when recorded.
+ *
+ * @return The iteration count.
+ */
+gm_uint gmComputePixel_(const gmIterationImage_ *image, int x, int y);
+
+/**
+ * Renders the image with the CPU backend.
+ *
+ * @param image_data Tightly packed RGB data, laid out like the data read back
+ * from the GPU.
+ * @param cost_data When not NULL, receives the cost of each pixel like
+ * `gmReadCostData_`.  Ignored by the Buddhabrot engine.
+ */
+gmError gmRenderImageOnCpu_(GM_OUT_PARAM unsigned char *image_data,
+                            GM_OUT_PARAM float *cost_data,
+                            const gmImageConfig *image_config);
@@ -0,0 +1,92 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "equalization.h"
+
+#include <stdlib.h>
+
+#include "cpu.h"
+#include "gm/gm.h"
+#include "image-config.h"
+#include "thread-pool.h"
+
+typedef struct gmHistograms_ {
+  const gmIterationImage_ *image;
+  gm_uint bin_width;
+  gm_uint bin_count;
+
+  /**
+   * One histogram per worker, one after the other.
+   */
+  unsigned long long *counts;
+} gmHistograms_;
+
+void gmCountRows_(void *histograms, size_t begin, size_t end,
+                  size_t worker_index);
+
+float *gmComputeEqualizedHues_(const gmIterationImage_ *image,
+                               const gmImageConfig *image_config,
+                               gmThreadPool_ *pool) {
+  const size_t kWorkerCount = gmGetThreadPoolSize_(pool);
+
+  gmHistograms_ histograms = {
+      .image = image,
+      .bin_width = gmGetEqualizationBinWidth_(image_config),
+      .bin_count = gmGetEqualizationBinCount_(image_config)};
+
+  histograms.counts =
+      calloc(kWorkerCount * histograms.bin_count, sizeof(unsigned long long));
+
+  gmRunParallelFor_(pool, image->size.h, 16, gmCountRows_, &histograms);
+
+  // The histograms are merged into the first one, which is summed into the
+  // cumulative distribution of the iteration counts.
+  unsigned long long *const kCdf = histograms.counts;
+  for (size_t i = 1; i < kWorkerCount; ++i) {
+    for (gm_uint bin = 0; bin < histograms.bin_count; ++bin) {
+      kCdf[bin] += histograms.counts[i * histograms.bin_count + bin];
+    }
+  }
+
+  for (gm_uint bin = 1; bin < histograms.bin_count; ++bin) {
+    kCdf[bin] += kCdf[bin - 1];
+  }
+
+  const unsigned long long kTotal = kCdf[histograms.bin_count - 1];
+  float *const kHues = malloc(image->max_iteration_count * sizeof(float));
+
+  // The iteration counts of a bin spread its share evenly, so that a bin
+  // holding most of the image still gets several colors.
+  for (gm_uint i = 0; i < image->max_iteration_count; ++i) {
+    const gm_uint kBin = i / histograms.bin_width;
+    const double kPrevious = kBin ? (double)kCdf[kBin - 1] : 0.0;
+    const double kShare =
+        (double)(i % histograms.bin_width + 1) / histograms.bin_width;
+
+    const double kCount = kPrevious + (kCdf[kBin] - kPrevious) * kShare;
+    kHues[i] = kTotal ? (float)(kCount / kTotal) : 0.0f;
+  }
+
+  free(histograms.counts);
+  return kHues;
+}
+
+void gmCountRows_(void *histograms, size_t begin, size_t end,
+                  size_t worker_index) {
+  const gmHistograms_ *const kHistograms = histograms;
+  const gmIterationImage_ *const kImage = kHistograms->image;
+
+  unsigned long long *const kCounts =
+      &kHistograms->counts[worker_index * kHistograms->bin_count];
+
+  const size_t kEndPixel = end * kImage->size.w;
+  for (size_t i = begin * kImage->size.w; i < kEndPixel; ++i) {
+    const gm_uint kIterationCount = kImage->iteration_counts[i];
+
+    // Points inside the set are black whatever their share.
+    if ((kIterationCount < kImage->max_iteration_count) &&
+        (!kImage->coverage || kImage->coverage[i])) {
+      ++kCounts[kIterationCount / kHistograms->bin_width];
+    }
+  }
+}
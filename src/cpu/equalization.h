@@ -0,0 +1,20 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "cpu.h"
+#include "gm/gm.h"
+#include "thread-pool.h"
+
+/**
+ * Computes the hues of the equalized coloring from the histogram of the
+ * iteration counts of the image, each worker of the pool counting its rows
+ * in its own histogram.
+ *
+ * @return The hue of each iteration count below the max iteration count, to
+ * be freed.
+ */
+float *gmComputeEqualizedHues_(const gmIterationImage_ *image,
+                               const gmImageConfig *image_config,
+                               gmThreadPool_ *pool);
@@ -0,0 +1,228 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+// Kernel of the fixed-point numbers of `GM_LIMB_COUNT_` limbs, whose
+// functions are named by `GM_FIXED_NAME_`.  This file has no include guard:
+// `fixed-point.c` includes it once per limb count, so that the loops over the
+// limbs have constant bounds which compilers unroll.
+
+#define GM_FRACTION_SHIFT_ (64 - GM_FIXED_INTEGER_BITS_)
+
+int GM_FIXED_NAME_(gmGetMagnitude)(GM_OUT_PARAM uint64_t *magnitude,
+                                   const uint64_t *value);
+
+void GM_FIXED_NAME_(gmSquareMagnitude)(GM_OUT_PARAM uint64_t *square,
+                                       const uint64_t *magnitude);
+
+void GM_FIXED_NAME_(gmMultiplyMagnitudes)(GM_OUT_PARAM uint64_t *product,
+                                          const uint64_t *a,
+                                          const uint64_t *b);
+
+void GM_FIXED_NAME_(gmAdd)(GM_OUT_PARAM uint64_t *sum, const uint64_t *a,
+                           const uint64_t *b);
+
+void GM_FIXED_NAME_(gmSubtract)(GM_OUT_PARAM uint64_t *difference,
+                                const uint64_t *a, const uint64_t *b);
+
+void GM_FIXED_NAME_(gmNegate)(GM_OUT_PARAM uint64_t *value);
+
+gm_uint GM_FIXED_NAME_(gmComputeFixedIterationCount)(
+    const uint64_t *c_x, const uint64_t *c_y, gm_uint max_iteration_count) {
+  uint64_t x[GM_LIMB_COUNT_];
+  uint64_t y[GM_LIMB_COUNT_];
+  memcpy(x, c_x, sizeof(x));
+  memcpy(y, c_y, sizeof(y));
+
+  const uint64_t kFour = (uint64_t)4 << GM_FRACTION_SHIFT_;
+  const uint64_t kSixteen = (uint64_t)16 << GM_FRACTION_SHIFT_;
+
+  // The escape is tested before every iteration rather than every block: the
+  // orbit would leave the integer bits within a block.
+  gm_uint i = 0;
+  for (; i < max_iteration_count; ++i) {
+    uint64_t x_magnitude[GM_LIMB_COUNT_];
+    uint64_t y_magnitude[GM_LIMB_COUNT_];
+    const int kIsXNegative = GM_FIXED_NAME_(gmGetMagnitude)(x_magnitude, x);
+    const int kIsYNegative = GM_FIXED_NAME_(gmGetMagnitude)(y_magnitude, y);
+
+    // Points outside of the square of side 8 escaped, the squares of the
+    // others are below 16.
+    if ((x_magnitude[GM_LIMB_COUNT_ - 1] >= kFour) ||
+        (y_magnitude[GM_LIMB_COUNT_ - 1] >= kFour)) {
+      break;
+    }
+
+    uint64_t x_square[GM_LIMB_COUNT_];
+    uint64_t y_square[GM_LIMB_COUNT_];
+    GM_FIXED_NAME_(gmSquareMagnitude)(x_square, x_magnitude);
+    GM_FIXED_NAME_(gmSquareMagnitude)(y_square, y_magnitude);
+
+    uint64_t squared_magnitude[GM_LIMB_COUNT_];
+    GM_FIXED_NAME_(gmAdd)(squared_magnitude, x_square, y_square);
+    if (squared_magnitude[GM_LIMB_COUNT_ - 1] >= kSixteen) {
+      break;
+    }
+
+    // 2xy, below 16 like the squared magnitude.
+    uint64_t product[GM_LIMB_COUNT_];
+    GM_FIXED_NAME_(gmMultiplyMagnitudes)(product, x_magnitude, y_magnitude);
+    GM_FIXED_NAME_(gmAdd)(product, product, product);
+    if (kIsXNegative != kIsYNegative) {
+      GM_FIXED_NAME_(gmNegate)(product);
+    }
+
+    GM_FIXED_NAME_(gmAdd)(y, product, c_y);
+    GM_FIXED_NAME_(gmSubtract)(x, x_square, y_square);
+    GM_FIXED_NAME_(gmAdd)(x, x, c_x);
+  }
+
+  return i;
+}
+
+/**
+ * @return Whether the value is negative.
+ */
+int GM_FIXED_NAME_(gmGetMagnitude)(GM_OUT_PARAM uint64_t *magnitude,
+                                   const uint64_t *value) {
+  memcpy(magnitude, value, GM_LIMB_COUNT_ * sizeof(uint64_t));
+
+  const int kIsNegative = (value[GM_LIMB_COUNT_ - 1] >> 63) != 0;
+  if (kIsNegative) {
+    GM_FIXED_NAME_(gmNegate)(magnitude);
+  }
+
+  return kIsNegative;
+}
+
+void GM_FIXED_NAME_(gmShiftProduct)(GM_OUT_PARAM uint64_t *product,
+                                    const uint64_t *columns);
+
+/**
+ * Same as `gmMultiplyMagnitudes` with half the limb products, the products of
+ * two different limbs being counted twice.
+ */
+void GM_FIXED_NAME_(gmSquareMagnitude)(GM_OUT_PARAM uint64_t *square,
+                                       const uint64_t *magnitude) {
+  uint64_t columns[2 * GM_LIMB_COUNT_];
+
+  // 192-bit sums of the columns.
+  unsigned __int128 sum = 0;
+  uint64_t sum_top = 0;
+
+  for (int k = GM_LIMB_COUNT_ - 2; k < 2 * GM_LIMB_COUNT_ - 1; ++k) {
+    unsigned __int128 cross_sum = 0;
+    uint64_t cross_sum_top = 0;
+
+    for (int i = k < GM_LIMB_COUNT_ ? 0 : k - GM_LIMB_COUNT_ + 1; i < k - i;
+         ++i) {
+      const unsigned __int128 kProduct =
+          (unsigned __int128)magnitude[i] * magnitude[k - i];
+      cross_sum += kProduct;
+      cross_sum_top += cross_sum < kProduct;
+    }
+
+    cross_sum_top = (cross_sum_top << 1) | (uint64_t)(cross_sum >> 127);
+    cross_sum <<= 1;
+
+    sum += cross_sum;
+    sum_top += cross_sum_top + (sum < cross_sum);
+
+    if (!(k % 2)) {
+      const unsigned __int128 kProduct =
+          (unsigned __int128)magnitude[k / 2] * magnitude[k / 2];
+      sum += kProduct;
+      sum_top += sum < kProduct;
+    }
+
+    columns[k] = (uint64_t)sum;
+    sum = (sum >> 64) | ((unsigned __int128)sum_top << 64);
+    sum_top = 0;
+  }
+
+  columns[2 * GM_LIMB_COUNT_ - 1] = (uint64_t)sum;
+  GM_FIXED_NAME_(gmShiftProduct)(square, columns);
+}
+
+/**
+ * Multiplies two non-negative numbers by summing the products of their limbs
+ * column by column, which compilers turn into 64x64-bit multiplications such
+ * as `mulx`.  The columns below the last two limbs of the operands are left
+ * out: their carries change the product by less than its last bit.
+ */
+void GM_FIXED_NAME_(gmMultiplyMagnitudes)(GM_OUT_PARAM uint64_t *product,
+                                          const uint64_t *a,
+                                          const uint64_t *b) {
+  uint64_t columns[2 * GM_LIMB_COUNT_];
+
+  // 192-bit sum of the column.
+  unsigned __int128 sum = 0;
+  uint64_t sum_top = 0;
+
+  for (int k = GM_LIMB_COUNT_ - 2; k < 2 * GM_LIMB_COUNT_ - 1; ++k) {
+    const int kEnd = k < GM_LIMB_COUNT_ ? k : GM_LIMB_COUNT_ - 1;
+
+    for (int i = k < GM_LIMB_COUNT_ ? 0 : k - GM_LIMB_COUNT_ + 1; i <= kEnd;
+         ++i) {
+      const unsigned __int128 kProduct = (unsigned __int128)a[i] * b[k - i];
+      sum += kProduct;
+      sum_top += sum < kProduct;
+    }
+
+    columns[k] = (uint64_t)sum;
+    sum = (sum >> 64) | ((unsigned __int128)sum_top << 64);
+    sum_top = 0;
+  }
+
+  columns[2 * GM_LIMB_COUNT_ - 1] = (uint64_t)sum;
+  GM_FIXED_NAME_(gmShiftProduct)(product, columns);
+}
+
+/**
+ * Keeps the fixed-point product from the columns of the integer product,
+ * which has twice as many fraction bits.
+ */
+void GM_FIXED_NAME_(gmShiftProduct)(GM_OUT_PARAM uint64_t *product,
+                                    const uint64_t *columns) {
+  for (int i = 0; i < GM_LIMB_COUNT_; ++i) {
+    product[i] = (columns[GM_LIMB_COUNT_ - 1 + i] >> GM_FRACTION_SHIFT_) |
+                 (columns[GM_LIMB_COUNT_ + i] << GM_FIXED_INTEGER_BITS_);
+  }
+}
+
+void GM_FIXED_NAME_(gmAdd)(GM_OUT_PARAM uint64_t *sum, const uint64_t *a,
+                           const uint64_t *b) {
+  uint64_t carry = 0;
+
+  for (int i = 0; i < GM_LIMB_COUNT_; ++i) {
+    const uint64_t kPartialSum = a[i] + carry;
+    const uint64_t kSum = kPartialSum + b[i];
+
+    carry = (kPartialSum < carry) | (kSum < kPartialSum);
+    sum[i] = kSum;
+  }
+}
+
+void GM_FIXED_NAME_(gmSubtract)(GM_OUT_PARAM uint64_t *difference,
+                                const uint64_t *a, const uint64_t *b) {
+  uint64_t borrow = 0;
+
+  for (int i = 0; i < GM_LIMB_COUNT_; ++i) {
+    const uint64_t kPartialDifference = a[i] - borrow;
+    const uint64_t kDifference = kPartialDifference - b[i];
+
+    borrow = (a[i] < borrow) | (kPartialDifference < b[i]);
+    difference[i] = kDifference;
+  }
+}
+
+void GM_FIXED_NAME_(gmNegate)(GM_OUT_PARAM uint64_t *value) {
+  uint64_t carry = 1;
+
+  for (int i = 0; i < GM_LIMB_COUNT_; ++i) {
+    const uint64_t kLimb = ~value[i] + carry;
+    carry = carry && !kLimb;
+    value[i] = kLimb;
+  }
+}
+
+#undef GM_FRACTION_SHIFT_
@@ -0,0 +1,191 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "fixed-point.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>  // For memcpy and memset.
+
+#include "gm/gm.h"
+#include "image-config.h"
+#include "setup.h"
+
+#define GM_PASTE_FIXED_NAME_(name, limb_count) name##limb_count##_
+#define GM_EXPAND_FIXED_NAME_(name, limb_count) \
+  GM_PASTE_FIXED_NAME_(name, limb_count)
+#define GM_FIXED_NAME_(name) GM_EXPAND_FIXED_NAME_(name, GM_LIMB_COUNT_)
+
+#define GM_LIMB_COUNT_ 2
+#include "fixed-point-kernel.h"
+#undef GM_LIMB_COUNT_
+
+#define GM_LIMB_COUNT_ 3
+#include "fixed-point-kernel.h"
+#undef GM_LIMB_COUNT_
+
+#define GM_LIMB_COUNT_ 4
+#include "fixed-point-kernel.h"
+#undef GM_LIMB_COUNT_
+
+#define GM_LIMB_COUNT_ 5
+#include "fixed-point-kernel.h"
+#undef GM_LIMB_COUNT_
+
+/**
+ * Pixels at least this large are computed with doubles, whose rounding errors
+ * stay far below them.
+ */
+#define GM_MIN_DOUBLE_PIXEL_EXPONENT_ -40
+
+/**
+ * Fraction bits kept below the size of the pixels, absorbing the rounding
+ * errors of the iterations.
+ */
+#define GM_FIXED_GUARD_BITS_ 24
+
+/**
+ * Coordinates of the viewport below this magnitude leave room in the integer
+ * bits for the orbits, points further away escape right away.
+ */
+#define GM_MAX_FIXED_COORDINATE_ 64.0
+
+void gmConvertToFixed_(GM_OUT_PARAM uint64_t *fixed, double value,
+                       int limb_count);
+
+void gmAddFixed_(GM_OUT_PARAM uint64_t *sum, const uint64_t *a,
+                 const uint64_t *b, int limb_count);
+
+void gmGetFixedPixelMapping_(GM_OUT_PARAM gmFixedPixelMapping_ *mapping,
+                             const gmImageConfig *image_config) {
+  gmViewport viewport;
+  gmGetViewport_(&viewport, image_config);
+
+  const double kStepX = viewport.width / image_config->size.w;
+  const double kStepY = viewport.height / image_config->size.h;
+
+  const int kPixelExponent = ilogb(kStepX < kStepY ? kStepX : kStepY);
+  const double kMaxCoordinate =
+      fmax(fabs(viewport.center_x) + viewport.width,
+           fabs(viewport.center_y) + viewport.height);
+
+  mapping->limb_count = 0;
+  if ((kPixelExponent >= GM_MIN_DOUBLE_PIXEL_EXPONENT_) ||
+      !(kMaxCoordinate < GM_MAX_FIXED_COORDINATE_)) {
+    return;
+  }
+
+  // Deeper pixels are rounded to the widest numbers.
+  const int kFractionBitCount = -kPixelExponent + GM_FIXED_GUARD_BITS_;
+  int limb_count = 2;
+  while ((limb_count < GM_MAX_LIMB_COUNT_) &&
+         (64 * limb_count - GM_FIXED_INTEGER_BITS_ < kFractionBitCount)) {
+    ++limb_count;
+  }
+
+  mapping->limb_count = limb_count;
+
+  gmConvertToFixed_(mapping->step_x, kStepX, limb_count);
+  gmConvertToFixed_(mapping->step_y, kStepY, limb_count);
+
+  // The origin is shifted so that pixels sample their center, like with
+  // doubles.
+  uint64_t offset[GM_MAX_LIMB_COUNT_];
+
+  gmConvertToFixed_(mapping->origin_x, viewport.center_x, limb_count);
+  gmConvertToFixed_(offset, (kStepX - viewport.width) / 2.0, limb_count);
+  gmAddFixed_(mapping->origin_x, mapping->origin_x, offset, limb_count);
+
+  gmConvertToFixed_(mapping->origin_y, viewport.center_y, limb_count);
+  gmConvertToFixed_(offset, (kStepY - viewport.height) / 2.0, limb_count);
+  gmAddFixed_(mapping->origin_y, mapping->origin_y, offset, limb_count);
+}
+
+/**
+ * Converts the double exactly, but for the bits below the last fraction bit.
+ */
+void gmConvertToFixed_(GM_OUT_PARAM uint64_t *fixed, double value,
+                       int limb_count) {
+  memset(fixed, 0, limb_count * sizeof(uint64_t));
+
+  int exponent;
+  const double kMantissa = frexp(fabs(value), &exponent);
+  const uint64_t kMantissaBits = (uint64_t)ldexp(kMantissa, 53);
+
+  // Position of the last bit of the mantissa in the fixed-point number.
+  const int kShift =
+      exponent - 53 + 64 * limb_count - GM_FIXED_INTEGER_BITS_;
+
+  if (kShift >= 0) {
+    const int kLimb = kShift / 64;
+    const int kBit = kShift % 64;
+
+    fixed[kLimb] = kMantissaBits << kBit;
+    if (kBit && (kLimb + 1 < limb_count)) {
+      fixed[kLimb + 1] = kMantissaBits >> (64 - kBit);
+    }
+  } else if (kShift > -64) {
+    fixed[0] = kMantissaBits >> -kShift;
+  }
+
+  if (value < 0.0) {
+    uint64_t carry = 1;
+    for (int i = 0; i < limb_count; ++i) {
+      fixed[i] = ~fixed[i] + carry;
+      carry = carry && !fixed[i];
+    }
+  }
+}
+
+void gmAddFixed_(GM_OUT_PARAM uint64_t *sum, const uint64_t *a,
+                 const uint64_t *b, int limb_count) {
+  unsigned __int128 carry = 0;
+
+  for (int i = 0; i < limb_count; ++i) {
+    const unsigned __int128 kSum = (unsigned __int128)a[i] + b[i] + carry;
+    sum[i] = (uint64_t)kSum;
+    carry = kSum >> 64;
+  }
+}
+
+void gmMapFixedPixel_(GM_OUT_PARAM uint64_t *coordinate,
+                      const uint64_t *origin, const uint64_t *step, int pixel,
+                      int limb_count);
+
+gm_uint gmComputeFixedIterationCount_(const gmFixedPixelMapping_ *mapping,
+                                      int x, int y,
+                                      gm_uint max_iteration_count) {
+  const int kLimbCount = mapping->limb_count;
+
+  uint64_t c_x[GM_MAX_LIMB_COUNT_];
+  uint64_t c_y[GM_MAX_LIMB_COUNT_];
+  gmMapFixedPixel_(c_x, mapping->origin_x, mapping->step_x, x, kLimbCount);
+  gmMapFixedPixel_(c_y, mapping->origin_y, mapping->step_y, y, kLimbCount);
+
+  switch (kLimbCount) {
+    case 2:
+      return gmComputeFixedIterationCount2_(c_x, c_y, max_iteration_count);
+    case 3:
+      return gmComputeFixedIterationCount3_(c_x, c_y, max_iteration_count);
+    case 4:
+      return gmComputeFixedIterationCount4_(c_x, c_y, max_iteration_count);
+    default:
+      return gmComputeFixedIterationCount5_(c_x, c_y, max_iteration_count);
+  }
+}
+
+/**
+ * Computes `origin + pixel * step`, the step being positive.
+ */
+void gmMapFixedPixel_(GM_OUT_PARAM uint64_t *coordinate,
+                      const uint64_t *origin, const uint64_t *step, int pixel,
+                      int limb_count) {
+  unsigned __int128 carry = 0;
+
+  for (int i = 0; i < limb_count; ++i) {
+    const unsigned __int128 kSum =
+        (unsigned __int128)step[i] * (uint64_t)pixel + origin[i] + carry;
+    coordinate[i] = (uint64_t)kSum;
+    carry = kSum >> 64;
+  }
+}
@@ -0,0 +1,51 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include <stdint.h>
+
+#include "gm/gm.h"
+#include "setup.h"
+
+/**
+ * Limbs of the widest fixed-point numbers, 320 bits.
+ */
+#define GM_MAX_LIMB_COUNT_ 5
+
+/**
+ * Integer bits of the fixed-point numbers, sign included.  Orbit points stay
+ * below 32 in magnitude before they escape.
+ */
+#define GM_FIXED_INTEGER_BITS_ 8
+
+/**
+ * Same as `gmPixelMapping_` with fixed-point numbers of `limb_count` 64-bit
+ * limbs in two's complement, the least significant limb first.
+ */
+typedef struct gmFixedPixelMapping_ {
+  /**
+   * 0 when doubles resolve the pixels of the image.
+   */
+  int limb_count;
+
+  uint64_t origin_x[GM_MAX_LIMB_COUNT_];
+  uint64_t origin_y[GM_MAX_LIMB_COUNT_];
+  uint64_t step_x[GM_MAX_LIMB_COUNT_];
+  uint64_t step_y[GM_MAX_LIMB_COUNT_];
+} gmFixedPixelMapping_;
+
+/**
+ * Picks the fewest limbs resolving the pixels of the image with a margin for
+ * rounding errors, or none when pixels are large enough for doubles.
+ */
+void gmGetFixedPixelMapping_(GM_OUT_PARAM gmFixedPixelMapping_ *mapping,
+                             const gmImageConfig *image_config);
+
+/**
+ * Same as `gmComputeIterationCount_` for the pixel (x, y), computed in fixed
+ * point so that deep zooms don't show the blocks of rounded coordinates.
+ */
+gm_uint gmComputeFixedIterationCount_(const gmFixedPixelMapping_ *mapping,
+                                      int x, int y,
+                                      gm_uint max_iteration_count);
@@ -0,0 +1,129 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "iterations.h"
+
+#include <stdlib.h>
+
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "image-config.h"
+#include "iteration-file.h"
+#include "kernel.h"
+#include "setup.h"
+#include "thread-pool.h"
+
+typedef struct gmTileRow_ {
+  const gmIterationFile_ *file;
+  gmPixelMapping_ mapping;
+  gm_uint max_iteration_count;
+  int row;
+
+  /**
+   * Data of the tiles of the row, one after the other.
+   */
+  float *data;
+} gmTileRow_;
+
+void gmComputeTiles_(void *tile_row, size_t begin, size_t end,
+                     size_t worker_index);
+
+gmError gmRenderIterationFileOnCpu_(const char *filepath,
+                                    const gmImageConfig *image_config) {
+  gmError error;
+
+  gmThreadPool_ *pool;
+  error = gmCreateThreadPool_(&pool, image_config->cpu.thread_count);
+  if (!error) {
+    gmIterationFile_ file;
+    error = gmCreateIterationFile_(&file, filepath, image_config);
+    if (!error) {
+      const gmIterationFileHeader *const kHeader = &file.header;
+      const size_t kTileFloatCount = GM_ITERATION_FILE_TILE_SIZE *
+                                     GM_ITERATION_FILE_TILE_SIZE *
+                                     GM_ITERATION_CHANNEL_COUNT_;
+
+      gmTileRow_ tile_row = {
+          .file = &file,
+          .max_iteration_count = gmGetMaxIterationCount_(image_config),
+          .data = malloc(kHeader->tile_column_count * kTileFloatCount *
+                         sizeof(float))};
+
+      gmGetPixelMapping_(&tile_row.mapping, image_config);
+
+      for (int row = 0; (row < (int)kHeader->tile_row_count) && !error;
+           ++row) {
+        tile_row.row = row;
+        gmRunParallelFor_(pool, kHeader->tile_column_count, 1,
+                          gmComputeTiles_, &tile_row);
+
+        // Written in order, while the next row is not started yet.
+        for (int column = 0;
+             (column < (int)kHeader->tile_column_count) && !error; ++column) {
+          error = gmWriteIterationTile_(
+              &file, column, row, tile_row.data + column * kTileFloatCount,
+              GM_ITERATION_FILE_TILE_SIZE * GM_ITERATION_CHANNEL_COUNT_);
+        }
+      }
+
+      free(tile_row.data);
+      error = gmCloseIterationFile_(&file, filepath, error);
+    }
+
+    gmDeleteThreadPool_(pool);
+  }
+
+  return error;
+}
+
+void gmComputeTiles_(void *tile_row, size_t begin, size_t end,
+                     size_t worker_index) {
+  (void)worker_index;
+
+  const gmTileRow_ *const kTileRow = tile_row;
+  const gmIterationFileHeader *const kHeader = &kTileRow->file->header;
+  const gmIntSize kImageSize = {.w = kHeader->width, .h = kHeader->height};
+  const int kTileSize = GM_ITERATION_FILE_TILE_SIZE;
+
+  for (size_t column = begin; column < end; ++column) {
+    float *const kTileData = kTileRow->data + column * kTileSize * kTileSize *
+                                                  GM_ITERATION_CHANNEL_COUNT_;
+
+    gmComputeTileRows_(kTileData, &kTileRow->mapping,
+                       kTileRow->max_iteration_count, &kImageSize, (int)column,
+                       kTileRow->row, 0, kTileSize);
+  }
+}
+
+void gmComputeTileRows_(GM_OUT_PARAM float *tile_data,
+                        const gmPixelMapping_ *mapping,
+                        gm_uint max_iteration_count,
+                        const gmIntSize *image_size, int column, int row,
+                        int y_begin, int y_end) {
+  const int kTileSize = GM_ITERATION_FILE_TILE_SIZE;
+
+  for (int y = y_begin; y < y_end; ++y) {
+    const int kImageY = row * kTileSize + y;
+
+    for (int x = 0; x < kTileSize; ++x) {
+      const int kImageX = column * kTileSize + x;
+      float *const kPixel =
+          tile_data + (y * kTileSize + x) * GM_ITERATION_CHANNEL_COUNT_;
+
+      // The writer ignores the pixels outside of the image.
+      if ((kImageX >= image_size->w) || (kImageY >= image_size->h)) {
+        continue;
+      }
+
+      double squared_magnitude;
+      gm_uint executed_count;
+      const gm_uint kIterationCount = gmComputeIterationData_(
+          mapping->origin_x + kImageX * mapping->step_x,
+          mapping->origin_y + kImageY * mapping->step_y, max_iteration_count,
+          &squared_magnitude, &executed_count);
+
+      kPixel[0] = (float)kIterationCount;
+      kPixel[1] = (float)squared_magnitude;
+    }
+  }
+}
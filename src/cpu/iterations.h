@@ -0,0 +1,27 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "kernel.h"
+#include "setup.h"
+
+/**
+ * Renders the iteration file of the image with the CPU backend, one row of
+ * tiles at a time.
+ */
+gmError gmRenderIterationFileOnCpu_(const char *filepath,
+                                    const gmImageConfig *image_config);
+
+/**
+ * Computes the rows [y_begin, y_end[ of the tile at the specified column and
+ * row of the tile grid of the iteration files, laid out like their tiles.  The
+ * pixels outside of the image are left as is.
+ */
+void gmComputeTileRows_(GM_OUT_PARAM float *tile_data,
+                        const gmPixelMapping_ *mapping,
+                        gm_uint max_iteration_count,
+                        const gmIntSize *image_size, int column, int row,
+                        int y_begin, int y_end);
@@ -0,0 +1,139 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "kernel.h"
+
+#include <math.h>
+
+#include "gm/gm.h"
+#include "image-config.h"
+#include "setup.h"
+
+void gmGetPixelMapping_(GM_OUT_PARAM gmPixelMapping_ *mapping,
+                        const gmImageConfig *image_config) {
+  gmViewport viewport;
+  gmGetViewport_(&viewport, image_config);
+
+  mapping->step_x = viewport.width / image_config->size.w;
+  mapping->step_y = viewport.height / image_config->size.h;
+
+  // The origin is shifted so that pixels sample their center.
+  mapping->origin_x = viewport.center_x - viewport.width / 2.0 +
+                      mapping->step_x / 2.0;
+
+  mapping->origin_y = viewport.center_y - viewport.height / 2.0 +
+                      mapping->step_y / 2.0;
+}
+
+gm_uint gmComputeIterationCount_(double c_x, double c_y,
+                                 gm_uint max_iteration_count) {
+  gm_uint executed_count;
+  return gmComputeIterationCost_(c_x, c_y, max_iteration_count,
+                                 &executed_count);
+}
+
+gm_uint gmComputeIterationCost_(double c_x, double c_y,
+                                gm_uint max_iteration_count,
+                                GM_OUT_PARAM gm_uint *executed_count) {
+  double squared_magnitude;
+  return gmComputeIterationData_(c_x, c_y, max_iteration_count,
+                                 &squared_magnitude, executed_count);
+}
+
+/**
+ * Point of an orbit, along with the squares of its coordinates.
+ */
+typedef struct gmOrbitPoint_ {
+  double x;
+  double y;
+  double x_square;
+  double y_square;
+} gmOrbitPoint_;
+
+void gmIterateOrbit_(gmOrbitPoint_ *z, double c_x, double c_y);
+
+gm_uint gmComputeIterationData_(double c_x, double c_y,
+                                gm_uint max_iteration_count,
+                                GM_OUT_PARAM double *squared_magnitude,
+                                GM_OUT_PARAM gm_uint *executed_count) {
+  gmOrbitPoint_ z = {
+      .x = c_x, .y = c_y, .x_square = c_x * c_x, .y_square = c_y * c_y};
+
+  // Same blocks as the shaders, the block in which the orbit escaped being
+  // iterated again from its start one iteration at a time.
+  gm_uint i = 0;
+  gm_uint rolled_back_count = 0;
+  for (; (max_iteration_count - i >= GM_ITERATION_BLOCK_SIZE_) &&
+         (z.x_square + z.y_square < 16.0);
+       i += GM_ITERATION_BLOCK_SIZE_) {
+    const gmOrbitPoint_ kBlockZ = z;
+
+    for (int j = 0; j < GM_ITERATION_BLOCK_SIZE_; ++j) {
+      gmIterateOrbit_(&z, c_x, c_y);
+    }
+
+    if (!(z.x_square + z.y_square < 16.0)) {
+      z = kBlockZ;
+      rolled_back_count = GM_ITERATION_BLOCK_SIZE_;
+      break;
+    }
+  }
+
+  for (; (i < max_iteration_count) && (z.x_square + z.y_square < 16.0); ++i) {
+    gmIterateOrbit_(&z, c_x, c_y);
+  }
+
+  *squared_magnitude = z.x_square + z.y_square;
+  *executed_count = i + rolled_back_count;
+  return i;
+}
+
+void gmIterateOrbit_(gmOrbitPoint_ *z, double c_x, double c_y) {
+  const double kNewX = z->x_square - z->y_square + c_x;
+  z->y = 2.0 * z->x * z->y + c_y;
+  z->x = kNewX;
+
+  z->x_square = z->x * z->x;
+  z->y_square = z->y * z->y;
+}
+
+void gmIterationCountToRgb_(GM_OUT_PARAM unsigned char *rgb,
+                            gm_uint iteration_count,
+                            gm_uint max_iteration_count) {
+  if (iteration_count == max_iteration_count) {
+    rgb[0] = rgb[1] = rgb[2] = 0;
+    return;
+  }
+
+  gmHueToRgb_(rgb, (float)(iteration_count % 360) / 360.0f);
+}
+
+void gmHsvToRgb_(GM_OUT_PARAM float *rgb, float h, float s, float v);
+
+void gmHueToRgb_(GM_OUT_PARAM unsigned char *rgb, float hue) {
+  float float_rgb[3];
+  gmHsvToRgb_(float_rgb, hue, 0.9f, 1.0f);
+
+  // Same conversion as OpenGL does for normalized color attachments.
+  for (int i = 0; i < 3; ++i) {
+    rgb[i] = (unsigned char)(float_rgb[i] * 255.0f + 0.5f);
+  }
+}
+
+float gmClamp_(float value, float min, float max);
+
+void gmHsvToRgb_(GM_OUT_PARAM float *rgb, float h, float s, float v) {
+  const float kOffsets[3] = {1.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+
+  for (int i = 0; i < 3; ++i) {
+    const float kShifted = h + kOffsets[i];
+    const float kP = fabsf((kShifted - floorf(kShifted)) * 6.0f - 3.0f);
+
+    const float kChannel = gmClamp_(kP - 1.0f, 0.0f, 1.0f);
+    rgb[i] = v * (1.0f + (kChannel - 1.0f) * s);
+  }
+}
+
+float gmClamp_(float value, float min, float max) {
+  return value < min ? min : (value > max ? max : value);
+}
@@ -0,0 +1,66 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "gm/gm.h"
+#include "setup.h"
+
+/**
+ * Maps the pixel (x, y) of the image to the point of the complex plane at
+ * `origin + (pixel + 0.5) * step`.  Pixel rows go from the bottom of the
+ * viewport to its top, as they do on the GPU.
+ */
+typedef struct gmPixelMapping_ {
+  double origin_x;
+  double origin_y;
+  double step_x;
+  double step_y;
+} gmPixelMapping_;
+
+void gmGetPixelMapping_(GM_OUT_PARAM gmPixelMapping_ *mapping,
+                        const gmImageConfig *image_config);
+
+/**
+ * Iterations run between two escape tests, by the shaders too.
+ */
+#define GM_ITERATION_BLOCK_SIZE_ 4
+
+/**
+ * The CPU counterpart of the fragment shader loop, computed in double
+ * precision.
+ *
+ * @return The number of iterations before the point escaped, or the max
+ * iteration count if it did not.
+ */
+gm_uint gmComputeIterationCount_(double c_x, double c_y,
+                                 gm_uint max_iteration_count);
+
+/**
+ * Same as `gmComputeIterationCount_`, also counting the iterations executed,
+ * which include the block in which the orbit escaped, iterated twice.
+ */
+gm_uint gmComputeIterationCost_(double c_x, double c_y,
+                                gm_uint max_iteration_count,
+                                GM_OUT_PARAM gm_uint *executed_count);
+
+/**
+ * Same as `gmComputeIterationCost_`, also computing the squared magnitude of
+ * the last point of the orbit.
+ */
+gm_uint gmComputeIterationData_(double c_x, double c_y,
+                                gm_uint max_iteration_count,
+                                GM_OUT_PARAM double *squared_magnitude,
+                                GM_OUT_PARAM gm_uint *executed_count);
+
+/**
+ * Same color as the shaders for the specified hue, in [0, 1].
+ */
+void gmHueToRgb_(GM_OUT_PARAM unsigned char *rgb, float hue);
+
+/**
+ * Same color as the fragment shader, black for points inside the set.
+ */
+void gmIterationCountToRgb_(GM_OUT_PARAM unsigned char *rgb,
+                            gm_uint iteration_count,
+                            gm_uint max_iteration_count);
@@ -0,0 +1,66 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "per-pixel.h"
+
+#include <stdlib.h>
+
+#include "cpu.h"
+#include "region.h"
+#include "thread-pool.h"
+
+void gmComputeRows_(void *image, size_t begin, size_t end,
+                    size_t worker_index);
+
+void gmComputeAllPixels_(const gmIterationImage_ *image, gmThreadPool_ *pool) {
+  // Small row chunks balance the load between the cheap rows far from the set
+  // and the expensive rows going through it.
+  gmRunParallelFor_(pool, image->size.h, 4, gmComputeRows_, (void *)image);
+}
+
+void gmComputeRows_(void *image, size_t begin, size_t end,
+                    size_t worker_index) {
+  (void)worker_index;
+  const gmIterationImage_ *const kImage = image;
+
+  for (size_t y = begin; y < end; ++y) {
+    for (int x = 0; x < kImage->size.w; ++x) {
+      gmComputePixel_(kImage, x, (int)y);
+    }
+  }
+}
+
+typedef struct gmRegionWork_ {
+  const gmIterationImage_ *image;
+  const gmSpan_ *spans;
+} gmRegionWork_;
+
+void gmComputeSpans_(void *region_work, size_t begin, size_t end,
+                     size_t worker_index);
+
+void gmComputeRegionPixels_(const gmIterationImage_ *image,
+                            gmThreadPool_ *pool) {
+  size_t span_count;
+  gmSpan_ *const kSpans =
+      gmGetRegionSpans_(&span_count, image->coverage, &image->size);
+
+  // Spans are often shorter than rows, they are handed out in larger chunks.
+  gmRegionWork_ region_work = {.image = image, .spans = kSpans};
+  gmRunParallelFor_(pool, span_count, 16, gmComputeSpans_, &region_work);
+
+  free(kSpans);
+}
+
+void gmComputeSpans_(void *region_work, size_t begin, size_t end,
+                     size_t worker_index) {
+  (void)worker_index;
+  const gmRegionWork_ *const kWork = region_work;
+
+  for (size_t i = begin; i < end; ++i) {
+    const gmSpan_ *const kSpan = &kWork->spans[i];
+
+    for (int x = kSpan->begin; x < kSpan->end; ++x) {
+      gmComputePixel_(kWork->image, x, kSpan->y);
+    }
+  }
+}
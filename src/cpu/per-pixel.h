@@ -0,0 +1,19 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "cpu.h"
+#include "thread-pool.h"
+
+/**
+ * Computes every pixel of the image, rows being split between the workers.
+ */
+void gmComputeAllPixels_(const gmIterationImage_ *image, gmThreadPool_ *pool);
+
+/**
+ * Computes the pixels inside the region of the image, the spans of the region
+ * being split between the workers.
+ */
+void gmComputeRegionPixels_(const gmIterationImage_ *image,
+                            gmThreadPool_ *pool);
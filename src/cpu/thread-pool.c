@@ -0,0 +1,345 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "thread-pool.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>  // For sysconf.
+
+#include "gm/error.h"
+#include "setup.h"
+
+typedef struct gmTask_ {
+  gmTaskFunc_ func;
+  void *data;
+} gmTask_;
+
+/**
+ * Ring buffer used as a double-ended queue.  The owner pushes and pops at the
+ * back, thieves pop at the front.
+ */
+typedef struct gmTaskQueue_ {
+  pthread_mutex_t mutex;
+  gmTask_ *tasks;
+  size_t capacity;
+  size_t front;
+  size_t count;
+} gmTaskQueue_;
+
+typedef struct gmWorker_ {
+  gmThreadPool_ *pool;
+  size_t index;
+  pthread_t thread;
+  gmTaskQueue_ queue;
+} gmWorker_;
+
+struct gmThreadPool_ {
+  gmWorker_ *workers;
+  size_t thread_count;
+
+  /**
+   * Identifies the worker of the calling thread, if any.
+   */
+  pthread_key_t worker_key;
+
+  // Protects the counters below, workers sleep on `work_cond` when no task is
+  // queued and `gmWaitForTasks_` sleeps on `done_cond`.
+  pthread_mutex_t mutex;
+  pthread_cond_t work_cond;
+  pthread_cond_t done_cond;
+
+  size_t queued_count;
+
+  /**
+   * Queued and running tasks.
+   */
+  size_t pending_count;
+
+  size_t next_queue_index;
+  int stopping;
+};
+
+gmError gmStartWorkers_(gmThreadPool_ *pool);
+
+gmError gmCreateThreadPool_(GM_OUT_PARAM gmThreadPool_ **pool,
+                            size_t thread_count) {
+  gmThreadPool_ *const kPool = calloc(1, sizeof(gmThreadPool_));
+  kPool->thread_count = thread_count ? thread_count : gmGetProcessorCount_();
+  kPool->workers = calloc(kPool->thread_count, sizeof(gmWorker_));
+
+  pthread_key_create(&kPool->worker_key, NULL);
+  pthread_mutex_init(&kPool->mutex, NULL);
+  pthread_cond_init(&kPool->work_cond, NULL);
+  pthread_cond_init(&kPool->done_cond, NULL);
+
+  const gmError kError = gmStartWorkers_(kPool);
+  if (!kError) {
+    *pool = kPool;
+  }
+
+  return kError;
+}
+
+void *gmRunWorker_(void *worker);
+
+void gmStopWorkers_(gmThreadPool_ *pool, size_t started_count);
+
+gmError gmStartWorkers_(gmThreadPool_ *pool) {
+  size_t started_count = 0;
+  for (; started_count < pool->thread_count; ++started_count) {
+    gmWorker_ *const kWorker = &pool->workers[started_count];
+    kWorker->pool = pool;
+    kWorker->index = started_count;
+    pthread_mutex_init(&kWorker->queue.mutex, NULL);
+
+    if (pthread_create(&kWorker->thread, NULL, gmRunWorker_, kWorker)) {
+      pthread_mutex_destroy(&kWorker->queue.mutex);
+      break;
+    }
+  }
+
+  if (started_count < pool->thread_count) {
+    gmStopWorkers_(pool, started_count);
+    return gmError_ThreadCreationFailed;
+  }
+
+  return gmError_Success;
+}
+
+void gmDeleteThreadPool_(gmThreadPool_ *pool) {
+  gmStopWorkers_(pool, pool->thread_count);
+}
+
+void gmStopWorkers_(gmThreadPool_ *pool, size_t started_count) {
+  pthread_mutex_lock(&pool->mutex);
+  pool->stopping = 1;
+  pthread_cond_broadcast(&pool->work_cond);
+  pthread_mutex_unlock(&pool->mutex);
+
+  for (size_t i = 0; i < started_count; ++i) {
+    gmWorker_ *const kWorker = &pool->workers[i];
+    pthread_join(kWorker->thread, NULL);
+
+    pthread_mutex_destroy(&kWorker->queue.mutex);
+    free(kWorker->queue.tasks);
+  }
+
+  pthread_cond_destroy(&pool->done_cond);
+  pthread_cond_destroy(&pool->work_cond);
+  pthread_mutex_destroy(&pool->mutex);
+  pthread_key_delete(pool->worker_key);
+
+  free(pool->workers);
+  free(pool);
+}
+
+size_t gmGetThreadPoolSize_(const gmThreadPool_ *pool) {
+  return pool->thread_count;
+}
+
+void gmPushTask_(gmTaskQueue_ *queue, const gmTask_ *task);
+
+void gmSubmitTask_(gmThreadPool_ *pool, gmTaskFunc_ func, void *data) {
+  const gmTask_ kTask = {.func = func, .data = data};
+
+  pthread_mutex_lock(&pool->mutex);
+  ++pool->queued_count;
+  ++pool->pending_count;
+
+  const gmWorker_ *const kCurrentWorker =
+      pthread_getspecific(pool->worker_key);
+
+  const size_t kQueueIndex =
+      kCurrentWorker ? kCurrentWorker->index
+                     : pool->next_queue_index++ % pool->thread_count;
+
+  // The task is pushed while holding the pool mutex so that a worker counting
+  // it as queued always finds it.
+  gmPushTask_(&pool->workers[kQueueIndex].queue, &kTask);
+
+  pthread_cond_signal(&pool->work_cond);
+  pthread_mutex_unlock(&pool->mutex);
+}
+
+void gmPushTask_(gmTaskQueue_ *queue, const gmTask_ *task) {
+  pthread_mutex_lock(&queue->mutex);
+
+  if (queue->count == queue->capacity) {
+    const size_t kNewCapacity = queue->capacity ? queue->capacity * 2 : 64;
+    gmTask_ *const kTasks = malloc(kNewCapacity * sizeof(gmTask_));
+
+    // Unwrap the ring buffer into the new storage.
+    for (size_t i = 0; i < queue->count; ++i) {
+      kTasks[i] = queue->tasks[(queue->front + i) % queue->capacity];
+    }
+
+    free(queue->tasks);
+    queue->tasks = kTasks;
+    queue->capacity = kNewCapacity;
+    queue->front = 0;
+  }
+
+  queue->tasks[(queue->front + queue->count) % queue->capacity] = *task;
+  ++queue->count;
+
+  pthread_mutex_unlock(&queue->mutex);
+}
+
+void gmWaitForTasks_(gmThreadPool_ *pool) {
+  pthread_mutex_lock(&pool->mutex);
+
+  while (pool->pending_count) {
+    pthread_cond_wait(&pool->done_cond, &pool->mutex);
+  }
+
+  pthread_mutex_unlock(&pool->mutex);
+}
+
+int gmWaitForTask_(gmWorker_ *worker, GM_OUT_PARAM gmTask_ *task);
+
+void gmFinishTask_(gmThreadPool_ *pool);
+
+void *gmRunWorker_(void *worker) {
+  gmWorker_ *const kWorker = worker;
+  pthread_setspecific(kWorker->pool->worker_key, kWorker);
+
+  gmTask_ task;
+  while (gmWaitForTask_(kWorker, &task)) {
+    task.func(task.data, kWorker->index);
+    gmFinishTask_(kWorker->pool);
+  }
+
+  return NULL;
+}
+
+int gmTakeTask_(gmWorker_ *worker, GM_OUT_PARAM gmTask_ *task);
+
+/**
+ * @return 0 when the pool is stopping, in which case no task is returned.
+ */
+int gmWaitForTask_(gmWorker_ *worker, GM_OUT_PARAM gmTask_ *task) {
+  gmThreadPool_ *const kPool = worker->pool;
+  pthread_mutex_lock(&kPool->mutex);
+
+  while (!kPool->queued_count && !kPool->stopping) {
+    pthread_cond_wait(&kPool->work_cond, &kPool->mutex);
+  }
+
+  const int kHasTask = kPool->queued_count > 0;
+  if (kHasTask) {
+    // Reserve a task before looking for it so that other workers don't go
+    // looking for the same one.
+    --kPool->queued_count;
+  }
+
+  pthread_mutex_unlock(&kPool->mutex);
+
+  // Tasks are taken out of the queues outside of the pool mutex, the reserved
+  // task is always found because submissions push before counting.
+  return kHasTask && gmTakeTask_(worker, task);
+}
+
+int gmPopBackTask_(gmTaskQueue_ *queue, GM_OUT_PARAM gmTask_ *task);
+int gmPopFrontTask_(gmTaskQueue_ *queue, GM_OUT_PARAM gmTask_ *task);
+
+int gmTakeTask_(gmWorker_ *worker, GM_OUT_PARAM gmTask_ *task) {
+  if (gmPopBackTask_(&worker->queue, task)) {
+    return 1;
+  }
+
+  // Steal from the other workers, starting with the next one so that thieves
+  // don't all target the first worker.
+  gmThreadPool_ *const kPool = worker->pool;
+
+  for (;;) {
+    for (size_t i = 1; i < kPool->thread_count; ++i) {
+      const size_t kVictim = (worker->index + i) % kPool->thread_count;
+      if (gmPopFrontTask_(&kPool->workers[kVictim].queue, task)) {
+        return 1;
+      }
+    }
+
+    // Another thief may hold the reserved task's queue lock, or the task may
+    // have been pushed back to our own queue in the meantime.
+    if (gmPopBackTask_(&worker->queue, task)) {
+      return 1;
+    }
+  }
+}
+
+int gmPopBackTask_(gmTaskQueue_ *queue, GM_OUT_PARAM gmTask_ *task) {
+  pthread_mutex_lock(&queue->mutex);
+
+  const int kHasTask = queue->count > 0;
+  if (kHasTask) {
+    --queue->count;
+    *task = queue->tasks[(queue->front + queue->count) % queue->capacity];
+  }
+
+  pthread_mutex_unlock(&queue->mutex);
+  return kHasTask;
+}
+
+int gmPopFrontTask_(gmTaskQueue_ *queue, GM_OUT_PARAM gmTask_ *task) {
+  pthread_mutex_lock(&queue->mutex);
+
+  const int kHasTask = queue->count > 0;
+  if (kHasTask) {
+    *task = queue->tasks[queue->front];
+    queue->front = (queue->front + 1) % queue->capacity;
+    --queue->count;
+  }
+
+  pthread_mutex_unlock(&queue->mutex);
+  return kHasTask;
+}
+
+void gmFinishTask_(gmThreadPool_ *pool) {
+  pthread_mutex_lock(&pool->mutex);
+
+  if (!--pool->pending_count) {
+    pthread_cond_broadcast(&pool->done_cond);
+  }
+
+  pthread_mutex_unlock(&pool->mutex);
+}
+
+typedef struct gmRangeTask_ {
+  gmRangeFunc_ func;
+  void *data;
+  size_t begin;
+  size_t end;
+} gmRangeTask_;
+
+void gmRunRangeTask_(void *range_task, size_t worker_index);
+
+void gmRunParallelFor_(gmThreadPool_ *pool, size_t count, size_t grain_size,
+                       gmRangeFunc_ func, void *data) {
+  const size_t kTaskCount = (count + grain_size - 1) / grain_size;
+  gmRangeTask_ *const kTasks = malloc(kTaskCount * sizeof(gmRangeTask_));
+
+  for (size_t i = 0; i < kTaskCount; ++i) {
+    const size_t kBegin = i * grain_size;
+    const size_t kEnd =
+        kBegin + grain_size < count ? kBegin + grain_size : count;
+
+    kTasks[i] = (gmRangeTask_){
+        .func = func, .data = data, .begin = kBegin, .end = kEnd};
+
+    gmSubmitTask_(pool, gmRunRangeTask_, &kTasks[i]);
+  }
+
+  gmWaitForTasks_(pool);
+  free(kTasks);
+}
+
+void gmRunRangeTask_(void *range_task, size_t worker_index) {
+  const gmRangeTask_ *const kTask = range_task;
+  kTask->func(kTask->data, kTask->begin, kTask->end, worker_index);
+}
+
+size_t gmGetProcessorCount_() {
+  const long kCount = sysconf(_SC_NPROCESSORS_ONLN);
+  return kCount > 0 ? (size_t)kCount : 1;
+}
@@ -0,0 +1,62 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include <stdlib.h>  // For size_t.
+
+#include "gm/error.h"
+#include "setup.h"
+
+/**
+ * Work-stealing thread pool.  Each worker owns a double-ended task queue: it
+ * runs its own tasks last in first out and steals the oldest tasks of the other
+ * workers once its queue is empty.
+ */
+typedef struct gmThreadPool_ gmThreadPool_;
+
+/**
+ * @param worker_index Index of the worker running the task, less than the
+ * thread count of the pool.
+ */
+typedef void (*gmTaskFunc_)(void *data, size_t worker_index);
+
+/**
+ * A thread count of 0 creates one worker per online processor.
+ */
+gmError gmCreateThreadPool_(GM_OUT_PARAM gmThreadPool_ **pool,
+                            size_t thread_count);
+
+void gmDeleteThreadPool_(gmThreadPool_ *pool);
+
+size_t gmGetThreadPoolSize_(const gmThreadPool_ *pool);
+
+/**
+ * Queues a task.  Tasks submitted from a worker go to the queue of that
+ * worker, other tasks are spread over the workers.
+ */
+void gmSubmitTask_(gmThreadPool_ *pool, gmTaskFunc_ func, void *data);
+
+/**
+ * Blocks until every submitted task, including the tasks submitted by other
+ * tasks, is done.
+ */
+void gmWaitForTasks_(gmThreadPool_ *pool);
+
+/**
+ * Processes the range [begin, end[ of a parallel loop.
+ */
+typedef void (*gmRangeFunc_)(void *data, size_t begin, size_t end,
+                             size_t worker_index);
+
+/**
+ * Splits the range [0, count[ into chunks of `grain_size` elements processed
+ * by the workers, and waits for them to be done.
+ */
+void gmRunParallelFor_(gmThreadPool_ *pool, size_t count, size_t grain_size,
+                       gmRangeFunc_ func, void *data);
+
+/**
+ * @return The number of online processors.
+ */
+size_t gmGetProcessorCount_();
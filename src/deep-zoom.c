@@ -0,0 +1,471 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "deep-zoom.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>  // For mkdir.
+
+#include "cpu/thread-pool.h"
+#include "file-writer.h"
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "image-config.h"
+#include "png.h"
+#include "setup.h"
+
+/**
+ * Tiles rendered at once along a row of tiles of the finest level.
+ */
+#define GM_DEEP_ZOOM_STRIP_TILE_COUNT_ 8
+
+typedef struct gmPyramidLevel_ {
+  gmIntSize size;
+
+  /**
+   * Row of tiles being filled, tightly packed RGB rows from the top of the
+   * level.  Each row of tiles of a level is filled by two rows of tiles of
+   * the next finer level.
+   */
+  unsigned char *band_data;
+  int band_index;
+  int band_row_count;
+} gmPyramidLevel_;
+
+typedef struct gmPyramid_ {
+  char *tile_dirpath;
+
+  /**
+   * From the 1x1 level to the finest one, each level being half the size of
+   * the next one, rounded up.
+   */
+  gmPyramidLevel_ *levels;
+  int level_count;
+
+  /**
+   * Encodes the tiles of a row in parallel.
+   */
+  gmThreadPool_ *pool;
+
+  /**
+   * Writes the encoded tiles while the next rows render.
+   */
+  gmFileWriter_ *file_writer;
+} gmPyramid_;
+
+gmError gmCreatePyramid_(GM_OUT_PARAM gmPyramid_ *pyramid,
+                         const char *filepath, const gmIntSize *size);
+
+gmError gmRenderPyramid_(gmPyramid_ *pyramid,
+                         const gmImageConfig *image_config,
+                         gmRenderStripFunc_ render_strip, void *user_data);
+
+gmError gmWriteDeepZoomManifest_(const char *filepath, const gmIntSize *size);
+
+gmError gmDeletePyramid_(const gmPyramid_ *pyramid);
+
+gmError gmWriteDeepZoomImage_(const char *filepath,
+                              const gmImageConfig *image_config,
+                              gmRenderStripFunc_ render_strip,
+                              void *user_data) {
+  gmError error;
+
+  gmPyramid_ pyramid;
+  error = gmCreatePyramid_(&pyramid, filepath, &image_config->size);
+  if (!error) {
+    error = gmRenderPyramid_(&pyramid, image_config, render_strip, user_data);
+
+    // Waits for the tiles to be written.
+    const gmError kWriteError = gmDeletePyramid_(&pyramid);
+    if (!error) {
+      error = kWriteError;
+    }
+
+    // Written last, so that viewers never see a partial pyramid.
+    if (!error) {
+      error = gmWriteDeepZoomManifest_(filepath, &image_config->size);
+    }
+  }
+
+  return error;
+}
+
+void gmCreatePyramidLevels_(gmPyramid_ *pyramid, const gmIntSize *size);
+char *gmGetTileDirpath_(const char *filepath);
+gmError gmCreateTileDirectories_(const gmPyramid_ *pyramid);
+
+gmError gmCreatePyramid_(GM_OUT_PARAM gmPyramid_ *pyramid,
+                         const char *filepath, const gmIntSize *size) {
+  gmError error;
+
+  error = gmCreateThreadPool_(&pyramid->pool, 0);
+  if (!error) {
+    error = gmCreateFileWriter_(&pyramid->file_writer,
+                                GM_DEFAULT_MAX_QUEUED_FILE_SIZE_);
+    if (!error) {
+      gmCreatePyramidLevels_(pyramid, size);
+      pyramid->tile_dirpath = gmGetTileDirpath_(filepath);
+
+      error = gmCreateTileDirectories_(pyramid);
+      if (error) {
+        gmDeletePyramid_(pyramid);
+      }
+    } else {
+      gmDeleteThreadPool_(pyramid->pool);
+    }
+  }
+
+  return error;
+}
+
+void gmCreatePyramidLevels_(gmPyramid_ *pyramid, const gmIntSize *size) {
+  // The finest level is the first one whose size is a power of two at least
+  // as large as the image.
+  const int kMaxSize = size->w > size->h ? size->w : size->h;
+  int max_level = 0;
+  while ((1 << max_level) < kMaxSize) {
+    ++max_level;
+  }
+
+  pyramid->level_count = max_level + 1;
+  pyramid->levels = calloc(pyramid->level_count, sizeof(gmPyramidLevel_));
+
+  gmIntSize level_size = *size;
+  for (int i = max_level; i >= 0; --i) {
+    gmPyramidLevel_ *const kLevel = &pyramid->levels[i];
+    kLevel->size = level_size;
+    kLevel->band_data =
+        malloc((size_t)level_size.w * GM_DEEP_ZOOM_TILE_SIZE_ * 3);  // RGB.
+
+    level_size.w = (level_size.w + 1) / 2;
+    level_size.h = (level_size.h + 1) / 2;
+  }
+}
+
+/**
+ * @return The path of the directory of the tiles, "image_files" for the
+ * "image.dzi" manifest, to be freed.
+ */
+char *gmGetTileDirpath_(const char *filepath) {
+  const char *const kExtension = ".dzi";
+  const size_t kLength = strlen(filepath);
+  const size_t kExtensionLength = strlen(kExtension);
+
+  const int kHasExtension =
+      (kLength >= kExtensionLength) &&
+      !strcmp(filepath + kLength - kExtensionLength, kExtension);
+  const size_t kBaseLength =
+      kHasExtension ? kLength - kExtensionLength : kLength;
+
+  const char *const kSuffix = "_files";
+  char *const kDirpath = malloc(kBaseLength + strlen(kSuffix) + 1);
+  sprintf(kDirpath, "%.*s%s", (int)kBaseLength, filepath, kSuffix);
+
+  return kDirpath;
+}
+
+int gmMakeDirectory_(const char *dirpath);
+
+gmError gmCreateTileDirectories_(const gmPyramid_ *pyramid) {
+  if (!gmMakeDirectory_(pyramid->tile_dirpath)) {
+    return gmError_ImageWriteFailed;
+  }
+
+  char *const kLevelDirpath = malloc(strlen(pyramid->tile_dirpath) + 16);
+  int has_failed = 0;
+
+  for (int i = 0; (i < pyramid->level_count) && !has_failed; ++i) {
+    sprintf(kLevelDirpath, "%s/%d", pyramid->tile_dirpath, i);
+    has_failed = !gmMakeDirectory_(kLevelDirpath);
+  }
+
+  free(kLevelDirpath);
+  return !has_failed ? gmError_Success : gmError_ImageWriteFailed;
+}
+
+/**
+ * @return Whether the directory exists, the pyramids of previous renders being
+ * overwritten.
+ */
+int gmMakeDirectory_(const char *dirpath) {
+  return !mkdir(dirpath, 0755) || (errno == EEXIST);
+}
+
+void gmCopyStrip_(gmPyramidLevel_ *level, const unsigned char *strip_data,
+                  int x, int strip_width);
+
+gmError gmFlushBand_(gmPyramid_ *pyramid, int level_index);
+
+gmError gmRenderPyramid_(gmPyramid_ *pyramid,
+                         const gmImageConfig *image_config,
+                         gmRenderStripFunc_ render_strip, void *user_data) {
+  gmError error = gmError_Success;
+
+  const int kTileSize = GM_DEEP_ZOOM_TILE_SIZE_;
+  const gmIntSize *const kSize = &image_config->size;
+  const int kColumnCount = (kSize->w + kTileSize - 1) / kTileSize;
+  const int kBandCount = (kSize->h + kTileSize - 1) / kTileSize;
+
+  // Every strip has the same size so that the renderer keeps its resources,
+  // the pixels outside of the image are rendered and dropped.
+  const int kStripTileCount = kColumnCount < GM_DEEP_ZOOM_STRIP_TILE_COUNT_
+                                  ? kColumnCount
+                                  : GM_DEEP_ZOOM_STRIP_TILE_COUNT_;
+  const int kStripWidth = kStripTileCount * kTileSize;
+
+  gmViewport viewport;
+  gmGetViewport_(&viewport, image_config);
+
+  const double kStepX = viewport.width / kSize->w;
+  const double kStepY = viewport.height / kSize->h;
+  const double kLeft = viewport.center_x - viewport.width / 2.0;
+  const double kBottom = viewport.center_y - viewport.height / 2.0;
+
+  gmImageConfig strip_config = *image_config;
+  strip_config.size.w = kStripWidth;
+  strip_config.size.h = kTileSize;
+  strip_config.viewport.width = kStripWidth * kStepX;
+  strip_config.viewport.height = kTileSize * kStepY;
+
+  // Strips are not previewed, and are rendered whole.
+  memset(&strip_config.preview, 0, sizeof(gmPreviewConfig));
+  memset(&strip_config.region, 0, sizeof(gmRegionConfig));
+
+  // Equalizing each strip on its own would change the colors between strips.
+  strip_config.coloring_mode = gmColoringMode_Cyclic;
+
+  unsigned char *const kStripData =
+      malloc((size_t)kStripWidth * kTileSize * 3);  // RGB.
+
+  gmPyramidLevel_ *const kFinestLevel =
+      &pyramid->levels[pyramid->level_count - 1];
+
+  for (int band = 0; (band < kBandCount) && !error; ++band) {
+    const int kY = band * kTileSize;
+
+    for (int column = 0; (column < kColumnCount) && !error;
+         column += kStripTileCount) {
+      const int kX = column * kTileSize;
+
+      // The rows of the image go from the bottom of the viewport, like the
+      // rows of the PNG images.
+      strip_config.viewport.center_x =
+          kLeft + (kX + kStripWidth / 2.0) * kStepX;
+      strip_config.viewport.center_y =
+          kBottom + (kY + kTileSize / 2.0) * kStepY;
+
+      error = render_strip(kStripData, &strip_config, user_data);
+      if (!error) {
+        gmCopyStrip_(kFinestLevel, kStripData, kX, kStripWidth);
+      }
+    }
+
+    if (!error) {
+      const int kRowCount = kSize->h - kY;
+      kFinestLevel->band_row_count = kRowCount < kTileSize ? kRowCount
+                                                          : kTileSize;
+
+      error = gmFlushBand_(pyramid, pyramid->level_count - 1);
+    }
+  }
+
+  free(kStripData);
+  return error;
+}
+
+void gmCopyStrip_(gmPyramidLevel_ *level, const unsigned char *strip_data,
+                  int x, int strip_width) {
+  const int kRemainingWidth = level->size.w - x;
+  const int kCopiedWidth =
+      kRemainingWidth < strip_width ? kRemainingWidth : strip_width;
+
+  for (int y = 0; y < GM_DEEP_ZOOM_TILE_SIZE_; ++y) {
+    memcpy(&level->band_data[((size_t)y * level->size.w + x) * 3],
+           &strip_data[(size_t)y * strip_width * 3], (size_t)kCopiedWidth * 3);
+  }
+}
+
+gmError gmWriteBandTiles_(const gmPyramid_ *pyramid, int level_index);
+
+void gmDownsampleBand_(gmPyramidLevel_ *coarse_level,
+                       const gmPyramidLevel_ *level);
+
+/**
+ * Writes the tiles of the filled row of tiles of the level, then downsamples
+ * it into the coarser level, whose row of tiles is flushed in turn once
+ * filled.
+ */
+gmError gmFlushBand_(gmPyramid_ *pyramid, int level_index) {
+  gmError error;
+
+  gmPyramidLevel_ *const kLevel = &pyramid->levels[level_index];
+
+  error = gmWriteBandTiles_(pyramid, level_index);
+  if (!error && (level_index > 0)) {
+    gmDownsampleBand_(&pyramid->levels[level_index - 1], kLevel);
+
+    const int kIsLastBand =
+        (kLevel->band_index + 1) * GM_DEEP_ZOOM_TILE_SIZE_ >= kLevel->size.h;
+
+    if ((kLevel->band_index % 2) || kIsLastBand) {
+      error = gmFlushBand_(pyramid, level_index - 1);
+    }
+  }
+
+  ++kLevel->band_index;
+  kLevel->band_row_count = 0;
+
+  return error;
+}
+
+typedef struct gmBandTiles_ {
+  const gmPyramid_ *pyramid;
+  int level_index;
+
+  /**
+   * One flag per tile.
+   */
+  int *has_failed;
+} gmBandTiles_;
+
+void gmWriteTiles_(void *band_tiles, size_t begin, size_t end,
+                   size_t worker_index);
+
+gmError gmWriteBandTiles_(const gmPyramid_ *pyramid, int level_index) {
+  const gmPyramidLevel_ *const kLevel = &pyramid->levels[level_index];
+  const size_t kColumnCount =
+      (kLevel->size.w + GM_DEEP_ZOOM_TILE_SIZE_ - 1) / GM_DEEP_ZOOM_TILE_SIZE_;
+
+  gmBandTiles_ band_tiles = {.pyramid = pyramid,
+                             .level_index = level_index,
+                             .has_failed = calloc(kColumnCount, sizeof(int))};
+
+  gmRunParallelFor_(pyramid->pool, kColumnCount, 1, gmWriteTiles_,
+                    &band_tiles);
+
+  int has_failed = 0;
+  for (size_t i = 0; i < kColumnCount; ++i) {
+    has_failed |= band_tiles.has_failed[i];
+  }
+
+  free(band_tiles.has_failed);
+  return !has_failed ? gmError_Success : gmError_ImageWriteFailed;
+}
+
+void gmWriteTiles_(void *band_tiles, size_t begin, size_t end,
+                   size_t worker_index) {
+  (void)worker_index;
+
+  const gmBandTiles_ *const kBandTiles = band_tiles;
+  const gmPyramid_ *const kPyramid = kBandTiles->pyramid;
+  const gmPyramidLevel_ *const kLevel =
+      &kPyramid->levels[kBandTiles->level_index];
+  const int kTileSize = GM_DEEP_ZOOM_TILE_SIZE_;
+
+  char *const kTilePath = malloc(strlen(kPyramid->tile_dirpath) + 64);
+
+  for (size_t column = begin; column < end; ++column) {
+    const int kX = (int)column * kTileSize;
+    const int kRemainingWidth = kLevel->size.w - kX;
+    const int kWidth = kRemainingWidth < kTileSize ? kRemainingWidth
+                                                   : kTileSize;
+
+    sprintf(kTilePath, "%s/%d/%d_%d.png", kPyramid->tile_dirpath,
+            kBandTiles->level_index, (int)column, kLevel->band_index);
+
+    const gmIntSize kTileImageSize = {.w = kWidth,
+                                      .h = kLevel->band_row_count};
+
+    unsigned char *png_data;
+    size_t png_size;
+    kBandTiles->has_failed[column] =
+        gmEncodePngImage_(&png_data, &png_size,
+                          &kLevel->band_data[(size_t)kX * 3], &kTileImageSize,
+                          (size_t)kLevel->size.w * 3) != gmError_Success;
+
+    if (!kBandTiles->has_failed[column]) {
+      gmQueueFileWrite_(kPyramid->file_writer, kTilePath, png_data, png_size);
+    }
+  }
+
+  free(kTilePath);
+}
+
+/**
+ * Averages the pixels of the filled row of tiles of the level by blocks of
+ * 2x2 into the top or bottom half of the row of tiles of the coarser level.
+ * The last row and column are repeated for the levels of odd size.
+ */
+void gmDownsampleBand_(gmPyramidLevel_ *coarse_level,
+                       const gmPyramidLevel_ *level) {
+  const int kFirstRow = (level->band_index % 2) * GM_DEEP_ZOOM_TILE_SIZE_ / 2;
+  const int kRowCount = (level->band_row_count + 1) / 2;
+
+  const unsigned char *const kData = level->band_data;
+  const size_t kLineStride = (size_t)level->size.w * 3;
+
+  for (int y = 0; y < kRowCount; ++y) {
+    const int kTopY = 2 * y;
+    const int kBottomY = kTopY + 1 < level->band_row_count ? kTopY + 1 : kTopY;
+
+    const size_t kCoarseY = (size_t)kFirstRow + y;
+    unsigned char *const kCoarseRow =
+        &coarse_level->band_data[kCoarseY * coarse_level->size.w * 3];
+
+    for (int x = 0; x < coarse_level->size.w; ++x) {
+      const int kLeftX = 2 * x;
+      const int kRightX = kLeftX + 1 < level->size.w ? kLeftX + 1 : kLeftX;
+
+      for (int channel = 0; channel < 3; ++channel) {
+        const int kSum = kData[kTopY * kLineStride + kLeftX * 3 + channel] +
+                         kData[kTopY * kLineStride + kRightX * 3 + channel] +
+                         kData[kBottomY * kLineStride + kLeftX * 3 + channel] +
+                         kData[kBottomY * kLineStride + kRightX * 3 + channel];
+
+        kCoarseRow[x * 3 + channel] = (unsigned char)((kSum + 2) / 4);
+      }
+    }
+  }
+
+  coarse_level->band_row_count += kRowCount;
+}
+
+gmError gmWriteDeepZoomManifest_(const char *filepath, const gmIntSize *size) {
+  FILE *const kFile = fopen(filepath, "w");
+  if (!kFile) {
+    return gmError_ImageWriteFailed;
+  }
+
+  const int kPrintedCount = fprintf(
+      kFile,
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\"\n"
+      "       Format=\"png\" Overlap=\"0\" TileSize=\"%d\">\n"
+      "  <Size Width=\"%d\" Height=\"%d\"/>\n"
+      "</Image>\n",
+      GM_DEEP_ZOOM_TILE_SIZE_, size->w, size->h);
+
+  const int kCloseError = fclose(kFile);
+  return (kPrintedCount >= 0) && !kCloseError ? gmError_Success
+                                              : gmError_ImageWriteFailed;
+}
+
+/**
+ * @return `gmError_ImageWriteFailed` when a tile could not be written.
+ */
+gmError gmDeletePyramid_(const gmPyramid_ *pyramid) {
+  const gmError kError = gmDeleteFileWriter_(pyramid->file_writer);
+
+  for (int i = 0; i < pyramid->level_count; ++i) {
+    free(pyramid->levels[i].band_data);
+  }
+
+  free(pyramid->levels);
+  free(pyramid->tile_dirpath);
+  gmDeleteThreadPool_(pyramid->pool);
+
+  return kError;
+}
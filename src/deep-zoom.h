@@ -0,0 +1,33 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "setup.h"
+
+#define GM_DEEP_ZOOM_TILE_SIZE_ 256
+
+/**
+ * Renders a strip of the image with the specified config, which has the size
+ * and viewport of the strip.
+ *
+ * @param strip_data Tightly packed RGB data, laid out like the data read back
+ * from the GPU.
+ */
+typedef gmError (*gmRenderStripFunc_)(GM_OUT_PARAM unsigned char *strip_data,
+                                      const gmImageConfig *strip_config,
+                                      void *user_data);
+
+/**
+ * Writes the Deep Zoom pyramid of the image: the manifest at the specified
+ * path, and the tiles of each level in the `_files` directory next to it.  The
+ * finest level is rendered one row of tiles at a time in strips of a few
+ * tiles, the coarser levels are downsampled from it while it is rendered,
+ * keeping a single row of tiles of each level in memory.
+ */
+gmError gmWriteDeepZoomImage_(const char *filepath,
+                              const gmImageConfig *image_config,
+                              gmRenderStripFunc_ render_strip,
+                              void *user_data);
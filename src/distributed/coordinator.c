@@ -0,0 +1,495 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>  // For memset.
+#include <unistd.h>  // For close.
+
+#include "budget.h"
+#include "clock.h"
+#include "cpu/kernel.h"
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "image-config.h"
+#include "iteration-file.h"
+#include "png.h"
+#include "protocol.h"
+#include "setup.h"
+#include "socket.h"
+
+/**
+ * Tiles requested at once from each worker, so that workers start the next
+ * tile while the previous one is sent.
+ */
+#define GM_MAX_IN_FLIGHT_TILE_COUNT_ 2
+
+/**
+ * Failures after which a worker is not connected to anymore.
+ */
+#define GM_MAX_WORKER_FAILURE_COUNT_ 3
+
+/**
+ * Seconds before connecting again to a worker after its first failure,
+ * doubled by the next ones.
+ */
+#define GM_RECONNECT_DELAY_ 0.25
+
+typedef struct gmTileState_ {
+  int is_done;
+
+  /**
+   * Workers computing the tile, more than one once stolen.
+   */
+  int assignment_count;
+} gmTileState_;
+
+typedef struct gmRemoteWorker_ {
+  const char *address;
+
+  /**
+   * -1 when disconnected.
+   */
+  int socket;
+
+  /**
+   * Tiles requested from the worker, in the order of the requests.
+   */
+  size_t in_flight_tiles[GM_MAX_IN_FLIGHT_TILE_COUNT_];
+  size_t in_flight_count;
+
+  double reconnect_time;
+  gmWorkerReport *report;
+} gmRemoteWorker_;
+
+typedef struct gmCoordinator_ {
+  gmTileRequest_ request;
+  size_t tile_column_count;
+  size_t tile_count;
+  size_t done_count;
+  gmTileState_ *tiles;
+
+  /**
+   * Ring buffer of the tiles requested from no worker.
+   */
+  size_t *queued_tiles;
+  size_t queued_front;
+  size_t queued_count;
+
+  gmRemoteWorker_ *workers;
+  size_t worker_count;
+
+  /**
+   * Receives the tile data sent by the workers.
+   */
+  float *tile_data;
+
+  /**
+   * The image data is only used for PNG images, the file for iteration files.
+   */
+  unsigned char *image_data;
+  gmIterationFile_ file;
+  int writes_iteration_file;
+} gmCoordinator_;
+
+void gmCreateCoordinator_(GM_OUT_PARAM gmCoordinator_ *coordinator,
+                          const gmImageConfig *image_config,
+                          const gmDistributedConfig *distributed_config,
+                          gmWorkerReport *worker_reports);
+
+gmError gmRunCoordinator_(gmCoordinator_ *coordinator);
+
+void gmReportWorkerThroughputs_(const gmCoordinator_ *coordinator,
+                                double render_time);
+
+void gmDeleteCoordinator_(const gmCoordinator_ *coordinator);
+
+gmError gmRunDistributed(const gmConfig *config,
+                         const gmDistributedConfig *distributed_config) {
+  gmError error = gmError_Success;
+
+  const gmImageConfig *const kImageConfig = &config->image_config;
+  gmWorkerReport *const kWorkerReports =
+      distributed_config->worker_reports
+          ? distributed_config->worker_reports
+          : malloc(distributed_config->worker_count * sizeof(gmWorkerReport));
+
+  gmCoordinator_ coordinator;
+  gmCreateCoordinator_(&coordinator, kImageConfig, distributed_config,
+                       kWorkerReports);
+
+  coordinator.writes_iteration_file =
+      config->image_format == gmImageFormat_Iterations;
+
+  if (coordinator.writes_iteration_file) {
+    error = gmCreateIterationFile_(&coordinator.file,
+                                   config->image_output_filepath, kImageConfig);
+  } else {
+    coordinator.image_data =
+        malloc((size_t)kImageConfig->size.w * kImageConfig->size.h * 3);
+  }
+
+  if (!error) {
+    const double kStartTime = gmGetTime_();
+    error = gmRunCoordinator_(&coordinator);
+    const double kRenderTime = gmGetTime_() - kStartTime;
+
+    if (coordinator.writes_iteration_file) {
+      error = gmCloseIterationFile_(&coordinator.file,
+                                    config->image_output_filepath, error);
+    } else if (!error) {
+      const gmIntSize *const kSize = &kImageConfig->size;
+      error = gmWritePngImage_(config->image_output_filepath,
+                               coordinator.image_data, kSize,
+                               (size_t)kSize->w * 3);
+    }
+
+    gmReportWorkerThroughputs_(&coordinator, kRenderTime);
+
+    if (!error && config->report) {
+      gmInitReport_(config->report, kImageConfig);
+      config->report->render_time = kRenderTime;
+    }
+  }
+
+  gmDeleteCoordinator_(&coordinator);
+
+  if (!distributed_config->worker_reports) {
+    free(kWorkerReports);
+  }
+
+  return error;
+}
+
+void gmCreateCoordinator_(GM_OUT_PARAM gmCoordinator_ *coordinator,
+                          const gmImageConfig *image_config,
+                          const gmDistributedConfig *distributed_config,
+                          gmWorkerReport *worker_reports) {
+  const gmIntSize *const kSize = &image_config->size;
+  const int kTileSize = GM_ITERATION_FILE_TILE_SIZE;
+  const size_t kTileRowCount = (kSize->h + kTileSize - 1) / kTileSize;
+
+  memset(coordinator, 0, sizeof(gmCoordinator_));
+
+  coordinator->request.magic = GM_TILE_REQUEST_MAGIC_;
+  coordinator->request.max_iteration_count =
+      gmGetMaxIterationCount_(image_config);
+  coordinator->request.width = kSize->w;
+  coordinator->request.height = kSize->h;
+  gmGetPixelMapping_(&coordinator->request.mapping, image_config);
+
+  coordinator->tile_column_count = (kSize->w + kTileSize - 1) / kTileSize;
+  coordinator->tile_count = coordinator->tile_column_count * kTileRowCount;
+  coordinator->tiles = calloc(coordinator->tile_count, sizeof(gmTileState_));
+
+  // Every tile is queued, from the bottom left one.
+  coordinator->queued_tiles = malloc(coordinator->tile_count * sizeof(size_t));
+  coordinator->queued_count = coordinator->tile_count;
+  for (size_t i = 0; i < coordinator->tile_count; ++i) {
+    coordinator->queued_tiles[i] = i;
+  }
+
+  coordinator->worker_count = distributed_config->worker_count;
+  coordinator->workers =
+      calloc(coordinator->worker_count, sizeof(gmRemoteWorker_));
+
+  for (size_t i = 0; i < coordinator->worker_count; ++i) {
+    gmRemoteWorker_ *const kWorker = &coordinator->workers[i];
+    kWorker->address = distributed_config->worker_addresses[i];
+    kWorker->socket = -1;
+    kWorker->report = &worker_reports[i];
+    memset(kWorker->report, 0, sizeof(gmWorkerReport));
+  }
+
+  coordinator->tile_data = malloc(GM_TILE_FLOAT_COUNT_ * sizeof(float));
+}
+
+void gmConnectWorkers_(gmCoordinator_ *coordinator);
+void gmRequestTiles_(gmCoordinator_ *coordinator, gmRemoteWorker_ *worker);
+int gmHasLiveWorkers_(const gmCoordinator_ *coordinator);
+
+gmError gmReceiveTiles_(gmCoordinator_ *coordinator);
+
+gmError gmRunCoordinator_(gmCoordinator_ *coordinator) {
+  gmError error = gmError_Success;
+
+  while ((coordinator->done_count < coordinator->tile_count) && !error) {
+    gmConnectWorkers_(coordinator);
+
+    for (size_t i = 0; i < coordinator->worker_count; ++i) {
+      gmRequestTiles_(coordinator, &coordinator->workers[i]);
+    }
+
+    error = gmHasLiveWorkers_(coordinator) ? gmReceiveTiles_(coordinator)
+                                            : gmError_WorkersFailed;
+  }
+
+  return error;
+}
+
+void gmCountWorkerFailure_(gmRemoteWorker_ *worker, double time);
+
+void gmConnectWorkers_(gmCoordinator_ *coordinator) {
+  const double kTime = gmGetTime_();
+
+  for (size_t i = 0; i < coordinator->worker_count; ++i) {
+    gmRemoteWorker_ *const kWorker = &coordinator->workers[i];
+
+    if ((kWorker->socket >= 0) ||
+        (kWorker->report->failure_count >= GM_MAX_WORKER_FAILURE_COUNT_) ||
+        (kTime < kWorker->reconnect_time)) {
+      continue;
+    }
+
+    kWorker->socket = gmConnect_(kWorker->address);
+    if (kWorker->socket < 0) {
+      gmCountWorkerFailure_(kWorker, kTime);
+    }
+  }
+}
+
+void gmCountWorkerFailure_(gmRemoteWorker_ *worker, double time) {
+  ++worker->report->failure_count;
+  worker->reconnect_time =
+      time + GM_RECONNECT_DELAY_ * (1 << (worker->report->failure_count - 1));
+}
+
+int gmPickTile_(gmCoordinator_ *coordinator, const gmRemoteWorker_ *worker,
+                GM_OUT_PARAM size_t *tile);
+
+void gmFailWorker_(gmCoordinator_ *coordinator, gmRemoteWorker_ *worker);
+
+void gmRequestTiles_(gmCoordinator_ *coordinator, gmRemoteWorker_ *worker) {
+  size_t tile;
+  while ((worker->socket >= 0) &&
+         (worker->in_flight_count < GM_MAX_IN_FLIGHT_TILE_COUNT_) &&
+         gmPickTile_(coordinator, worker, &tile)) {
+    gmTileRequest_ request = coordinator->request;
+    request.column = tile % coordinator->tile_column_count;
+    request.row = tile / coordinator->tile_column_count;
+
+    ++coordinator->tiles[tile].assignment_count;
+    worker->in_flight_tiles[worker->in_flight_count++] = tile;
+
+    if (!gmSendAll_(worker->socket, &request, sizeof(request))) {
+      gmFailWorker_(coordinator, worker);
+    }
+  }
+}
+
+/**
+ * Picks the next queued tile.  Once every tile is requested, the workers left
+ * without work steal the oldest tiles of the other workers, so that a slow
+ * worker does not hold the end of the render.
+ *
+ * @return Whether a tile was picked.
+ */
+int gmPickTile_(gmCoordinator_ *coordinator, const gmRemoteWorker_ *worker,
+                GM_OUT_PARAM size_t *tile) {
+  if (coordinator->queued_count) {
+    *tile = coordinator->queued_tiles[coordinator->queued_front];
+    coordinator->queued_front =
+        (coordinator->queued_front + 1) % coordinator->tile_count;
+    --coordinator->queued_count;
+
+    return 1;
+  }
+
+  // Only the idle workers steal, their requests being answered first.
+  if (worker->in_flight_count) {
+    return 0;
+  }
+
+  for (size_t i = 0; i < GM_MAX_IN_FLIGHT_TILE_COUNT_; ++i) {
+    for (size_t j = 0; j < coordinator->worker_count; ++j) {
+      const gmRemoteWorker_ *const kVictim = &coordinator->workers[j];
+      if ((kVictim == worker) || (i >= kVictim->in_flight_count)) {
+        continue;
+      }
+
+      const size_t kTile = kVictim->in_flight_tiles[i];
+      const gmTileState_ *const kState = &coordinator->tiles[kTile];
+
+      if (!kState->is_done && (kState->assignment_count == 1)) {
+        *tile = kTile;
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+}
+
+void gmQueueTile_(gmCoordinator_ *coordinator, size_t tile);
+
+/**
+ * Disconnects the worker, its tiles going back to the queue unless another
+ * worker computes them too.
+ */
+void gmFailWorker_(gmCoordinator_ *coordinator, gmRemoteWorker_ *worker) {
+  close(worker->socket);
+  worker->socket = -1;
+
+  gmCountWorkerFailure_(worker, gmGetTime_());
+
+  for (size_t i = 0; i < worker->in_flight_count; ++i) {
+    gmTileState_ *const kTile = &coordinator->tiles[worker->in_flight_tiles[i]];
+
+    if (!--kTile->assignment_count && !kTile->is_done) {
+      gmQueueTile_(coordinator, worker->in_flight_tiles[i]);
+    }
+  }
+
+  worker->in_flight_count = 0;
+}
+
+void gmQueueTile_(gmCoordinator_ *coordinator, size_t tile) {
+  const size_t kBack = (coordinator->queued_front + coordinator->queued_count) %
+                       coordinator->tile_count;
+
+  coordinator->queued_tiles[kBack] = tile;
+  ++coordinator->queued_count;
+}
+
+int gmHasLiveWorkers_(const gmCoordinator_ *coordinator) {
+  for (size_t i = 0; i < coordinator->worker_count; ++i) {
+    const gmRemoteWorker_ *const kWorker = &coordinator->workers[i];
+
+    if ((kWorker->socket >= 0) ||
+        (kWorker->report->failure_count < GM_MAX_WORKER_FAILURE_COUNT_)) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+gmError gmReceiveTile_(gmCoordinator_ *coordinator, gmRemoteWorker_ *worker);
+
+/**
+ * Waits for the responses of the workers, waking up regularly to connect to
+ * the workers which failed.
+ */
+gmError gmReceiveTiles_(gmCoordinator_ *coordinator) {
+  gmError error = gmError_Success;
+
+  struct pollfd *const kPollFds =
+      malloc(coordinator->worker_count * sizeof(struct pollfd));
+
+  for (size_t i = 0; i < coordinator->worker_count; ++i) {
+    const gmRemoteWorker_ *const kWorker = &coordinator->workers[i];
+
+    // Negative sockets are ignored.
+    kPollFds[i].fd = kWorker->in_flight_count ? kWorker->socket : -1;
+    kPollFds[i].events = POLLIN;
+    kPollFds[i].revents = 0;
+  }
+
+  const int kTimeoutMs = 100;
+  poll(kPollFds, coordinator->worker_count, kTimeoutMs);
+
+  for (size_t i = 0; (i < coordinator->worker_count) && !error; ++i) {
+    if (kPollFds[i].revents) {
+      error = gmReceiveTile_(coordinator, &coordinator->workers[i]);
+    }
+  }
+
+  free(kPollFds);
+  return error;
+}
+
+gmError gmStoreTile_(gmCoordinator_ *coordinator, size_t column, size_t row);
+
+/**
+ * Receives the response to the oldest request of the worker, which sends its
+ * tile at once.
+ */
+gmError gmReceiveTile_(gmCoordinator_ *coordinator, gmRemoteWorker_ *worker) {
+  const size_t kTile = worker->in_flight_tiles[0];
+  const size_t kColumn = kTile % coordinator->tile_column_count;
+  const size_t kRow = kTile / coordinator->tile_column_count;
+
+  gmTileResponse_ response;
+  if (!gmReceiveAll_(worker->socket, &response, sizeof(response)) ||
+      (response.column != kColumn) || (response.row != kRow) ||
+      !gmReceiveAll_(worker->socket, coordinator->tile_data,
+                     GM_TILE_FLOAT_COUNT_ * sizeof(float))) {
+    gmFailWorker_(coordinator, worker);
+    return gmError_Success;
+  }
+
+  --worker->in_flight_count;
+  memmove(worker->in_flight_tiles, worker->in_flight_tiles + 1,
+          worker->in_flight_count * sizeof(size_t));
+
+  gmTileState_ *const kState = &coordinator->tiles[kTile];
+  --kState->assignment_count;
+
+  // The other worker of a stolen tile was faster.
+  if (kState->is_done) {
+    ++worker->report->duplicate_tile_count;
+    return gmError_Success;
+  }
+
+  kState->is_done = 1;
+  ++coordinator->done_count;
+  ++worker->report->tile_count;
+
+  return gmStoreTile_(coordinator, kColumn, kRow);
+}
+
+gmError gmStoreTile_(gmCoordinator_ *coordinator, size_t column, size_t row) {
+  const size_t kRowStride =
+      GM_ITERATION_FILE_TILE_SIZE * GM_ITERATION_CHANNEL_COUNT_;
+
+  if (coordinator->writes_iteration_file) {
+    return gmWriteIterationTile_(&coordinator->file, (int)column, (int)row,
+                                 coordinator->tile_data, kRowStride);
+  }
+
+  const gmTileRequest_ *const kRequest = &coordinator->request;
+  const size_t kTileSize = GM_ITERATION_FILE_TILE_SIZE;
+
+  for (size_t y = 0; y < kTileSize; ++y) {
+    const size_t kImageY = row * kTileSize + y;
+
+    for (size_t x = 0; x < kTileSize; ++x) {
+      const size_t kImageX = column * kTileSize + x;
+      if ((kImageX >= kRequest->width) || (kImageY >= kRequest->height)) {
+        continue;
+      }
+
+      const size_t kPixel = kImageY * kRequest->width + kImageX;
+      gmIterationCountToRgb_(
+          &coordinator->image_data[kPixel * 3],
+          (gm_uint)coordinator->tile_data[y * kRowStride +
+                                          x * GM_ITERATION_CHANNEL_COUNT_],
+          kRequest->max_iteration_count);
+    }
+  }
+
+  return gmError_Success;
+}
+
+void gmReportWorkerThroughputs_(const gmCoordinator_ *coordinator,
+                                double render_time) {
+  for (size_t i = 0; i < coordinator->worker_count; ++i) {
+    gmWorkerReport *const kReport = coordinator->workers[i].report;
+    kReport->tiles_per_second =
+        render_time > 0.0 ? kReport->tile_count / render_time : 0.0;
+  }
+}
+
+void gmDeleteCoordinator_(const gmCoordinator_ *coordinator) {
+  for (size_t i = 0; i < coordinator->worker_count; ++i) {
+    if (coordinator->workers[i].socket >= 0) {
+      close(coordinator->workers[i].socket);
+    }
+  }
+
+  free(coordinator->tiles);
+  free(coordinator->queued_tiles);
+  free(coordinator->workers);
+  free(coordinator->tile_data);
+  free(coordinator->image_data);
+}
@@ -0,0 +1,45 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include <stdint.h>
+
+#include "cpu/kernel.h"
+#include "gm/iterations.h"
+#include "iteration-file.h"
+
+// Messages exchanged by the coordinator and the workers of distributed
+// renders, in the byte order of the hosts, which must match.  The coordinator
+// sends tile requests, each worker answering them in order with a response
+// followed by the tile data.
+
+#define GM_TILE_REQUEST_MAGIC_ 0x51544d47  // "GMTQ" in little endian.
+
+typedef struct gmTileRequest_ {
+  uint32_t magic;
+  uint32_t max_iteration_count;
+
+  /**
+   * Size of the image, the pixels of the tile outside of it are set to 0.
+   */
+  uint32_t width;
+  uint32_t height;
+
+  uint32_t column;
+  uint32_t row;
+  gmPixelMapping_ mapping;
+} gmTileRequest_;
+
+typedef struct gmTileResponse_ {
+  uint32_t column;
+  uint32_t row;
+} gmTileResponse_;
+
+/**
+ * Floats of the tile data following a response, laid out like the tiles of
+ * the iteration files.
+ */
+#define GM_TILE_FLOAT_COUNT_                                  \
+  (GM_ITERATION_FILE_TILE_SIZE * GM_ITERATION_FILE_TILE_SIZE * \
+   GM_ITERATION_CHANNEL_COUNT_)
@@ -0,0 +1,173 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "socket.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>  // For close.
+
+#define GM_UNIX_PREFIX_ "unix:"
+#define GM_TCP_PREFIX_ "tcp:"
+
+/**
+ * Connects or binds the socket, like `connect`.
+ *
+ * @return 0 on success.
+ */
+typedef int (*gmSocketFunc_)(int socket, const struct sockaddr *address,
+                             socklen_t address_size);
+
+int gmOpenSocket_(const char *address, gmSocketFunc_ func, int listening);
+
+int gmConnect_(const char *address) {
+  return gmOpenSocket_(address, connect, 0);
+}
+
+int gmBindAndListen_(int socket, const struct sockaddr *address,
+                     socklen_t address_size);
+
+int gmListen_(const char *address) {
+  return gmOpenSocket_(address, gmBindAndListen_, 1);
+}
+
+int gmBindAndListen_(int socket, const struct sockaddr *address,
+                     socklen_t address_size) {
+  return bind(socket, address, address_size) || listen(socket, 8);
+}
+
+int gmOpenUnixSocket_(const char *path, gmSocketFunc_ func, int listening);
+int gmOpenTcpSocket_(const char *host_and_port, gmSocketFunc_ func,
+                     int listening);
+
+int gmOpenSocket_(const char *address, gmSocketFunc_ func, int listening) {
+  const size_t kUnixPrefixSize = strlen(GM_UNIX_PREFIX_);
+  const size_t kTcpPrefixSize = strlen(GM_TCP_PREFIX_);
+
+  if (!strncmp(address, GM_UNIX_PREFIX_, kUnixPrefixSize)) {
+    return gmOpenUnixSocket_(address + kUnixPrefixSize, func, listening);
+  }
+
+  if (!strncmp(address, GM_TCP_PREFIX_, kTcpPrefixSize)) {
+    return gmOpenTcpSocket_(address + kTcpPrefixSize, func, listening);
+  }
+
+  return -1;
+}
+
+int gmOpenUnixSocket_(const char *path, gmSocketFunc_ func, int listening) {
+  struct sockaddr_un address = {.sun_family = AF_UNIX};
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    return -1;
+  }
+
+  strcpy(address.sun_path, path);
+
+  if (listening) {
+    unlink(path);
+  }
+
+  const int kSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+  if ((kSocket >= 0) &&
+      func(kSocket, (const struct sockaddr *)&address, sizeof(address))) {
+    close(kSocket);
+    return -1;
+  }
+
+  return kSocket;
+}
+
+int gmOpenTcpSocket_(const char *host_and_port, gmSocketFunc_ func,
+                     int listening) {
+  char host[256];
+  char port[16];
+
+  // The port follows the last colon.
+  const char *const kColon = strrchr(host_and_port, ':');
+  if (!kColon || ((size_t)(kColon - host_and_port) >= sizeof(host)) ||
+      (strlen(kColon + 1) >= sizeof(port))) {
+    return -1;
+  }
+
+  snprintf(host, sizeof(host), "%.*s", (int)(kColon - host_and_port),
+           host_and_port);
+  snprintf(port, sizeof(port), "%s", kColon + 1);
+
+  const struct addrinfo kHints = {.ai_family = AF_UNSPEC,
+                                  .ai_socktype = SOCK_STREAM,
+                                  .ai_flags = listening ? AI_PASSIVE : 0};
+
+  struct addrinfo *addresses;
+  if (getaddrinfo(host, port, &kHints, &addresses)) {
+    return -1;
+  }
+
+  int result = -1;
+  for (const struct addrinfo *i = addresses; i && (result < 0);
+       i = i->ai_next) {
+    const int kSocket = socket(i->ai_family, i->ai_socktype, i->ai_protocol);
+    if (kSocket < 0) {
+      continue;
+    }
+
+    const int kEnabled = 1;
+    if (listening) {
+      // Restarted workers can listen on the same port right away.
+      setsockopt(kSocket, SOL_SOCKET, SO_REUSEADDR, &kEnabled,
+                 sizeof(kEnabled));
+    } else {
+      // Requests are small, they are sent without waiting for more data.
+      setsockopt(kSocket, IPPROTO_TCP, TCP_NODELAY, &kEnabled,
+                 sizeof(kEnabled));
+    }
+
+    if (func(kSocket, i->ai_addr, i->ai_addrlen)) {
+      close(kSocket);
+    } else {
+      result = kSocket;
+    }
+  }
+
+  freeaddrinfo(addresses);
+  return result;
+}
+
+int gmSendAll_(int socket, const void *data, size_t size) {
+  const char *const kBytes = data;
+
+  size_t sent_size = 0;
+  while (sent_size < size) {
+    // A closed peer is reported as an error rather than a signal.
+    const ssize_t kSize =
+        send(socket, kBytes + sent_size, size - sent_size, MSG_NOSIGNAL);
+    if (kSize <= 0) {
+      return 0;
+    }
+
+    sent_size += kSize;
+  }
+
+  return 1;
+}
+
+int gmReceiveAll_(int socket, void *data, size_t size) {
+  char *const kBytes = data;
+
+  size_t received_size = 0;
+  while (received_size < size) {
+    const ssize_t kSize =
+        recv(socket, kBytes + received_size, size - received_size, 0);
+    if (kSize <= 0) {
+      return 0;
+    }
+
+    received_size += kSize;
+  }
+
+  return 1;
+}
@@ -0,0 +1,33 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include <stddef.h>
+
+// Stream sockets of the distributed renders.  Addresses are either
+// "unix:PATH" or "tcp:HOST:PORT".
+
+/**
+ * @return The connected socket, or -1 on failure.
+ */
+int gmConnect_(const char *address);
+
+/**
+ * Removes the socket file of Unix addresses left by a previous worker.
+ *
+ * @return The listening socket, or -1 on failure.
+ */
+int gmListen_(const char *address);
+
+/**
+ * @return Whether all the data was sent.
+ */
+int gmSendAll_(int socket, const void *data, size_t size);
+
+/**
+ * Blocks until all the data is received.
+ *
+ * @return Whether all the data was received, 0 once the peer is gone.
+ */
+int gmReceiveAll_(int socket, void *data, size_t size);
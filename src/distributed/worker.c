@@ -0,0 +1,104 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include <stdlib.h>
+#include <string.h>      // For memset.
+#include <sys/socket.h>  // For accept.
+#include <unistd.h>      // For close.
+
+#include "cpu/iterations.h"
+#include "cpu/thread-pool.h"
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "protocol.h"
+#include "setup.h"
+#include "socket.h"
+
+void gmServeCoordinator_(int connection, gmThreadPool_ *pool,
+                         float *tile_data);
+
+gmError gmServe(const char *address) {
+  gmError error;
+
+  // Tiles are computed with every processor of the host.
+  gmThreadPool_ *pool;
+  error = gmCreateThreadPool_(&pool, 0);
+  if (!error) {
+    const int kListener = gmListen_(address);
+    if (kListener >= 0) {
+      float *const kTileData = malloc(GM_TILE_FLOAT_COUNT_ * sizeof(float));
+
+      int connection;
+      while ((connection = accept(kListener, NULL, NULL)) >= 0) {
+        gmServeCoordinator_(connection, pool, kTileData);
+        close(connection);
+      }
+
+      free(kTileData);
+      close(kListener);
+    }
+
+    // Only reached on failure.
+    error = gmError_ListenFailed;
+    gmDeleteThreadPool_(pool);
+  }
+
+  return error;
+}
+
+void gmComputeRequestedTile_(GM_OUT_PARAM float *tile_data,
+                             const gmTileRequest_ *request,
+                             gmThreadPool_ *pool);
+
+/**
+ * Answers the requests of the coordinator until it disconnects.
+ */
+void gmServeCoordinator_(int connection, gmThreadPool_ *pool,
+                         float *tile_data) {
+  gmTileRequest_ request;
+  while (gmReceiveAll_(connection, &request, sizeof(request)) &&
+         (request.magic == GM_TILE_REQUEST_MAGIC_)) {
+    gmComputeRequestedTile_(tile_data, &request, pool);
+
+    const gmTileResponse_ kResponse = {.column = request.column,
+                                       .row = request.row};
+
+    if (!gmSendAll_(connection, &kResponse, sizeof(kResponse)) ||
+        !gmSendAll_(connection, tile_data,
+                    GM_TILE_FLOAT_COUNT_ * sizeof(float))) {
+      break;
+    }
+  }
+}
+
+typedef struct gmTileTask_ {
+  float *tile_data;
+  const gmTileRequest_ *request;
+} gmTileTask_;
+
+void gmComputeRequestedRows_(void *tile_task, size_t begin, size_t end,
+                             size_t worker_index);
+
+void gmComputeRequestedTile_(GM_OUT_PARAM float *tile_data,
+                             const gmTileRequest_ *request,
+                             gmThreadPool_ *pool) {
+  // The pixels outside of the image are sent as 0.
+  memset(tile_data, 0, GM_TILE_FLOAT_COUNT_ * sizeof(float));
+
+  gmTileTask_ tile_task = {.tile_data = tile_data, .request = request};
+  gmRunParallelFor_(pool, GM_ITERATION_FILE_TILE_SIZE, 4,
+                    gmComputeRequestedRows_, &tile_task);
+}
+
+void gmComputeRequestedRows_(void *tile_task, size_t begin, size_t end,
+                             size_t worker_index) {
+  (void)worker_index;
+
+  const gmTileTask_ *const kTask = tile_task;
+  const gmTileRequest_ *const kRequest = kTask->request;
+  const gmIntSize kImageSize = {.w = kRequest->width, .h = kRequest->height};
+
+  gmComputeTileRows_(kTask->tile_data, &kRequest->mapping,
+                     kRequest->max_iteration_count, &kImageSize,
+                     kRequest->column, kRequest->row, (int)begin, (int)end);
+}
@@ -19,6 +19,24 @@ const char *gmGetErrorMessage(gmError error) {
       return "Failed to create a frame-buffer";
     case gmError_ImageWriteFailed:
       return "Failed to write the image";
+    case gmError_ThreadCreationFailed:
+      return "Failed to create a thread";
+    case gmError_ProfileWriteFailed:
+      return "Failed to write the performance profile";
+    case gmError_UnsupportedImageFormat:
+      return "The engine cannot write this image format";
+    case gmError_JobSubmissionFailed:
+      return "Failed to submit the render job";
+    case gmError_ListenFailed:
+      return "Failed to listen on the worker address";
+    case gmError_WorkersFailed:
+      return "Every distributed worker failed";
+    case gmError_FrameSizeMismatch:
+      return "The frame size differs from the stream size";
+    case gmError_Canceled:
+      return "The render was canceled";
+    case gmError_TraceWriteFailed:
+      return "Failed to write the trace";
     default:
       return "Unknown error";
   }
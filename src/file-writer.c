@@ -0,0 +1,499 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "file-writer.h"
+
+#include <errno.h>
+#include <fcntl.h>  // For AT_FDCWD and the open flags.
+#include <linux/io_uring.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>  // For memcpy, memset and strlen.
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "cpu/thread-pool.h"
+#include "gm/error.h"
+#include "setup.h"
+
+/**
+ * Files being written at once through io_uring, each having one operation in
+ * flight.
+ */
+#define GM_RING_ENTRY_COUNT_ 64
+
+/**
+ * Threads writing the files when io_uring is not available, enough to keep
+ * the storage busy while they block.
+ */
+#define GM_FILE_WRITER_THREAD_COUNT_ 4
+
+/**
+ * Writes are split in parts of at most this size, below the limit of the
+ * 32-bit length of the requests.
+ */
+#define GM_MAX_WRITE_SIZE_ ((size_t)1 << 30)
+
+typedef enum gmFileWriteStep_ {
+  gmFileWriteStep_Opening_,
+  gmFileWriteStep_Writing_,
+  gmFileWriteStep_Closing_,
+  gmFileWriteStep_Done_
+} gmFileWriteStep_;
+
+typedef struct gmFileWrite_ {
+  gmFileWriter_ *writer;
+
+  /**
+   * Next file of the queue of the ring.
+   */
+  struct gmFileWrite_ *next;
+
+  char *filepath;
+  unsigned char *data;
+  size_t size;
+
+  // State of the operations submitted to the ring.
+  gmFileWriteStep_ step;
+  int fd;
+  size_t written_size;
+  int has_failed;
+} gmFileWrite_;
+
+/**
+ * Submission and completion queues shared with the kernel, mapped from the
+ * file descriptor of the ring.
+ */
+typedef struct gmRing_ {
+  int fd;
+  unsigned entry_count;
+
+  unsigned *sq_tail;
+  unsigned *sq_mask;
+  unsigned *sq_array;
+  struct io_uring_sqe *sqes;
+
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned *cq_mask;
+  struct io_uring_cqe *cqes;
+
+  void *sq_ring;
+  size_t sq_ring_size;
+  void *cq_ring;
+  size_t cq_ring_size;
+  size_t sqes_size;
+} gmRing_;
+
+struct gmFileWriter_ {
+  // Protects the members below, which are shared by the queuing threads and
+  // the threads writing the files.
+  pthread_mutex_t mutex;
+  pthread_cond_t queue_cond;
+  pthread_cond_t space_cond;
+
+  gmFileWrite_ *first_queued_file;
+  gmFileWrite_ *last_queued_file;
+
+  /**
+   * Bytes of the files queued and being written.
+   */
+  size_t queued_size;
+  size_t max_queued_size;
+
+  int is_stopping;
+  int has_failed;
+
+  /**
+   * Set when the files are written through the ring by `ring_thread`, the
+   * files being written by `pool` otherwise.
+   */
+  int uses_ring;
+  gmRing_ ring;
+  pthread_t ring_thread;
+
+  gmThreadPool_ *pool;
+};
+
+int gmCreateRing_(GM_OUT_PARAM gmRing_ *ring, unsigned entry_count);
+void gmDeleteRing_(const gmRing_ *ring);
+
+void *gmRunRingThread_(void *writer);
+
+gmError gmCreateFileWriter_(GM_OUT_PARAM gmFileWriter_ **writer,
+                            size_t max_queued_size) {
+  gmFileWriter_ *const kWriter = calloc(1, sizeof(gmFileWriter_));
+  kWriter->max_queued_size = max_queued_size;
+
+  pthread_mutex_init(&kWriter->mutex, NULL);
+  pthread_cond_init(&kWriter->queue_cond, NULL);
+  pthread_cond_init(&kWriter->space_cond, NULL);
+
+  kWriter->uses_ring = gmCreateRing_(&kWriter->ring, GM_RING_ENTRY_COUNT_);
+  if (kWriter->uses_ring && pthread_create(&kWriter->ring_thread, NULL,
+                                           gmRunRingThread_, kWriter)) {
+    gmDeleteRing_(&kWriter->ring);
+    kWriter->uses_ring = 0;
+  }
+
+  gmError error = gmError_Success;
+  if (!kWriter->uses_ring) {
+    error = gmCreateThreadPool_(&kWriter->pool, GM_FILE_WRITER_THREAD_COUNT_);
+  }
+
+  if (error) {
+    pthread_cond_destroy(&kWriter->space_cond);
+    pthread_cond_destroy(&kWriter->queue_cond);
+    pthread_mutex_destroy(&kWriter->mutex);
+    free(kWriter);
+  } else {
+    *writer = kWriter;
+  }
+
+  return error;
+}
+
+void gmWriteFileTask_(void *file, size_t worker_index);
+
+void gmQueueFileWrite_(gmFileWriter_ *writer, const char *filepath,
+                       unsigned char *data, size_t size) {
+  const size_t kFilepathSize = strlen(filepath) + 1;
+
+  gmFileWrite_ *const kFile = calloc(1, sizeof(gmFileWrite_));
+  kFile->writer = writer;
+  kFile->filepath = malloc(kFilepathSize);
+  memcpy(kFile->filepath, filepath, kFilepathSize);
+  kFile->data = data;
+  kFile->size = size;
+
+  pthread_mutex_lock(&writer->mutex);
+
+  // Files larger than the limit are queued once the others are written.
+  while (writer->queued_size &&
+         (writer->queued_size + size > writer->max_queued_size)) {
+    pthread_cond_wait(&writer->space_cond, &writer->mutex);
+  }
+
+  writer->queued_size += size;
+
+  if (writer->uses_ring) {
+    if (writer->last_queued_file) {
+      writer->last_queued_file->next = kFile;
+    } else {
+      writer->first_queued_file = kFile;
+    }
+
+    writer->last_queued_file = kFile;
+    pthread_cond_signal(&writer->queue_cond);
+  }
+
+  pthread_mutex_unlock(&writer->mutex);
+
+  if (!writer->uses_ring) {
+    gmSubmitTask_(writer->pool, gmWriteFileTask_, kFile);
+  }
+}
+
+gmError gmDeleteFileWriter_(gmFileWriter_ *writer) {
+  if (writer->uses_ring) {
+    pthread_mutex_lock(&writer->mutex);
+    writer->is_stopping = 1;
+    pthread_cond_signal(&writer->queue_cond);
+    pthread_mutex_unlock(&writer->mutex);
+
+    // The thread writes the queued files before it stops.
+    pthread_join(writer->ring_thread, NULL);
+    gmDeleteRing_(&writer->ring);
+  } else {
+    gmWaitForTasks_(writer->pool);
+    gmDeleteThreadPool_(writer->pool);
+  }
+
+  const int kHasFailed = writer->has_failed;
+
+  pthread_cond_destroy(&writer->space_cond);
+  pthread_cond_destroy(&writer->queue_cond);
+  pthread_mutex_destroy(&writer->mutex);
+  free(writer);
+
+  return !kHasFailed ? gmError_Success : gmError_ImageWriteFailed;
+}
+
+/**
+ * Frees the file and makes room in the queue for the next files.
+ */
+void gmFinishFileWrite_(gmFileWrite_ *file) {
+  gmFileWriter_ *const kWriter = file->writer;
+
+  pthread_mutex_lock(&kWriter->mutex);
+  kWriter->queued_size -= file->size;
+  kWriter->has_failed |= file->has_failed;
+  pthread_cond_broadcast(&kWriter->space_cond);
+  pthread_mutex_unlock(&kWriter->mutex);
+
+  free(file->data);
+  free(file->filepath);
+  free(file);
+}
+
+void gmWriteFileTask_(void *file, size_t worker_index) {
+  (void)worker_index;
+
+  gmFileWrite_ *const kFile = file;
+
+  FILE *const kStream = fopen(kFile->filepath, "wb");
+  kFile->has_failed = !kStream;
+  if (kStream) {
+    kFile->has_failed = fwrite(kFile->data, 1, kFile->size, kStream) !=
+                        kFile->size;
+    kFile->has_failed |= fclose(kStream) != 0;
+  }
+
+  gmFinishFileWrite_(kFile);
+}
+
+/**
+ * The opens, writes and closes of io_uring came with the kernel 5.6, along
+ * with this feature.
+ */
+int gmCreateRing_(GM_OUT_PARAM gmRing_ *ring, unsigned entry_count) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+
+  ring->fd = (int)syscall(__NR_io_uring_setup, entry_count, &params);
+  if (ring->fd < 0) {
+    return 0;  // Not supported by the kernel, or denied to the process.
+  }
+
+  if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+    close(ring->fd);
+    return 0;
+  }
+
+  ring->entry_count = params.sq_entries;
+  ring->sq_ring_size =
+      params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cq_ring_size =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+  ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+  ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+
+  if ((ring->sq_ring == MAP_FAILED) || (ring->cq_ring == MAP_FAILED) ||
+      (ring->sqes == MAP_FAILED)) {
+    gmDeleteRing_(ring);
+    return 0;
+  }
+
+  unsigned char *const kSqRing = ring->sq_ring;
+  ring->sq_tail = (unsigned *)(kSqRing + params.sq_off.tail);
+  ring->sq_mask = (unsigned *)(kSqRing + params.sq_off.ring_mask);
+  ring->sq_array = (unsigned *)(kSqRing + params.sq_off.array);
+
+  unsigned char *const kCqRing = ring->cq_ring;
+  ring->cq_head = (unsigned *)(kCqRing + params.cq_off.head);
+  ring->cq_tail = (unsigned *)(kCqRing + params.cq_off.tail);
+  ring->cq_mask = (unsigned *)(kCqRing + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)(kCqRing + params.cq_off.cqes);
+
+  return 1;
+}
+
+void gmDeleteRing_(const gmRing_ *ring) {
+  if (ring->sq_ring != MAP_FAILED) {
+    munmap(ring->sq_ring, ring->sq_ring_size);
+  }
+
+  if (ring->cq_ring != MAP_FAILED) {
+    munmap(ring->cq_ring, ring->cq_ring_size);
+  }
+
+  if (ring->sqes != MAP_FAILED) {
+    munmap(ring->sqes, ring->sqes_size);
+  }
+
+  close(ring->fd);
+}
+
+void gmPrepareFileOperation_(gmRing_ *ring, gmFileWrite_ *file);
+
+int gmSubmitRingOperations_(const gmRing_ *ring, unsigned operation_count,
+                            int waits_for_completion);
+
+void gmCompleteFileOperation_(gmRing_ *ring, gmFileWrite_ *file, int result);
+
+/**
+ * Submits the operations of the queued files in batches, each batch holding
+ * the next operations of the files whose previous operations completed, and
+ * the opens of the files queued since.
+ */
+void *gmRunRingThread_(void *writer) {
+  gmFileWriter_ *const kWriter = writer;
+  gmRing_ *const kRing = &kWriter->ring;
+
+  unsigned file_count = 0;  // Files with an operation in flight.
+  unsigned prepared_count = 0;
+
+  pthread_mutex_lock(&kWriter->mutex);
+
+  for (;;) {
+    while (!kWriter->first_queued_file && !file_count &&
+           !kWriter->is_stopping) {
+      pthread_cond_wait(&kWriter->queue_cond, &kWriter->mutex);
+    }
+
+    if (!kWriter->first_queued_file && !file_count) {
+      break;  // Stopping.
+    }
+
+    while (kWriter->first_queued_file && (file_count < kRing->entry_count)) {
+      gmFileWrite_ *const kFile = kWriter->first_queued_file;
+      kWriter->first_queued_file = kFile->next;
+      if (!kWriter->first_queued_file) {
+        kWriter->last_queued_file = NULL;
+      }
+
+      kFile->step = gmFileWriteStep_Opening_;
+      gmPrepareFileOperation_(kRing, kFile);
+      ++file_count;
+      ++prepared_count;
+    }
+
+    pthread_mutex_unlock(&kWriter->mutex);
+
+    const int kSubmittedCount =
+        gmSubmitRingOperations_(kRing, prepared_count, 1);
+    if (kSubmittedCount > 0) {
+      prepared_count -= (unsigned)kSubmittedCount;
+    }
+
+    // Completed operations prepare the next operation of their file, or
+    // finish it.
+    unsigned head = *kRing->cq_head;
+    while (head != __atomic_load_n(kRing->cq_tail, __ATOMIC_ACQUIRE)) {
+      const struct io_uring_cqe *const kCqe =
+          &kRing->cqes[head & *kRing->cq_mask];
+      gmFileWrite_ *const kFile = (gmFileWrite_ *)(uintptr_t)kCqe->user_data;
+
+      gmCompleteFileOperation_(kRing, kFile, kCqe->res);
+      if (kFile->step == gmFileWriteStep_Done_) {
+        gmFinishFileWrite_(kFile);
+        --file_count;
+      } else {
+        ++prepared_count;
+      }
+
+      ++head;
+    }
+
+    __atomic_store_n(kRing->cq_head, head, __ATOMIC_RELEASE);
+
+    pthread_mutex_lock(&kWriter->mutex);
+  }
+
+  pthread_mutex_unlock(&kWriter->mutex);
+  return NULL;
+}
+
+/**
+ * Adds the operation of the current step of the file to the submission queue.
+ */
+void gmPrepareFileOperation_(gmRing_ *ring, gmFileWrite_ *file) {
+  const unsigned kTail = *ring->sq_tail;
+  const unsigned kIndex = kTail & *ring->sq_mask;
+
+  struct io_uring_sqe *const kSqe = &ring->sqes[kIndex];
+  memset(kSqe, 0, sizeof(struct io_uring_sqe));
+  kSqe->user_data = (uintptr_t)file;
+
+  // NOLINTNEXTLINE
+  switch (file->step) {
+    case gmFileWriteStep_Opening_:
+      kSqe->opcode = IORING_OP_OPENAT;
+      kSqe->fd = AT_FDCWD;
+      kSqe->addr = (uintptr_t)file->filepath;
+      kSqe->len = 0666;  // Mode, like the files created by `fopen`.
+      kSqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+      break;
+    case gmFileWriteStep_Writing_: {
+      const size_t kRemainingSize = file->size - file->written_size;
+      kSqe->opcode = IORING_OP_WRITE;
+      kSqe->fd = file->fd;
+      kSqe->addr = (uintptr_t)&file->data[file->written_size];
+      kSqe->len = (unsigned)(kRemainingSize < GM_MAX_WRITE_SIZE_
+                                 ? kRemainingSize
+                                 : GM_MAX_WRITE_SIZE_);
+      kSqe->off = file->written_size;
+      break;
+    }
+    default:
+      kSqe->opcode = IORING_OP_CLOSE;
+      kSqe->fd = file->fd;
+      break;
+  }
+
+  ring->sq_array[kIndex] = kIndex;
+  __atomic_store_n(ring->sq_tail, kTail + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @return The number of operations submitted, negative on failure.
+ */
+int gmSubmitRingOperations_(const gmRing_ *ring, unsigned operation_count,
+                            int waits_for_completion) {
+  int submitted_count;
+  do {
+    submitted_count = (int)syscall(
+        __NR_io_uring_enter, ring->fd, operation_count,
+        waits_for_completion ? 1 : 0, IORING_ENTER_GETEVENTS, NULL, 0);
+  } while ((submitted_count < 0) && (errno == EINTR));
+
+  return submitted_count;
+}
+
+/**
+ * Moves the file to its next step, preparing its operation.  Files are done
+ * once closed or when they could not be opened.
+ */
+void gmCompleteFileOperation_(gmRing_ *ring, gmFileWrite_ *file, int result) {
+  switch (file->step) {
+    case gmFileWriteStep_Opening_:
+      if (result < 0) {
+        file->has_failed = 1;
+        file->step = gmFileWriteStep_Done_;
+        return;
+      }
+
+      file->fd = result;
+      file->step = file->size ? gmFileWriteStep_Writing_
+                              : gmFileWriteStep_Closing_;
+      break;
+    case gmFileWriteStep_Writing_:
+      if (result <= 0) {
+        file->has_failed = 1;
+        file->step = gmFileWriteStep_Closing_;
+        break;
+      }
+
+      // Short writes are followed by the write of the rest.
+      file->written_size += (size_t)result;
+      if (file->written_size == file->size) {
+        file->step = gmFileWriteStep_Closing_;
+      }
+      break;
+    default:
+      file->has_failed |= result < 0;
+      file->step = gmFileWriteStep_Done_;
+      return;
+  }
+
+  gmPrepareFileOperation_(ring, file);
+}
@@ -0,0 +1,47 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include <stddef.h>
+
+#include "gm/error.h"
+#include "setup.h"
+
+/**
+ * Bytes of the files queued by default before `gmQueueFileWrite_` blocks.
+ */
+#define GM_DEFAULT_MAX_QUEUED_FILE_SIZE_ ((size_t)64 << 20)
+
+/**
+ * Writes whole files in the background, so that the threads encoding them
+ * don't wait on the file system.  On Linux, a thread submits the opens, writes
+ * and closes of the queued files in batches through io_uring.  Otherwise, or
+ * when the kernel doesn't allow io_uring, a few threads write the files with
+ * blocking calls.
+ */
+typedef struct gmFileWriter_ gmFileWriter_;
+
+/**
+ * @param max_queued_size Bytes of the files queued and being written above
+ * which `gmQueueFileWrite_` blocks, a larger file being queued alone.
+ */
+gmError gmCreateFileWriter_(GM_OUT_PARAM gmFileWriter_ **writer,
+                            size_t max_queued_size);
+
+/**
+ * Queues the file, blocking while too many bytes are queued.  This function
+ * may be called from any thread.
+ *
+ * @param data Contents of the file, allocated with `malloc`.  The writer takes
+ * ownership of it and frees it once written.
+ */
+void gmQueueFileWrite_(gmFileWriter_ *writer, const char *filepath,
+                       unsigned char *data, size_t size);
+
+/**
+ * Waits for the queued files to be written, then deletes the writer.
+ *
+ * @return `gmError_ImageWriteFailed` when a file could not be written.
+ */
+gmError gmDeleteFileWriter_(gmFileWriter_ *writer);
@@ -0,0 +1,211 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "frame-stream.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>  // For memset.
+
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "setup.h"
+
+struct gmFrameStream {
+  FILE *file;
+
+  /**
+   * The standard output is flushed but not closed with the stream.
+   */
+  int owns_file;
+
+  gmStreamFormat format;
+  gm_uint frame_rate;
+
+  /**
+   * Size of the first frame, 0 until it is written along with the header.
+   */
+  gmIntSize size;
+
+  /**
+   * Planes of the last Y4M frame, kept from one frame to the next.
+   */
+  unsigned char *yuv_data;
+};
+
+gmError gmOpenFrameStream(gmFrameStream **stream, const char *filepath,
+                          const gmStreamConfig *config) {
+  FILE *const kFile = filepath ? fopen(filepath, "wb") : stdout;
+  if (!kFile) {
+    return gmError_ImageWriteFailed;
+  }
+
+  const gmStreamFormat kFormat = config ? config->format : gmStreamFormat_Y4m;
+  const gm_uint kFrameRate = config ? config->frame_rate : 0;
+
+  gmFrameStream *const kStream = calloc(1, sizeof(gmFrameStream));
+  kStream->file = kFile;
+  kStream->owns_file = filepath != NULL;
+  kStream->format =
+      kFormat != gmStreamFormat_Default ? kFormat : gmStreamFormat_Y4m;
+  kStream->frame_rate = kFrameRate ? kFrameRate : 30;
+
+  *stream = kStream;
+  return gmError_Success;
+}
+
+gmError gmCloseFrameStream(gmFrameStream *stream) {
+  int failed = fflush(stream->file) != 0;
+  if (stream->owns_file) {
+    failed |= fclose(stream->file) != 0;
+  }
+
+  free(stream->yuv_data);
+  free(stream);
+
+  return !failed ? gmError_Success : gmError_ImageWriteFailed;
+}
+
+size_t gmGetI420Size_(const gmIntSize *size);
+
+int gmWriteStreamHeader_(const gmFrameStream *stream);
+
+gmError gmWriteFrame_(gmFrameStream *stream, const unsigned char *image_data,
+                      const gmIntSize *size) {
+  if (!stream->size.w) {
+    stream->size = *size;
+    if (!gmWriteStreamHeader_(stream)) {
+      return gmError_ImageWriteFailed;
+    }
+  } else if ((size->w != stream->size.w) || (size->h != stream->size.h)) {
+    return gmError_FrameSizeMismatch;
+  }
+
+  const unsigned char *frame_data = image_data;
+  size_t frame_size = (size_t)size->w * size->h * 3;  // RGB.
+
+  if (stream->format == gmStreamFormat_Y4m) {
+    frame_size = gmGetI420Size_(size);
+    if (!stream->yuv_data) {
+      stream->yuv_data = malloc(frame_size);
+    }
+
+    gmConvertToI420_(stream->yuv_data, image_data, size);
+    frame_data = stream->yuv_data;
+
+    if (fputs("FRAME\n", stream->file) < 0) {
+      return gmError_ImageWriteFailed;
+    }
+  }
+
+  const size_t kWrittenSize = fwrite(frame_data, 1, frame_size, stream->file);
+  return kWrittenSize == frame_size ? gmError_Success
+                                    : gmError_ImageWriteFailed;
+}
+
+size_t gmGetI420Size_(const gmIntSize *size) {
+  const size_t kChromaSize =
+      (size_t)((size->w + 1) / 2) * (size_t)((size->h + 1) / 2);
+
+  return (size_t)size->w * size->h + kChromaSize * 2;
+}
+
+#define GM_RGB24_HEADER_SIZE_ 32
+
+int gmWriteStreamHeader_(const gmFrameStream *stream) {
+  const gmIntSize *const kSize = &stream->size;
+
+  if (stream->format == gmStreamFormat_Y4m) {
+    // Chroma samples are centered between the luma samples, which matches
+    // averaging 2x2 blocks.
+    return fprintf(stream->file,
+                   "YUV4MPEG2 W%d H%d F%u:1 Ip A1:1 C420jpeg "
+                   "XCOLORRANGE=FULL\n",
+                   kSize->w, kSize->h, stream->frame_rate) > 0;
+  }
+
+  // Fixed size so that readers can skip it without parsing it.
+  char header[GM_RGB24_HEADER_SIZE_];
+  memset(header, ' ', sizeof(header));
+
+  const int kLength = snprintf(header, sizeof(header), "RGB24 %d %d %u",
+                               kSize->w, kSize->h, stream->frame_rate);
+  if ((kLength < 0) || (kLength >= GM_RGB24_HEADER_SIZE_ - 1)) {
+    return 0;
+  }
+
+  // Replaces the terminating null character.
+  header[kLength] = ' ';
+  header[GM_RGB24_HEADER_SIZE_ - 1] = '\n';
+
+  return fwrite(header, 1, GM_RGB24_HEADER_SIZE_, stream->file) ==
+         GM_RGB24_HEADER_SIZE_;
+}
+
+void gmConvertChromaRows_(GM_OUT_PARAM unsigned char *u_row,
+                          GM_OUT_PARAM unsigned char *v_row,
+                          const unsigned char *row0, const unsigned char *row1,
+                          int width);
+
+void gmConvertToI420_(GM_OUT_PARAM unsigned char *yuv_data,
+                      const unsigned char *image_data, const gmIntSize *size) {
+  const size_t kPixelCount = (size_t)size->w * size->h;
+
+  // Integer weights summing to 256, rounded.  The loop has no branch so that
+  // compilers vectorize it.
+  for (size_t i = 0; i < kPixelCount; ++i) {
+    const unsigned char *const kRgb = &image_data[i * 3];
+    yuv_data[i] = (unsigned char)((77 * kRgb[0] + 150 * kRgb[1] +
+                                   29 * kRgb[2] + 128) >> 8);
+  }
+
+  const int kChromaWidth = (size->w + 1) / 2;
+  const int kChromaHeight = (size->h + 1) / 2;
+  const size_t kChromaSize = (size_t)kChromaWidth * kChromaHeight;
+
+  unsigned char *const kUPlane = &yuv_data[kPixelCount];
+  unsigned char *const kVPlane = &kUPlane[kChromaSize];
+
+  const size_t kStride = (size_t)size->w * 3;
+  for (int y = 0; y < kChromaHeight; ++y) {
+    // The last row of odd heights is paired with itself.
+    const int kRow1 = 2 * y + 1 < size->h ? 2 * y + 1 : 2 * y;
+
+    gmConvertChromaRows_(&kUPlane[(size_t)y * kChromaWidth],
+                         &kVPlane[(size_t)y * kChromaWidth],
+                         &image_data[2 * y * kStride],
+                         &image_data[kRow1 * kStride], size->w);
+  }
+}
+
+/**
+ * Converts the average of each pair of columns of the two rows, the last
+ * column of odd widths being paired with itself.
+ */
+void gmConvertChromaRows_(GM_OUT_PARAM unsigned char *u_row,
+                          GM_OUT_PARAM unsigned char *v_row,
+                          const unsigned char *row0, const unsigned char *row1,
+                          int width) {
+  const int kChromaWidth = (width + 1) / 2;
+
+  for (int x = 0; x < kChromaWidth; ++x) {
+    const int kLeft = 2 * x * 3;
+    const int kRight = 2 * x + 1 < width ? kLeft + 3 : kLeft;
+
+    // Sums of the 4 pixels, the weights being divided by 4 with the shift.
+    const int kR = row0[kLeft] + row0[kRight] + row1[kLeft] + row1[kRight];
+    const int kG = row0[kLeft + 1] + row0[kRight + 1] + row1[kLeft + 1] +
+                   row1[kRight + 1];
+    const int kB = row0[kLeft + 2] + row0[kRight + 2] + row1[kLeft + 2] +
+                   row1[kRight + 2];
+
+    // Offset so that the shifted values are never negative, and rounded down
+    // at 0.5 so that they never exceed 255.
+    const int kOffset = (128 << 10) + 511;
+    const int kU = -43 * kR - 85 * kG + 128 * kB + kOffset;
+    const int kV = 128 * kR - 107 * kG - 21 * kB + kOffset;
+
+    u_row[x] = (unsigned char)(kU >> 10);
+    v_row[x] = (unsigned char)(kV >> 10);
+  }
+}
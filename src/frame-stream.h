@@ -0,0 +1,28 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "setup.h"
+
+/**
+ * Writes the image as the next frame of the stream, RGB frames being written
+ * straight from the image data.
+ *
+ * @param image_data Tightly packed RGB data, laid out like the data read back
+ * from the GPU.
+ */
+gmError gmWriteFrame_(gmFrameStream *stream, const unsigned char *image_data,
+                      const gmIntSize *size);
+
+/**
+ * Converts the image to the planes of a 4:2:0 frame in full range BT.601, the
+ * chroma of each 2x2 block of pixels being their average.
+ *
+ * @param yuv_data Receives the Y plane followed by the U and V planes, whose
+ * size is half the image size rounded up.
+ */
+void gmConvertToI420_(GM_OUT_PARAM unsigned char *yuv_data,
+                      const unsigned char *image_data, const gmIntSize *size);
@@ -5,127 +5,814 @@
 
 #include "gm/gm.h"
 
+#include <glad/glad.h>
 #include <stb/stb_image_write.h>
+#include <stdlib.h>
+#include <string.h>  // For memcpy, strcmp and strlen.
 
+#include "budget.h"
+#include "clock.h"
 #include "context/context.h"
+#include "cost.h"
+#include "cpu/cpu.h"
+#include "cpu/iterations.h"
+#include "cpu/thread-pool.h"
+#include "deep-zoom.h"
+#include "frame-stream.h"
 #include "gm/error.h"
+#include "image-config.h"
+#include "mapped-image.h"
+#include "memory-plan.h"
+#include "output-targets.h"
+#include "profile/profile.h"
+#include "profile/tuner.h"
+#include "render/batch.h"
+#include "render/calibration.h"
+#include "render/iterations.h"
+#include "render/render.h"
 #include "resources/resources.h"
+#include "run.h"
+#include "trace.h"
 
-gmError gmRenderImageToFile_(const gmConfig *config);
+gmError gmRenderImageToFile_(const gmConfig *config, gmRenderState_ *state);
+gmError gmRenderImageToFileOnCpu_(const gmConfig *config);
+
+void gmApplyHostProfile_(GM_OUT_PARAM gmConfig *config,
+                         gmRenderState_ *state, int with_gl_renderer);
+
+int gmWritesIterationFile_(const gmConfig *config);
+int gmWritesDeepZoomImage_(const gmConfig *config);
+int gmWritesMappedImage_(const gmConfig *config);
 
 gmError gmRun(const gmConfig *config) {
+  gmLazyContext_ context = {.is_created = 0};
+
+  gmRenderState_ state;
+  gmInitRenderState_(&state, &context);
+
+  const gmError kError = gmRunWithState_(config, &state);
+
+  gmDeleteRenderState_(&state);
+  gmDeleteLazyContext_(&context);
+
+  return kError;
+}
+
+void gmInitRenderState_(GM_OUT_PARAM gmRenderState_ *state,
+                        gmLazyContext_ *context) {
+  state->context = context;
+  state->has_resources = 0;
+  state->trace = NULL;
+  state->gl_iteration_rate = 0.0;
+  state->profile_filepath = NULL;
+}
+
+void gmDeleteRenderState_(const gmRenderState_ *state) {
+  if (state->has_resources) {
+    // The resources were created in the context.
+    gmMakeContextCurrent_(&state->context->context);
+    gmDeleteResources_(&state->resources);
+    gmClearCurrentContext_();
+  }
+
+  free(state->profile_filepath);
+}
+
+gmError gmRunWithState_(const gmConfig *config, gmRenderState_ *state) {
+  if ((gmWritesIterationFile_(config) || gmWritesDeepZoomImage_(config)) &&
+      ((gmGetEngine_(&config->image_config) != gmEngine_EscapeTime) ||
+       config->frame_stream)) {
+    return gmError_UnsupportedImageFormat;
+  }
+
+  if ((gmWritesMappedImage_(config) && config->frame_stream) ||
+      !gmHasSupportedOutputTargets_(config)) {
+    return gmError_UnsupportedImageFormat;
+  }
+
+  gmConfig profiled_config = *config;
+
+  if (gmGetBackend_(&config->image_config) == gmBackend_Cpu) {
+    // The CPU backend doesn't need an OpenGL context.
+    gmApplyHostProfile_(&profiled_config, state, 0);
+    return gmRenderImageToFileOnCpu_(&profiled_config);
+  }
+
   gmError error;
 
-  gmContext_ context;
-  error = gmCreateContext_(&context);
+  state->trace = config->trace;
+
+  const double kContextStartTime = gmBeginTraceEvent_(config->trace);
+  error = gmUseLazyContext_(state->context);
+  gmEndTraceEvent_(config->trace, "Set up context", kContextStartTime);
   if (!error) {
-    gmMakeContextCurrent_(&context);
-    error = gmRenderImageToFile_(config);
+    // The renderer string of the host key needs a context.
+    gmApplyHostProfile_(&profiled_config, state, 1);
+
+    if (gmGetBackend_(&profiled_config.image_config) == gmBackend_Cpu) {
+      gmClearCurrentContext_();
+      return gmRenderImageToFileOnCpu_(&profiled_config);
+    }
 
+    error = gmRenderImageToFile_(&profiled_config, state);
     gmClearCurrentContext_();
-    gmDeleteContext_(&context);
   }
 
   return error;
 }
 
-void gmRenderImage_(const gmResources_ *resources,
-                    const gmImageConfig *image_config);
+int gmWritesIterationFile_(const gmConfig *config) {
+  return config->image_format == gmImageFormat_Iterations;
+}
+
+int gmWritesDeepZoomImage_(const gmConfig *config) {
+  return config->image_format == gmImageFormat_DeepZoom;
+}
+
+int gmWritesMappedImage_(const gmConfig *config) {
+  return gmIsMappedImageFormat_(config->image_format);
+}
+
+/**
+ * Applies the profile of the host, which is only read from its file by the
+ * first render of the state, streams and render queues running many renders.
+ */
+void gmApplyHostProfile_(GM_OUT_PARAM gmConfig *config,
+                         gmRenderState_ *state, int with_gl_renderer) {
+  const char *const kFilepath = gmGetProfileFilepath_(config->profile_filepath);
+
+  if (!state->profile_filepath || strcmp(state->profile_filepath, kFilepath) ||
+      (state->profile_has_gl_renderer != with_gl_renderer)) {
+    gmHostKey_ host_key;
+    gmGetHostKey_(&host_key, with_gl_renderer);
+
+    state->has_profile = gmLoadProfile_(&state->profile, kFilepath, &host_key);
+    state->profile_has_gl_renderer = with_gl_renderer;
+
+    const size_t kFilepathSize = strlen(kFilepath) + 1;
+    free(state->profile_filepath);
+    state->profile_filepath = malloc(kFilepathSize);
+    memcpy(state->profile_filepath, kFilepath, kFilepathSize);
+  }
+
+  if (state->has_profile) {
+    gmApplyProfile_(&config->image_config, &state->profile);
+  }
+}
+
+gmError gmFitImageConfigOnGl_(GM_OUT_PARAM gmImageConfig *image_config,
+                              GM_OUT_PARAM gmReport *report,
+                              const gmConfig *config, gmRenderState_ *state);
+
+int gmRecordsCosts_(const gmConfig *config);
+
+gmError gmUseStateResources_(gmRenderState_ *state,
+                             const gmImageConfig *image_config,
+                             int record_costs);
+
+gmError gmRenderStripOnGl_(GM_OUT_PARAM unsigned char *strip_data,
+                           const gmImageConfig *strip_config, void *state);
+
+gmError gmRenderTilesToFile_(GM_OUT_PARAM double *render_time,
+                             const gmImageConfig *image_config,
+                             const gmMemoryPlan_ *plan,
+                             const gmConfig *config, gmRenderState_ *state);
 
 gmError gmSaveImage_(const gmFrameBuffer_ *final_frame_buffer,
+                     const gmImageConfig *image_config,
+                     const gmConfig *config);
+
+gmError gmSaveCosts_(GM_OUT_PARAM gmCostStats *stats,
+                     const gmFrameBuffer_ *final_frame_buffer,
+                     const gmImageConfig *image_config,
                      const gmConfig *config);
 
-gmError gmRenderImageToFile_(const gmConfig *config) {
+gmError gmRenderImageToFile_(const gmConfig *config, gmRenderState_ *state) {
   gmError error;
 
-  gmResources_ resources;
-  error = gmCreateResources_(&resources, &config->image_config);
+  gmImageConfig image_config;
+  gmReport report;
+
+  error = gmFitImageConfigOnGl_(&image_config, &report, config, state);
+  if (!error && gmWritesIterationFile_(config)) {
+    const double kStartTime = gmGetTime_();
+    error = gmRenderIterationFile_(config->image_output_filepath,
+                                   &image_config);
+    report.render_time = gmGetTime_() - kStartTime;
+  } else if (!error && gmWritesDeepZoomImage_(config)) {
+    const double kStartTime = gmGetTime_();
+    error = gmWriteDeepZoomImage_(config->image_output_filepath, &image_config,
+                                  gmRenderStripOnGl_, state);
+    report.render_time = gmGetTime_() - kStartTime;
+  } else if (!error) {
+    const int kRecordsCosts = gmRecordsCosts_(config);
+
+    // Planned before the resources are created, which would fail or thrash
+    // when they don't fit in GPU memory.
+    gmMemoryPlan_ plan;
+    gmPlanGpuMemory_(&plan, &image_config, kRecordsCosts,
+                     (size_t)image_config.gl.memory_budget);
+
+    image_config.sample_count = plan.sample_count;
+    report.sample_count = plan.sample_count;
+    report.tile_size = plan.tile_size;
+    report.estimated_gpu_memory = plan.estimated_memory;
+    report.available_gpu_memory = plan.available_memory;
+
+    if (gmIsTiledPlan_(&plan, &image_config)) {
+      error = gmRenderTilesToFile_(&report.render_time, &image_config, &plan,
+                                   config, state);
+    } else {
+      error = gmUseStateResources_(state, &image_config, kRecordsCosts);
+      if (!error) {
+        const gmResources_ *const kResources = &state->resources;
+
+        gmGpuTraceEvent_ gpu_event;
+        gmBeginGpuTraceEvent_(&gpu_event, config->trace);
+
+        const double kStartTime = gmGetTime_();
+        error = gmRenderImage_(kResources, &image_config);
+        gmEndTraceEvent_(config->trace, "Draw", kStartTime);
+
+        gmEndGpuTraceEvent_(config->trace, &gpu_event, "Draw and resolve");
+
+        const double kWaitStartTime = gmBeginTraceEvent_(config->trace);
+        glFinish();
+        gmEndTraceEvent_(config->trace, "Wait for the GPU", kWaitStartTime);
+        report.render_time = gmGetTime_() - kStartTime;
+
+        gmResolveGpuTraceEvent_(config->trace, &gpu_event);
+
+        if (!error) {
+          error = gmSaveImage_(&kResources->render_frame_buffers.final,
+                               &image_config, config);
+        }
+
+        if (!error && kRecordsCosts) {
+          error = gmSaveCosts_(&report.cost_stats,
+                               &kResources->render_frame_buffers.final,
+                               &image_config, config);
+        }
+      }
+    }
+  }
+
+  if (!error && config->report) {
+    *config->report = report;
+  }
+
+  return error;
+}
+
+int gmHasTimeBudget_(const gmConfig *config);
+
+/**
+ * Keeps the resources of the state when they can render the image, recreates
+ * them otherwise.
+ */
+gmError gmUseStateResources_(gmRenderState_ *state,
+                             const gmImageConfig *image_config,
+                             int record_costs) {
+  if (state->has_resources &&
+      (state->resources_record_costs == record_costs) &&
+      gmCanReuseResources_(&state->resources_image_config, image_config)) {
+    return gmError_Success;
+  }
+
+  if (state->has_resources) {
+    gmDeleteResources_(&state->resources);
+    state->has_resources = 0;
+  }
+
+  const double kStartTime = gmBeginTraceEvent_(state->trace);
+  const gmError kError =
+      gmCreateResources_(&state->resources, image_config, record_costs);
+  gmEndTraceEvent_(state->trace, "Compile shaders and create frame-buffers",
+                   kStartTime);
+  if (!kError) {
+    state->resources_image_config = *image_config;
+    state->resources_record_costs = record_costs;
+    state->has_resources = 1;
+  }
+
+  return kError;
+}
+
+/**
+ * Renders the strips of Deep Zoom images with the resources of the render
+ * state, which are kept from one strip to the next.
+ */
+gmError gmRenderStripOnGl_(GM_OUT_PARAM unsigned char *strip_data,
+                           const gmImageConfig *strip_config, void *state) {
+  gmRenderState_ *const kState = state;
+
+  gmError error = gmUseStateResources_(kState, strip_config, 0);
   if (!error) {
-    gmRenderImage_(&resources, &config->image_config);
-    error = gmSaveImage_(&resources.render_frame_buffers.final, config);
-    gmDeleteResources_(&resources);
+    gmGpuTraceEvent_ gpu_event;
+    gmBeginGpuTraceEvent_(&gpu_event, kState->trace);
+
+    const double kStartTime = gmBeginTraceEvent_(kState->trace);
+    error = gmRenderImage_(&kState->resources, strip_config);
+    gmEndTraceEvent_(kState->trace, "Draw", kStartTime);
+
+    gmEndGpuTraceEvent_(kState->trace, &gpu_event, "Draw and resolve");
+
+    if (!error) {
+      const double kReadStartTime = gmBeginTraceEvent_(kState->trace);
+      gmReadImageData_(strip_data,
+                       &kState->resources.render_frame_buffers.final,
+                       &strip_config->size);
+      gmEndTraceEvent_(kState->trace, "Read back", kReadStartTime);
+    }
+
+    // The GPU is idle once the strip is read back.
+    gmResolveGpuTraceEvent_(kState->trace, &gpu_event);
   }
 
   return error;
 }
 
-void gmRenderImageOnRenderFrameBuffer_(const gmResources_ *resources);
+gmError gmWriteImageOutputs_(const unsigned char *image_data,
+                             const gmImageConfig *image_config,
+                             const gmConfig *config);
+
+/**
+ * Renders the tiles of the image with the resources of the render state, like
+ * the strips of Deep Zoom images, then writes the image they make up.
+ */
+gmError gmRenderTilesToFile_(GM_OUT_PARAM double *render_time,
+                             const gmImageConfig *image_config,
+                             const gmMemoryPlan_ *plan,
+                             const gmConfig *config, gmRenderState_ *state) {
+  const gmIntSize *const kSize = &image_config->size;
+  unsigned char *const kImageData =
+      malloc((size_t)kSize->w * kSize->h * 3);  // RGB.
+
+  const double kStartTime = gmGetTime_();
+  gmError error = gmRenderImageInTiles_(kImageData, image_config, plan,
+                                        gmRenderStripOnGl_, state);
+  *render_time = gmGetTime_() - kStartTime;
+
+  if (!error) {
+    error = gmWriteImageOutputs_(kImageData, image_config, config);
+  }
+
+  free(kImageData);
+  return error;
+}
 
-void gmBlitToFinalFrameBuffer_(const gmRenderFrameBuffers_ *frame_buffers,
-                               const gmIntSize *image_size);
+double gmGetRemainingTimeBudget_(const gmConfig *config, double start_time);
 
-void gmRenderImage_(const gmResources_ *resources,
-                    const gmImageConfig *image_config) {
-  // Not setting the viewport results in the image not rendering entirely.
-  glViewport(0, 0, image_config->size.w, image_config->size.h);
-  gmRenderImageOnRenderFrameBuffer_(resources);
+gmError gmFitImageConfigOnGl_(GM_OUT_PARAM gmImageConfig *image_config,
+                              GM_OUT_PARAM gmReport *report,
+                              const gmConfig *config, gmRenderState_ *state) {
+  *image_config = config->image_config;
+  gmInitReport_(report, image_config);
 
-  gmBlitToFinalFrameBuffer_(&resources->render_frame_buffers,
-                            &image_config->size);
+  if (!gmHasTimeBudget_(config)) {
+    return gmError_Success;
+  }
+
+  gmError error = gmError_Success;
+
+  const double kStartTime = gmGetTime_();
+
+  // Measured once per context, the renders of streams and render queues
+  // sharing the rate.
+  if (!state->gl_iteration_rate) {
+    double iteration_rate;
+    error = gmMeasureGlIterationRate_(&iteration_rate);
+    if (!error) {
+      state->gl_iteration_rate = iteration_rate;
+    }
+  }
+
+  if (!error) {
+    gmCostProbe_ probe;
+    gmCreateCostProbe_(&probe, image_config);
+
+    gmFitImageConfigInTimeBudget_(
+        image_config, report, &probe, state->gl_iteration_rate,
+        gmGetRemainingTimeBudget_(config, kStartTime));
+
+    gmDeleteCostProbe_(&probe);
+  }
+
+  return error;
 }
 
-void gmRenderImageOnRenderFrameBuffer_(const gmResources_ *resources) {
-  gmUseFrameBufferAs_(&resources->render_frame_buffers.render,
-                      gmFramebufferTarget_Draw_);
+/**
+ * The time spent measuring the cost of the image counts against its budget.
+ */
+double gmGetRemainingTimeBudget_(const gmConfig *config, double start_time) {
+  const double kRemainingTime =
+      config->time_budget - (gmGetTime_() - start_time);
+  return kRemainingTime > 0.0 ? kRemainingTime : 0.0;
+}
+
+int gmRecordsCosts_(const gmConfig *config) {
+  // The Buddhabrot doesn't iterate per pixel.
+  return config->cost_output_filepath && !gmWritesIterationFile_(config) &&
+         !gmWritesDeepZoomImage_(config) &&
+         (gmGetEngine_(&config->image_config) == gmEngine_EscapeTime);
+}
+
+int gmHasTimeBudget_(const gmConfig *config) {
+  // The cost of the Buddhabrot depends on its point count only, and Deep Zoom
+  // images are rendered at the requested quality.
+  return (config->time_budget > 0.0) && !gmWritesDeepZoomImage_(config) &&
+         (gmGetEngine_(&config->image_config) == gmEngine_EscapeTime);
+}
+
+void gmFitImageConfigOnCpu_(GM_OUT_PARAM gmImageConfig *image_config,
+                            GM_OUT_PARAM gmReport *report,
+                            const gmConfig *config);
 
-  gmUseModel_(&resources->render_data.quad);
-  gmUseProgram_(&resources->render_data.program);
+gmError gmRenderStripOnCpu_(GM_OUT_PARAM unsigned char *strip_data,
+                            const gmImageConfig *strip_config,
+                            void *user_data);
+
+int gmIsImageResized_(const gmImageConfig *image_config,
+                      const gmConfig *config);
+
+int gmWritesImageInPlace_(const gmImageConfig *image_config,
+                          const gmConfig *config);
+
+gmError gmWriteCosts_(GM_OUT_PARAM gmCostStats *stats, const float *cost_data,
+                      const gmImageConfig *image_config,
+                      const gmConfig *config);
+
+gmError gmRenderImageToFileOnCpu_(const gmConfig *config) {
+  gmError error;
 
-  // Hard coded because we're only rendering one quad.
-  glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, NULL);
+  gmImageConfig image_config;
+  gmReport report;
+  gmFitImageConfigOnCpu_(&image_config, &report, config);
 
-  gmClearCurrentFrameBuffer_(gmFramebufferTarget_Draw_);
-  gmClearCurrentModel_();
-  gmClearCurrentProgram_();
+  if (gmWritesIterationFile_(config)) {
+    const double kStartTime = gmGetTime_();
+    error = gmRenderIterationFileOnCpu_(config->image_output_filepath,
+                                        &image_config);
+    report.render_time = gmGetTime_() - kStartTime;
+
+    if (!error && config->report) {
+      *config->report = report;
+    }
+
+    return error;
+  }
+
+  if (gmWritesDeepZoomImage_(config)) {
+    const double kStartTime = gmGetTime_();
+    error = gmWriteDeepZoomImage_(config->image_output_filepath, &image_config,
+                                  gmRenderStripOnCpu_, NULL);
+    report.render_time = gmGetTime_() - kStartTime;
+
+    if (!error && config->report) {
+      *config->report = report;
+    }
+
+    return error;
+  }
+
+  const gmIntSize *const kSize = &image_config.size;
+
+  // Uncompressed images are rendered straight into the mapping of the file,
+  // whose pages the kernel writes back during the render.
+  gmMappedImage_ mapped_image;
+  const int kRendersIntoFile = gmWritesImageInPlace_(&image_config, config);
+  if (kRendersIntoFile) {
+    error = gmMapImageFile_(&mapped_image, config->image_output_filepath,
+                            config->image_format, kSize);
+    if (error) {
+      return error;
+    }
+  }
+
+  unsigned char *const kImageData =
+      kRendersIntoFile ? mapped_image.pixels
+                       : malloc(kSize->w * kSize->h * 3);  // RGB.
+  float *const kCostData =
+      gmRecordsCosts_(config)
+          ? malloc((size_t)kSize->w * kSize->h * 2 * sizeof(float))
+          : NULL;
+
+  const double kStartTime = gmGetTime_();
+  error = gmRenderImageOnCpu_(kImageData, kCostData, &image_config);
+  gmEndTraceEvent_(config->trace, "Render on the CPU", kStartTime);
+  report.render_time = gmGetTime_() - kStartTime;
+
+  if (!error) {
+    const gmPreviewConfig *const kPreview = &image_config.preview;
+    if (kPreview->func) {
+      // Progressive renders are done in a single pass.
+      kPreview->func(kImageData, kSize, 0, 1, kPreview->user_data);
+    }
+
+    if (kRendersIntoFile) {
+      gmPackMappedPixels_(&mapped_image);
+    } else {
+      error = gmWriteImageOutputs_(kImageData, &image_config, config);
+    }
+  }
+
+  if (!error && kCostData) {
+    error = gmWriteCosts_(&report.cost_stats, kCostData, &image_config, config);
+  }
+
+  if (!error && config->report) {
+    *config->report = report;
+  }
+
+  if (kRendersIntoFile) {
+    gmUnmapImageFile_(&mapped_image);
+  } else {
+    free(kImageData);
+  }
+
+  free(kCostData);
+  return error;
 }
 
-void gmBlitToFinalFrameBuffer_(const gmRenderFrameBuffers_ *frame_buffers,
-                               const gmIntSize *image_size) {
-  gmUseFrameBufferAs_(&frame_buffers->final, gmFramebufferTarget_Draw_);
-  gmUseFrameBufferAs_(&frame_buffers->render, gmFramebufferTarget_Read_);
+void gmFitImageConfigOnCpu_(GM_OUT_PARAM gmImageConfig *image_config,
+                            GM_OUT_PARAM gmReport *report,
+                            const gmConfig *config) {
+  *image_config = config->image_config;
+  gmInitReport_(report, image_config);
+
+  if (!gmHasTimeBudget_(config)) {
+    return;
+  }
 
-  glBlitFramebuffer(0, 0, image_size->w, image_size->h, 0, 0, image_size->w,
-                    image_size->h, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+  const double kStartTime = gmGetTime_();
 
-  gmClearCurrentFrameBuffer_(gmFramebufferTarget_Read_);
-  gmClearCurrentFrameBuffer_(gmFramebufferTarget_Draw_);
+  gmCostProbe_ probe;
+  gmCreateCostProbe_(&probe, image_config);
+
+  const gm_uint kThreadCount = image_config->cpu.thread_count;
+  const double kIterationRate =
+      probe.cpu_iteration_rate *
+      (kThreadCount ? kThreadCount : gmGetProcessorCount_());
+
+  gmFitImageConfigInTimeBudget_(image_config, report, &probe, kIterationRate,
+                                gmGetRemainingTimeBudget_(config, kStartTime));
+
+  gmDeleteCostProbe_(&probe);
 }
 
-void gmReadImageData_(GM_OUT_PARAM void *image_data,
-                      const gmFrameBuffer_ *final_frame_buffer,
-                      const gmIntSize *image_size);
+gmError gmRenderStripOnCpu_(GM_OUT_PARAM unsigned char *strip_data,
+                            const gmImageConfig *strip_config,
+                            void *user_data) {
+  (void)user_data;
+  return gmRenderImageOnCpu_(strip_data, NULL, strip_config);
+}
 
-gmError gmWriteImageToFile_(unsigned char *image_data, const gmConfig *config);
+gmError gmSaveMappedImage_(const gmFrameBuffer_ *final_frame_buffer,
+                           const gmImageConfig *image_config,
+                           const gmConfig *config);
 
 gmError gmSaveImage_(const gmFrameBuffer_ *final_frame_buffer,
+                     const gmImageConfig *image_config,
                      const gmConfig *config) {
-  const gmIntSize *const kSize = &config->image_config.size;
+  if (gmWritesImageInPlace_(image_config, config)) {
+    return gmSaveMappedImage_(final_frame_buffer, image_config, config);
+  }
+
+  const gmIntSize *const kSize = &image_config->size;
   unsigned char *const kImageData = malloc(kSize->w * kSize->h * 3);  // RGB.
 
-  gmReadImageData_(kImageData, final_frame_buffer, &config->image_config.size);
-  const gmError kWriteError = gmWriteImageToFile_(kImageData, config);
+  const double kStartTime = gmBeginTraceEvent_(config->trace);
+  gmReadImageData_(kImageData, final_frame_buffer, kSize);
+  gmEndTraceEvent_(config->trace, "Read back", kStartTime);
+
+  const gmError kWriteError =
+      gmWriteImageOutputs_(kImageData, image_config, config);
   free(kImageData);
 
   return kWriteError;
 }
 
-void gmReadImageData_(GM_OUT_PARAM void *image_data,
-                      const gmFrameBuffer_ *final_frame_buffer,
-                      const gmIntSize *image_size) {
-  glReadBuffer(GL_COLOR_ATTACHMENT0);
-  gmUseFrameBufferAs_(final_frame_buffer, gmFramebufferTarget_Read_);
+/**
+ * Reads the image back straight into the mapping of the output file, in the
+ * pixel layout of its format.
+ */
+gmError gmSaveMappedImage_(const gmFrameBuffer_ *final_frame_buffer,
+                           const gmImageConfig *image_config,
+                           const gmConfig *config) {
+  gmMappedImage_ image;
+  const gmError kError =
+      gmMapImageFile_(&image, config->image_output_filepath,
+                      config->image_format, &image_config->size);
+  if (!kError) {
+    const double kStartTime = gmBeginTraceEvent_(config->trace);
+    gmReadImagePixels_(image.pixels, final_frame_buffer, &image_config->size,
+                       image.is_bgr ? GL_BGR : GL_RGB, image.row_alignment);
+    gmEndTraceEvent_(config->trace, "Read back into the file", kStartTime);
+
+    gmUnmapImageFile_(&image);
+  }
+
+  return kError;
+}
+
+gmError gmSaveCosts_(GM_OUT_PARAM gmCostStats *stats,
+                     const gmFrameBuffer_ *final_frame_buffer,
+                     const gmImageConfig *image_config,
+                     const gmConfig *config) {
+  const gmIntSize *const kSize = &image_config->size;
+  float *const kCostData = malloc((size_t)kSize->w * kSize->h * 2 *
+                                  sizeof(float));  // Executed and count.
+
+  const double kStartTime = gmBeginTraceEvent_(config->trace);
+  gmReadCostData_(kCostData, final_frame_buffer, kSize);
+  gmEndTraceEvent_(config->trace, "Read back costs", kStartTime);
+
+  const gmError kWriteError =
+      gmWriteCosts_(stats, kCostData, image_config, config);
+  free(kCostData);
+
+  return kWriteError;
+}
+
+gmError gmWriteImageToFile_(const unsigned char *image_data,
+                            const gmImageConfig *image_config,
+                            const gmConfig *config);
+
+/**
+ * Writes the image and its output targets, which are encoded on worker threads
+ * while the image is written.
+ */
+gmError gmWriteImageOutputs_(const unsigned char *image_data,
+                             const gmImageConfig *image_config,
+                             const gmConfig *config) {
+  gmOutputTargetWriter_ writer;
+  gmError error = gmStartWritingOutputTargets_(&writer, image_data,
+                                               &image_config->size, config);
+  if (!error) {
+    const double kStartTime = gmBeginTraceEvent_(config->trace);
+    error = gmWriteImageToFile_(image_data, image_config, config);
+    gmEndTraceEvent_(config->trace, "Encode and write image", kStartTime);
+
+    const double kWaitStartTime = gmBeginTraceEvent_(config->trace);
+    const gmError kTargetsError = gmFinishWritingOutputTargets_(&writer);
+    gmEndTraceEvent_(config->trace, "Wait for the output targets",
+                     kWaitStartTime);
+    if (!error) {
+      error = kTargetsError;
+    }
+  }
+
+  return error;
+}
+
+gmError gmWriteMappedImage_(const unsigned char *image_data,
+                            const gmImageConfig *image_config,
+                            const gmConfig *config);
+
+/**
+ * Writes the image rendered with the specified image config, upscaling it to
+ * the requested size when it was rendered smaller to fit in the time budget.
+ * The image goes to the frame stream of the config instead of the output file
+ * when it has one.
+ */
+gmError gmWriteImageToFile_(const unsigned char *image_data,
+                            const gmImageConfig *image_config,
+                            const gmConfig *config) {
+  if (gmWritesMappedImage_(config)) {
+    return gmWriteMappedImage_(image_data, image_config, config);
+  }
+
+  const gmIntSize *const kImageSize = &config->image_config.size;
+  const gmIntSize *const kRenderSize = &image_config->size;
+
+  unsigned char *resized_image_data = NULL;
+  if (gmIsImageResized_(image_config, config)) {
+    resized_image_data = malloc(kImageSize->w * kImageSize->h * 3);  // RGB.
+    gmResizeImage_(resized_image_data, kImageSize, image_data, kRenderSize);
+  }
+
+  const unsigned char *const kWrittenData =
+      resized_image_data ? resized_image_data : image_data;
+
+  gmError error;
+  if (config->frame_stream) {
+    error = gmWriteFrame_(config->frame_stream, kWrittenData, kImageSize);
+  } else {
+    error = gmWriteImageFile_(config->image_output_filepath,
+                              config->image_format, kWrittenData, kImageSize);
+  }
+
+  free(resized_image_data);
+  return error;
+}
+
+/**
+ * Writes the image data into the mapping of the output file, upscaling it in
+ * place of the copy when it was rendered smaller.
+ */
+gmError gmWriteMappedImage_(const unsigned char *image_data,
+                            const gmImageConfig *image_config,
+                            const gmConfig *config) {
+  const gmIntSize *const kImageSize = &config->image_config.size;
+  const gmIntSize *const kRenderSize = &image_config->size;
+
+  gmMappedImage_ image;
+  const gmError kError = gmMapImageFile_(
+      &image, config->image_output_filepath, config->image_format, kImageSize);
+  if (!kError) {
+    if (gmIsImageResized_(image_config, config)) {
+      gmResizeImage_(image.pixels, kImageSize, image_data, kRenderSize);
+    } else {
+      memcpy(image.pixels, image_data,
+             (size_t)kImageSize->w * kImageSize->h * 3);  // RGB.
+    }
+
+    gmPackMappedPixels_(&image);
+    gmUnmapImageFile_(&image);
+  }
+
+  return kError;
+}
+
+/**
+ * Whether the pixels are written straight into the mapping of the output file,
+ * which needs the image at its requested size and no output targets to scale
+ * from its data.
+ */
+int gmWritesImageInPlace_(const gmImageConfig *image_config,
+                          const gmConfig *config) {
+  return gmWritesMappedImage_(config) &&
+         !gmIsImageResized_(image_config, config) &&
+         !config->output_target_count;
+}
+
+/**
+ * Whether the image was rendered smaller than requested to fit in the time
+ * budget.
+ */
+int gmIsImageResized_(const gmImageConfig *image_config,
+                      const gmConfig *config) {
+  const gmIntSize *const kImageSize = &config->image_config.size;
+  const gmIntSize *const kRenderSize = &image_config->size;
 
-  glReadPixels(0, 0, image_size->w, image_size->h, GL_RGB, GL_UNSIGNED_BYTE,
-               image_data);
+  return (kRenderSize->w != kImageSize->w) || (kRenderSize->h != kImageSize->h);
 }
 
-gmError gmWriteImageToFile_(unsigned char *image_data, const gmConfig *config) {
-  const gmIntSize *kImageSize = &config->image_config.size;
-  const int kLineStride = kImageSize->w * 3;
+/**
+ * Summarizes the costs in the report and writes them as a heatmap, which stays
+ * at the render size to show the work actually done.
+ */
+gmError gmWriteCosts_(GM_OUT_PARAM gmCostStats *stats, const float *cost_data,
+                      const gmImageConfig *image_config,
+                      const gmConfig *config) {
+  const double kStartTime = gmBeginTraceEvent_(config->trace);
+  gmComputeCostStats_(stats, cost_data, &image_config->size,
+                      gmGetMaxIterationCount_(image_config));
+
+  const gmError kError = gmWriteCostImage_(config->cost_output_filepath,
+                                           cost_data, &image_config->size);
+  gmEndTraceEvent_(config->trace, "Write costs", kStartTime);
+
+  return kError;
+}
 
-  const int kError =
-      !stbi_write_png(config->image_output_filepath, kImageSize->w,
-                      kImageSize->h, 3, image_data, kLineStride);
+gmError gmRunBatch(const gmBatchConfig *config) {
+  gmError error;
 
-  return !kError ? gmError_Success : gmError_ImageWriteFailed;
+  gmContext_ context;
+  error = gmCreateContext_(&context);
+  if (!error) {
+    gmMakeContextCurrent_(&context);
+    error = gmRenderBatch_(config);
+
+    gmClearCurrentContext_();
+    gmDeleteContext_(&context);
+  }
+
+  return error;
+}
+
+gmError gmTune(const char *profile_filepath) {
+  gmError error;
+
+  gmContext_ context;
+  error = gmCreateContext_(&context);
+  if (!error) {
+    gmMakeContextCurrent_(&context);
+
+    gmProfile_ profile;
+    error = gmMeasureProfile_(&profile);
+    if (!error) {
+      gmHostKey_ host_key;
+      gmGetHostKey_(&host_key, 1);
+
+      error = gmSaveProfile_(gmGetProfileFilepath_(profile_filepath),
+                             &host_key, &profile);
+    }
+
+    gmClearCurrentContext_();
+    gmDeleteContext_(&context);
+  }
+
+  return error;
 }
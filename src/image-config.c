@@ -0,0 +1,95 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "image-config.h"
+
+#include "gm/gm.h"
+#include "setup.h"
+
+gm_uint gmGetMaxIterationCount_(const gmImageConfig *image_config) {
+  const gm_uint kCount = image_config->max_iteration_count;
+  return kCount ? kCount : 100;
+}
+
+void gmGetViewport_(GM_OUT_PARAM gmViewport *viewport,
+                    const gmImageConfig *image_config) {
+  const gmViewport kDefaultViewport = {
+      .center_x = -0.5, .center_y = 0.0, .width = 2.0, .height = 2.0};
+
+  const gmViewport *const kViewport = &image_config->viewport;
+  const int kIsDefault =
+      (kViewport->width == 0.0) || (kViewport->height == 0.0);
+
+  *viewport = kIsDefault ? kDefaultViewport : *kViewport;
+}
+
+gmEngine gmGetEngine_(const gmImageConfig *image_config) {
+  const gmEngine kEngine = image_config->engine;
+  return kEngine != gmEngine_Default ? kEngine : gmEngine_EscapeTime;
+}
+
+gmBackend gmGetBackend_(const gmImageConfig *image_config) {
+  if (gmGetEngine_(image_config) == gmEngine_Buddhabrot) {
+    return gmBackend_Cpu;  // The only backend implementing it.
+  }
+
+  const gmBackend kBackend = image_config->backend;
+  return kBackend != gmBackend_Default ? kBackend : gmBackend_Gl;
+}
+
+gmCpuAlgorithm gmGetCpuAlgorithm_(const gmImageConfig *image_config) {
+  const gmCpuAlgorithm kAlgorithm = image_config->cpu.algorithm;
+  return kAlgorithm != gmCpuAlgorithm_Default ? kAlgorithm
+                                               : gmCpuAlgorithm_PerPixel;
+}
+
+gmGlAlgorithm gmGetGlAlgorithm_(const gmImageConfig *image_config) {
+  // Progressive renders have their own passes.
+  const gmGlAlgorithm kAlgorithm = image_config->preview.func
+                                       ? gmGlAlgorithm_PerPixel
+                                       : image_config->gl.algorithm;
+
+  return kAlgorithm != gmGlAlgorithm_Default ? kAlgorithm
+                                              : gmGlAlgorithm_PerPixel;
+}
+
+gmColoringMode gmGetColoringMode_(const gmImageConfig *image_config) {
+  // Previews are colored before the image is complete.
+  const gmColoringMode kMode = image_config->preview.func
+                                   ? gmColoringMode_Cyclic
+                                   : image_config->coloring_mode;
+
+  return kMode != gmColoringMode_Default ? kMode : gmColoringMode_Cyclic;
+}
+
+int gmHasRegion_(const gmImageConfig *image_config) {
+  const gmRegionConfig *const kRegion = &image_config->region;
+
+  // Previews are shown over the whole image.
+  return (kRegion->rect_count || kRegion->mask) &&
+         !image_config->preview.func &&
+         (gmGetEngine_(image_config) == gmEngine_EscapeTime);
+}
+
+gm_uint gmDivideRoundingUp_(gm_uint dividend, gm_uint divisor);
+
+gm_uint gmGetEqualizationBinWidth_(const gmImageConfig *image_config) {
+  return gmDivideRoundingUp_(gmGetMaxIterationCount_(image_config),
+                             GM_MAX_EQUALIZATION_BIN_COUNT_);
+}
+
+gm_uint gmGetEqualizationBinCount_(const gmImageConfig *image_config) {
+  return gmDivideRoundingUp_(gmGetMaxIterationCount_(image_config),
+                             gmGetEqualizationBinWidth_(image_config));
+}
+
+gm_uint gmGetEqualizationRowCount_(const gmImageConfig *image_config) {
+  return gmDivideRoundingUp_(
+      (gm_uint)image_config->size.w * (gm_uint)image_config->size.h,
+      GM_MAX_EQUALIZATION_ROW_PIXEL_COUNT_);
+}
+
+gm_uint gmDivideRoundingUp_(gm_uint dividend, gm_uint divisor) {
+  // Does not overflow for the largest dividends.
+  return dividend / divisor + (dividend % divisor != 0);
+}
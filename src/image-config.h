@@ -0,0 +1,58 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "gm/gm.h"
+#include "setup.h"
+
+// The functions below resolve the settings left at their default value.
+
+gm_uint gmGetMaxIterationCount_(const gmImageConfig *image_config);
+
+void gmGetViewport_(GM_OUT_PARAM gmViewport *viewport,
+                    const gmImageConfig *image_config);
+
+gmEngine gmGetEngine_(const gmImageConfig *image_config);
+
+gmBackend gmGetBackend_(const gmImageConfig *image_config);
+
+gmCpuAlgorithm gmGetCpuAlgorithm_(const gmImageConfig *image_config);
+
+gmGlAlgorithm gmGetGlAlgorithm_(const gmImageConfig *image_config);
+
+gmColoringMode gmGetColoringMode_(const gmImageConfig *image_config);
+
+/**
+ * Whether only the region of the image is rendered.
+ */
+int gmHasRegion_(const gmImageConfig *image_config);
+
+/**
+ * Most bins of the histograms of equalized renders.
+ */
+#define GM_MAX_EQUALIZATION_BIN_COUNT_ 4096
+
+/**
+ * Number of consecutive iteration counts sharing a bin of the histogram of
+ * equalized renders.
+ */
+gm_uint gmGetEqualizationBinWidth_(const gmImageConfig *image_config);
+
+/**
+ * Number of bins of the histogram of equalized renders, which counts the
+ * escaping pixels only.
+ */
+gm_uint gmGetEqualizationBinCount_(const gmImageConfig *image_config);
+
+/**
+ * Most pixels added up in a row of the histogram of equalized renders, past
+ * which its 32-bit float bins would stop counting by ones.
+ */
+#define GM_MAX_EQUALIZATION_ROW_PIXEL_COUNT_ (1 << 24)
+
+/**
+ * Number of rows of the histogram of equalized renders, which are added up
+ * before its prefix sums.
+ */
+gm_uint gmGetEqualizationRowCount_(const gmImageConfig *image_config);
@@ -0,0 +1,155 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "iteration-file.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "gm/iterations.h"
+#include "image-config.h"
+#include "setup.h"
+
+void gmGetIterationFileHeader_(GM_OUT_PARAM gmIterationFileHeader *header,
+                               const gmImageConfig *image_config);
+
+gmError gmWriteTileIndex_(const gmIterationFile_ *file);
+
+gmError gmCreateIterationFile_(GM_OUT_PARAM gmIterationFile_ *file,
+                               const char *filepath,
+                               const gmImageConfig *image_config) {
+  gmIterationFileHeader *const kHeader = &file->header;
+  gmGetIterationFileHeader_(kHeader, image_config);
+
+  const uint64_t kTileCount =
+      (uint64_t)kHeader->tile_column_count * kHeader->tile_row_count;
+  const uint64_t kIndexEnd = kHeader->index_offset + kTileCount * 8;
+
+  // Aligned so that tiles can be mapped on their own.
+  file->tiles_offset = (kIndexEnd + GM_ITERATION_FILE_ALIGNMENT - 1) /
+                       GM_ITERATION_FILE_ALIGNMENT *
+                       GM_ITERATION_FILE_ALIGNMENT;
+
+  file->file = fopen(filepath, "wb");
+  if (!file->file) {
+    return gmError_ImageWriteFailed;
+  }
+
+  file->tile_data = malloc(GM_ITERATION_FILE_TILE_SIZE *
+                           GM_ITERATION_FILE_TILE_SIZE *
+                           GM_ITERATION_CHANNEL_COUNT_ * sizeof(float));
+
+  const gmError kError = gmWriteTileIndex_(file);
+  if (kError) {
+    gmCloseIterationFile_(file, filepath, kError);
+  }
+
+  return kError;
+}
+
+void gmGetIterationFileHeader_(GM_OUT_PARAM gmIterationFileHeader *header,
+                               const gmImageConfig *image_config) {
+  const gmIntSize *const kSize = &image_config->size;
+  const int kTileSize = GM_ITERATION_FILE_TILE_SIZE;
+
+  gmViewport viewport;
+  gmGetViewport_(&viewport, image_config);
+
+  memset(header, 0, sizeof(gmIterationFileHeader));
+  memcpy(header->magic, GM_ITERATION_FILE_MAGIC, sizeof(header->magic));
+
+  header->header_size = sizeof(gmIterationFileHeader);
+  header->width = kSize->w;
+  header->height = kSize->h;
+  header->tile_size = kTileSize;
+  header->tile_column_count = (kSize->w + kTileSize - 1) / kTileSize;
+  header->tile_row_count = (kSize->h + kTileSize - 1) / kTileSize;
+  header->channel_count = GM_ITERATION_CHANNEL_COUNT_;
+  header->max_iteration_count = gmGetMaxIterationCount_(image_config);
+  header->viewport_center_x = viewport.center_x;
+  header->viewport_center_y = viewport.center_y;
+  header->viewport_width = viewport.width;
+  header->viewport_height = viewport.height;
+  header->index_offset = sizeof(gmIterationFileHeader);
+}
+
+uint64_t gmGetTileOffset_(const gmIterationFile_ *file, uint64_t tile_index);
+
+/**
+ * Writes the header and the index, the tiles being stored in the order of
+ * the index.
+ */
+gmError gmWriteTileIndex_(const gmIterationFile_ *file) {
+  const gmIterationFileHeader *const kHeader = &file->header;
+  int error = fwrite(kHeader, sizeof(gmIterationFileHeader), 1, file->file) !=
+              1;
+
+  const uint64_t kTileCount =
+      (uint64_t)kHeader->tile_column_count * kHeader->tile_row_count;
+
+  for (uint64_t i = 0; (i < kTileCount) && !error; ++i) {
+    const uint64_t kOffset = gmGetTileOffset_(file, i);
+    error = fwrite(&kOffset, sizeof(kOffset), 1, file->file) != 1;
+  }
+
+  return !error ? gmError_Success : gmError_ImageWriteFailed;
+}
+
+uint64_t gmGetTileOffset_(const gmIterationFile_ *file, uint64_t tile_index) {
+  // The tile byte size is a multiple of the alignment.
+  const uint64_t kTileByteSize = GM_ITERATION_FILE_TILE_SIZE *
+                                 GM_ITERATION_FILE_TILE_SIZE *
+                                 GM_ITERATION_CHANNEL_COUNT_ * sizeof(float);
+
+  return file->tiles_offset + tile_index * kTileByteSize;
+}
+
+gmError gmWriteIterationTile_(gmIterationFile_ *file, int column, int row,
+                              const float *data, size_t row_stride) {
+  const gmIterationFileHeader *const kHeader = &file->header;
+  const int kTileSize = GM_ITERATION_FILE_TILE_SIZE;
+  const size_t kRowSize = kTileSize * GM_ITERATION_CHANNEL_COUNT_;
+
+  // The last tiles are partially outside of the image.
+  const int kWidth = kHeader->width - column * kTileSize < kTileSize
+                         ? kHeader->width - column * kTileSize
+                         : kTileSize;
+  const int kHeight = kHeader->height - row * kTileSize < kTileSize
+                          ? kHeader->height - row * kTileSize
+                          : kTileSize;
+
+  memset(file->tile_data, 0, kTileSize * kRowSize * sizeof(float));
+  for (int y = 0; y < kHeight; ++y) {
+    memcpy(file->tile_data + y * kRowSize, data + y * row_stride,
+           kWidth * GM_ITERATION_CHANNEL_COUNT_ * sizeof(float));
+  }
+
+  const uint64_t kTileIndex =
+      (uint64_t)row * kHeader->tile_column_count + column;
+
+  const int kError =
+      fseeko(file->file, (off_t)gmGetTileOffset_(file, kTileIndex),
+             SEEK_SET) ||
+      (fwrite(file->tile_data, sizeof(float), kTileSize * kRowSize,
+              file->file) != kTileSize * kRowSize);
+
+  return !kError ? gmError_Success : gmError_ImageWriteFailed;
+}
+
+gmError gmCloseIterationFile_(const gmIterationFile_ *file,
+                              const char *filepath, gmError write_error) {
+  free(file->tile_data);
+
+  const int kCloseError = fclose(file->file);
+  const gmError kError =
+      write_error ? write_error
+                  : (!kCloseError ? gmError_Success : gmError_ImageWriteFailed);
+
+  if (kError) {
+    remove(filepath);  // Readers would map a truncated file.
+  }
+
+  return kError;
+}
@@ -0,0 +1,56 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "gm/iterations.h"
+#include "setup.h"
+
+#define GM_ITERATION_CHANNEL_COUNT_ 2
+
+/**
+ * Iteration file being written, tile by tile.
+ */
+typedef struct gmIterationFile_ {
+  FILE *file;
+  gmIterationFileHeader header;
+
+  /**
+   * Offset of the first tile, the others following it.
+   */
+  uint64_t tiles_offset;
+
+  /**
+   * Staging memory of a tile, padded with zeros.
+   */
+  float *tile_data;
+} gmIterationFile_;
+
+/**
+ * Creates the file and writes its header and tile index.
+ */
+gmError gmCreateIterationFile_(GM_OUT_PARAM gmIterationFile_ *file,
+                               const char *filepath,
+                               const gmImageConfig *image_config);
+
+/**
+ * Writes the tile at the specified column and row of the tile grid.
+ *
+ * @param data Pixels of the tile starting from its bottom left corner,
+ * `GM_ITERATION_CHANNEL_COUNT_` floats each.  Only the pixels inside the image
+ * are read.
+ * @param row_stride Floats between the rows of the data.
+ */
+gmError gmWriteIterationTile_(gmIterationFile_ *file, int column, int row,
+                              const float *data, size_t row_stride);
+
+/**
+ * Closes the file, which is deleted when the write failed.
+ */
+gmError gmCloseIterationFile_(const gmIterationFile_ *file,
+                              const char *filepath, gmError write_error);
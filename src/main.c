@@ -2,21 +2,113 @@
 // See the LICENSE file at the root of the repository for all the details.
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "gm/gm.h"
 
-int main() {
-  // Note that your GPU might not support as many as 32 samples, the sample
-  // count will automatically be reduced to the max supported value.
-  const gmConfig kConfig = {
-      .image_config = {.size = {.w = 500, .h = 500}, .sample_count = 32},
-      .image_output_filepath = "output.png"};
+gmError gmStreamZoom_(int frame_count);
 
-  const gmError kError = gmRun(&kConfig);
-  if (kError) {
-    const char *const kErrorMessage = gmGetErrorMessage(kError);
+int main(int argc, char **argv) {
+  gmError error;
+
+  if ((argc > 1) && !strcmp(argv[1], "--tune")) {
+    // The profile is used by the next renders of this host.
+    error = gmTune(NULL);
+    if (!error) {
+      printf("Profile saved to %s\n", GM_DEFAULT_PROFILE_FILEPATH);
+    }
+  } else if ((argc > 2) && !strcmp(argv[1], "--serve")) {
+    error = gmServe(argv[2]);
+  } else if ((argc > 2) && !strcmp(argv[1], "--distribute")) {
+    const gmConfig kConfig = {
+        .image_config = {.size = {.w = 500, .h = 500}},
+        .image_output_filepath = "output.png"};
+
+    // Every remaining argument is a worker address.
+    const gm_uint kWorkerCount = (gm_uint)(argc - 2);
+    gmWorkerReport *const kReports =
+        malloc(kWorkerCount * sizeof(gmWorkerReport));
+
+    const gmDistributedConfig kDistributedConfig = {
+        .worker_addresses = (const char *const *)&argv[2],
+        .worker_count = kWorkerCount,
+        .worker_reports = kReports};
+
+    error = gmRunDistributed(&kConfig, &kDistributedConfig);
+
+    for (gm_uint i = 0; i < kWorkerCount; ++i) {
+      printf("%s: %u tiles (%u duplicates), %.1f tiles/s, %u failures\n",
+             argv[i + 2], kReports[i].tile_count,
+             kReports[i].duplicate_tile_count, kReports[i].tiles_per_second,
+             kReports[i].failure_count);
+    }
+
+    free(kReports);
+  } else if ((argc > 2) && !strcmp(argv[1], "--stream")) {
+    // Meant to be piped to an encoder: gm --stream 300 | ffmpeg -i - zoom.mp4
+    error = gmStreamZoom_(atoi(argv[2]));
+  } else {
+    // Note that your GPU might not support as many as 32 samples, the sample
+    // count will automatically be reduced to the max supported value.
+    const gmConfig kConfig = {
+        .image_config = {.size = {.w = 500, .h = 500}, .sample_count = 32},
+        .image_output_filepath = "output.png"};
+
+    error = gmRun(&kConfig);
+  }
+
+  if (error) {
+    const char *const kErrorMessage = gmGetErrorMessage(error);
     fprintf(stderr, "Error: %s\n", kErrorMessage);
   }
 
-  return kError;
+  return error;
+}
+
+/**
+ * Writes the frames of a zoom to the standard output as a Y4M stream.
+ */
+gmError gmStreamZoom_(int frame_count) {
+  gmError error;
+
+  gmFrameStream *stream;
+  error = gmOpenFrameStream(&stream, NULL, NULL);
+  if (!error) {
+    gmConfig config = {
+        .image_config = {.size = {.w = 640, .h = 480},
+                         .sample_count = 4,
+                         .max_iteration_count = 1000,
+                         .viewport = {.center_x = -0.743643887,
+                                      .center_y = 0.131825904,
+                                      .width = 3.0,
+                                      .height = 2.25}},
+        .frame_stream = stream};
+
+    // A single worker keeps its context and resources from frame to frame,
+    // only the viewport changing between them.
+    gmRenderQueue *queue;
+    error = gmCreateRenderQueue(&queue, NULL);
+    if (!error) {
+      for (int i = 0; !error && (i < frame_count); ++i) {
+        gmJob *job;
+        error = gmSubmit(queue, &config, NULL, NULL, &job);
+        if (!error) {
+          error = gmWait(job);
+        }
+
+        config.image_config.viewport.width *= 0.97;
+        config.image_config.viewport.height *= 0.97;
+      }
+
+      gmDeleteRenderQueue(queue);
+    }
+
+    const gmError kCloseError = gmCloseFrameStream(stream);
+    if (!error) {
+      error = kCloseError;
+    }
+  }
+
+  return error;
 }
@@ -0,0 +1,178 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "mapped-image.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>  // For memcpy, memmove and memset.
+#include <sys/mman.h>
+#include <unistd.h>  // For close.
+
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "setup.h"
+
+int gmIsMappedImageFormat_(gmImageFormat format) {
+  return (format == gmImageFormat_Ppm) || (format == gmImageFormat_Pam) ||
+         (format == gmImageFormat_Bmp) || (format == gmImageFormat_Tga);
+}
+
+#define GM_MAX_IMAGE_HEADER_SIZE_ 128
+
+size_t gmFormatImageHeader_(GM_OUT_PARAM unsigned char *header,
+                            GM_OUT_PARAM gmMappedImage_ *image,
+                            gmImageFormat format);
+
+gmError gmMapImageFile_(GM_OUT_PARAM gmMappedImage_ *image,
+                        const char *filepath, gmImageFormat format,
+                        const gmIntSize *size) {
+  image->size = *size;
+  image->row_stride = (size_t)size->w * 3;
+  image->row_alignment = 1;
+  image->is_bgr = 0;
+
+  unsigned char header[GM_MAX_IMAGE_HEADER_SIZE_];
+  const size_t kHeaderSize = gmFormatImageHeader_(header, image, format);
+  if (!kHeaderSize) {
+    return gmError_UnsupportedImageFormat;
+  }
+
+  image->file_size = kHeaderSize + image->row_stride * size->h;
+
+  const int kFile = open(filepath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (kFile < 0) {
+    return gmError_ImageWriteFailed;
+  }
+
+  // Allocating the blocks up front reports a full disk here, rather than as a
+  // bus error when the pixels are written through the mapping.
+  void *mapping = MAP_FAILED;
+  if (!posix_fallocate(kFile, 0, (off_t)image->file_size)) {
+    mapping = mmap(NULL, image->file_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   kFile, 0);
+  }
+
+  // The mapping keeps the file open.
+  close(kFile);
+
+  if (mapping == MAP_FAILED) {
+    return gmError_ImageWriteFailed;
+  }
+
+  image->mapping = mapping;
+  image->pixels = &image->mapping[kHeaderSize];
+  memcpy(image->mapping, header, kHeaderSize);
+
+  return gmError_Success;
+}
+
+void gmWriteLittleEndian_(GM_OUT_PARAM unsigned char *bytes,
+                          unsigned long value, int byte_count);
+
+/**
+ * Formats the header of the file and sets the pixel layout of the image.
+ *
+ * @return The size of the header, 0 when the format can't store the image.
+ */
+size_t gmFormatImageHeader_(GM_OUT_PARAM unsigned char *header,
+                            GM_OUT_PARAM gmMappedImage_ *image,
+                            gmImageFormat format) {
+  const gmIntSize *const kSize = &image->size;
+
+  if ((format == gmImageFormat_Ppm) || (format == gmImageFormat_Pam)) {
+    const int kLength =
+        format == gmImageFormat_Ppm
+            ? snprintf((char *)header, GM_MAX_IMAGE_HEADER_SIZE_,
+                       "P6\n%d %d\n255\n", kSize->w, kSize->h)
+            : snprintf((char *)header, GM_MAX_IMAGE_HEADER_SIZE_,
+                       "P7\nWIDTH %d\nHEIGHT %d\nDEPTH 3\nMAXVAL 255\n"
+                       "TUPLTYPE RGB\nENDHDR\n",
+                       kSize->w, kSize->h);
+
+    return (kLength > 0) && (kLength < GM_MAX_IMAGE_HEADER_SIZE_) ? kLength
+                                                                  : 0;
+  }
+
+  if (format == gmImageFormat_Bmp) {
+    const size_t kHeaderSize = 14 + 40;  // File and info headers.
+
+    image->row_stride = ((size_t)kSize->w * 3 + 3) & ~(size_t)3;
+    image->row_alignment = 4;
+    image->is_bgr = 1;
+
+    const size_t kPixelsSize = image->row_stride * kSize->h;
+    if (kHeaderSize + kPixelsSize > 0xFFFFFFFFu) {
+      return 0;
+    }
+
+    memset(header, 0, kHeaderSize);
+    header[0] = 'B';
+    header[1] = 'M';
+    gmWriteLittleEndian_(&header[2], kHeaderSize + kPixelsSize, 4);
+    gmWriteLittleEndian_(&header[10], kHeaderSize, 4);
+
+    gmWriteLittleEndian_(&header[14], 40, 4);
+    gmWriteLittleEndian_(&header[18], kSize->w, 4);
+    // A negative height stores the rows top-down.
+    gmWriteLittleEndian_(&header[22], 0x100000000ul - kSize->h, 4);
+    gmWriteLittleEndian_(&header[26], 1, 2);   // Planes.
+    gmWriteLittleEndian_(&header[28], 24, 2);  // Bits per pixel.
+    gmWriteLittleEndian_(&header[34], kPixelsSize, 4);
+
+    return kHeaderSize;
+  }
+
+  if (format == gmImageFormat_Tga) {
+    const size_t kHeaderSize = 18;
+
+    if ((kSize->w > 0xFFFF) || (kSize->h > 0xFFFF)) {
+      return 0;
+    }
+
+    image->is_bgr = 1;
+
+    memset(header, 0, kHeaderSize);
+    header[2] = 2;  // Uncompressed true-color.
+    gmWriteLittleEndian_(&header[12], kSize->w, 2);
+    gmWriteLittleEndian_(&header[14], kSize->h, 2);
+    header[16] = 24;    // Bits per pixel.
+    header[17] = 0x20;  // Top-left origin.
+
+    return kHeaderSize;
+  }
+
+  return 0;
+}
+
+void gmWriteLittleEndian_(GM_OUT_PARAM unsigned char *bytes,
+                          unsigned long value, int byte_count) {
+  for (int i = 0; i < byte_count; ++i) {
+    bytes[i] = (unsigned char)(value >> (8 * i));
+  }
+}
+
+void gmPackMappedPixels_(const gmMappedImage_ *image) {
+  const size_t kRowSize = (size_t)image->size.w * 3;
+
+  // Rows only move forward, the last one first so that no row is overwritten
+  // before it is moved.
+  for (int y = image->size.h - 1; y >= 0; --y) {
+    unsigned char *const kRow = &image->pixels[y * image->row_stride];
+
+    memmove(kRow, &image->pixels[y * kRowSize], kRowSize);
+    memset(&kRow[kRowSize], 0, image->row_stride - kRowSize);
+
+    if (image->is_bgr) {
+      for (size_t i = 0; i < kRowSize; i += 3) {
+        const unsigned char kRed = kRow[i];
+        kRow[i] = kRow[i + 2];
+        kRow[i + 2] = kRed;
+      }
+    }
+  }
+}
+
+void gmUnmapImageFile_(const gmMappedImage_ *image) {
+  munmap(image->mapping, image->file_size);
+}
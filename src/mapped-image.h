@@ -0,0 +1,59 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include <stddef.h>
+
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "setup.h"
+
+/**
+ * Uncompressed image file whose pixels are written in place through a shared
+ * mapping of the file.
+ */
+typedef struct gmMappedImage_ {
+  unsigned char *mapping;
+  size_t file_size;
+
+  /**
+   * First row of pixels, right after the header.
+   */
+  unsigned char *pixels;
+
+  gmIntSize size;
+
+  /**
+   * Bytes from one row to the next, rows of BMP files being padded to 4 bytes
+   * like the default pack alignment of OpenGL.
+   */
+  size_t row_stride;
+  int row_alignment;
+
+  /**
+   * Whether the pixels are stored as BGR rather than RGB.
+   */
+  int is_bgr;
+} gmMappedImage_;
+
+int gmIsMappedImageFormat_(gmImageFormat format);
+
+/**
+ * Creates the file at its final size, writes its header and maps it.  The
+ * rows are stored top-down in the order of the image data, like PNG files.
+ */
+gmError gmMapImageFile_(GM_OUT_PARAM gmMappedImage_ *image,
+                        const char *filepath, gmImageFormat format,
+                        const gmIntSize *size);
+
+/**
+ * Converts tightly packed RGB data written at the start of the pixels to the
+ * layout of the file, in place.
+ */
+void gmPackMappedPixels_(const gmMappedImage_ *image);
+
+/**
+ * Unmaps the file, whose dirty pages are written back by the kernel.
+ */
+void gmUnmapImageFile_(const gmMappedImage_ *image);
@@ -0,0 +1,313 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "memory-plan.h"
+
+#include <glad/glad.h>
+#include <stdlib.h>
+#include <string.h>  // For memcpy and strcmp.
+
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "image-config.h"
+#include "resources/resources.h"
+#include "setup.h"
+
+// Queries of the memory info extensions, which the loader doesn't define.
+// Both report kibibytes.
+#define GM_GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX_ 0x9049
+#define GM_GL_TEXTURE_FREE_MEMORY_ATI_ 0x87FC
+
+/**
+ * Share of the available memory the resources are planned to fill, the rest
+ * being left to the driver and to the other resources of the context.
+ */
+#define GM_PLANNED_MEMORY_SHARE_ 0.75
+
+/**
+ * Tiles are not split below this side, the sample count is lowered instead.
+ */
+#define GM_MIN_TILE_SIZE_ 256
+
+size_t gmQueryAvailableGpuMemory_(void);
+
+int gmCanTileImage_(const gmImageConfig *image_config, int record_costs);
+
+int gmGetMaxResourceSize_(void);
+
+void gmGetTileSize_(GM_OUT_PARAM gmIntSize *tile_size,
+                    const gmIntSize *image_size, const gmIntSize *tile_counts);
+
+size_t gmEstimateGpuMemory_(const gmImageConfig *image_config,
+                            const gmIntSize *size, gm_uint sample_count,
+                            int record_costs);
+
+void gmPlanGpuMemory_(GM_OUT_PARAM gmMemoryPlan_ *plan,
+                      const gmImageConfig *image_config, int record_costs,
+                      size_t memory_budget) {
+  const size_t kAvailableMemory =
+      memory_budget ? memory_budget : gmQueryAvailableGpuMemory_();
+  const size_t kPlannedMemory =
+      (size_t)((double)kAvailableMemory * GM_PLANNED_MEMORY_SHARE_);
+
+  int max_sample_count;
+  glGetIntegerv(GL_MAX_SAMPLES, &max_sample_count);
+
+  gm_uint sample_count = image_config->sample_count;
+  if (sample_count > (gm_uint)max_sample_count) {
+    sample_count = (gm_uint)max_sample_count;
+  }
+
+  const gmIntSize *const kSize = &image_config->size;
+  const int kCanTile = gmCanTileImage_(image_config, record_costs);
+
+  // Images larger than the render-buffers are always tiled when they can be.
+  gmIntSize tile_counts = {.w = 1, .h = 1};
+  if (kCanTile) {
+    const int kMaxSize = gmGetMaxResourceSize_();
+    tile_counts.w = (kSize->w + kMaxSize - 1) / kMaxSize;
+    tile_counts.h = (kSize->h + kMaxSize - 1) / kMaxSize;
+  }
+
+  gmIntSize tile_size;
+  gmGetTileSize_(&tile_size, kSize, &tile_counts);
+
+  size_t memory = gmEstimateGpuMemory_(image_config, &tile_size, sample_count,
+                                       record_costs);
+
+  // Tiles render the same image, so they are split before the sample count is
+  // lowered, along their longest side.
+  while (memory > kPlannedMemory) {
+    const int kSplitsWidth = tile_size.w >= tile_size.h;
+    const int kSplitSide = kSplitsWidth ? tile_size.w : tile_size.h;
+
+    if (kCanTile && (kSplitSide / 2 >= GM_MIN_TILE_SIZE_)) {
+      if (kSplitsWidth) {
+        tile_counts.w *= 2;
+      } else {
+        tile_counts.h *= 2;
+      }
+
+      gmGetTileSize_(&tile_size, kSize, &tile_counts);
+    } else if (sample_count > 1) {
+      sample_count /= 2;
+    } else {
+      break;  // Rendered anyway, the driver may still find the memory.
+    }
+
+    memory = gmEstimateGpuMemory_(image_config, &tile_size, sample_count,
+                                  record_costs);
+  }
+
+  plan->tile_size = tile_size;
+  plan->sample_count = sample_count;
+  plan->estimated_memory = memory;
+  plan->available_memory = kAvailableMemory;
+}
+
+int gmHasGlExtension_(const char *name);
+
+size_t gmQueryAvailableGpuMemory_(void) {
+  // The ATI query writes 4 values, the free memory of the pool coming first.
+  int memory_info[4] = {0};
+
+  if (gmHasGlExtension_("GL_NVX_gpu_memory_info")) {
+    glGetIntegerv(GM_GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX_,
+                  memory_info);
+  } else if (gmHasGlExtension_("GL_ATI_meminfo")) {
+    glGetIntegerv(GM_GL_TEXTURE_FREE_MEMORY_ATI_, memory_info);
+  }
+
+  return memory_info[0] > 0 ? (size_t)memory_info[0] * 1024
+                            : GM_DEFAULT_GPU_MEMORY_BUDGET_;
+}
+
+int gmHasGlExtension_(const char *name) {
+  int extension_count;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+
+  for (int i = 0; i < extension_count; ++i) {
+    const char *const kExtension =
+        (const char *)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+    if (kExtension && !strcmp(kExtension, name)) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * Tiles are rendered on their own, so the image can't be tiled when its
+ * render needs all of its pixels: to equalize its colors, to cover its region
+ * or to preview it.  Costs are not read back from tiles.
+ */
+int gmCanTileImage_(const gmImageConfig *image_config, int record_costs) {
+  return !record_costs && !image_config->preview.func &&
+         !gmHasRegion_(image_config) &&
+         (gmGetColoringMode_(image_config) != gmColoringMode_Equalized);
+}
+
+int gmGetMaxResourceSize_(void) {
+  int max_render_buffer_size;
+  glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &max_render_buffer_size);
+
+  int max_texture_size;
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+
+  return max_render_buffer_size < max_texture_size ? max_render_buffer_size
+                                                   : max_texture_size;
+}
+
+void gmGetTileSize_(GM_OUT_PARAM gmIntSize *tile_size,
+                    const gmIntSize *image_size, const gmIntSize *tile_counts) {
+  tile_size->w = (image_size->w + tile_counts->w - 1) / tile_counts->w;
+  tile_size->h = (image_size->h + tile_counts->h - 1) / tile_counts->h;
+
+  // Split sides are rounded up to whole blocks, so that the blocks of
+  // hierarchical renders stay where they are in the whole image.
+  if (tile_counts->w > 1) {
+    tile_size->w = (tile_size->w + 7) / 8 * 8;
+  }
+
+  if (tile_counts->h > 1) {
+    tile_size->h = (tile_size->h + 7) / 8 * 8;
+  }
+}
+
+/**
+ * Adds up the frame-buffers `gmCreateResources_` creates for the image.
+ * Drivers pad the RGB pixels to 4 bytes, like the depth-stencil ones.
+ */
+size_t gmEstimateGpuMemory_(const gmImageConfig *image_config,
+                            const gmIntSize *size, gm_uint sample_count,
+                            int record_costs) {
+  const size_t kPixelCount = (size_t)size->w * size->h;
+
+  const int kIsHierarchical =
+      gmGetGlAlgorithm_(image_config) == gmGlAlgorithm_Hierarchical;
+  const int kHasRegion = gmHasRegion_(image_config);
+  const int kIsEqualized =
+      gmGetColoringMode_(image_config) == gmColoringMode_Equalized;
+
+  // Color, stencil and cost of the samples of the render frame-buffer.
+  size_t sample_bytes = 4;
+  if (kIsHierarchical || kHasRegion) {
+    sample_bytes += 4;
+  }
+
+  if (record_costs || kIsEqualized) {
+    sample_bytes += 8;
+  }
+
+  size_t memory =
+      kPixelCount * (sample_count ? sample_count : 1) * sample_bytes;
+
+  // The final frame-buffer, which the samples are resolved into and which is
+  // read back, and the costs resolved with them.
+  const size_t kResolvedPixelBytes = record_costs ? 12 : 4;
+  memory += kPixelCount * kResolvedPixelBytes;
+
+  if (image_config->preview.func) {
+    for (size_t i = 0; i < GM_PROGRESSIVE_PASS_COUNT_; ++i) {
+      gmIntSize pass_size;
+      gmGetProgressivePassSize_(&pass_size, size, i);
+      memory += (size_t)pass_size.w * pass_size.h * kResolvedPixelBytes;
+    }
+  }
+
+  if (kIsHierarchical) {
+    gmIntSize grid_size;
+    gmGetBlockGridSize_(&grid_size, size);
+
+    const size_t kCornerBytes = record_costs ? 8 : 4;
+    memory += (size_t)(grid_size.w + 1) * (grid_size.h + 1) * kCornerBytes +
+              (size_t)grid_size.w * grid_size.h * kResolvedPixelBytes;
+  }
+
+  if (kIsEqualized) {
+    memory += kPixelCount * 8;  // The iteration counts.
+  }
+
+  if (kHasRegion) {
+    memory += kPixelCount;  // The coverage.
+  }
+
+  return memory;
+}
+
+int gmIsTiledPlan_(const gmMemoryPlan_ *plan,
+                   const gmImageConfig *image_config) {
+  return (plan->tile_size.w != image_config->size.w) ||
+         (plan->tile_size.h != image_config->size.h);
+}
+
+void gmCopyTile_(GM_OUT_PARAM unsigned char *image_data,
+                 const gmIntSize *image_size, const unsigned char *tile_data,
+                 const gmIntSize *tile_size, int x, int y);
+
+gmError gmRenderImageInTiles_(GM_OUT_PARAM unsigned char *image_data,
+                              const gmImageConfig *image_config,
+                              const gmMemoryPlan_ *plan,
+                              gmRenderStripFunc_ render_tile,
+                              void *user_data) {
+  gmError error = gmError_Success;
+
+  const gmIntSize *const kSize = &image_config->size;
+  const gmIntSize *const kTileSize = &plan->tile_size;
+
+  gmViewport viewport;
+  gmGetViewport_(&viewport, image_config);
+
+  const double kStepX = viewport.width / kSize->w;
+  const double kStepY = viewport.height / kSize->h;
+  const double kLeft = viewport.center_x - viewport.width / 2.0;
+  const double kBottom = viewport.center_y - viewport.height / 2.0;
+
+  // Every tile has the same size so that the renderer keeps its resources.
+  gmImageConfig tile_config = *image_config;
+  tile_config.size = *kTileSize;
+  tile_config.sample_count = plan->sample_count;
+  tile_config.viewport.width = kTileSize->w * kStepX;
+  tile_config.viewport.height = kTileSize->h * kStepY;
+
+  unsigned char *const kTileData =
+      malloc((size_t)kTileSize->w * kTileSize->h * 3);  // RGB.
+
+  for (int y = 0; (y < kSize->h) && !error; y += kTileSize->h) {
+    for (int x = 0; (x < kSize->w) && !error; x += kTileSize->w) {
+      // The rows of the image go from the bottom of the viewport.
+      tile_config.viewport.center_x = kLeft + (x + kTileSize->w / 2.0) * kStepX;
+      tile_config.viewport.center_y =
+          kBottom + (y + kTileSize->h / 2.0) * kStepY;
+
+      error = render_tile(kTileData, &tile_config, user_data);
+      if (!error) {
+        gmCopyTile_(image_data, kSize, kTileData, kTileSize, x, y);
+      }
+    }
+  }
+
+  free(kTileData);
+  return error;
+}
+
+/**
+ * Copies the pixels of the tile inside of the image.
+ */
+void gmCopyTile_(GM_OUT_PARAM unsigned char *image_data,
+                 const gmIntSize *image_size, const unsigned char *tile_data,
+                 const gmIntSize *tile_size, int x, int y) {
+  const int kRemainingWidth = image_size->w - x;
+  const int kRemainingHeight = image_size->h - y;
+  const int kCopiedWidth =
+      kRemainingWidth < tile_size->w ? kRemainingWidth : tile_size->w;
+  const int kCopiedHeight =
+      kRemainingHeight < tile_size->h ? kRemainingHeight : tile_size->h;
+
+  for (int row = 0; row < kCopiedHeight; ++row) {
+    memcpy(&image_data[((size_t)(y + row) * image_size->w + x) * 3],
+           &tile_data[(size_t)row * tile_size->w * 3],
+           (size_t)kCopiedWidth * 3);
+  }
+}
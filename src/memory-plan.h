@@ -0,0 +1,64 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include <stddef.h>
+
+#include "deep-zoom.h"
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "setup.h"
+
+/**
+ * Bytes of GPU memory assumed available when the driver doesn't tell and the
+ * config has no memory budget, as with llvmpipe.
+ */
+#define GM_DEFAULT_GPU_MEMORY_BUDGET_ ((size_t)1 << 30)
+
+/**
+ * How an image is rendered so that its resources fit in GPU memory.
+ */
+typedef struct gmMemoryPlan_ {
+  /**
+   * The image is rendered in tiles of this size when it is smaller than the
+   * image, the pixels of the last tiles outside of the image being dropped.
+   */
+  gmIntSize tile_size;
+
+  gm_uint sample_count;
+
+  /**
+   * Bytes of the resources of a tile, and of the memory they had to fit in.
+   */
+  size_t estimated_memory;
+  size_t available_memory;
+} gmMemoryPlan_;
+
+/**
+ * Plans the render of the image with the resources created for it, in the
+ * current context.  Images which can be tiled are split in tiles until they
+ * fit, the others lower their sample count instead, and are rendered whole at
+ * 1 sample per pixel even when they still don't fit.
+ *
+ * @param memory_budget Bytes available, queried from the driver when 0.
+ */
+void gmPlanGpuMemory_(GM_OUT_PARAM gmMemoryPlan_ *plan,
+                      const gmImageConfig *image_config, int record_costs,
+                      size_t memory_budget);
+
+/**
+ * Whether the plan renders the image in more than one tile.
+ */
+int gmIsTiledPlan_(const gmMemoryPlan_ *plan,
+                   const gmImageConfig *image_config);
+
+/**
+ * Renders the tiles of the plan and copies them into the image.
+ *
+ * @param image_data Tightly packed RGB data of the whole image.
+ */
+gmError gmRenderImageInTiles_(GM_OUT_PARAM unsigned char *image_data,
+                              const gmImageConfig *image_config,
+                              const gmMemoryPlan_ *plan,
+                              gmRenderStripFunc_ render_tile, void *user_data);
@@ -0,0 +1,250 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "output-targets.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>  // For memcpy and memset.
+
+#include "budget.h"
+#include "cpu/thread-pool.h"
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "mapped-image.h"
+#include "png.h"
+#include "qoi.h"
+#include "setup.h"
+#include "trace.h"
+
+struct gmOutputTargetTask_ {
+  const gmOutputTarget *target;
+  const unsigned char *image_data;
+  gmIntSize image_size;
+
+  /**
+   * Size of the image requested by the config, which output targets of size 0
+   * are scaled to.
+   */
+  gmIntSize requested_size;
+
+  gmTrace *trace;
+  gmError error;
+};
+
+int gmIsOutputTargetFormat_(gmImageFormat format);
+
+int gmHasSupportedOutputTargets_(const gmConfig *config) {
+  if (!config->output_target_count) {
+    return 1;
+  }
+
+  if ((config->image_format == gmImageFormat_Iterations) ||
+      (config->image_format == gmImageFormat_DeepZoom)) {
+    return 0;
+  }
+
+  for (gm_uint i = 0; i < config->output_target_count; ++i) {
+    if (!gmIsOutputTargetFormat_(config->output_targets[i].format)) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+int gmIsOutputTargetFormat_(gmImageFormat format) {
+  return (format == gmImageFormat_Default) || (format == gmImageFormat_Png) ||
+         (format == gmImageFormat_Qoi) || gmIsMappedImageFormat_(format);
+}
+
+void gmWriteOutputTarget_(void *task, size_t worker_index);
+
+gmError gmStartWritingOutputTargets_(GM_OUT_PARAM gmOutputTargetWriter_ *writer,
+                                     const unsigned char *image_data,
+                                     const gmIntSize *image_size,
+                                     const gmConfig *config) {
+  writer->pool = NULL;
+  writer->tasks = NULL;
+  writer->task_count = config->output_target_count;
+
+  if (!writer->task_count) {
+    return gmError_Success;
+  }
+
+  const gmError kError =
+      gmCreateThreadPool_(&writer->pool, config->image_config.cpu.thread_count);
+  if (kError) {
+    return kError;
+  }
+
+  writer->tasks = malloc(writer->task_count * sizeof(gmOutputTargetTask_));
+
+  for (gm_uint i = 0; i < writer->task_count; ++i) {
+    gmOutputTargetTask_ *const kTask = &writer->tasks[i];
+    kTask->target = &config->output_targets[i];
+    kTask->image_data = image_data;
+    kTask->image_size = *image_size;
+    kTask->requested_size = config->image_config.size;
+    kTask->trace = config->trace;
+    kTask->error = gmError_Success;
+
+    gmSubmitTask_(writer->pool, gmWriteOutputTarget_, kTask);
+  }
+
+  return gmError_Success;
+}
+
+gmError gmFinishWritingOutputTargets_(gmOutputTargetWriter_ *writer) {
+  if (!writer->task_count) {
+    return gmError_Success;
+  }
+
+  gmWaitForTasks_(writer->pool);
+
+  gmError error = gmError_Success;
+  for (gm_uint i = 0; !error && (i < writer->task_count); ++i) {
+    error = writer->tasks[i].error;
+  }
+
+  free(writer->tasks);
+  gmDeleteThreadPool_(writer->pool);
+
+  return error;
+}
+
+void gmGetOutputTargetSize_(GM_OUT_PARAM gmIntSize *size,
+                            const gmOutputTarget *target,
+                            const gmIntSize *requested_size);
+
+void gmWriteOutputTarget_(void *task, size_t worker_index) {
+  (void)worker_index;
+
+  gmOutputTargetTask_ *const kTask = task;
+  const gmIntSize *const kImageSize = &kTask->image_size;
+
+  gmIntSize size;
+  gmGetOutputTargetSize_(&size, kTask->target, &kTask->requested_size);
+
+  // Targets of the rendered size are encoded without a copy.
+  unsigned char *scaled_image_data = NULL;
+  if ((size.w != kImageSize->w) || (size.h != kImageSize->h)) {
+    const double kScaleStartTime = gmBeginTraceEvent_(kTask->trace);
+    scaled_image_data = malloc((size_t)size.w * size.h * 3);  // RGB.
+
+    if ((size.w <= kImageSize->w) && (size.h <= kImageSize->h)) {
+      gmDownsampleImage_(scaled_image_data, &size, kTask->image_data,
+                         kImageSize);
+    } else {
+      gmResizeImage_(scaled_image_data, &size, kTask->image_data, kImageSize);
+    }
+
+    gmEndTraceEvent_(kTask->trace, "Scale output target", kScaleStartTime);
+  }
+
+  const double kWriteStartTime = gmBeginTraceEvent_(kTask->trace);
+  kTask->error = gmWriteImageFile_(
+      kTask->target->filepath, kTask->target->format,
+      scaled_image_data ? scaled_image_data : kTask->image_data, &size);
+  gmEndTraceEvent_(kTask->trace, "Encode and write output target",
+                   kWriteStartTime);
+
+  free(scaled_image_data);
+}
+
+void gmGetOutputTargetSize_(GM_OUT_PARAM gmIntSize *size,
+                            const gmOutputTarget *target,
+                            const gmIntSize *requested_size) {
+  const gmIntSize *const kTargetSize = &target->size;
+
+  if (!kTargetSize->w && !kTargetSize->h) {
+    *size = *requested_size;
+  } else if (!kTargetSize->w) {
+    size->h = kTargetSize->h;
+    size->w = (int)((double)kTargetSize->h * requested_size->w /
+                        requested_size->h +
+                    0.5);
+  } else if (!kTargetSize->h) {
+    size->w = kTargetSize->w;
+    size->h = (int)((double)kTargetSize->w * requested_size->h /
+                        requested_size->w +
+                    0.5);
+  } else {
+    *size = *kTargetSize;
+  }
+
+  size->w = size->w > 0 ? size->w : 1;
+  size->h = size->h > 0 ? size->h : 1;
+}
+
+gmError gmWriteImageFile_(const char *filepath, gmImageFormat format,
+                          const unsigned char *image_data,
+                          const gmIntSize *size) {
+  if (format == gmImageFormat_Qoi) {
+    return gmWriteQoiImage_(filepath, image_data, size);
+  }
+
+  if (gmIsMappedImageFormat_(format)) {
+    gmMappedImage_ image;
+    const gmError kError = gmMapImageFile_(&image, filepath, format, size);
+    if (!kError) {
+      memcpy(image.pixels, image_data, (size_t)size->w * size->h * 3);  // RGB.
+      gmPackMappedPixels_(&image);
+      gmUnmapImageFile_(&image);
+    }
+
+    return kError;
+  }
+
+  return gmWritePngImage_(filepath, image_data, size, (size_t)size->w * 3);
+}
+
+void gmDownsampleImage_(GM_OUT_PARAM unsigned char *image_data,
+                        const gmIntSize *size,
+                        const unsigned char *source_data,
+                        const gmIntSize *source_size) {
+  // Sums of the source rows covered by the current row, one per channel.
+  uint64_t *const kSums = malloc((size_t)size->w * 3 * sizeof(uint64_t));
+
+  for (int y = 0; y < size->h; ++y) {
+    const int kFirstRow = (int)((int64_t)y * source_size->h / size->h);
+    const int kEndRow = (int)((int64_t)(y + 1) * source_size->h / size->h);
+
+    memset(kSums, 0, (size_t)size->w * 3 * sizeof(uint64_t));
+
+    for (int source_y = kFirstRow; source_y < kEndRow; ++source_y) {
+      const unsigned char *const kRow =
+          source_data + (size_t)source_y * source_size->w * 3;
+
+      for (int x = 0; x < size->w; ++x) {
+        const int kFirstColumn = (int)((int64_t)x * source_size->w / size->w);
+        const int kEndColumn =
+            (int)((int64_t)(x + 1) * source_size->w / size->w);
+
+        uint64_t *const kPixelSums = &kSums[x * 3];
+        for (int source_x = kFirstColumn; source_x < kEndColumn; ++source_x) {
+          kPixelSums[0] += kRow[source_x * 3];
+          kPixelSums[1] += kRow[source_x * 3 + 1];
+          kPixelSums[2] += kRow[source_x * 3 + 2];
+        }
+      }
+    }
+
+    const uint64_t kRowCount = kEndRow - kFirstRow;
+
+    unsigned char *const kRow = image_data + (size_t)y * size->w * 3;
+    for (int x = 0; x < size->w; ++x) {
+      const int kColumnCount =
+          (int)((int64_t)(x + 1) * source_size->w / size->w) -
+          (int)((int64_t)x * source_size->w / size->w);
+      const uint64_t kPixelCount = kColumnCount * kRowCount;
+
+      for (int c = 0; c < 3; ++c) {
+        kRow[x * 3 + c] =
+            (unsigned char)((kSums[x * 3 + c] + kPixelCount / 2) / kPixelCount);
+      }
+    }
+  }
+
+  free(kSums);
+}
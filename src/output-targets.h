@@ -0,0 +1,64 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "cpu/thread-pool.h"
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "setup.h"
+
+typedef struct gmOutputTargetTask_ gmOutputTargetTask_;
+
+/**
+ * Output targets of a config being scaled and encoded on a thread pool.
+ */
+typedef struct gmOutputTargetWriter_ {
+  gmThreadPool_ *pool;
+
+  /**
+   * One task per output target.
+   */
+  gmOutputTargetTask_ *tasks;
+  gm_uint task_count;
+} gmOutputTargetWriter_;
+
+/**
+ * Whether the formats of the image and its output targets support output
+ * targets.
+ */
+int gmHasSupportedOutputTargets_(const gmConfig *config);
+
+/**
+ * Starts writing the output targets of the config, scaled from the rendered
+ * image, which must stay valid until they are written.  Nothing is started
+ * when the config has no output targets.
+ *
+ * @param image_size Size of the rendered image, smaller than the size of the
+ * config when it was fitted in a time budget.
+ */
+gmError gmStartWritingOutputTargets_(GM_OUT_PARAM gmOutputTargetWriter_ *writer,
+                                     const unsigned char *image_data,
+                                     const gmIntSize *image_size,
+                                     const gmConfig *config);
+
+/**
+ * Waits for the output targets to be written.
+ */
+gmError gmFinishWritingOutputTargets_(gmOutputTargetWriter_ *writer);
+
+/**
+ * Writes tightly packed RGB data as a PNG, QOI or mapped image file.
+ */
+gmError gmWriteImageFile_(const char *filepath, gmImageFormat format,
+                          const unsigned char *image_data,
+                          const gmIntSize *size);
+
+/**
+ * Averages the source pixels covered by each pixel of tightly packed RGB
+ * data, the source being at least as large on both sides.
+ */
+void gmDownsampleImage_(GM_OUT_PARAM unsigned char *image_data,
+                        const gmIntSize *size,
+                        const unsigned char *source_data,
+                        const gmIntSize *source_size);
@@ -0,0 +1,400 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "png.h"
+
+#include <stb/stb_image_write.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>  // For memcpy and memset.
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "setup.h"
+
+/**
+ * Compressor of `stbi_write_png`, defined by the implementation of
+ * stb_image_write though its header doesn't declare it.  The compressed data
+ * is freed with `free`.
+ */
+unsigned char *stbi_zlib_compress(unsigned char *data, int data_len,
+                                  int *out_len, int quality);
+
+#define GM_PNG_FILTER_COUNT_ 5
+
+typedef enum gmPngFilter_ {
+  gmPngFilter_None_,
+  gmPngFilter_Sub_,
+  gmPngFilter_Up_,
+  gmPngFilter_Average_,
+  gmPngFilter_Paeth_
+} gmPngFilter_;
+
+void gmFilterPngRow_(GM_OUT_PARAM unsigned char *filtered_row,
+                     GM_OUT_PARAM unsigned char *residuals,
+                     const unsigned char *row, const unsigned char *above_row,
+                     size_t row_size);
+
+unsigned char *gmPutPngChunk_(GM_OUT_PARAM unsigned char *png_data,
+                              const char *type, const unsigned char *data,
+                              size_t size, const uint32_t *crc_table);
+
+void gmGetCrcTable_(GM_OUT_PARAM uint32_t *crc_table);
+
+gmError gmEncodePngImage_(GM_OUT_PARAM unsigned char **png_data,
+                          GM_OUT_PARAM size_t *png_size,
+                          const unsigned char *image_data,
+                          const gmIntSize *size, size_t row_stride) {
+  const size_t kRowSize = (size_t)size->w * 3;
+  const size_t kFilteredRowSize = kRowSize + 1;  // Filter type first.
+
+  // The row above the first one is zeros.
+  unsigned char *const kZeroRow = calloc(kRowSize, 1);
+  unsigned char *const kResiduals = malloc(kRowSize * GM_PNG_FILTER_COUNT_);
+  unsigned char *const kFilteredData = malloc(kFilteredRowSize * size->h);
+
+  for (int y = 0; y < size->h; ++y) {
+    const unsigned char *const kRow = image_data + y * row_stride;
+    gmFilterPngRow_(&kFilteredData[y * kFilteredRowSize], kResiduals, kRow,
+                    y ? kRow - row_stride : kZeroRow, kRowSize);
+  }
+
+  free(kZeroRow);
+  free(kResiduals);
+
+  int compressed_size;
+  unsigned char *const kCompressedData =
+      stbi_zlib_compress(kFilteredData, (int)(kFilteredRowSize * size->h),
+                         &compressed_size, stbi_write_png_compression_level);
+  free(kFilteredData);
+
+  if (!kCompressedData) {
+    return gmError_ImageWriteFailed;
+  }
+
+  uint32_t crc_table[256];
+  gmGetCrcTable_(crc_table);
+
+  // Big-endian sides, 8 bits per channel, RGB, then the default compression,
+  // filtering and interlacing.
+  unsigned char header[13] = {0, 0, 0, 0, 0, 0, 0, 0, 8, 2, 0, 0, 0};
+  for (int i = 0; i < 4; ++i) {
+    header[i] = (unsigned char)((uint32_t)size->w >> (24 - 8 * i));
+    header[4 + i] = (unsigned char)((uint32_t)size->h >> (24 - 8 * i));
+  }
+
+  // The signature, then the length, type and CRC of each of the 3 chunks
+  // around their data.
+  *png_size = 8 + 3 * 12 + 13 + (size_t)compressed_size;
+  *png_data = malloc(*png_size);
+
+  const unsigned char kSignature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+  memcpy(*png_data, kSignature, 8);
+
+  unsigned char *chunk = *png_data + 8;
+  chunk = gmPutPngChunk_(chunk, "IHDR", header, 13, crc_table);
+  chunk = gmPutPngChunk_(chunk, "IDAT", kCompressedData,
+                         (size_t)compressed_size, crc_table);
+  gmPutPngChunk_(chunk, "IEND", NULL, 0, crc_table);
+
+  free(kCompressedData);
+  return gmError_Success;
+}
+
+gmError gmWritePngImage_(const char *filepath, const unsigned char *image_data,
+                         const gmIntSize *size, size_t row_stride) {
+  unsigned char *png_data;
+  size_t png_size;
+  gmError error =
+      gmEncodePngImage_(&png_data, &png_size, image_data, size, row_stride);
+  if (!error) {
+    FILE *const kFile = fopen(filepath, "wb");
+
+    int has_failed = !kFile;
+    if (kFile) {
+      has_failed = fwrite(png_data, 1, png_size, kFile) != png_size;
+      has_failed |= fclose(kFile) != 0;
+    }
+
+    free(png_data);
+    error = !has_failed ? gmError_Success : gmError_ImageWriteFailed;
+  }
+
+  return error;
+}
+
+void gmComputePngResiduals_(GM_OUT_PARAM unsigned char *residuals,
+                            GM_OUT_PARAM size_t *costs,
+                            const unsigned char *row,
+                            const unsigned char *above_row, size_t begin,
+                            size_t end, size_t row_size);
+
+#if defined(__SSE2__)
+void gmComputePngResidualsSse2_(GM_OUT_PARAM unsigned char *residuals,
+                                GM_OUT_PARAM size_t *costs,
+                                const unsigned char *row,
+                                const unsigned char *above_row, size_t begin,
+                                size_t end, size_t row_size);
+#endif
+
+/**
+ * Computes the residuals of every filter in a single pass over the row, then
+ * keeps the filter whose residuals change the least from one pixel to the
+ * next.  The compressor of stb_image_write codes literals with the fixed
+ * Huffman codes, so that repeated residuals, which it finds as matches, shrink
+ * the image far more than small ones: the bands of flat colors of Mandelbrot
+ * images compress best unfiltered, where `stbi_write_png` picks the filter
+ * with the smallest residuals.
+ *
+ * @param residuals Room for the residuals of each filter, one row after the
+ * other.
+ */
+void gmFilterPngRow_(GM_OUT_PARAM unsigned char *filtered_row,
+                     GM_OUT_PARAM unsigned char *residuals,
+                     const unsigned char *row, const unsigned char *above_row,
+                     size_t row_size) {
+  size_t costs[GM_PNG_FILTER_COUNT_] = {0};
+
+  // The first pixel has no left neighbor, the blocks of the other ones load
+  // the pixel on their left.
+  const size_t kFirstPixelSize = row_size < 3 ? row_size : 3;
+  gmComputePngResiduals_(residuals, costs, row, above_row, 0, kFirstPixelSize,
+                         row_size);
+
+  size_t begin = kFirstPixelSize;
+#if defined(__SSE2__)
+  const size_t kBlocksEnd = begin + (row_size - begin) / 16 * 16;
+  gmComputePngResidualsSse2_(residuals, costs, row, above_row, begin,
+                             kBlocksEnd, row_size);
+  begin = kBlocksEnd;
+#endif
+
+  gmComputePngResiduals_(residuals, costs, row, above_row, begin, row_size,
+                         row_size);
+
+  int best_filter = 0;
+  for (int filter = 1; filter < GM_PNG_FILTER_COUNT_; ++filter) {
+    if (costs[filter] < costs[best_filter]) {
+      best_filter = filter;
+    }
+  }
+
+  filtered_row[0] = (unsigned char)best_filter;
+  memcpy(&filtered_row[1], &residuals[best_filter * row_size], row_size);
+}
+
+unsigned char gmPredictPaeth_(int left, int above, int above_left);
+
+void gmComputePngResiduals_(GM_OUT_PARAM unsigned char *residuals,
+                            GM_OUT_PARAM size_t *costs,
+                            const unsigned char *row,
+                            const unsigned char *above_row, size_t begin,
+                            size_t end, size_t row_size) {
+  for (size_t i = begin; i < end; ++i) {
+    const int kLeft = i >= 3 ? row[i - 3] : 0;
+    const int kAbove = above_row[i];
+    const int kAboveLeft = i >= 3 ? above_row[i - 3] : 0;
+
+    const int kPredictions[GM_PNG_FILTER_COUNT_] = {
+        0, kLeft, kAbove, (kLeft + kAbove) >> 1,
+        gmPredictPaeth_(kLeft, kAbove, kAboveLeft)};
+
+    for (int filter = 0; filter < GM_PNG_FILTER_COUNT_; ++filter) {
+      const unsigned char kResidual =
+          (unsigned char)(row[i] - kPredictions[filter]);
+
+      unsigned char *const kResiduals = &residuals[filter * row_size];
+      kResiduals[i] = kResidual;
+      costs[filter] += kResidual != (i >= 3 ? kResiduals[i - 3] : 0);
+    }
+  }
+}
+
+/**
+ * Predicts the byte from the neighbor closest to `left + above - above_left`,
+ * in this order on ties.
+ */
+unsigned char gmPredictPaeth_(int left, int above, int above_left) {
+  const int kLeftDistance = abs(above - above_left);
+  const int kAboveDistance = abs(left - above_left);
+  const int kAboveLeftDistance = abs(left + above - 2 * above_left);
+
+  if ((kLeftDistance <= kAboveDistance) &&
+      (kLeftDistance <= kAboveLeftDistance)) {
+    return (unsigned char)left;
+  }
+
+  return (unsigned char)(kAboveDistance <= kAboveLeftDistance ? above
+                                                              : above_left);
+}
+
+#if defined(__SSE2__)
+__m128i gmPredictPaethSse2_(__m128i left, __m128i above, __m128i above_left);
+
+__m128i gmPredictPaethHalfSse2_(__m128i left, __m128i above,
+                                __m128i above_left);
+
+/**
+ * Same as `gmComputePngResiduals_` 16 bytes at a time, `begin` being at least
+ * 3 and the range a multiple of 16 bytes.
+ */
+void gmComputePngResidualsSse2_(GM_OUT_PARAM unsigned char *residuals,
+                                GM_OUT_PARAM size_t *costs,
+                                const unsigned char *row,
+                                const unsigned char *above_row, size_t begin,
+                                size_t end, size_t row_size) {
+  const __m128i kZero = _mm_setzero_si128();
+  const __m128i kOnes = _mm_set1_epi8(1);
+
+  // Counts of changed residuals in two 64-bit lanes.
+  __m128i cost_sums[GM_PNG_FILTER_COUNT_];
+
+  // Residuals of the previous block, whose last pixel is compared with the
+  // first pixel of the next block.
+  __m128i previous_residuals[GM_PNG_FILTER_COUNT_];
+
+  for (int filter = 0; filter < GM_PNG_FILTER_COUNT_; ++filter) {
+    const unsigned char *const kLastPixel =
+        &residuals[filter * row_size + begin - 3];
+
+    cost_sums[filter] = kZero;
+    previous_residuals[filter] = _mm_slli_si128(
+        _mm_cvtsi32_si128(kLastPixel[0] | kLastPixel[1] << 8 |
+                          kLastPixel[2] << 16),
+        13);
+  }
+
+  for (size_t i = begin; i < end; i += 16) {
+    const __m128i kBytes = _mm_loadu_si128((const __m128i *)&row[i]);
+    const __m128i kLeft = _mm_loadu_si128((const __m128i *)&row[i - 3]);
+    const __m128i kAbove = _mm_loadu_si128((const __m128i *)&above_row[i]);
+    const __m128i kAboveLeft =
+        _mm_loadu_si128((const __m128i *)&above_row[i - 3]);
+
+    // The rounded up average of the instruction is rounded down.
+    const __m128i kAverage =
+        _mm_sub_epi8(_mm_avg_epu8(kLeft, kAbove),
+                     _mm_and_si128(_mm_xor_si128(kLeft, kAbove), kOnes));
+
+    const __m128i kPredictions[GM_PNG_FILTER_COUNT_] = {
+        kZero, kLeft, kAbove, kAverage,
+        gmPredictPaethSse2_(kLeft, kAbove, kAboveLeft)};
+
+    for (int filter = 0; filter < GM_PNG_FILTER_COUNT_; ++filter) {
+      const __m128i kResiduals = _mm_sub_epi8(kBytes, kPredictions[filter]);
+      _mm_storeu_si128((__m128i *)&residuals[filter * row_size + i],
+                       kResiduals);
+
+      // Residuals of the pixels on the left.
+      const __m128i kLeftResiduals =
+          _mm_or_si128(_mm_slli_si128(kResiduals, 3),
+                       _mm_srli_si128(previous_residuals[filter], 13));
+      previous_residuals[filter] = kResiduals;
+
+      const __m128i kChanges = _mm_andnot_si128(
+          _mm_cmpeq_epi8(kResiduals, kLeftResiduals), kOnes);
+      cost_sums[filter] =
+          _mm_add_epi64(cost_sums[filter], _mm_sad_epu8(kChanges, kZero));
+    }
+  }
+
+  for (int filter = 0; filter < GM_PNG_FILTER_COUNT_; ++filter) {
+    const __m128i kSums = cost_sums[filter];
+    const __m128i kHighSum = _mm_unpackhi_epi64(kSums, kSums);
+    costs[filter] +=
+        (size_t)_mm_cvtsi128_si64(kSums) + (size_t)_mm_cvtsi128_si64(kHighSum);
+  }
+}
+
+__m128i gmPredictPaethSse2_(__m128i left, __m128i above, __m128i above_left) {
+  const __m128i kZero = _mm_setzero_si128();
+
+  const __m128i kLow = gmPredictPaethHalfSse2_(
+      _mm_unpacklo_epi8(left, kZero), _mm_unpacklo_epi8(above, kZero),
+      _mm_unpacklo_epi8(above_left, kZero));
+  const __m128i kHigh = gmPredictPaethHalfSse2_(
+      _mm_unpackhi_epi8(left, kZero), _mm_unpackhi_epi8(above, kZero),
+      _mm_unpackhi_epi8(above_left, kZero));
+
+  return _mm_packus_epi16(kLow, kHigh);
+}
+
+/**
+ * Same as `gmPredictPaeth_` on 8 bytes widened to 16 bits.
+ */
+__m128i gmPredictPaethHalfSse2_(__m128i left, __m128i above,
+                                __m128i above_left) {
+  const __m128i kZero = _mm_setzero_si128();
+
+  const __m128i kAboveDifference = _mm_sub_epi16(above, above_left);
+  const __m128i kLeftDifference = _mm_sub_epi16(left, above_left);
+  const __m128i kSum = _mm_add_epi16(kAboveDifference, kLeftDifference);
+
+  const __m128i kLeftDistance = _mm_max_epi16(
+      kAboveDifference, _mm_sub_epi16(kZero, kAboveDifference));
+  const __m128i kAboveDistance =
+      _mm_max_epi16(kLeftDifference, _mm_sub_epi16(kZero, kLeftDifference));
+  const __m128i kAboveLeftDistance =
+      _mm_max_epi16(kSum, _mm_sub_epi16(kZero, kSum));
+
+  const __m128i kIsAboveLeft = _mm_cmpgt_epi16(kAboveDistance,
+                                               kAboveLeftDistance);
+  const __m128i kAboveOrAboveLeft =
+      _mm_or_si128(_mm_and_si128(kIsAboveLeft, above_left),
+                   _mm_andnot_si128(kIsAboveLeft, above));
+
+  const __m128i kIsNotLeft =
+      _mm_or_si128(_mm_cmpgt_epi16(kLeftDistance, kAboveDistance),
+                   _mm_cmpgt_epi16(kLeftDistance, kAboveLeftDistance));
+
+  return _mm_or_si128(_mm_and_si128(kIsNotLeft, kAboveOrAboveLeft),
+                      _mm_andnot_si128(kIsNotLeft, left));
+}
+#endif
+
+/**
+ * @return The end of the chunk, where the next chunk goes.
+ */
+unsigned char *gmPutPngChunk_(GM_OUT_PARAM unsigned char *png_data,
+                              const char *type, const unsigned char *data,
+                              size_t size, const uint32_t *crc_table) {
+  for (int i = 0; i < 4; ++i) {
+    png_data[i] = (unsigned char)((uint32_t)size >> (24 - 8 * i));
+  }
+
+  memcpy(&png_data[4], type, 4);
+  if (size) {
+    memcpy(&png_data[8], data, size);
+  }
+
+  // The CRC covers the type and the data.
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 4; i < 8 + size; ++i) {
+    crc = crc_table[(crc ^ png_data[i]) & 0xFF] ^ (crc >> 8);
+  }
+
+  crc ^= 0xFFFFFFFF;
+
+  unsigned char *const kCrcBytes = &png_data[8 + size];
+  for (int i = 0; i < 4; ++i) {
+    kCrcBytes[i] = (unsigned char)(crc >> (24 - 8 * i));
+  }
+
+  return kCrcBytes + 4;
+}
+
+void gmGetCrcTable_(GM_OUT_PARAM uint32_t *crc_table) {
+  for (uint32_t i = 0; i < 256; ++i) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = crc & 1 ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+    }
+
+    crc_table[i] = crc;
+  }
+}
@@ -0,0 +1,30 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include <stddef.h>
+
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "setup.h"
+
+/**
+ * Writes RGB data as a PNG file, the rows being stored in the order of the
+ * image data.  Same as `stbi_write_png`, whose compressor encodes the rows,
+ * with a vectorized filter stage choosing the filters for that compressor.
+ *
+ * @param row_stride Bytes from one row of the image data to the next.
+ */
+gmError gmWritePngImage_(const char *filepath, const unsigned char *image_data,
+                         const gmIntSize *size, size_t row_stride);
+
+/**
+ * Same as `gmWritePngImage_`, encoding the file in memory.
+ *
+ * @param png_data Receives the contents of the file, to be freed with `free`.
+ */
+gmError gmEncodePngImage_(GM_OUT_PARAM unsigned char **png_data,
+                          GM_OUT_PARAM size_t *png_size,
+                          const unsigned char *image_data,
+                          const gmIntSize *size, size_t row_stride);
@@ -0,0 +1,272 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "profile.h"
+
+#include <glad/glad.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "setup.h"
+
+// Names of the settings in profile files, indexed by their enum values.
+const char *const kGmBackendNames_[] = {"default", "gl", "cpu"};
+
+const char *const kGmGlAlgorithmNames_[] = {"default", "per-pixel",
+                                            "hierarchical"};
+
+const char *const kGmCpuAlgorithmNames_[] = {
+    "default", "per-pixel", "boundary-tracing", "checked-boundary-tracing"};
+
+void gmReadCpuModel_(GM_OUT_PARAM char *cpu_model);
+
+void gmCopyHostKeyString_(GM_OUT_PARAM char *destination, const char *source);
+
+void gmGetHostKey_(GM_OUT_PARAM gmHostKey_ *host_key, int with_gl_renderer) {
+  gmReadCpuModel_(host_key->cpu_model);
+
+  const char *const kGlRenderer =
+      with_gl_renderer ? (const char *)glGetString(GL_RENDERER) : NULL;
+
+  gmCopyHostKeyString_(host_key->gl_renderer, kGlRenderer ? kGlRenderer : "");
+}
+
+void gmReadCpuModel_(GM_OUT_PARAM char *cpu_model) {
+  gmCopyHostKeyString_(cpu_model, "unknown");
+
+  FILE *const kFile = fopen("/proc/cpuinfo", "r");
+  if (!kFile) {
+    return;
+  }
+
+  char line[512];
+  while (fgets(line, sizeof(line), kFile)) {
+    const char *const kSeparator = strchr(line, ':');
+
+    if (kSeparator && !strncmp(line, "model name", strlen("model name"))) {
+      // Skips the space following the separator.
+      gmCopyHostKeyString_(cpu_model, kSeparator[1] ? kSeparator + 2 : "");
+      break;
+    }
+  }
+
+  fclose(kFile);
+}
+
+/**
+ * Copies the string, truncated to the host key string size and to its first
+ * line, since profile files store one value per line.
+ */
+void gmCopyHostKeyString_(GM_OUT_PARAM char *destination, const char *source) {
+  size_t length = strcspn(source, "\r\n");
+  if (length >= GM_HOST_KEY_STRING_SIZE_) {
+    length = GM_HOST_KEY_STRING_SIZE_ - 1;
+  }
+
+  memcpy(destination, source, length);
+  destination[length] = '\0';
+}
+
+const char *gmGetProfileFilepath_(const char *profile_filepath) {
+  return profile_filepath ? profile_filepath : GM_DEFAULT_PROFILE_FILEPATH;
+}
+
+/**
+ * Enough for every host of a small cluster sharing the same file.
+ */
+#define GM_MAX_PROFILE_ENTRY_COUNT_ 64
+
+typedef struct gmProfileEntry_ {
+  gmHostKey_ host_key;
+  gmProfile_ profile;
+} gmProfileEntry_;
+
+size_t gmReadProfileEntries_(GM_OUT_PARAM gmProfileEntry_ *entries,
+                             const char *filepath);
+
+int gmLoadProfile_(GM_OUT_PARAM gmProfile_ *profile, const char *filepath,
+                   const gmHostKey_ *host_key) {
+  gmProfileEntry_ *const kEntries =
+      malloc(GM_MAX_PROFILE_ENTRY_COUNT_ * sizeof(gmProfileEntry_));
+
+  const size_t kEntryCount = gmReadProfileEntries_(kEntries, filepath);
+
+  int found = 0;
+  for (size_t i = 0; (i < kEntryCount) && !found; ++i) {
+    const gmHostKey_ *const kEntryKey = &kEntries[i].host_key;
+
+    found = !strcmp(kEntryKey->cpu_model, host_key->cpu_model) &&
+            (!host_key->gl_renderer[0] ||
+             !strcmp(kEntryKey->gl_renderer, host_key->gl_renderer));
+
+    if (found) {
+      *profile = kEntries[i].profile;
+    }
+  }
+
+  free(kEntries);
+  return found;
+}
+
+void gmParseProfileLine_(GM_OUT_PARAM gmProfileEntry_ *entry,
+                         const char *name, const char *value);
+
+/**
+ * Profile files list the settings of each host, one per line with its name
+ * followed by a space and its value, starting with the CPU model.
+ *
+ * @return The number of entries read, 0 when the file does not exist.
+ */
+size_t gmReadProfileEntries_(GM_OUT_PARAM gmProfileEntry_ *entries,
+                             const char *filepath) {
+  FILE *const kFile = fopen(filepath, "r");
+  if (!kFile) {
+    return 0;
+  }
+
+  size_t entry_count = 0;
+
+  char line[512];
+  while (fgets(line, sizeof(line), kFile)) {
+    line[strcspn(line, "\r\n")] = '\0';
+
+    char *const kSeparator = strchr(line, ' ');
+    if ((line[0] == '#') || !kSeparator) {
+      continue;  // Comments and blank lines.
+    }
+
+    *kSeparator = '\0';
+    const char *const kValue = kSeparator + 1;
+
+    if (!strcmp(line, "cpu_model")) {
+      if (entry_count == GM_MAX_PROFILE_ENTRY_COUNT_) {
+        break;
+      }
+
+      gmProfileEntry_ *const kEntry = &entries[entry_count++];
+      memset(kEntry, 0, sizeof(gmProfileEntry_));
+      gmCopyHostKeyString_(kEntry->host_key.cpu_model, kValue);
+    } else if (entry_count) {
+      gmParseProfileLine_(&entries[entry_count - 1], line, kValue);
+    }
+  }
+
+  fclose(kFile);
+  return entry_count;
+}
+
+int gmFindName_(const char *const *names, int name_count, const char *value);
+
+/**
+ * Unknown settings and values are ignored, leaving the setting at its
+ * default value.
+ */
+void gmParseProfileLine_(GM_OUT_PARAM gmProfileEntry_ *entry,
+                         const char *name, const char *value) {
+  gmProfile_ *const kProfile = &entry->profile;
+
+  if (!strcmp(name, "gl_renderer")) {
+    gmCopyHostKeyString_(entry->host_key.gl_renderer, value);
+  } else if (!strcmp(name, "backend")) {
+    kProfile->backend = gmFindName_(kGmBackendNames_, 3, value);
+  } else if (!strcmp(name, "gl_algorithm")) {
+    kProfile->gl_algorithm = gmFindName_(kGmGlAlgorithmNames_, 3, value);
+  } else if (!strcmp(name, "cpu_algorithm")) {
+    kProfile->cpu_algorithm = gmFindName_(kGmCpuAlgorithmNames_, 4, value);
+  } else if (!strcmp(name, "cpu_thread_count")) {
+    kProfile->cpu_thread_count = (gm_uint)strtoul(value, NULL, 10);
+  }
+}
+
+/**
+ * @return The index of the value in the names, 0 when it is missing.
+ */
+int gmFindName_(const char *const *names, int name_count, const char *value) {
+  for (int i = 0; i < name_count; ++i) {
+    if (!strcmp(names[i], value)) {
+      return i;
+    }
+  }
+
+  return 0;
+}
+
+void gmWriteProfileEntry_(FILE *file, const gmProfileEntry_ *entry);
+
+gmError gmSaveProfile_(const char *filepath, const gmHostKey_ *host_key,
+                       const gmProfile_ *profile) {
+  gmProfileEntry_ *const kEntries =
+      malloc(GM_MAX_PROFILE_ENTRY_COUNT_ * sizeof(gmProfileEntry_));
+
+  size_t entry_count = gmReadProfileEntries_(kEntries, filepath);
+
+  size_t entry_index = 0;
+  while ((entry_index < entry_count) &&
+         (strcmp(kEntries[entry_index].host_key.cpu_model,
+                 host_key->cpu_model) ||
+          strcmp(kEntries[entry_index].host_key.gl_renderer,
+                 host_key->gl_renderer))) {
+    ++entry_index;
+  }
+
+  if (entry_index == entry_count) {
+    // Replaces the last entry when the file is full.
+    entry_index = entry_count < GM_MAX_PROFILE_ENTRY_COUNT_ ? entry_count++
+                                                            : entry_count - 1;
+  }
+
+  kEntries[entry_index].host_key = *host_key;
+  kEntries[entry_index].profile = *profile;
+
+  FILE *const kFile = fopen(filepath, "w");
+  if (kFile) {
+    fputs("# Performance profiles measured by gm --tune.\n", kFile);
+
+    for (size_t i = 0; i < entry_count; ++i) {
+      gmWriteProfileEntry_(kFile, &kEntries[i]);
+    }
+  }
+
+  const int kError = !kFile || fclose(kFile);
+
+  free(kEntries);
+  return !kError ? gmError_Success : gmError_ProfileWriteFailed;
+}
+
+void gmWriteProfileEntry_(FILE *file, const gmProfileEntry_ *entry) {
+  const gmProfile_ *const kProfile = &entry->profile;
+
+  fprintf(file, "\ncpu_model %s\n", entry->host_key.cpu_model);
+  fprintf(file, "gl_renderer %s\n", entry->host_key.gl_renderer);
+  fprintf(file, "backend %s\n", kGmBackendNames_[kProfile->backend]);
+
+  fprintf(file, "gl_algorithm %s\n",
+          kGmGlAlgorithmNames_[kProfile->gl_algorithm]);
+
+  fprintf(file, "cpu_algorithm %s\n",
+          kGmCpuAlgorithmNames_[kProfile->cpu_algorithm]);
+
+  fprintf(file, "cpu_thread_count %u\n", kProfile->cpu_thread_count);
+}
+
+void gmApplyProfile_(GM_OUT_PARAM gmImageConfig *image_config,
+                     const gmProfile_ *profile) {
+  if (image_config->backend == gmBackend_Default) {
+    image_config->backend = profile->backend;
+  }
+
+  if (image_config->gl.algorithm == gmGlAlgorithm_Default) {
+    image_config->gl.algorithm = profile->gl_algorithm;
+  }
+
+  if (image_config->cpu.algorithm == gmCpuAlgorithm_Default) {
+    image_config->cpu.algorithm = profile->cpu_algorithm;
+  }
+
+  if (!image_config->cpu.thread_count) {
+    image_config->cpu.thread_count = profile->cpu_thread_count;
+  }
+}
@@ -0,0 +1,65 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "setup.h"
+
+#define GM_HOST_KEY_STRING_SIZE_ 256
+
+/**
+ * Identifies the hardware a profile was measured on.
+ */
+typedef struct gmHostKey_ {
+  char cpu_model[GM_HOST_KEY_STRING_SIZE_];
+
+  /**
+   * Empty when the key only identifies the CPU.
+   */
+  char gl_renderer[GM_HOST_KEY_STRING_SIZE_];
+} gmHostKey_;
+
+/**
+ * The fastest settings measured on a host.
+ */
+typedef struct gmProfile_ {
+  gmBackend backend;
+  gmGlAlgorithm gl_algorithm;
+  gmCpuAlgorithm cpu_algorithm;
+  gm_uint cpu_thread_count;
+} gmProfile_;
+
+/**
+ * Reads the CPU model of the host, and the renderer string of the current
+ * context when `with_gl_renderer` is set.
+ */
+void gmGetHostKey_(GM_OUT_PARAM gmHostKey_ *host_key, int with_gl_renderer);
+
+/**
+ * @return The specified profile filepath, or the default one when NULL.
+ */
+const char *gmGetProfileFilepath_(const char *profile_filepath);
+
+/**
+ * Loads the profile of the host from the specified file.  A host key without
+ * renderer matches the first profile measured on the same CPU.
+ *
+ * @return Whether the file exists and contains a profile of the host.
+ */
+int gmLoadProfile_(GM_OUT_PARAM gmProfile_ *profile, const char *filepath,
+                   const gmHostKey_ *host_key);
+
+/**
+ * Saves the profile of the host, replacing its previous one and keeping the
+ * profiles of the other hosts sharing the file.
+ */
+gmError gmSaveProfile_(const char *filepath, const gmHostKey_ *host_key,
+                       const gmProfile_ *profile);
+
+/**
+ * Uses the profile for the settings left at their default value.
+ */
+void gmApplyProfile_(GM_OUT_PARAM gmImageConfig *image_config,
+                     const gmProfile_ *profile);
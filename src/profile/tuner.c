@@ -0,0 +1,187 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "tuner.h"
+
+#include <glad/glad.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "clock.h"
+#include "cpu/cpu.h"
+#include "cpu/thread-pool.h"
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "profile.h"
+#include "render/render.h"
+#include "resources/resources.h"
+#include "setup.h"
+
+// Viewports covering the usual workloads: the whole set, a region dominated
+// by the boundary and one dominated by the interior.
+#define GM_BENCHMARK_VIEWPORT_COUNT_ 3
+
+const gmViewport kGmBenchmarkViewports_[GM_BENCHMARK_VIEWPORT_COUNT_] = {
+    {.center_x = -0.5, .width = 3.0, .height = 3.0},
+    {.center_x = -0.745, .center_y = 0.11, .width = 0.02, .height = 0.02},
+    {.center_x = -0.3, .width = 0.8, .height = 0.8}};
+
+#define GM_BENCHMARK_SIZE_ 256
+#define GM_BENCHMARK_MAX_ITERATION_COUNT_ 1000
+
+gmError gmMeasureGlProfile_(GM_OUT_PARAM gmProfile_ *profile,
+                            GM_OUT_PARAM double *time);
+
+void gmMeasureCpuProfile_(GM_OUT_PARAM gmProfile_ *profile,
+                          GM_OUT_PARAM double *time);
+
+gmError gmMeasureProfile_(GM_OUT_PARAM gmProfile_ *profile) {
+  gmError error;
+
+  double gl_time;
+  error = gmMeasureGlProfile_(profile, &gl_time);
+  if (!error) {
+    double cpu_time;
+    gmMeasureCpuProfile_(profile, &cpu_time);
+
+    profile->backend = gl_time <= cpu_time ? gmBackend_Gl : gmBackend_Cpu;
+  }
+
+  return error;
+}
+
+void gmGetBenchmarkImageConfig_(GM_OUT_PARAM gmImageConfig *image_config,
+                                size_t viewport_index);
+
+gmError gmMeasureGlRenderTime_(GM_OUT_PARAM double *time,
+                               const gmImageConfig *image_config);
+
+gmError gmMeasureGlProfile_(GM_OUT_PARAM gmProfile_ *profile,
+                            GM_OUT_PARAM double *time) {
+  gmError error = gmError_Success;
+
+  *time = HUGE_VAL;
+  for (gmGlAlgorithm algorithm = gmGlAlgorithm_PerPixel;
+       (algorithm <= gmGlAlgorithm_Hierarchical) && !error; ++algorithm) {
+    double algorithm_time = 0.0;
+
+    for (size_t i = 0; (i < GM_BENCHMARK_VIEWPORT_COUNT_) && !error; ++i) {
+      gmImageConfig image_config;
+      gmGetBenchmarkImageConfig_(&image_config, i);
+      image_config.backend = gmBackend_Gl;
+      image_config.gl.algorithm = algorithm;
+
+      double viewport_time;
+      error = gmMeasureGlRenderTime_(&viewport_time, &image_config);
+      algorithm_time += viewport_time;
+    }
+
+    if (!error && (algorithm_time < *time)) {
+      profile->gl_algorithm = algorithm;
+      *time = algorithm_time;
+    }
+  }
+
+  return error;
+}
+
+void gmGetBenchmarkImageConfig_(GM_OUT_PARAM gmImageConfig *image_config,
+                                size_t viewport_index) {
+  const gmImageConfig kImageConfig = {
+      .size = {.w = GM_BENCHMARK_SIZE_, .h = GM_BENCHMARK_SIZE_},
+      .viewport = kGmBenchmarkViewports_[viewport_index],
+      .max_iteration_count = GM_BENCHMARK_MAX_ITERATION_COUNT_};
+
+  *image_config = kImageConfig;
+}
+
+gmError gmMeasureGlRenderTime_(GM_OUT_PARAM double *time,
+                               const gmImageConfig *image_config) {
+  gmError error;
+
+  gmResources_ resources;
+  error = gmCreateResources_(&resources, image_config, 0);
+  if (!error) {
+    // The first render also includes compiling the shaders on some drivers.
+    gmRenderImage_(&resources, image_config);
+    glFinish();
+
+    const double kStartTime = gmGetTime_();
+    gmRenderImage_(&resources, image_config);
+    glFinish();
+    *time = gmGetTime_() - kStartTime;
+
+    gmDeleteResources_(&resources);
+  }
+
+  return error;
+}
+
+size_t gmGetNextThreadCount_(size_t thread_count, size_t processor_count);
+
+double gmMeasureCpuRenderTime_(const gmImageConfig *image_config,
+                               unsigned char *image_data);
+
+/**
+ * Tries the CPU algorithms with power of two thread counts up to the number
+ * of processors, and the number of processors itself.
+ */
+void gmMeasureCpuProfile_(GM_OUT_PARAM gmProfile_ *profile,
+                          GM_OUT_PARAM double *time) {
+  const size_t kProcessorCount = gmGetProcessorCount_();
+
+  unsigned char *const kImageData =
+      malloc(GM_BENCHMARK_SIZE_ * GM_BENCHMARK_SIZE_ * 3);  // RGB.
+
+  *time = HUGE_VAL;
+  for (gmCpuAlgorithm algorithm = gmCpuAlgorithm_PerPixel;
+       algorithm <= gmCpuAlgorithm_CheckedBoundaryTracing; ++algorithm) {
+    for (size_t thread_count = 1; thread_count <= kProcessorCount;
+         thread_count = gmGetNextThreadCount_(thread_count, kProcessorCount)) {
+      double candidate_time = 0.0;
+
+      for (size_t i = 0; i < GM_BENCHMARK_VIEWPORT_COUNT_; ++i) {
+        gmImageConfig image_config;
+        gmGetBenchmarkImageConfig_(&image_config, i);
+        image_config.backend = gmBackend_Cpu;
+        image_config.cpu.algorithm = algorithm;
+        image_config.cpu.thread_count = (gm_uint)thread_count;
+
+        candidate_time += gmMeasureCpuRenderTime_(&image_config, kImageData);
+      }
+
+      if (candidate_time < *time) {
+        profile->cpu_algorithm = algorithm;
+        profile->cpu_thread_count = (gm_uint)thread_count;
+        *time = candidate_time;
+      }
+    }
+  }
+
+  free(kImageData);
+}
+
+/**
+ * @return The next thread count to try, greater than the processor count once
+ * it has been tried.
+ */
+size_t gmGetNextThreadCount_(size_t thread_count, size_t processor_count) {
+  if ((thread_count == processor_count) ||
+      (thread_count * 2 <= processor_count)) {
+    return thread_count * 2;
+  }
+
+  return processor_count;
+}
+
+/**
+ * @return The render time, infinite when the render failed so that the
+ * settings are not picked.
+ */
+double gmMeasureCpuRenderTime_(const gmImageConfig *image_config,
+                               unsigned char *image_data) {
+  const double kStartTime = gmGetTime_();
+  const gmError kError = gmRenderImageOnCpu_(image_data, NULL, image_config);
+
+  return !kError ? gmGetTime_() - kStartTime : HUGE_VAL;
+}
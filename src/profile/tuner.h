@@ -0,0 +1,15 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "gm/error.h"
+#include "profile.h"
+#include "setup.h"
+
+/**
+ * Measures the fastest settings of the host by rendering representative
+ * viewports with every backend, algorithm and thread count.  This function
+ * assumes a context is current.
+ */
+gmError gmMeasureProfile_(GM_OUT_PARAM gmProfile_ *profile);
@@ -0,0 +1,162 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "qoi.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>  // For memcmp, memcpy and memset.
+
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "setup.h"
+
+/**
+ * Bytes buffered before each write.
+ */
+#define GM_QOI_BUFFER_SIZE_ 65536
+
+#define GM_QOI_OP_INDEX_ 0x00
+#define GM_QOI_OP_DIFF_ 0x40
+#define GM_QOI_OP_LUMA_ 0x80
+#define GM_QOI_OP_RUN_ 0xC0
+#define GM_QOI_OP_RGB_ 0xFE
+
+#define GM_QOI_MAX_RUN_LENGTH_ 62
+
+typedef struct gmQoiWriter_ {
+  FILE *file;
+  unsigned char buffer[GM_QOI_BUFFER_SIZE_];
+  size_t size;
+  int has_failed;
+} gmQoiWriter_;
+
+void gmWriteQoiHeader_(gmQoiWriter_ *writer, const gmIntSize *size);
+
+void gmWriteQoiPixels_(gmQoiWriter_ *writer, const unsigned char *image_data,
+                       size_t pixel_count);
+
+void gmFlushQoiWriter_(gmQoiWriter_ *writer);
+
+gmError gmWriteQoiImage_(const char *filepath, const unsigned char *image_data,
+                         const gmIntSize *size) {
+  gmQoiWriter_ writer = {.file = fopen(filepath, "wb")};
+  if (!writer.file) {
+    return gmError_ImageWriteFailed;
+  }
+
+  gmWriteQoiHeader_(&writer, size);
+  gmWriteQoiPixels_(&writer, image_data, (size_t)size->w * size->h);
+
+  gmFlushQoiWriter_(&writer);
+
+  // End marker.
+  const unsigned char kEnd[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+  memcpy(writer.buffer, kEnd, sizeof(kEnd));
+  writer.size = sizeof(kEnd);
+
+  gmFlushQoiWriter_(&writer);
+  writer.has_failed |= fclose(writer.file) != 0;
+
+  return !writer.has_failed ? gmError_Success : gmError_ImageWriteFailed;
+}
+
+void gmWriteQoiHeader_(gmQoiWriter_ *writer, const gmIntSize *size) {
+  unsigned char *const kHeader = writer->buffer;
+  memcpy(kHeader, "qoif", 4);
+
+  // Big-endian sides, then 3 channels in the sRGB color space.
+  for (int i = 0; i < 4; ++i) {
+    kHeader[4 + i] = (unsigned char)((uint32_t)size->w >> (24 - 8 * i));
+    kHeader[8 + i] = (unsigned char)((uint32_t)size->h >> (24 - 8 * i));
+  }
+
+  kHeader[12] = 3;
+  kHeader[13] = 0;
+  writer->size = 14;
+}
+
+/**
+ * Encodes each pixel as a run of the previous one, an index into the pixels
+ * seen before, a small difference from the previous one or raw values,
+ * whichever is shortest.  The alpha of the pixels stays at 255.
+ */
+void gmWriteQoiPixels_(gmQoiWriter_ *writer, const unsigned char *image_data,
+                       size_t pixel_count) {
+  // RGBA like the index of the decoders, which starts with transparent black
+  // that no pixel of the image matches.
+  unsigned char seen_pixels[64][4];
+  memset(seen_pixels, 0, sizeof(seen_pixels));
+
+  unsigned char previous[3] = {0, 0, 0};
+  int run_length = 0;
+
+  for (size_t i = 0; i < pixel_count; ++i) {
+    const unsigned char *const kPixel = &image_data[i * 3];
+
+    // Flushing before each pixel leaves room for its chunk and the run.
+    if (writer->size > GM_QOI_BUFFER_SIZE_ - 8) {
+      gmFlushQoiWriter_(writer);
+    }
+
+    unsigned char *const kChunk = &writer->buffer[writer->size];
+
+    if (!memcmp(kPixel, previous, 3)) {
+      ++run_length;
+      if ((run_length == GM_QOI_MAX_RUN_LENGTH_) || (i + 1 == pixel_count)) {
+        kChunk[0] = GM_QOI_OP_RUN_ | (run_length - 1);
+        ++writer->size;
+        run_length = 0;
+      }
+
+      continue;
+    }
+
+    size_t chunk_size = 0;
+    if (run_length) {
+      kChunk[chunk_size++] = GM_QOI_OP_RUN_ | (run_length - 1);
+      run_length = 0;
+    }
+
+    const int kIndex = (kPixel[0] * 3 + kPixel[1] * 5 + kPixel[2] * 7 +
+                        255 * 11) % 64;
+
+    if (!memcmp(seen_pixels[kIndex], kPixel, 3) &&
+        (seen_pixels[kIndex][3] == 255)) {
+      kChunk[chunk_size++] = GM_QOI_OP_INDEX_ | kIndex;
+    } else {
+      memcpy(seen_pixels[kIndex], kPixel, 3);
+      seen_pixels[kIndex][3] = 255;
+
+      // Differences wrap around like the channels.
+      const int kDiffR = (signed char)(kPixel[0] - previous[0]);
+      const int kDiffG = (signed char)(kPixel[1] - previous[1]);
+      const int kDiffB = (signed char)(kPixel[2] - previous[2]);
+      const int kDiffRG = kDiffR - kDiffG;
+      const int kDiffBG = kDiffB - kDiffG;
+
+      if ((kDiffR >= -2) && (kDiffR <= 1) && (kDiffG >= -2) &&
+          (kDiffG <= 1) && (kDiffB >= -2) && (kDiffB <= 1)) {
+        kChunk[chunk_size++] = GM_QOI_OP_DIFF_ | (kDiffR + 2) << 4 |
+                               (kDiffG + 2) << 2 | (kDiffB + 2);
+      } else if ((kDiffG >= -32) && (kDiffG <= 31) && (kDiffRG >= -8) &&
+                 (kDiffRG <= 7) && (kDiffBG >= -8) && (kDiffBG <= 7)) {
+        kChunk[chunk_size++] = GM_QOI_OP_LUMA_ | (kDiffG + 32);
+        kChunk[chunk_size++] = (kDiffRG + 8) << 4 | (kDiffBG + 8);
+      } else {
+        kChunk[chunk_size++] = GM_QOI_OP_RGB_;
+        memcpy(&kChunk[chunk_size], kPixel, 3);
+        chunk_size += 3;
+      }
+    }
+
+    writer->size += chunk_size;
+    memcpy(previous, kPixel, 3);
+  }
+}
+
+void gmFlushQoiWriter_(gmQoiWriter_ *writer) {
+  writer->has_failed |=
+      fwrite(writer->buffer, 1, writer->size, writer->file) != writer->size;
+  writer->size = 0;
+}
@@ -0,0 +1,15 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "setup.h"
+
+/**
+ * Encodes tightly packed RGB data as a QOI file, the rows being stored in the
+ * order of the image data like PNG files.
+ */
+gmError gmWriteQoiImage_(const char *filepath, const unsigned char *image_data,
+                         const gmIntSize *size);
@@ -0,0 +1,109 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "region.h"
+
+#include <stdlib.h>
+#include <string.h>  // For memset.
+
+#include "gm/gm.h"
+#include "setup.h"
+
+void gmCoverRect_(GM_OUT_PARAM unsigned char *coverage, const gmIntSize *size,
+                  const gmIntRect *rect);
+
+void gmCoverMask_(GM_OUT_PARAM unsigned char *coverage, const gmIntSize *size,
+                  const unsigned char *mask);
+
+unsigned char *gmComputeRegionCoverage_(const gmImageConfig *image_config) {
+  const gmRegionConfig *const kRegion = &image_config->region;
+  const gmIntSize *const kSize = &image_config->size;
+
+  unsigned char *const kCoverage = calloc((size_t)kSize->w * kSize->h, 1);
+
+  for (gm_uint i = 0; i < kRegion->rect_count; ++i) {
+    gmCoverRect_(kCoverage, kSize, &kRegion->rects[i]);
+  }
+
+  if (kRegion->mask) {
+    gmCoverMask_(kCoverage, kSize, kRegion->mask);
+  }
+
+  return kCoverage;
+}
+
+int gmClampCoordinate_(int coordinate, int size);
+
+void gmCoverRect_(GM_OUT_PARAM unsigned char *coverage, const gmIntSize *size,
+                  const gmIntRect *rect) {
+  const int kLeft = gmClampCoordinate_(rect->x, size->w);
+  const int kRight = gmClampCoordinate_(rect->x + rect->w, size->w);
+  const int kBottom = gmClampCoordinate_(rect->y, size->h);
+  const int kTop = gmClampCoordinate_(rect->y + rect->h, size->h);
+
+  if (kLeft >= kRight) {
+    return;
+  }
+
+  for (int y = kBottom; y < kTop; ++y) {
+    memset(&coverage[(size_t)y * size->w + kLeft], 1, kRight - kLeft);
+  }
+}
+
+int gmClampCoordinate_(int coordinate, int size) {
+  return coordinate < 0 ? 0 : (coordinate > size ? size : coordinate);
+}
+
+void gmCoverMask_(GM_OUT_PARAM unsigned char *coverage, const gmIntSize *size,
+                  const unsigned char *mask) {
+  const size_t kRowByteCount = ((size_t)size->w + 7) / 8;
+
+  for (int y = 0; y < size->h; ++y) {
+    const unsigned char *const kRow = &mask[y * kRowByteCount];
+    unsigned char *const kCoverageRow = &coverage[(size_t)y * size->w];
+
+    for (int x = 0; x < size->w; ++x) {
+      if (kRow[x / 8] & (0x80 >> (x % 8))) {
+        kCoverageRow[x] = 1;
+      }
+    }
+  }
+}
+
+gmSpan_ *gmGetRegionSpans_(GM_OUT_PARAM size_t *span_count,
+                           const unsigned char *coverage,
+                           const gmIntSize *size) {
+  size_t count = 0;
+  size_t capacity = (size_t)size->h;
+  gmSpan_ *spans = malloc(capacity * sizeof(gmSpan_));
+
+  for (int y = 0; y < size->h; ++y) {
+    const unsigned char *const kRow = &coverage[(size_t)y * size->w];
+
+    int x = 0;
+    while (x < size->w) {
+      while ((x < size->w) && !kRow[x]) {
+        ++x;
+      }
+
+      const int kBegin = x;
+      while ((x < size->w) && kRow[x]) {
+        ++x;
+      }
+
+      if (kBegin == x) {
+        break;
+      }
+
+      if (count == capacity) {
+        capacity *= 2;
+        spans = realloc(spans, capacity * sizeof(gmSpan_));
+      }
+
+      spans[count++] = (gmSpan_){.y = y, .begin = kBegin, .end = x};
+    }
+  }
+
+  *span_count = count;
+  return spans;
+}
@@ -0,0 +1,35 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include <stddef.h>
+
+#include "gm/gm.h"
+#include "setup.h"
+
+/**
+ * Pixels of a row inside the region, from `begin` to `end` excluded.
+ */
+typedef struct gmSpan_ {
+  int y;
+  int begin;
+  int end;
+} gmSpan_;
+
+/**
+ * Computes which pixels of the image are inside its region, one byte per pixel
+ * set to 1 inside and 0 outside, laid out like the image data.
+ *
+ * @return The coverage of the region, to be freed.
+ */
+unsigned char *gmComputeRegionCoverage_(const gmImageConfig *image_config);
+
+/**
+ * Lists the spans of the pixels inside the region, row after row.
+ *
+ * @return The spans, to be freed.
+ */
+gmSpan_ *gmGetRegionSpans_(GM_OUT_PARAM size_t *span_count,
+                           const unsigned char *coverage,
+                           const gmIntSize *size);
@@ -0,0 +1,385 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+// For the thread affinity.
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <unistd.h>  // For close and write.
+
+#include "context/context.h"
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "run.h"
+#include "setup.h"
+
+struct gmJob {
+  gmConfig config;
+  gmCompletionFunc on_completion;
+  void *user_data;
+
+  /**
+   * Signaled once the job is done.
+   */
+  int event_fd;
+
+  // Protects the state below, `gmWait` sleeps on `done_cond`.
+  pthread_mutex_t mutex;
+  pthread_cond_t done_cond;
+
+  int is_done;
+  gmError error;
+
+  /**
+   * Next job of the worker queue.
+   */
+  gmJob *next;
+};
+
+typedef struct gmRenderWorker_ {
+  gmRenderQueue *queue;
+  pthread_t thread;
+
+  /**
+   * Created along with the queue, on the thread creating it.
+   */
+  gmLazyContext_ context;
+
+  // Protected by the queue mutex, the worker sleeps on `work_cond` when no job
+  // is queued.
+  pthread_cond_t work_cond;
+  gmJob *first_job;
+  gmJob *last_job;
+
+  /**
+   * Queued and running jobs.
+   */
+  size_t pending_count;
+} gmRenderWorker_;
+
+struct gmRenderQueue {
+  gmRenderWorker_ *workers;
+  size_t worker_count;
+
+  /**
+   * Protects the jobs of the workers.
+   */
+  pthread_mutex_t mutex;
+
+  /**
+   * First worker looked at by the next submission, so that idle workers take
+   * turns.
+   */
+  size_t next_worker_index;
+
+  int stopping;
+};
+
+gmError gmCreateWorkerContexts_(gmRenderQueue *queue);
+
+gmError gmStartRenderWorkers_(gmRenderQueue *queue,
+                              const int *worker_processors);
+
+void gmDeleteWorkerContexts_(const gmRenderQueue *queue);
+
+gmError gmCreateRenderQueue(gmRenderQueue **queue,
+                            const gmRenderQueueConfig *config) {
+  gmError error;
+
+  const gm_uint kWorkerCount = config ? config->worker_count : 0;
+
+  gmRenderQueue *const kQueue = calloc(1, sizeof(gmRenderQueue));
+  kQueue->worker_count = kWorkerCount ? kWorkerCount : 1;
+  kQueue->workers = calloc(kQueue->worker_count, sizeof(gmRenderWorker_));
+  pthread_mutex_init(&kQueue->mutex, NULL);
+
+  error = gmCreateWorkerContexts_(kQueue);
+  if (!error) {
+    error = gmStartRenderWorkers_(kQueue,
+                                  config ? config->worker_processors : NULL);
+    if (error) {
+      gmDeleteWorkerContexts_(kQueue);
+    }
+  }
+
+  if (error) {
+    pthread_mutex_destroy(&kQueue->mutex);
+    free(kQueue->workers);
+    free(kQueue);
+  } else {
+    *queue = kQueue;
+  }
+
+  return error;
+}
+
+gmError gmCreateWorkerContexts_(gmRenderQueue *queue) {
+  gmContext_ *const kContexts =
+      malloc(queue->worker_count * sizeof(gmContext_));
+
+  // Windows are created on the thread creating the queue, workers only make
+  // their context current.
+  const gmError kError = gmCreateContexts_(kContexts, queue->worker_count);
+  if (!kError) {
+    for (size_t i = 0; i < queue->worker_count; ++i) {
+      queue->workers[i].context.context = kContexts[i];
+      queue->workers[i].context.is_created = 1;
+    }
+  }
+
+  free(kContexts);
+  return kError;
+}
+
+void *gmRunRenderWorker_(void *worker);
+
+void gmStopRenderWorkers_(gmRenderQueue *queue, size_t started_count);
+
+gmError gmStartRenderWorkers_(gmRenderQueue *queue,
+                              const int *worker_processors) {
+  size_t started_count = 0;
+  for (; started_count < queue->worker_count; ++started_count) {
+    gmRenderWorker_ *const kWorker = &queue->workers[started_count];
+    kWorker->queue = queue;
+    pthread_cond_init(&kWorker->work_cond, NULL);
+
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+
+    if (worker_processors) {
+      cpu_set_t processors;
+      CPU_ZERO(&processors);
+      CPU_SET(worker_processors[started_count], &processors);
+
+      pthread_attr_setaffinity_np(&attributes, sizeof(cpu_set_t), &processors);
+    }
+
+    // Fails when pinned to a processor which is not available.
+    const int kCreateError = pthread_create(&kWorker->thread, &attributes,
+                                            gmRunRenderWorker_, kWorker);
+    pthread_attr_destroy(&attributes);
+
+    if (kCreateError) {
+      pthread_cond_destroy(&kWorker->work_cond);
+      break;
+    }
+  }
+
+  if (started_count < queue->worker_count) {
+    gmStopRenderWorkers_(queue, started_count);
+    return gmError_ThreadCreationFailed;
+  }
+
+  return gmError_Success;
+}
+
+gmJob *gmPopJob_(gmRenderWorker_ *worker);
+void gmCompleteJob_(gmJob *job, gmError error);
+void gmFinishJob_(gmRenderWorker_ *worker);
+
+void *gmRunRenderWorker_(void *worker) {
+  gmRenderWorker_ *const kWorker = worker;
+
+  // Keeps the resources of the last render for the next ones.
+  gmRenderState_ state;
+  gmInitRenderState_(&state, &kWorker->context);
+
+  gmJob *job;
+  while ((job = gmPopJob_(kWorker))) {
+    gmCompleteJob_(job, gmRunWithState_(&job->config, &state));
+    gmFinishJob_(kWorker);
+  }
+
+  gmDeleteRenderState_(&state);
+  return NULL;
+}
+
+/**
+ * Blocks until a job is queued on the worker.
+ *
+ * @return The oldest job of the worker, NULL once the queue is stopping and
+ * the worker has no job left.
+ */
+gmJob *gmPopJob_(gmRenderWorker_ *worker) {
+  gmRenderQueue *const kQueue = worker->queue;
+  pthread_mutex_lock(&kQueue->mutex);
+
+  while (!worker->first_job && !kQueue->stopping) {
+    pthread_cond_wait(&worker->work_cond, &kQueue->mutex);
+  }
+
+  gmJob *const kJob = worker->first_job;
+  if (kJob) {
+    worker->first_job = kJob->next;
+    if (!worker->first_job) {
+      worker->last_job = NULL;
+    }
+  }
+
+  pthread_mutex_unlock(&kQueue->mutex);
+  return kJob;
+}
+
+void gmCompleteJob_(gmJob *job, gmError error) {
+  // Called first, the job can be released as soon as it is marked done.
+  if (job->on_completion) {
+    job->on_completion(job, error, job->user_data);
+  }
+
+  pthread_mutex_lock(&job->mutex);
+  job->error = error;
+  job->is_done = 1;
+
+  // Cannot fail, the counter is only incremented once.
+  const uint64_t kIncrement = 1;
+  const ssize_t kWrittenSize =
+      write(job->event_fd, &kIncrement, sizeof(kIncrement));
+  (void)kWrittenSize;
+
+  pthread_cond_broadcast(&job->done_cond);
+  pthread_mutex_unlock(&job->mutex);
+}
+
+void gmFinishJob_(gmRenderWorker_ *worker) {
+  pthread_mutex_lock(&worker->queue->mutex);
+  --worker->pending_count;
+  pthread_mutex_unlock(&worker->queue->mutex);
+}
+
+void gmDeleteRenderQueue(gmRenderQueue *queue) {
+  gmStopRenderWorkers_(queue, queue->worker_count);
+  gmDeleteWorkerContexts_(queue);
+
+  pthread_mutex_destroy(&queue->mutex);
+  free(queue->workers);
+  free(queue);
+}
+
+void gmStopRenderWorkers_(gmRenderQueue *queue, size_t started_count) {
+  pthread_mutex_lock(&queue->mutex);
+  queue->stopping = 1;
+
+  for (size_t i = 0; i < started_count; ++i) {
+    pthread_cond_signal(&queue->workers[i].work_cond);
+  }
+
+  pthread_mutex_unlock(&queue->mutex);
+
+  // The workers run their queued jobs before stopping.
+  for (size_t i = 0; i < started_count; ++i) {
+    pthread_join(queue->workers[i].thread, NULL);
+    pthread_cond_destroy(&queue->workers[i].work_cond);
+  }
+}
+
+void gmDeleteWorkerContexts_(const gmRenderQueue *queue) {
+  gmContext_ *const kContexts =
+      malloc(queue->worker_count * sizeof(gmContext_));
+
+  for (size_t i = 0; i < queue->worker_count; ++i) {
+    kContexts[i] = queue->workers[i].context.context;
+  }
+
+  gmDeleteContexts_(kContexts, queue->worker_count);
+  free(kContexts);
+}
+
+gmRenderWorker_ *gmGetLeastLoadedWorker_(gmRenderQueue *queue);
+
+gmError gmSubmit(gmRenderQueue *queue, const gmConfig *config,
+                 gmCompletionFunc on_completion, void *user_data,
+                 gmJob **job) {
+  const int kEventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (kEventFd < 0) {
+    return gmError_JobSubmissionFailed;
+  }
+
+  gmJob *const kJob = calloc(1, sizeof(gmJob));
+  kJob->config = *config;
+  kJob->on_completion = on_completion;
+  kJob->user_data = user_data;
+  kJob->event_fd = kEventFd;
+
+  pthread_mutex_init(&kJob->mutex, NULL);
+  pthread_cond_init(&kJob->done_cond, NULL);
+
+  // Set before queuing the job, which may be done right away.
+  *job = kJob;
+
+  pthread_mutex_lock(&queue->mutex);
+
+  gmRenderWorker_ *const kWorker = gmGetLeastLoadedWorker_(queue);
+  ++kWorker->pending_count;
+
+  if (kWorker->last_job) {
+    kWorker->last_job->next = kJob;
+  } else {
+    kWorker->first_job = kJob;
+  }
+
+  kWorker->last_job = kJob;
+
+  pthread_cond_signal(&kWorker->work_cond);
+  pthread_mutex_unlock(&queue->mutex);
+
+  return gmError_Success;
+}
+
+/**
+ * This function assumes the queue mutex is locked.
+ */
+gmRenderWorker_ *gmGetLeastLoadedWorker_(gmRenderQueue *queue) {
+  const size_t kFirstIndex = queue->next_worker_index++ % queue->worker_count;
+  gmRenderWorker_ *least_loaded_worker = &queue->workers[kFirstIndex];
+
+  for (size_t i = 1; i < queue->worker_count; ++i) {
+    gmRenderWorker_ *const kWorker =
+        &queue->workers[(kFirstIndex + i) % queue->worker_count];
+
+    if (kWorker->pending_count < least_loaded_worker->pending_count) {
+      least_loaded_worker = kWorker;
+    }
+  }
+
+  return least_loaded_worker;
+}
+
+int gmPoll(const gmJob *job, gmError *error) {
+  gmJob *const kJob = (gmJob *)job;  // Only the mutex is modified.
+
+  pthread_mutex_lock(&kJob->mutex);
+
+  const int kIsDone = kJob->is_done;
+  if (kIsDone && error) {
+    *error = kJob->error;
+  }
+
+  pthread_mutex_unlock(&kJob->mutex);
+  return kIsDone;
+}
+
+int gmGetJobFd(const gmJob *job) {
+  return job->event_fd;
+}
+
+gmError gmWait(gmJob *job) {
+  pthread_mutex_lock(&job->mutex);
+
+  while (!job->is_done) {
+    pthread_cond_wait(&job->done_cond, &job->mutex);
+  }
+
+  const gmError kError = job->error;
+  pthread_mutex_unlock(&job->mutex);
+
+  close(job->event_fd);
+  pthread_mutex_destroy(&job->mutex);
+  pthread_cond_destroy(&job->done_cond);
+  free(job);
+
+  return kError;
+}
@@ -0,0 +1,277 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "batch.h"
+
+#include <glad/glad.h>
+#include <stdlib.h>
+#include <string.h>  // For memset.
+
+#include "cpu/thread-pool.h"
+#include "file-writer.h"
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "image-config.h"
+#include "png.h"
+#include "render.h"
+#include "resources/resources.h"
+#include "setup.h"
+
+/**
+ * Bytes of the layers read back at once, so that batches of large images
+ * don't allocate hundreds of layers.  Single layers may be larger.
+ */
+#define GM_MAX_BATCH_LAYERS_SIZE_ (64 << 20)
+
+/**
+ * Layout of the `Images` uniform block, std140 aligning each element of its
+ * arrays on a vec4.
+ */
+typedef struct gmBatchUniforms_ {
+  float viewports[GM_MAX_BATCH_LAYER_COUNT_][4];
+  float julia_constants[GM_MAX_BATCH_LAYER_COUNT_][4];
+} gmBatchUniforms_;
+
+gm_uint gmGetBatchLayerCount_(const gmBatchConfig *config);
+
+void gmUseBatchResources_(const gmBatchResources_ *resources,
+                          const gmImageConfig *image_config);
+
+void gmDrawBatchLayers_(const gmBatchResources_ *resources,
+                        const gmBatchConfig *config, gm_uint first_image);
+
+gmError gmWriteBatchImages_(gmThreadPool_ *pool, gmFileWriter_ *file_writer,
+                            const unsigned char *layers_data,
+                            const gmBatchConfig *config, gm_uint first_image,
+                            gm_uint image_count);
+
+gmError gmRenderBatch_(const gmBatchConfig *config) {
+  if (!config->image_count) {
+    return gmError_Success;
+  }
+
+  gmError error;
+
+  const gmIntSize *const kImageSize = &config->image_config.size;
+  const gm_uint kLayerCount = gmGetBatchLayerCount_(config);
+
+  gmThreadPool_ *pool;
+  error = gmCreateThreadPool_(&pool, config->image_config.cpu.thread_count);
+  if (!error) {
+    // Writes the encoded images while the next layers render.
+    gmFileWriter_ *file_writer;
+    error = gmCreateFileWriter_(&file_writer, GM_DEFAULT_MAX_QUEUED_FILE_SIZE_);
+
+    gmBatchResources_ resources;
+    if (!error) {
+      error = gmCreateBatchResources_(&resources, kImageSize, kLayerCount);
+      if (error) {
+        gmDeleteFileWriter_(file_writer);
+      }
+    }
+
+    if (!error) {
+      unsigned char *const kLayersData =
+          malloc((size_t)kImageSize->w * kImageSize->h * 3 * kLayerCount);
+
+      gmUseBatchResources_(&resources, &config->image_config);
+      gmDrawBatchLayers_(&resources, config, 0);
+
+      for (gm_uint first_image = 0;
+           !error && (first_image < config->image_count);
+           first_image += kLayerCount) {
+        const gm_uint kRemainingCount = config->image_count - first_image;
+        const gm_uint kImageCount =
+            kRemainingCount < kLayerCount ? kRemainingCount : kLayerCount;
+
+        // Waits for the layers, then has the GPU render the next images while
+        // these ones are encoded.
+        gmReadFrameBufferLayers_(kLayersData, &resources.layers_frame_buffer);
+        if (kImageCount < kRemainingCount) {
+          gmDrawBatchLayers_(&resources, config, first_image + kLayerCount);
+          glFlush();
+        }
+
+        error = gmWriteBatchImages_(pool, file_writer, kLayersData, config,
+                                    first_image, kImageCount);
+      }
+
+      glBindBufferBase(GL_UNIFORM_BUFFER, 0, 0);
+      gmClearCurrentProgram_();
+      gmClearCurrentModel_();
+      gmClearCurrentFrameBuffer_(gmFrameBufferTarget_Framebuffer_);
+
+      free(kLayersData);
+      gmDeleteBatchResources_(&resources);
+
+      // Waits for the images to be written.
+      const gmError kWriteError = gmDeleteFileWriter_(file_writer);
+      if (!error) {
+        error = kWriteError;
+      }
+    }
+
+    gmDeleteThreadPool_(pool);
+  }
+
+  return error;
+}
+
+gm_uint gmGetBatchLayerCount_(const gmBatchConfig *config) {
+  GLint max_layer_count;
+  glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layer_count);
+
+  const gmIntSize *const kImageSize = &config->image_config.size;
+  const size_t kLayerSize = (size_t)kImageSize->w * kImageSize->h * 3;
+  const size_t kBudgetLayerCount = GM_MAX_BATCH_LAYERS_SIZE_ / kLayerSize;
+
+  size_t layer_count = config->image_count;
+  if (layer_count > GM_MAX_BATCH_LAYER_COUNT_) {
+    layer_count = GM_MAX_BATCH_LAYER_COUNT_;
+  }
+
+  if (layer_count > (size_t)max_layer_count) {
+    layer_count = max_layer_count;
+  }
+
+  if (layer_count > kBudgetLayerCount) {
+    layer_count = kBudgetLayerCount ? kBudgetLayerCount : 1;
+  }
+
+  return (gm_uint)layer_count;
+}
+
+void gmUseBatchResources_(const gmBatchResources_ *resources,
+                          const gmImageConfig *image_config) {
+  gmUseFrameBufferAs_(&resources->layers_frame_buffer,
+                      gmFrameBufferTarget_Framebuffer_);
+
+  glViewport(0, 0, image_config->size.w, image_config->size.h);
+
+  gmUseModel_(&resources->quad);
+  gmUseProgram_(&resources->program);
+  gmSetKernelUniforms_(&resources->program, image_config);
+
+  gmUseBufferAs_(&resources->images_buffer, gmBufferTarget_Uniform_);
+  glBindBufferBase(GL_UNIFORM_BUFFER, 0, resources->images_buffer);
+}
+
+void gmGetBatchImageViewport_(GM_OUT_PARAM gmViewport *viewport,
+                              const gmBatchImage *image);
+
+/**
+ * Draws one instance of the quad per image, on the layer of its index in the
+ * batch resources.  This function assumes the batch resources are in use.
+ */
+void gmDrawBatchLayers_(const gmBatchResources_ *resources,
+                        const gmBatchConfig *config, gm_uint first_image) {
+  const gm_uint kRemainingCount = config->image_count - first_image;
+  const gm_uint kImageCount = kRemainingCount < resources->layer_count
+                                  ? kRemainingCount
+                                  : resources->layer_count;
+
+  gmBatchUniforms_ uniforms;
+  memset(&uniforms, 0, sizeof(uniforms));
+
+  for (gm_uint i = 0; i < kImageCount; ++i) {
+    const gmBatchImage *const kImage = &config->images[first_image + i];
+
+    gmViewport viewport;
+    gmGetBatchImageViewport_(&viewport, kImage);
+
+    uniforms.viewports[i][0] = viewport.center_x - viewport.width / 2.0;
+    uniforms.viewports[i][1] = viewport.center_y - viewport.height / 2.0;
+    uniforms.viewports[i][2] = viewport.width;
+    uniforms.viewports[i][3] = viewport.height;
+
+    uniforms.julia_constants[i][0] = kImage->julia_c_x;
+    uniforms.julia_constants[i][1] = kImage->julia_c_y;
+    uniforms.julia_constants[i][2] = kImage->is_julia ? 1.0f : 0.0f;
+  }
+
+  gmLoadBufferDataAs_(gmBufferTarget_Uniform_, sizeof(uniforms), &uniforms);
+
+  glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, NULL,
+                          kImageCount);
+}
+
+void gmGetBatchImageViewport_(GM_OUT_PARAM gmViewport *viewport,
+                              const gmBatchImage *image) {
+  const gmViewport kDefaultJuliaViewport = {
+      .center_x = 0.0, .center_y = 0.0, .width = 4.0, .height = 4.0};
+
+  const int kIsDefault =
+      (image->viewport.width == 0.0) || (image->viewport.height == 0.0);
+
+  if (image->is_julia && kIsDefault) {
+    *viewport = kDefaultJuliaViewport;
+  } else {
+    const gmImageConfig kImageConfig = {.viewport = image->viewport};
+    gmGetViewport_(viewport, &kImageConfig);
+  }
+}
+
+typedef struct gmBatchImages_ {
+  gmFileWriter_ *file_writer;
+  const unsigned char *layers_data;
+  const gmBatchConfig *config;
+  gm_uint first_image;
+
+  /**
+   * One flag per image.
+   */
+  int *has_failed;
+} gmBatchImages_;
+
+void gmWriteBatchImageRange_(void *batch_images, size_t begin, size_t end,
+                             size_t worker_index);
+
+gmError gmWriteBatchImages_(gmThreadPool_ *pool, gmFileWriter_ *file_writer,
+                            const unsigned char *layers_data,
+                            const gmBatchConfig *config, gm_uint first_image,
+                            gm_uint image_count) {
+  gmBatchImages_ batch_images = {
+      .file_writer = file_writer,
+      .layers_data = layers_data,
+      .config = config,
+      .first_image = first_image,
+      .has_failed = calloc(image_count, sizeof(int))};
+
+  gmRunParallelFor_(pool, image_count, 1, gmWriteBatchImageRange_,
+                    &batch_images);
+
+  int has_failed = 0;
+  for (gm_uint i = 0; i < image_count; ++i) {
+    has_failed |= batch_images.has_failed[i];
+  }
+
+  free(batch_images.has_failed);
+  return !has_failed ? gmError_Success : gmError_ImageWriteFailed;
+}
+
+void gmWriteBatchImageRange_(void *batch_images, size_t begin, size_t end,
+                             size_t worker_index) {
+  (void)worker_index;
+
+  const gmBatchImages_ *const kBatchImages = batch_images;
+  const gmIntSize *const kImageSize = &kBatchImages->config->image_config.size;
+  const size_t kLayerSize = (size_t)kImageSize->w * kImageSize->h * 3;
+
+  for (size_t i = begin; i < end; ++i) {
+    const gmBatchImage *const kImage =
+        &kBatchImages->config->images[kBatchImages->first_image + i];
+
+    unsigned char *png_data;
+    size_t png_size;
+    kBatchImages->has_failed[i] =
+        gmEncodePngImage_(&png_data, &png_size,
+                          kBatchImages->layers_data + i * kLayerSize,
+                          kImageSize, (size_t)kImageSize->w * 3) !=
+        gmError_Success;
+
+    if (!kBatchImages->has_failed[i]) {
+      gmQueueFileWrite_(kBatchImages->file_writer, kImage->output_filepath,
+                        png_data, png_size);
+    }
+  }
+}
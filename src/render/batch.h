@@ -0,0 +1,15 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "setup.h"
+
+/**
+ * Renders the images of the batch as PNG files with the OpenGL backend, as
+ * many images at once as the layers of the batch resources.  This function
+ * assumes a context is current.
+ */
+gmError gmRenderBatch_(const gmBatchConfig *config);
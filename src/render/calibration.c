@@ -0,0 +1,49 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "calibration.h"
+
+#include <glad/glad.h>
+
+#include "clock.h"
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "render.h"
+#include "resources/resources.h"
+#include "setup.h"
+
+gmError gmMeasureGlIterationRate_(GM_OUT_PARAM double *iteration_rate) {
+  // Large enough to keep the GPU busy, small enough for software renderers.
+  const gmImageConfig kImageConfig = {
+      .size = {.w = 128, .h = 128},
+      .viewport = {.center_x = -0.1, .width = 0.01, .height = 0.01},
+      .max_iteration_count = 512,
+      .backend = gmBackend_Gl};
+
+  gmError error;
+
+  gmResources_ resources;
+  error = gmCreateResources_(&resources, &kImageConfig, 0);
+  if (!error) {
+    // The first render also includes compiling the shaders on some drivers.
+    gmRenderImage_(&resources, &kImageConfig);
+    glFinish();
+
+    const double kStartTime = gmGetTime_();
+    gmRenderImage_(&resources, &kImageConfig);
+    glFinish();
+    const double kElapsedTime = gmGetTime_() - kStartTime;
+
+    // The last test of each pixel counts as an iteration, like on the CPU.
+    const double kIterationCount = (double)kImageConfig.size.w *
+                                   kImageConfig.size.h *
+                                   (kImageConfig.max_iteration_count + 1);
+
+    *iteration_rate =
+        kIterationCount / (kElapsedTime > 1e-6 ? kElapsedTime : 1e-6);
+
+    gmDeleteResources_(&resources);
+  }
+
+  return error;
+}
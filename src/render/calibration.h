@@ -0,0 +1,14 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "gm/error.h"
+#include "setup.h"
+
+/**
+ * Measures the number of iterations computed per second by the OpenGL
+ * backend, rendering a viewport inside the set where every pixel reaches the
+ * max iteration count.  This function assumes a context is current.
+ */
+gmError gmMeasureGlIterationRate_(GM_OUT_PARAM double *iteration_rate);
@@ -0,0 +1,164 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "equalization.h"
+
+#include <glad/glad.h>
+
+#include "gm/gm.h"
+#include "image-config.h"
+#include "render.h"
+#include "resources/program/uniform.h"
+#include "resources/resources.h"
+
+void gmResolveIterationCounts_(const gmResources_ *resources,
+                               const gmIntSize *image_size);
+
+void gmComputeHistogram_(const gmEqualizationResources_ *equalization,
+                         const gmImageConfig *image_config);
+
+const gmFrameBuffer_ *gmComputePrefixSums_(
+    const gmEqualizationResources_ *equalization, int bin_count, int row_count);
+
+void gmDrawEqualizedColors_(const gmResources_ *resources,
+                            const gmImageConfig *image_config,
+                            const gmFrameBuffer_ *cdf_frame_buffer);
+
+void gmEqualizeColors_(const gmResources_ *resources,
+                       const gmImageConfig *image_config) {
+  const gmEqualizationResources_ *const kEqualization =
+      &resources->equalization;
+
+  gmResolveIterationCounts_(resources, &image_config->size);
+
+  gmUseModel_(&resources->render_data.quad);
+
+  gmComputeHistogram_(kEqualization, image_config);
+  const gmFrameBuffer_ *const kCdfFrameBuffer = gmComputePrefixSums_(
+      kEqualization, (int)gmGetEqualizationBinCount_(image_config),
+      (int)gmGetEqualizationRowCount_(image_config));
+
+  gmDrawEqualizedColors_(resources, image_config, kCdfFrameBuffer);
+
+  gmClearCurrentFrameBuffer_(gmFramebufferTarget_Draw_);
+  gmClearCurrentModel_();
+  gmClearCurrentProgram_();
+}
+
+void gmResolveIterationCounts_(const gmResources_ *resources,
+                               const gmIntSize *image_size) {
+  gmUseFrameBufferAs_(&resources->equalization.counts_frame_buffer,
+                      gmFramebufferTarget_Draw_);
+  gmUseFrameBufferAs_(&resources->render_frame_buffers.render,
+                      gmFramebufferTarget_Read_);
+
+  // The samples of a pixel share their iteration count.
+  glReadBuffer(GL_COLOR_ATTACHMENT1);
+  glBlitFramebuffer(0, 0, image_size->w, image_size->h, 0, 0, image_size->w,
+                    image_size->h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+
+  gmClearCurrentFrameBuffer_(gmFramebufferTarget_Read_);
+}
+
+void gmComputeHistogram_(const gmEqualizationResources_ *equalization,
+                         const gmImageConfig *image_config) {
+  const gmProgram_ *const kProgram = &equalization->histogram_program;
+  const int kBinCount = (int)gmGetEqualizationBinCount_(image_config);
+  const int kRowCount = (int)gmGetEqualizationRowCount_(image_config);
+
+  gmUseFrameBufferAs_(&equalization->bin_frame_buffers[0],
+                      gmFramebufferTarget_Draw_);
+  glViewport(0, 0, kBinCount, kRowCount);
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  gmUseProgram_(kProgram);
+  gmSetUniformInt_(kProgram, "u_MaxIterations",
+                   gmGetMaxIterationCount_(image_config));
+  gmSetUniformInt_(kProgram, "u_BinWidth",
+                   gmGetEqualizationBinWidth_(image_config));
+  gmSetUniformInt_(kProgram, "u_BinCount", kBinCount);
+  gmSetUniformInt_(kProgram, "u_RowPixelCount",
+                   GM_MAX_EQUALIZATION_ROW_PIXEL_COUNT_);
+  gmSetUniformInt_(kProgram, "u_RowCount", kRowCount);
+
+  gmUseFrameBufferTexture_(&equalization->counts_frame_buffer, 0);
+  gmSetUniformInt_(kProgram, "u_Counts", 0);
+
+  // OpenGL 3.3 has no atomic counters, the points of the pixels falling in the
+  // same bin are added up by blending instead.
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE, GL_ONE);
+
+  // One point per pixel.
+  glDrawArraysInstanced(GL_POINTS, 0, 1,
+                        image_config->size.w * image_config->size.h);
+
+  glDisable(GL_BLEND);
+}
+
+/**
+ * Sums up the bins in log2(bin count) passes, going back and forth between the
+ * bin frame-buffers.  The first pass also adds up the rows of the histogram,
+ * and is run even for a single bin.
+ *
+ * @return The frame-buffer holding the prefix sums, in its first row.
+ */
+const gmFrameBuffer_ *gmComputePrefixSums_(
+    const gmEqualizationResources_ *equalization, int bin_count,
+    int row_count) {
+  const gmProgram_ *const kProgram = &equalization->prefix_sum_program;
+
+  // The sums are only drawn to the first row.
+  glViewport(0, 0, bin_count, 1);
+
+  gmUseProgram_(kProgram);
+  gmSetUniformInt_(kProgram, "u_Bins", 0);
+
+  int source_index = 0;
+  int offset = 1;
+  do {
+    gmUseFrameBufferAs_(&equalization->bin_frame_buffers[1 - source_index],
+                        gmFramebufferTarget_Draw_);
+
+    gmUseFrameBufferTexture_(&equalization->bin_frame_buffers[source_index], 0);
+    gmSetUniformInt_(kProgram, "u_Offset", offset);
+    gmSetUniformInt_(kProgram, "u_RowCount", row_count);
+    gmDrawQuad_();
+
+    source_index = 1 - source_index;
+    offset *= 2;
+    row_count = 1;
+  } while (offset < bin_count);
+
+  return &equalization->bin_frame_buffers[source_index];
+}
+
+void gmDrawEqualizedColors_(const gmResources_ *resources,
+                            const gmImageConfig *image_config,
+                            const gmFrameBuffer_ *cdf_frame_buffer) {
+  const gmEqualizationResources_ *const kEqualization =
+      &resources->equalization;
+
+  const gmProgram_ *const kProgram = &kEqualization->palette_program;
+
+  // The cost buffer of the final frame-buffer, if any, is left out of its draw
+  // buffers once blitted.
+  gmUseFrameBufferAs_(&resources->render_frame_buffers.final,
+                      gmFramebufferTarget_Draw_);
+  glViewport(0, 0, image_config->size.w, image_config->size.h);
+
+  gmUseProgram_(kProgram);
+  gmSetUniformInt_(kProgram, "u_MaxIterations",
+                   gmGetMaxIterationCount_(image_config));
+  gmSetUniformInt_(kProgram, "u_BinWidth",
+                   gmGetEqualizationBinWidth_(image_config));
+
+  gmUseFrameBufferTexture_(&kEqualization->counts_frame_buffer, 0);
+  gmSetUniformInt_(kProgram, "u_Counts", 0);
+
+  gmUseFrameBufferTexture_(cdf_frame_buffer, 1);
+  gmSetUniformInt_(kProgram, "u_Cdf", 1);
+
+  gmDrawQuad_();
+}
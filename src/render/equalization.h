@@ -0,0 +1,14 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "gm/gm.h"
+#include "resources/resources.h"
+
+/**
+ * Colors the final frame-buffer from the iteration counts stored in the cost
+ * buffer of the render frame-buffer, following the histogram of the image.
+ */
+void gmEqualizeColors_(const gmResources_ *resources,
+                       const gmImageConfig *image_config);
@@ -0,0 +1,149 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "hierarchical.h"
+
+#include <glad/glad.h>
+#include <stdlib.h>  // For NULL.
+
+#include "gm/gm.h"
+#include "image-config.h"
+#include "render.h"
+#include "resources/program/uniform.h"
+#include "resources/resources.h"
+#include "stencil.h"
+
+void gmComputeBlockCorners_(const gmResources_ *resources,
+                            const gmImageConfig *image_config,
+                            const gmIntSize *grid_size);
+
+void gmClassifyBlocks_(const gmResources_ *resources,
+                       const gmImageConfig *image_config,
+                       const gmIntSize *grid_size);
+
+void gmFillUniformBlocks_(const gmResources_ *resources,
+                          const gmImageConfig *image_config,
+                          const gmIntSize *grid_size);
+
+void gmRenderRemainingPixels_(const gmResources_ *resources,
+                              const gmImageConfig *image_config);
+
+void gmRenderImageHierarchically_(const gmResources_ *resources,
+                                  const gmImageConfig *image_config) {
+  gmIntSize grid_size;
+  gmGetBlockGridSize_(&grid_size, &image_config->size);
+
+  gmUseModel_(&resources->render_data.quad);
+
+  gmComputeBlockCorners_(resources, image_config, &grid_size);
+  gmClassifyBlocks_(resources, image_config, &grid_size);
+
+  gmUseFrameBufferAs_(&resources->render_frame_buffers.render,
+                      gmFramebufferTarget_Draw_);
+  glViewport(0, 0, image_config->size.w, image_config->size.h);
+
+  gmMarkRegion_(resources, image_config);
+  glEnable(GL_STENCIL_TEST);
+
+  gmFillUniformBlocks_(resources, image_config, &grid_size);
+  gmRenderRemainingPixels_(resources, image_config);
+
+  glDisable(GL_STENCIL_TEST);
+
+  gmClearCurrentFrameBuffer_(gmFramebufferTarget_Draw_);
+  gmClearCurrentModel_();
+  gmClearCurrentProgram_();
+}
+
+void gmComputeBlockCorners_(const gmResources_ *resources,
+                            const gmImageConfig *image_config,
+                            const gmIntSize *grid_size) {
+  const gmHierarchicalResources_ *const kHierarchical =
+      &resources->hierarchical;
+
+  gmUseFrameBufferAs_(&kHierarchical->block_corners_frame_buffer,
+                      gmFramebufferTarget_Draw_);
+
+  // One more corner than blocks in each direction.
+  glViewport(0, 0, grid_size->w + 1, grid_size->h + 1);
+
+  gmUseProgram_(&kHierarchical->block_corners_program);
+  gmSetKernelUniforms_(&kHierarchical->block_corners_program, image_config);
+  gmDrawQuad_();
+}
+
+void gmClassifyBlocks_(const gmResources_ *resources,
+                       const gmImageConfig *image_config,
+                       const gmIntSize *grid_size) {
+  const gmHierarchicalResources_ *const kHierarchical =
+      &resources->hierarchical;
+
+  const gmProgram_ *const kProgram = &kHierarchical->classify_blocks_program;
+
+  gmUseFrameBufferAs_(&kHierarchical->blocks_frame_buffer,
+                      gmFramebufferTarget_Draw_);
+  glViewport(0, 0, grid_size->w, grid_size->h);
+
+  gmUseProgram_(kProgram);
+  gmSetKernelUniforms_(kProgram, image_config);
+
+  gmUseFrameBufferTexture_(&kHierarchical->block_corners_frame_buffer, 0);
+  gmSetUniformInt_(kProgram, "u_Corners", 0);
+  gmDrawQuad_();
+}
+
+void gmUseBlocksTextures_(const gmHierarchicalResources_ *hierarchical,
+                          const gmProgram_ *program);
+
+void gmFillUniformBlocks_(const gmResources_ *resources,
+                          const gmImageConfig *image_config,
+                          const gmIntSize *grid_size) {
+  const gmHierarchicalResources_ *const kHierarchical =
+      &resources->hierarchical;
+
+  const gmProgram_ *const kProgram = &kHierarchical->fill_blocks_program;
+
+  // Every fragment of the filled blocks inside the region is marked.
+  glStencilFunc(GL_EQUAL, GM_REGION_STENCIL_VALUE_ | 1,
+                GM_REGION_STENCIL_VALUE_);
+  glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+
+  gmUseProgram_(kProgram);
+  gmSetUniformIntSize_(kProgram, "u_ImageSize", &image_config->size);
+  gmSetUniformInt_(kProgram, "u_MaxIterations",
+                   gmGetMaxIterationCount_(image_config));
+
+  gmUseBlocksTextures_(kHierarchical, kProgram);
+
+  // One quad instance per block.
+  glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, NULL,
+                          grid_size->w * grid_size->h);
+}
+
+void gmRenderRemainingPixels_(const gmResources_ *resources,
+                              const gmImageConfig *image_config) {
+  const gmHierarchicalResources_ *const kHierarchical =
+      &resources->hierarchical;
+
+  const gmProgram_ *const kProgram = &kHierarchical->remaining_pixels_program;
+
+  // Only the fragments inside the region which were not filled are written.
+  glStencilFunc(GL_EQUAL, GM_REGION_STENCIL_VALUE_, 0xFF);
+  glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+
+  gmUseProgram_(kProgram);
+  gmSetKernelUniforms_(kProgram, image_config);
+
+  gmUseBlocksTextures_(kHierarchical, kProgram);
+  gmDrawQuad_();
+}
+
+void gmUseBlocksTextures_(const gmHierarchicalResources_ *hierarchical,
+                          const gmProgram_ *program) {
+  gmUseFrameBufferTexture_(&hierarchical->blocks_frame_buffer, 0);
+  gmSetUniformInt_(program, "u_Blocks", 0);
+
+  // The cost texture is 0 when the cost of the render is not recorded.
+  gmUseFrameBufferCostTexture_(&hierarchical->blocks_frame_buffer, 1);
+  gmSetUniformInt_(program, "u_BlockCosts", 1);
+}
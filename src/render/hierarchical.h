@@ -0,0 +1,14 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "gm/gm.h"
+#include "resources/resources.h"
+
+/**
+ * Renders the image on the render frame-buffer, only running the kernel on the
+ * 8x8 pixel blocks which could not be filled from their corners and edges.
+ */
+void gmRenderImageHierarchically_(const gmResources_ *resources,
+                                  const gmImageConfig *image_config);
@@ -0,0 +1,103 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "iterations.h"
+
+#include <glad/glad.h>
+#include <stdlib.h>
+
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "iteration-file.h"
+#include "render.h"
+#include "resources/program/uniform.h"
+#include "resources/resources.h"
+#include "setup.h"
+
+gmError gmRenderIterationStrips_(gmIterationFile_ *file,
+                                 const gmIterationResources_ *resources,
+                                 const gmImageConfig *image_config);
+
+gmError gmRenderIterationFile_(const char *filepath,
+                               const gmImageConfig *image_config) {
+  gmError error;
+
+  gmIterationResources_ resources;
+  error = gmCreateIterationResources_(&resources);
+  if (!error) {
+    gmIterationFile_ file;
+    error = gmCreateIterationFile_(&file, filepath, image_config);
+    if (!error) {
+      error = gmRenderIterationStrips_(&file, &resources, image_config);
+      error = gmCloseIterationFile_(&file, filepath, error);
+    }
+
+    gmDeleteIterationResources_(&resources);
+  }
+
+  return error;
+}
+
+void gmRenderIterationStrip_(const gmIterationResources_ *resources,
+                             int first_column, int row,
+                             GM_OUT_PARAM float *strip_data);
+
+gmError gmRenderIterationStrips_(gmIterationFile_ *file,
+                                 const gmIterationResources_ *resources,
+                                 const gmImageConfig *image_config) {
+  gmError error = gmError_Success;
+
+  const int kTileSize = GM_ITERATION_FILE_TILE_SIZE;
+  const int kStripWidth = kTileSize * GM_ITERATION_STRIP_TILE_COUNT_;
+  const size_t kRowStride = (size_t)kStripWidth * GM_ITERATION_CHANNEL_COUNT_;
+  float *const kStripData = malloc(kRowStride * kTileSize * sizeof(float));
+
+  gmUseFrameBufferAs_(&resources->strip_frame_buffer,
+                      gmFrameBufferTarget_Framebuffer_);
+
+  glViewport(0, 0, kStripWidth, kTileSize);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+  gmUseModel_(&resources->quad);
+  gmUseProgram_(&resources->program);
+  gmSetKernelUniforms_(&resources->program, image_config);
+
+  const gmIterationFileHeader *const kHeader = &file->header;
+  for (int row = 0; (row < (int)kHeader->tile_row_count) && !error; ++row) {
+    for (int first_column = 0;
+         (first_column < (int)kHeader->tile_column_count) && !error;
+         first_column += GM_ITERATION_STRIP_TILE_COUNT_) {
+      gmRenderIterationStrip_(resources, first_column, row, kStripData);
+
+      for (int i = 0; (i < GM_ITERATION_STRIP_TILE_COUNT_) && !error; ++i) {
+        if (first_column + i < (int)kHeader->tile_column_count) {
+          error = gmWriteIterationTile_(
+              file, first_column + i, row,
+              kStripData + (size_t)i * kTileSize * GM_ITERATION_CHANNEL_COUNT_,
+              kRowStride);
+        }
+      }
+    }
+  }
+
+  gmClearCurrentProgram_();
+  gmClearCurrentModel_();
+  gmClearCurrentFrameBuffer_(gmFrameBufferTarget_Framebuffer_);
+
+  free(kStripData);
+  return error;
+}
+
+void gmRenderIterationStrip_(const gmIterationResources_ *resources,
+                             int first_column, int row,
+                             GM_OUT_PARAM float *strip_data) {
+  const int kTileSize = GM_ITERATION_FILE_TILE_SIZE;
+  const int kStripWidth = kTileSize * GM_ITERATION_STRIP_TILE_COUNT_;
+
+  gmSetUniformInt2_(&resources->program, "u_PixelOffset",
+                    first_column * kTileSize, row * kTileSize);
+  gmDrawQuad_();
+
+  // Waits for the strip, the next one being rendered after writing it.
+  glReadPixels(0, 0, kStripWidth, kTileSize, GL_RG, GL_FLOAT, strip_data);
+}
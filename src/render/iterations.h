@@ -0,0 +1,16 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "setup.h"
+
+/**
+ * Renders the iteration file of the image with the OpenGL backend, strip of
+ * tiles by strip of tiles, writing each strip before rendering the next one.
+ * This function assumes a context is current.
+ */
+gmError gmRenderIterationFile_(const char *filepath,
+                               const gmImageConfig *image_config);
@@ -0,0 +1,109 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "progressive.h"
+
+#include <glad/glad.h>
+#include <stdlib.h>
+
+#include "gm/gm.h"
+#include "render.h"
+#include "resources/program/uniform.h"
+#include "resources/resources.h"
+
+void gmRenderPass_(const gmResources_ *resources,
+                   const gmImageConfig *image_config, size_t pass_index);
+
+void gmComposePasses_(const gmResources_ *resources,
+                      const gmIntSize *image_size, size_t pass_count);
+
+void gmRenderImageProgressively_(const gmResources_ *resources,
+                                 const gmImageConfig *image_config) {
+  const gmIntSize *const kSize = &image_config->size;
+  const gmPreviewConfig *const kPreview = &image_config->preview;
+  unsigned char *const kPreviewData = malloc(kSize->w * kSize->h * 3);  // RGB.
+
+  for (size_t i = 0; i < GM_PROGRESSIVE_PASS_COUNT_; ++i) {
+    gmRenderPass_(resources, image_config, i);
+
+    // The composed image of the last pass is the final image.
+    gmComposePasses_(resources, kSize, i + 1);
+    gmBlitToFinalFrameBuffer_(&resources->render_frame_buffers, kSize);
+
+    gmReadImageData_(kPreviewData, &resources->render_frame_buffers.final,
+                     kSize);
+
+    kPreview->func(kPreviewData, kSize, i, GM_PROGRESSIVE_PASS_COUNT_,
+                   kPreview->user_data);
+  }
+
+  free(kPreviewData);
+}
+
+void gmRenderPass_(const gmResources_ *resources,
+                   const gmImageConfig *image_config, size_t pass_index) {
+  const gmFrameBuffer_ *const kFrameBuffer =
+      &resources->progressive.pass_frame_buffers[pass_index];
+
+  gmIntSize pass_size;
+  gmGetProgressivePassSize_(&pass_size, &image_config->size, pass_index);
+
+  gmUseFrameBufferAs_(kFrameBuffer, gmFramebufferTarget_Draw_);
+  glViewport(0, 0, pass_size.w, pass_size.h);
+
+  // The texels with even coordinates of a pass are the texels of the previous
+  // pass, which has a step twice as large.
+  gmUseModel_(&resources->render_data.quad);
+  gmUseKernelProgram_(&resources->render_data.program, image_config,
+                      8 >> pass_index, pass_index > 0);
+  gmDrawQuad_();
+
+  gmClearCurrentFrameBuffer_(gmFramebufferTarget_Draw_);
+  gmClearCurrentModel_();
+  gmClearCurrentProgram_();
+}
+
+void gmUseComposeProgram_(const gmProgressiveResources_ *progressive,
+                          size_t pass_count);
+
+void gmComposePasses_(const gmResources_ *resources,
+                      const gmIntSize *image_size, size_t pass_count) {
+  gmUseFrameBufferAs_(&resources->render_frame_buffers.render,
+                      gmFramebufferTarget_Draw_);
+  glViewport(0, 0, image_size->w, image_size->h);
+
+  gmUseModel_(&resources->render_data.quad);
+  gmUseComposeProgram_(&resources->progressive, pass_count);
+  gmDrawQuad_();
+
+  gmClearCurrentFrameBuffer_(gmFramebufferTarget_Draw_);
+  gmClearCurrentModel_();
+  gmClearCurrentProgram_();
+}
+
+void gmUseComposeProgram_(const gmProgressiveResources_ *progressive,
+                          size_t pass_count) {
+  const char *const kSamplerNames[GM_PROGRESSIVE_PASS_COUNT_] = {
+      "u_Pass0", "u_Pass1", "u_Pass2", "u_Pass3"};
+
+  const char *const kCostSamplerNames[GM_PROGRESSIVE_PASS_COUNT_] = {
+      "u_PassCost0", "u_PassCost1", "u_PassCost2", "u_PassCost3"};
+
+  const gmProgram_ *const kProgram = &progressive->compose_program;
+  gmUseProgram_(kProgram);
+
+  // Each pass texture is bound to the texture unit of the same index, the
+  // cost textures following them.
+  for (size_t i = 0; i < GM_PROGRESSIVE_PASS_COUNT_; ++i) {
+    const gm_uint kCostUnit = GM_PROGRESSIVE_PASS_COUNT_ + i;
+
+    gmUseFrameBufferTexture_(&progressive->pass_frame_buffers[i], i);
+    gmSetUniformInt_(kProgram, kSamplerNames[i], i);
+
+    gmUseFrameBufferCostTexture_(&progressive->pass_frame_buffers[i],
+                                 kCostUnit);
+    gmSetUniformInt_(kProgram, kCostSamplerNames[i], kCostUnit);
+  }
+
+  gmSetUniformInt_(kProgram, "u_PassCount", pass_count);
+}
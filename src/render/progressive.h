@@ -0,0 +1,15 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "gm/gm.h"
+#include "resources/resources.h"
+
+/**
+ * Renders the image in coarse to fine passes, calling the preview function of
+ * the image config after each of them.  Every pixel is only computed once, by
+ * the first pass whose sampling grid contains it.
+ */
+void gmRenderImageProgressively_(const gmResources_ *resources,
+                                 const gmImageConfig *image_config);
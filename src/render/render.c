@@ -0,0 +1,274 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "render.h"
+
+#include <glad/glad.h>
+#include <stdlib.h>  // For NULL.
+
+#include "clock.h"
+#include "equalization.h"
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "hierarchical.h"
+#include "image-config.h"
+#include "progressive.h"
+#include "resources/program/uniform.h"
+#include "resources/resources.h"
+#include "setup.h"
+#include "stencil.h"
+
+gmError gmRenderImageOnRenderFrameBuffer_(const gmResources_ *resources,
+                                          const gmImageConfig *image_config);
+
+gmError gmRenderImage_(const gmResources_ *resources,
+                       const gmImageConfig *image_config) {
+  if (image_config->preview.func) {
+    gmRenderImageProgressively_(resources, image_config);
+    return gmError_Success;
+  }
+
+  if (gmGetGlAlgorithm_(image_config) == gmGlAlgorithm_Hierarchical) {
+    gmRenderImageHierarchically_(resources, image_config);
+  } else {
+    // Not setting the viewport results in the image not rendering entirely.
+    glViewport(0, 0, image_config->size.w, image_config->size.h);
+
+    const gmError kError =
+        gmRenderImageOnRenderFrameBuffer_(resources, image_config);
+    if (kError) {
+      return kError;
+    }
+  }
+
+  gmBlitToFinalFrameBuffer_(&resources->render_frame_buffers,
+                            &image_config->size);
+
+  // Overwrites the blitted colors.
+  if (gmGetColoringMode_(image_config) == gmColoringMode_Equalized) {
+    gmEqualizeColors_(resources, image_config);
+  }
+
+  return gmError_Success;
+}
+
+gmError gmDrawQuadInChunks_(const gmImageConfig *image_config);
+
+gmError gmRenderImageOnRenderFrameBuffer_(const gmResources_ *resources,
+                                          const gmImageConfig *image_config) {
+  gmUseFrameBufferAs_(&resources->render_frame_buffers.render,
+                      gmFramebufferTarget_Draw_);
+
+  gmUseModel_(&resources->render_data.quad);
+
+  const int kHasRegion = gmHasRegion_(image_config);
+  if (kHasRegion) {
+    // Only the pixels inside the region run the kernel.
+    gmMarkRegion_(resources, image_config);
+
+    glEnable(GL_STENCIL_TEST);
+    glStencilFunc(GL_EQUAL, GM_REGION_STENCIL_VALUE_, 0xFF);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+  }
+
+  gmUseKernelProgram_(&resources->render_data.program, image_config, 1, 0);
+
+  gmError error = gmError_Success;
+  if (image_config->gl.chunk_time > 0.0) {
+    error = gmDrawQuadInChunks_(image_config);
+  } else {
+    gmDrawQuad_();
+  }
+
+  if (kHasRegion) {
+    glDisable(GL_STENCIL_TEST);
+  }
+
+  gmClearCurrentFrameBuffer_(gmFramebufferTarget_Draw_);
+  gmClearCurrentModel_();
+  gmClearCurrentProgram_();
+
+  return error;
+}
+
+/**
+ * Rows of the first band, whose duration sizes the next ones.
+ */
+#define GM_FIRST_CHUNK_ROW_COUNT_ 16
+
+/**
+ * Factor by which a band grows at most from the previous one, the cost of the
+ * rows varying across the image.
+ */
+#define GM_MAX_CHUNK_GROWTH_ 4
+
+void gmWaitForChunk_();
+
+/**
+ * Draws the quad in scissored bands of rows, sizing each band from the
+ * duration of the previous one to last about the chunk time of the config.
+ */
+gmError gmDrawQuadInChunks_(const gmImageConfig *image_config) {
+  const gmGlConfig *const kGl = &image_config->gl;
+  const gmIntSize *const kSize = &image_config->size;
+
+  gmError error = gmError_Success;
+
+  glEnable(GL_SCISSOR_TEST);
+
+  int first_row = 0;
+  int row_count = GM_FIRST_CHUNK_ROW_COUNT_;
+  while (first_row < kSize->h) {
+    if (row_count > kSize->h - first_row) {
+      row_count = kSize->h - first_row;
+    }
+
+    const double kStartTime = gmGetTime_();
+    glScissor(0, first_row, kSize->w, row_count);
+    gmDrawQuad_();
+    gmWaitForChunk_();
+    const double kChunkTime = gmGetTime_() - kStartTime;
+
+    first_row += row_count;
+    if (kGl->progress_func) {
+      kGl->progress_func((double)first_row / kSize->h,
+                         kGl->progress_user_data);
+    }
+
+    if (kGl->cancel_flag &&
+        __atomic_load_n(kGl->cancel_flag, __ATOMIC_RELAXED)) {
+      error = gmError_Canceled;
+      break;
+    }
+
+    const double kNextRowCount =
+        kChunkTime > 0.0 ? row_count * kGl->chunk_time / kChunkTime
+                         : (double)row_count * GM_MAX_CHUNK_GROWTH_;
+    const double kMaxRowCount = (double)row_count * GM_MAX_CHUNK_GROWTH_;
+
+    row_count = (int)(kNextRowCount < kMaxRowCount ? kNextRowCount
+                                                   : kMaxRowCount);
+    row_count = row_count > 0 ? row_count : 1;
+  }
+
+  glDisable(GL_SCISSOR_TEST);
+  return error;
+}
+
+/**
+ * Blocks until the commands issued so far are executed, flushing them.
+ */
+void gmWaitForChunk_() {
+  const GLsync kFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  // Waits by steps of a second, some drivers limiting the timeout.
+  while (glClientWaitSync(kFence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) ==
+         GL_TIMEOUT_EXPIRED) {
+  }
+
+  glDeleteSync(kFence);
+}
+
+void gmUseKernelProgram_(const gmProgram_ *program,
+                         const gmImageConfig *image_config, int step,
+                         int skip_even_texels) {
+  gmUseProgram_(program);
+  gmSetKernelUniforms_(program, image_config);
+
+  gmSetUniformInt_(program, "u_Step", step);
+  gmSetUniformInt_(program, "u_SkipEvenTexels", skip_even_texels);
+}
+
+void gmSetKernelUniforms_(const gmProgram_ *program,
+                          const gmImageConfig *image_config) {
+  gmSetUniformIntSize_(program, "u_ImageSize", &image_config->size);
+
+  gmViewport viewport;
+  gmGetViewport_(&viewport, image_config);
+
+  gmSetUniformFloat2_(program, "u_ViewportOrigin",
+                      viewport.center_x - viewport.width / 2.0,
+                      viewport.center_y - viewport.height / 2.0);
+
+  gmSetUniformFloat2_(program, "u_ViewportSize", viewport.width,
+                      viewport.height);
+
+  gmSetUniformInt_(program, "u_MaxIterations",
+                   gmGetMaxIterationCount_(image_config));
+}
+
+void gmDrawQuad_() {
+  // Hard coded because we're only rendering one quad.
+  glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, NULL);
+}
+
+void gmBlitCostBuffer_(const gmIntSize *image_size);
+
+void gmBlitToFinalFrameBuffer_(const gmRenderFrameBuffers_ *frame_buffers,
+                               const gmIntSize *image_size) {
+  gmUseFrameBufferAs_(&frame_buffers->final, gmFramebufferTarget_Draw_);
+  gmUseFrameBufferAs_(&frame_buffers->render, gmFramebufferTarget_Read_);
+
+  // Equalized renders give the render frame-buffer a cost buffer even when
+  // their cost is not recorded.
+  if (gmHasCostBuffer_(&frame_buffers->final)) {
+    gmBlitCostBuffer_(image_size);
+  }
+
+  glBlitFramebuffer(0, 0, image_size->w, image_size->h, 0, 0, image_size->w,
+                    image_size->h, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+  gmClearCurrentFrameBuffer_(gmFramebufferTarget_Read_);
+  gmClearCurrentFrameBuffer_(gmFramebufferTarget_Draw_);
+}
+
+void gmBlitCostBuffer_(const gmIntSize *image_size) {
+  // A blit writes the read buffer to every draw buffer, the cost buffer is
+  // then blitted alone before restricting the draw buffers to the colors.
+  const GLenum kCostDrawBuffers[] = {GL_NONE, GL_COLOR_ATTACHMENT1};
+  const GLenum kColorDrawBuffers[] = {GL_COLOR_ATTACHMENT0, GL_NONE};
+
+  glReadBuffer(GL_COLOR_ATTACHMENT1);
+  glDrawBuffers(2, kCostDrawBuffers);
+
+  // Costs are not interpolated, the samples of a pixel sharing their cost.
+  glBlitFramebuffer(0, 0, image_size->w, image_size->h, 0, 0, image_size->w,
+                    image_size->h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+  glDrawBuffers(2, kColorDrawBuffers);
+}
+
+void gmReadImageData_(GM_OUT_PARAM void *image_data,
+                      const gmFrameBuffer_ *final_frame_buffer,
+                      const gmIntSize *image_size) {
+  // The image data is tightly packed, rows are 4-byte aligned by default.
+  gmReadImagePixels_(image_data, final_frame_buffer, image_size, GL_RGB, 1);
+}
+
+void gmReadImagePixels_(GM_OUT_PARAM void *pixels,
+                        const gmFrameBuffer_ *final_frame_buffer,
+                        const gmIntSize *image_size, GLenum format,
+                        GLint row_alignment) {
+  // The read buffer is a state of the bound frame-buffer, setting it on the
+  // default one is an error.
+  gmUseFrameBufferAs_(final_frame_buffer, gmFramebufferTarget_Read_);
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+
+  glPixelStorei(GL_PACK_ALIGNMENT, row_alignment);
+
+  glReadPixels(0, 0, image_size->w, image_size->h, format, GL_UNSIGNED_BYTE,
+               pixels);
+}
+
+void gmReadCostData_(GM_OUT_PARAM float *cost_data,
+                     const gmFrameBuffer_ *final_frame_buffer,
+                     const gmIntSize *image_size) {
+  gmUseFrameBufferAs_(final_frame_buffer, gmFramebufferTarget_Read_);
+  glReadBuffer(GL_COLOR_ATTACHMENT1);
+
+  glReadPixels(0, 0, image_size->w, image_size->h, GL_RG, GL_FLOAT, cost_data);
+
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+  gmClearCurrentFrameBuffer_(gmFramebufferTarget_Read_);
+}
@@ -0,0 +1,63 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "resources/resources.h"
+#include "setup.h"
+
+/**
+ * Renders the image on the final frame-buffer of the specified resources,
+ * failing only when a chunked render is canceled.
+ */
+gmError gmRenderImage_(const gmResources_ *resources,
+                       const gmImageConfig *image_config);
+
+/**
+ * Sets the uniforms of the kernel functions shared by the shaders computing
+ * the Mandelbrot set.  This function assumes the program is in use.
+ */
+void gmSetKernelUniforms_(const gmProgram_ *program,
+                          const gmImageConfig *image_config);
+
+/**
+ * Uses the Mandelbrot program, computing one pixel every `step` pixels of the
+ * full size image.  The texels with even coordinates are skipped when
+ * `skip_even_texels` is set.
+ */
+void gmUseKernelProgram_(const gmProgram_ *program,
+                         const gmImageConfig *image_config, int step,
+                         int skip_even_texels);
+
+/**
+ * Draws the quad covering the whole viewport.  This function assumes the quad
+ * model and a program are in use.
+ */
+void gmDrawQuad_();
+
+void gmBlitToFinalFrameBuffer_(const gmRenderFrameBuffers_ *frame_buffers,
+                               const gmIntSize *image_size);
+
+void gmReadImageData_(GM_OUT_PARAM void *image_data,
+                      const gmFrameBuffer_ *final_frame_buffer,
+                      const gmIntSize *image_size);
+
+/**
+ * Reads the image back in the specified pixel format, each row starting at a
+ * multiple of the row alignment.
+ */
+void gmReadImagePixels_(GM_OUT_PARAM void *pixels,
+                        const gmFrameBuffer_ *final_frame_buffer,
+                        const gmIntSize *image_size, GLenum format,
+                        GLint row_alignment);
+
+/**
+ * Reads the cost buffer of the final frame-buffer, two floats per pixel: the
+ * iterations executed for the pixel and its iteration count, -1 outside of the
+ * region.  The rows are in the same order as the image data.
+ */
+void gmReadCostData_(GM_OUT_PARAM float *cost_data,
+                     const gmFrameBuffer_ *final_frame_buffer,
+                     const gmIntSize *image_size);
@@ -0,0 +1,73 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "stencil.h"
+
+#include <glad/glad.h>
+#include <stdlib.h>
+
+#include "gm/gm.h"
+#include "image-config.h"
+#include "region.h"
+#include "render.h"
+#include "resources/program/uniform.h"
+#include "resources/resources.h"
+
+void gmClearOutsideOfRegion_(const gmResources_ *resources,
+                             const gmImageConfig *image_config);
+
+void gmMarkRegion_(const gmResources_ *resources,
+                   const gmImageConfig *image_config) {
+  if (!gmHasRegion_(image_config)) {
+    glClearStencil(GM_REGION_STENCIL_VALUE_);
+    glClear(GL_STENCIL_BUFFER_BIT);
+    glClearStencil(0);
+    return;
+  }
+
+  const gmRegionResources_ *const kRegion = &resources->region;
+
+  gmClearOutsideOfRegion_(resources, image_config);
+  glClear(GL_STENCIL_BUFFER_BIT);
+
+  unsigned char *const kCoverage = gmComputeRegionCoverage_(image_config);
+  gmSetFrameBufferBytes_(&kRegion->coverage_frame_buffer, &image_config->size,
+                         kCoverage);
+  free(kCoverage);
+
+  glEnable(GL_STENCIL_TEST);
+  glStencilFunc(GL_ALWAYS, GM_REGION_STENCIL_VALUE_, 0xFF);
+  glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+
+  // Only the stencil buffer is written.
+  glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+  gmUseProgram_(&kRegion->program);
+  gmUseFrameBufferTexture_(&kRegion->coverage_frame_buffer, 0);
+  gmSetUniformInt_(&kRegion->program, "u_Coverage", 0);
+  gmDrawQuad_();
+
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  glDisable(GL_STENCIL_TEST);
+}
+
+/**
+ * Clears the colors to the background color, and the costs to the cost of the
+ * pixels outside of the region.  The pixels inside it are overwritten by the
+ * render.
+ */
+void gmClearOutsideOfRegion_(const gmResources_ *resources,
+                             const gmImageConfig *image_config) {
+  const unsigned char *const kBackground =
+      image_config->region.background_color;
+
+  const GLfloat kColor[] = {kBackground[0] / 255.0f,
+                            kBackground[1] / 255.0f,
+                            kBackground[2] / 255.0f, 1.0f};
+  glClearBufferfv(GL_COLOR, 0, kColor);
+
+  if (gmHasCostBuffer_(&resources->render_frame_buffers.render)) {
+    const GLfloat kCost[] = {0.0f, -1.0f, 0.0f, 0.0f};
+    glClearBufferfv(GL_COLOR, 1, kCost);
+  }
+}
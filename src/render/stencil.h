@@ -0,0 +1,23 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "gm/gm.h"
+#include "resources/resources.h"
+
+/**
+ * Stencil value of the pixels inside the region of the image.  Hierarchical
+ * renders add the bit below it to the pixels of the filled blocks.
+ */
+#define GM_REGION_STENCIL_VALUE_ 2
+
+/**
+ * Marks the pixels inside the region of the image in the stencil buffer of the
+ * render frame-buffer, every pixel when the image has no region.  The pixels
+ * outside of the region are filled with the background color and given an
+ * iteration count of -1.  This function assumes the render frame-buffer is in
+ * use as draw frame-buffer, along with the quad model.
+ */
+void gmMarkRegion_(const gmResources_ *resources,
+                   const gmImageConfig *image_config);
@@ -25,8 +25,8 @@ void gmCreateRenderBuffer_(
 void gmSetRegularRenderBufferStorage_(const gmIntSize *size, gm_uint unused);
 
 /**
- * Creates the frame-buffer and binds it to its color render-buffer.  This
- * function assumes the render-buffer has already been created.
+ * Creates the frame-buffer and binds it to its color attachment.  This function
+ * assumes the render-buffer or texture has already been created.
  */
 gmError gmCreateColorFrameBuffer_(GM_OUT_PARAM gmFrameBuffer_ *frame_buffer);
 
@@ -34,6 +34,10 @@ gmError gmCreateFrameBuffer_(GM_OUT_PARAM gmFrameBuffer_ *frame_buffer,
                              const gmIntSize *size) {
   gmCreateRenderBuffer_(&frame_buffer->color_render_buffer,
                         gmSetRegularRenderBufferStorage_, size, 0);
+  frame_buffer->color_texture = 0;
+  frame_buffer->stencil_render_buffer = 0;
+  frame_buffer->cost_render_buffer = 0;
+  frame_buffer->cost_texture = 0;
 
   // Deletes the render-buffer on failure.
   return gmCreateColorFrameBuffer_(frame_buffer);
@@ -57,17 +61,112 @@ void gmSetRegularRenderBufferStorage_(const gmIntSize *size, gm_uint unused) {
   glRenderbufferStorage(GL_RENDERBUFFER, GL_RGB, size->w, size->h);
 }
 
+void gmCreateColorTexture_(GM_OUT_PARAM gmId_ *texture, const gmIntSize *size,
+                           gmTextureFormat_ format);
+
+gmError gmCreateTextureFrameBuffer_(GM_OUT_PARAM gmFrameBuffer_ *frame_buffer,
+                                    const gmIntSize *size,
+                                    gmTextureFormat_ format) {
+  gmCreateColorTexture_(&frame_buffer->color_texture, size, format);
+  frame_buffer->color_render_buffer = 0;
+  frame_buffer->stencil_render_buffer = 0;
+  frame_buffer->cost_render_buffer = 0;
+  frame_buffer->cost_texture = 0;
+
+  // Deletes the texture on failure.
+  return gmCreateColorFrameBuffer_(frame_buffer);
+}
+
+void gmCreateColorTexture_(GM_OUT_PARAM gmId_ *texture, const gmIntSize *size,
+                           gmTextureFormat_ format) {
+  glGenTextures(1, texture);
+  glBindTexture(GL_TEXTURE_2D, *texture);
+
+  // NOLINTNEXTLINE
+  switch (format) {
+    case gmTextureFormat_Rgb_:
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, size->w, size->h, 0, GL_RGB,
+                   GL_UNSIGNED_BYTE, NULL);
+      break;
+    case gmTextureFormat_Byte_:
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, size->w, size->h, 0, GL_RED,
+                   GL_UNSIGNED_BYTE, NULL);
+      break;
+    case gmTextureFormat_Int_:
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_R32I, size->w, size->h, 0,
+                   GL_RED_INTEGER, GL_INT, NULL);
+      break;
+    case gmTextureFormat_Int2_:
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32I, size->w, size->h, 0,
+                   GL_RG_INTEGER, GL_INT, NULL);
+      break;
+    case gmTextureFormat_Float_:
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, size->w, size->h, 0, GL_RED,
+                   GL_FLOAT, NULL);
+      break;
+    case gmTextureFormat_Float2_:
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, size->w, size->h, 0, GL_RG,
+                   GL_FLOAT, NULL);
+      break;
+  }
+
+  // The texture has no mipmaps, it would be incomplete with the default
+  // minifying filter.
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  GM_GL_PRINT_ERROR_();
+}
+
 gmError gmCheckFrameBufferStatus_(const gmFrameBuffer_ *frame_buffer,
                                   gmFrameBufferTarget_ target);
 
+gmError gmCreateLayeredFrameBuffer_(GM_OUT_PARAM gmFrameBuffer_ *frame_buffer,
+                                    const gmIntSize *size,
+                                    gm_uint layer_count) {
+  glGenTextures(1, &frame_buffer->color_texture);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, frame_buffer->color_texture);
+
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB8, size->w, size->h,
+               (GLsizei)layer_count, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+  frame_buffer->color_render_buffer = 0;
+  frame_buffer->stencil_render_buffer = 0;
+  frame_buffer->cost_render_buffer = 0;
+  frame_buffer->cost_texture = 0;
+
+  glGenFramebuffers(1, &frame_buffer->id);
+
+  const gmFrameBufferTarget_ kTarget = gmFrameBufferTarget_Framebuffer_;
+  gmUseFrameBufferAs_(frame_buffer, kTarget);
+
+  // Attaching the whole texture makes the frame-buffer layered.
+  glFramebufferTexture(kTarget, GL_COLOR_ATTACHMENT0,
+                       frame_buffer->color_texture, 0);
+
+  GM_GL_PRINT_ERROR_();
+
+  // Deletes the frame-buffer on failure.
+  return gmCheckFrameBufferStatus_(frame_buffer, kTarget);
+}
+
 gmError gmCreateColorFrameBuffer_(GM_OUT_PARAM gmFrameBuffer_ *frame_buffer) {
   glGenFramebuffers(1, &frame_buffer->id);
 
   const gmFrameBufferTarget_ kTarget = gmFrameBufferTarget_Framebuffer_;
   gmUseFrameBufferAs_(frame_buffer, kTarget);
 
-  glFramebufferRenderbuffer(kTarget, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
-                            frame_buffer->color_render_buffer);
+  if (frame_buffer->color_texture) {
+    glFramebufferTexture2D(kTarget, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           frame_buffer->color_texture, 0);
+  } else {
+    glFramebufferRenderbuffer(kTarget, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+                              frame_buffer->color_render_buffer);
+  }
 
   // Deletes the frame-buffer on failure.
   return gmCheckFrameBufferStatus_(frame_buffer, kTarget);
@@ -99,6 +198,10 @@ gmError gmCreateSampledFrameBuffer_(GM_OUT_PARAM gmFrameBuffer_ *frame_buffer,
                                     gm_uint sample_count) {
   gmCreateRenderBuffer_(&frame_buffer->color_render_buffer,
                         gmSetSampledRenderBufferStorage_, size, sample_count);
+  frame_buffer->color_texture = 0;
+  frame_buffer->stencil_render_buffer = 0;
+  frame_buffer->cost_render_buffer = 0;
+  frame_buffer->cost_texture = 0;
 
   // Deletes the render-buffer on failure.
   return gmCreateColorFrameBuffer_(frame_buffer);
@@ -130,9 +233,97 @@ gm_uint gmCheckSampleCountSupport_(gm_uint sample_count) {
   return final_sample_count;
 }
 
+void gmSetSampledStencilBufferStorage_(const gmIntSize *size,
+                                       gm_uint sample_count);
+
+gm_uint gmGetColorRenderBufferSampleCount_(
+    const gmFrameBuffer_ *frame_buffer);
+
+gmError gmAttachStencilBuffer_(gmFrameBuffer_ *frame_buffer,
+                               const gmIntSize *size) {
+  gmCreateRenderBuffer_(&frame_buffer->stencil_render_buffer,
+                        gmSetSampledStencilBufferStorage_, size,
+                        gmGetColorRenderBufferSampleCount_(frame_buffer));
+
+  const gmFrameBufferTarget_ kTarget = gmFrameBufferTarget_Framebuffer_;
+  gmUseFrameBufferAs_(frame_buffer, kTarget);
+
+  glFramebufferRenderbuffer(kTarget, GL_DEPTH_STENCIL_ATTACHMENT,
+                            GL_RENDERBUFFER,
+                            frame_buffer->stencil_render_buffer);
+
+  // Deletes the frame-buffer on failure.
+  return gmCheckFrameBufferStatus_(frame_buffer, kTarget);
+}
+
+gm_uint gmGetColorRenderBufferSampleCount_(
+    const gmFrameBuffer_ *frame_buffer) {
+  int sample_count;
+
+  glBindRenderbuffer(GL_RENDERBUFFER, frame_buffer->color_render_buffer);
+  glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_SAMPLES,
+                               &sample_count);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  return (gm_uint)sample_count;
+}
+
+void gmSetSampledStencilBufferStorage_(const gmIntSize *size,
+                                       gm_uint sample_count) {
+  // Combined depth and stencil formats are the most widely supported ones.
+  glRenderbufferStorageMultisample(GL_RENDERBUFFER, sample_count,
+                                   GL_DEPTH24_STENCIL8, size->w, size->h);
+}
+
+void gmSetSampledCostBufferStorage_(const gmIntSize *size,
+                                    gm_uint sample_count);
+
+gmError gmAttachCostBuffer_(gmFrameBuffer_ *frame_buffer,
+                            const gmIntSize *size) {
+  const gmFrameBufferTarget_ kTarget = gmFrameBufferTarget_Framebuffer_;
+
+  if (frame_buffer->color_texture) {
+    gmCreateColorTexture_(&frame_buffer->cost_texture, size,
+                          gmTextureFormat_Float2_);
+
+    gmUseFrameBufferAs_(frame_buffer, kTarget);
+    glFramebufferTexture2D(kTarget, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D,
+                           frame_buffer->cost_texture, 0);
+  } else {
+    // All the samples of a pixel get the same cost, resolving them keeps it.
+    gmCreateRenderBuffer_(&frame_buffer->cost_render_buffer,
+                          gmSetSampledCostBufferStorage_, size,
+                          gmGetColorRenderBufferSampleCount_(frame_buffer));
+
+    gmUseFrameBufferAs_(frame_buffer, kTarget);
+    glFramebufferRenderbuffer(kTarget, GL_COLOR_ATTACHMENT1, GL_RENDERBUFFER,
+                              frame_buffer->cost_render_buffer);
+  }
+
+  const GLenum kDrawBuffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+  glDrawBuffers(2, kDrawBuffers);
+
+  // Deletes the frame-buffer on failure.
+  return gmCheckFrameBufferStatus_(frame_buffer, kTarget);
+}
+
+void gmSetSampledCostBufferStorage_(const gmIntSize *size,
+                                    gm_uint sample_count) {
+  glRenderbufferStorageMultisample(GL_RENDERBUFFER, sample_count, GL_RG32F,
+                                   size->w, size->h);
+}
+
+int gmHasCostBuffer_(const gmFrameBuffer_ *frame_buffer) {
+  return frame_buffer->cost_render_buffer || frame_buffer->cost_texture;
+}
+
 void gmDeleteFrameBuffer_(const gmFrameBuffer_ *frame_buffer) {
   glDeleteFramebuffers(1, &frame_buffer->id);
   glDeleteRenderbuffers(1, &frame_buffer->color_render_buffer);
+  glDeleteTextures(1, &frame_buffer->color_texture);
+  glDeleteRenderbuffers(1, &frame_buffer->stencil_render_buffer);
+  glDeleteRenderbuffers(1, &frame_buffer->cost_render_buffer);
+  glDeleteTextures(1, &frame_buffer->cost_texture);
 }
 
 void gmClearCurrentFrameBuffer_(gmFrameBufferTarget_ target) {
@@ -143,3 +334,39 @@ void gmUseFrameBufferAs_(const gmFrameBuffer_ *frame_buffer,
                          gmFrameBufferTarget_ target) {
   glBindFramebuffer(target, frame_buffer->id);
 }
+
+void gmUseFrameBufferTexture_(const gmFrameBuffer_ *frame_buffer,
+                              gm_uint texture_unit) {
+  glActiveTexture(GL_TEXTURE0 + texture_unit);
+  glBindTexture(GL_TEXTURE_2D, frame_buffer->color_texture);
+}
+
+void gmUseFrameBufferCostTexture_(const gmFrameBuffer_ *frame_buffer,
+                                  gm_uint texture_unit) {
+  glActiveTexture(GL_TEXTURE0 + texture_unit);
+  glBindTexture(GL_TEXTURE_2D, frame_buffer->cost_texture);
+}
+
+void gmSetFrameBufferBytes_(const gmFrameBuffer_ *frame_buffer,
+                            const gmIntSize *size, const unsigned char *data) {
+  glBindTexture(GL_TEXTURE_2D, frame_buffer->color_texture);
+
+  // Rows are 4-byte aligned by default.
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size->w, size->h, GL_RED,
+                  GL_UNSIGNED_BYTE, data);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void gmReadFrameBufferLayers_(GM_OUT_PARAM unsigned char *data,
+                              const gmFrameBuffer_ *frame_buffer) {
+  glBindTexture(GL_TEXTURE_2D_ARRAY, frame_buffer->color_texture);
+
+  // Rows are 4-byte aligned by default.
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glGetTexImage(GL_TEXTURE_2D_ARRAY, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
@@ -10,18 +10,92 @@
 #include "resources/id.h"
 #include "setup.h"
 
+/**
+ * The color attachment is either a render-buffer or a texture, the unused one
+ * being set to 0.  The stencil and cost attachments are 0 unless they were
+ * attached, the cost attachment being of the same kind as the color one.
+ */
 typedef struct gmFrameBuffer_ {
   gmId_ id;
   gmId_ color_render_buffer;
+  gmId_ color_texture;
+  gmId_ stencil_render_buffer;
+  gmId_ cost_render_buffer;
+  gmId_ cost_texture;
 } gmFrameBuffer_;
 
 gmError gmCreateFrameBuffer_(GM_OUT_PARAM gmFrameBuffer_ *frame_buffer,
                              const gmIntSize *size);
 
+typedef enum gmTextureFormat_ {
+  gmTextureFormat_Rgb_,
+
+  /**
+   * Single normalized unsigned byte channel.
+   */
+  gmTextureFormat_Byte_,
+
+  /**
+   * Single signed integer channel.
+   */
+  gmTextureFormat_Int_,
+
+  /**
+   * Two signed integer channels.
+   */
+  gmTextureFormat_Int2_,
+
+  /**
+   * Single 32-bit float channel.
+   */
+  gmTextureFormat_Float_,
+
+  /**
+   * Two 32-bit float channels.
+   */
+  gmTextureFormat_Float2_
+} gmTextureFormat_;
+
+/**
+ * Creates a frame-buffer whose color attachment can be sampled by shaders.
+ */
+gmError gmCreateTextureFrameBuffer_(GM_OUT_PARAM gmFrameBuffer_ *frame_buffer,
+                                    const gmIntSize *size,
+                                    gmTextureFormat_ format);
+
+/**
+ * Creates a frame-buffer whose color attachment is an RGB array texture of the
+ * specified number of layers, shaders selecting the layer they render to.
+ */
+gmError gmCreateLayeredFrameBuffer_(GM_OUT_PARAM gmFrameBuffer_ *frame_buffer,
+                                    const gmIntSize *size,
+                                    gm_uint layer_count);
+
 gmError gmCreateSampledFrameBuffer_(GM_OUT_PARAM gmFrameBuffer_ *frame_buffer,
                                     const gmIntSize *size,
                                     gm_uint sample_count);
 
+/**
+ * Attaches a stencil buffer with the same sample count as the color
+ * render-buffer of the specified frame-buffer.  The frame-buffer is deleted on
+ * failure.
+ */
+gmError gmAttachStencilBuffer_(gmFrameBuffer_ *frame_buffer,
+                               const gmIntSize *size);
+
+/**
+ * Attaches a second color buffer, receiving the iterations executed for each
+ * pixel and its iteration count in two float channels.  Shaders write it with
+ * their output of location 1.  The frame-buffer is deleted on failure.
+ */
+gmError gmAttachCostBuffer_(gmFrameBuffer_ *frame_buffer,
+                            const gmIntSize *size);
+
+/**
+ * @return Whether a cost buffer was attached to the frame-buffer.
+ */
+int gmHasCostBuffer_(const gmFrameBuffer_ *frame_buffer);
+
 void gmDeleteFrameBuffer_(const gmFrameBuffer_ *frame_buffer);
 
 typedef enum gmFrameBufferTarget_ {
@@ -38,3 +112,31 @@ void gmClearCurrentFrameBuffer_(gmFrameBufferTarget_ target);
 
 void gmUseFrameBufferAs_(const gmFrameBuffer_ *frame_buffer,
                          gmFrameBufferTarget_ target);
+
+/**
+ * Binds the color texture of the specified frame-buffer to the specified
+ * texture unit.
+ */
+void gmUseFrameBufferTexture_(const gmFrameBuffer_ *frame_buffer,
+                              gm_uint texture_unit);
+
+/**
+ * Binds the cost texture of the specified frame-buffer to the specified
+ * texture unit.
+ */
+void gmUseFrameBufferCostTexture_(const gmFrameBuffer_ *frame_buffer,
+                                  gm_uint texture_unit);
+
+/**
+ * Reads back every layer of the color texture of the specified layered
+ * frame-buffer at once, as tightly packed RGB data.
+ */
+void gmReadFrameBufferLayers_(GM_OUT_PARAM unsigned char *data,
+                              const gmFrameBuffer_ *frame_buffer);
+
+/**
+ * Replaces the content of the color texture of the specified frame-buffer,
+ * created with the byte format, with tightly packed bytes.
+ */
+void gmSetFrameBufferBytes_(const gmFrameBuffer_ *frame_buffer,
+                            const gmIntSize *size, const unsigned char *data);
@@ -17,7 +17,8 @@ void gmDeleteBuffers_(size_t count, const gmBuffer_ *buffers);
 
 typedef enum gmBufferTarget_ {
   gmBufferTarget_Vertex_ = GL_ARRAY_BUFFER,
-  gmBufferTarget_Index_ = GL_ELEMENT_ARRAY_BUFFER
+  gmBufferTarget_Index_ = GL_ELEMENT_ARRAY_BUFFER,
+  gmBufferTarget_Uniform_ = GL_UNIFORM_BUFFER
 } gmBufferTarget_;
 
 void gmClearCurrentBuffer_(gmBufferTarget_ type);
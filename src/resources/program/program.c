@@ -15,21 +15,29 @@ gmError gmCheckProgramLinkStatus(const gmProgram_ *program);
 
 typedef struct gmProgramShaders_ {
   gmShader_ vertex;
+
+  /**
+   * 0 without geometry shader.
+   */
+  gmShader_ geometry;
+
   gmShader_ fragment;
 } gmProgramShaders_;
 
-gmError gmCreateProgramShaders_(GM_OUT_PARAM gmProgramShaders_ *shaders);
+gmError gmCreateProgramShaders_(GM_OUT_PARAM gmProgramShaders_ *shaders,
+                                const gmProgramSources_ *sources);
 
 gmError gmLinkProgram_(GM_OUT_PARAM gmProgram_ *program,
                        const gmProgramShaders_ *shaders);
 
 void gmDeleteProgramShaders_(const gmProgramShaders_ *shaders);
 
-gmError gmCreateProgram_(GM_OUT_PARAM gmProgram_ *program) {
+gmError gmCreateProgram_(GM_OUT_PARAM gmProgram_ *program,
+                         const gmProgramSources_ *sources) {
   gmError error;
 
   gmProgramShaders_ shaders;
-  error = gmCreateProgramShaders_(&shaders);
+  error = gmCreateProgramShaders_(&shaders, sources);
   if (!error) {
     error = gmLinkProgram_(program, &shaders);
     gmDeleteProgramShaders_(&shaders);  // Don't need the shaders anymore.
@@ -40,19 +48,28 @@ gmError gmCreateProgram_(GM_OUT_PARAM gmProgram_ *program) {
   return error;
 }
 
-// These files contain the shader sources.
-#include "shaders/shaders.h"
-
-gmError gmCreateProgramShaders_(GM_OUT_PARAM gmProgramShaders_ *shaders) {
+gmError gmCreateProgramShaders_(GM_OUT_PARAM gmProgramShaders_ *shaders,
+                                const gmProgramSources_ *sources) {
   gmError error;
 
+  shaders->geometry = 0;
+
   error = gmCreateShader_(&shaders->vertex, gmShaderType_Vertex_,
-                          kGmVertexShaderSource_);
+                          sources->vertex);
+  if (!error && sources->geometry) {
+    error = gmCreateShader_(&shaders->geometry, gmShaderType_Geometry_,
+                            sources->geometry);
+    if (error) {
+      gmDeleteShader_(&shaders->vertex);
+    }
+  }
+
   if (!error) {
     error = gmCreateShader_(&shaders->fragment, gmShaderType_Fragment_,
-                            kGmFragmentShaderSource_);
+                            sources->fragment);
     if (error) {
       gmDeleteShader_(&shaders->vertex);
+      gmDeleteShader_(&shaders->geometry);
     }
   }
 
@@ -64,6 +81,9 @@ gmError gmLinkProgram_(GM_OUT_PARAM gmProgram_ *program,
   *program = glCreateProgram();
 
   glAttachShader(*program, shaders->vertex);
+  if (shaders->geometry) {
+    glAttachShader(*program, shaders->geometry);
+  }
   glAttachShader(*program, shaders->fragment);
 
   glLinkProgram(*program);
@@ -77,6 +97,7 @@ gmError gmLinkProgram_(GM_OUT_PARAM gmProgram_ *program,
 
 void gmDeleteProgramShaders_(const gmProgramShaders_ *shaders) {
   gmDeleteShader_(&shaders->vertex);
+  gmDeleteShader_(&shaders->geometry);
   gmDeleteShader_(&shaders->fragment);
 }
 
@@ -9,7 +9,19 @@
 
 typedef gmId_ gmProgram_;
 
-gmError gmCreateProgram_(GM_OUT_PARAM gmProgram_ *program);
+typedef struct gmProgramSources_ {
+  const char *vertex;
+
+  /**
+   * Optional, NULL when the program has no geometry shader.
+   */
+  const char *geometry;
+
+  const char *fragment;
+} gmProgramSources_;
+
+gmError gmCreateProgram_(GM_OUT_PARAM gmProgram_ *program,
+                         const gmProgramSources_ *sources);
 void gmDeleteProgram_(const gmProgram_ *program);
 
 void gmClearCurrentProgram_();
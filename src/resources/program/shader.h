@@ -13,6 +13,7 @@ typedef gmId_ gmShader_;
 
 typedef enum gmShaderType_ {
   gmShaderType_Vertex_ = GL_VERTEX_SHADER,
+  gmShaderType_Geometry_ = GL_GEOMETRY_SHADER,
   gmShaderType_Fragment_ = GL_FRAGMENT_SHADER
 } gmShaderType_;
 
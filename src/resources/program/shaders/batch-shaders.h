@@ -0,0 +1,82 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "kernel.h"
+
+// Shaders of the batch renders, which draw one instance of the quad per image
+// into the layers of an array texture.  Each image reads its viewport and
+// Julia constant from the uniform block, at the index of its layer.
+
+// Size of the arrays of the uniform block, `GM_MAX_BATCH_LAYER_COUNT_`.
+#define GM_GLSL_MAX_BATCH_LAYER_COUNT_ "256"
+
+// clang-format off
+const char *const kGmBatchVertexShaderSource_ =
+    "#version 330 core\n"
+
+    "layout (location = 0) in vec2 a_Position;\n"
+
+    "flat out int v_Layer;\n"
+
+    "void main() {\n"
+      "gl_Position = vec4(a_Position, 0.0, 1.0);\n"
+      "v_Layer = gl_InstanceID;\n"
+    "}\n";
+
+// Sends the triangles of each instance to its layer, which vertex shaders
+// can't select in OpenGL 3.3.
+const char *const kGmBatchGeometryShaderSource_ =
+    "#version 330 core\n"
+
+    "layout (triangles) in;\n"
+    "layout (triangle_strip, max_vertices = 3) out;\n"
+
+    "flat in int v_Layer[];\n"
+    "flat out int g_Layer;\n"
+
+    "void main() {\n"
+      "for (int i = 0; i < 3; ++i) {\n"
+        "gl_Position = gl_in[i].gl_Position;\n"
+        "gl_Layer = v_Layer[0];\n"
+        "g_Layer = v_Layer[0];\n"
+        "EmitVertex();\n"
+      "}\n"
+
+      "EndPrimitive();\n"
+    "}\n";
+
+const char *const kGmBatchFragmentShaderSource_ =
+    "#version 330 core\n"
+
+    GM_GLSL_KERNEL_FUNCTIONS_
+    GM_GLSL_COLOR_FUNCTIONS_
+
+    "layout (location = 0) out vec4 f_Color;\n"
+
+    // Bottom left corner and size of the viewport of each image, then its
+    // Julia constant and whether it is a Julia set.
+    "layout (std140) uniform Images {\n"
+      "vec4 u_Viewports[" GM_GLSL_MAX_BATCH_LAYER_COUNT_ "];\n"
+      "vec4 u_JuliaConstants[" GM_GLSL_MAX_BATCH_LAYER_COUNT_ "];\n"
+    "};\n"
+
+    "flat in int g_Layer;\n"
+
+    "void main() {\n"
+      "vec4 viewport = u_Viewports[g_Layer];\n"
+      "vec4 julia = u_JuliaConstants[g_Layer];\n"
+
+      "vec2 uv = (vec2(ivec2(gl_FragCoord.xy)) + 0.5) / vec2(u_ImageSize);\n"
+      "vec2 point = viewport.xy + uv * viewport.zw;\n"
+
+      "float squared_magnitude;\n"
+      "int executed_count;\n"
+      "int iterations =\n"
+          "ComputeOrbitData(point, julia.z != 0.0 ? julia.xy : point,\n"
+                           "squared_magnitude, executed_count);\n"
+
+      "f_Color = IterationCountToColor(iterations);\n"
+    "}\n";
+// clang-format on
@@ -0,0 +1,56 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+// Assembles the passes of a progressive render into the full size image.  Each
+// pixel takes the color and cost of the nearest computed pixel, looking them
+// up in the coarsest pass that computed it.
+
+// clang-format off
+const char *const kGmComposeFragmentShaderSource_ =
+    "#version 330 core\n"
+
+    "layout (location = 0) out vec4 f_Color;\n"
+    "layout (location = 1) out vec2 f_Cost;\n"
+
+    // Passes computed every 8, 4, 2 and 1 pixels respectively.
+    "uniform sampler2D u_Pass0;\n"
+    "uniform sampler2D u_Pass1;\n"
+    "uniform sampler2D u_Pass2;\n"
+    "uniform sampler2D u_Pass3;\n"
+
+    // Costs of the passes, only bound when recording the cost of the render.
+    "uniform sampler2D u_PassCost0;\n"
+    "uniform sampler2D u_PassCost1;\n"
+    "uniform sampler2D u_PassCost2;\n"
+    "uniform sampler2D u_PassCost3;\n"
+
+    "uniform int u_PassCount;\n"
+
+    "bool IsOnGrid(ivec2 pixel, int step) {\n"
+      "return (pixel.x % step == 0) && (pixel.y % step == 0);\n"
+    "}\n"
+
+    "void main() {\n"
+      "ivec2 pixel = ivec2(gl_FragCoord.xy);\n"
+
+      // The nearest pixel computed by the passes rendered so far.
+      "int step = 8 >> (u_PassCount - 1);\n"
+      "ivec2 anchor = pixel - pixel % step;\n"
+
+      "if (IsOnGrid(anchor, 8)) {\n"
+        "f_Color = texelFetch(u_Pass0, anchor / 8, 0);\n"
+        "f_Cost = texelFetch(u_PassCost0, anchor / 8, 0).rg;\n"
+      "} else if (IsOnGrid(anchor, 4)) {\n"
+        "f_Color = texelFetch(u_Pass1, anchor / 4, 0);\n"
+        "f_Cost = texelFetch(u_PassCost1, anchor / 4, 0).rg;\n"
+      "} else if (IsOnGrid(anchor, 2)) {\n"
+        "f_Color = texelFetch(u_Pass2, anchor / 2, 0);\n"
+        "f_Cost = texelFetch(u_PassCost2, anchor / 2, 0).rg;\n"
+      "} else {\n"
+        "f_Color = texelFetch(u_Pass3, anchor, 0);\n"
+        "f_Cost = texelFetch(u_PassCost3, anchor, 0).rg;\n"
+      "}\n"
+    "}\n";
+// clang-format on
@@ -0,0 +1,125 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "kernel.h"
+
+// Shaders of the equalized coloring, which builds the histogram of the
+// iteration counts of the escaping pixels, sums it up and colors each pixel
+// with the share of the escaping pixels escaping in as many iterations or
+// fewer.
+
+// clang-format off
+
+// Draws one point per pixel, on the texel of the bin of its iteration count,
+// the points being added up by blending.  Each row of the histogram counts
+// `u_RowPixelCount` pixels at most, which its floats count exactly.  The points
+// of the pixels inside the set or outside of the region are moved outside of
+// the viewport.
+const char *const kGmHistogramVertexShaderSource_ =
+    "#version 330 core\n"
+
+    "uniform sampler2D u_Counts;\n"
+    "uniform int u_MaxIterations;\n"
+    "uniform int u_BinWidth;\n"
+    "uniform int u_BinCount;\n"
+    "uniform int u_RowPixelCount;\n"
+    "uniform int u_RowCount;\n"
+
+    "void main() {\n"
+      "int columns = textureSize(u_Counts, 0).x;\n"
+      "ivec2 pixel = ivec2(gl_InstanceID % columns, gl_InstanceID / columns);\n"
+      "float count = texelFetch(u_Counts, pixel, 0).g;\n"
+      "int iterations = int(count + 0.5);\n"
+
+      "if ((count < 0.0) || (iterations >= u_MaxIterations)) {\n"
+        "gl_Position = vec4(-2.0, 0.0, 0.0, 1.0);\n"
+        "return;\n"
+      "}\n"
+
+      "float x = (float(iterations / u_BinWidth) + 0.5) / float(u_BinCount);\n"
+      "int row = gl_InstanceID / u_RowPixelCount;\n"
+      "float y = (float(row) + 0.5) / float(u_RowCount);\n"
+      "gl_Position = vec4(x * 2.0 - 1.0, y * 2.0 - 1.0, 0.0, 1.0);\n"
+    "}\n";
+
+const char *const kGmHistogramFragmentShaderSource_ =
+    "#version 330 core\n"
+
+    "out float f_Count;\n"
+
+    "void main() {\n"
+      "f_Count = 1.0;\n"
+    "}\n";
+
+// One pass of the prefix sum of the bins, adding the bin `u_Offset` bins
+// before each bin.  The offset doubles with each pass.  The first pass also
+// adds up the `u_RowCount` rows of the histogram, the others reading a single
+// row.
+const char *const kGmPrefixSumFragmentShaderSource_ =
+    "#version 330 core\n"
+
+    "out float f_Sum;\n"
+
+    "uniform sampler2D u_Bins;\n"
+    "uniform int u_Offset;\n"
+    "uniform int u_RowCount;\n"
+
+    "void main() {\n"
+      "int bin = int(gl_FragCoord.x);\n"
+      "f_Sum = 0.0;\n"
+
+      "for (int row = 0; row < u_RowCount; ++row) {\n"
+        "f_Sum += texelFetch(u_Bins, ivec2(bin, row), 0).r;\n"
+
+        "if (bin >= u_Offset) {\n"
+          "f_Sum += texelFetch(u_Bins, ivec2(bin - u_Offset, row), 0).r;\n"
+        "}\n"
+      "}\n"
+    "}\n";
+
+const char *const kGmPaletteFragmentShaderSource_ =
+    "#version 330 core\n"
+
+    "uniform int u_MaxIterations;\n"
+
+    GM_GLSL_COLOR_FUNCTIONS_
+
+    "out vec4 f_Color;\n"
+
+    "uniform sampler2D u_Counts;\n"
+
+    // Prefix sums of the bins, the last one counting every escaping pixel.
+    "uniform sampler2D u_Cdf;\n"
+    "uniform int u_BinWidth;\n"
+
+    "void main() {\n"
+      "ivec2 pixel = ivec2(gl_FragCoord.xy);\n"
+      "float count = texelFetch(u_Counts, pixel, 0).g;\n"
+      "int iterations = int(count + 0.5);\n"
+
+      // Keeps the background color outside of the region.
+      "if (count < 0.0) {\n"
+        "discard;\n"
+      "}\n"
+
+      "if (iterations >= u_MaxIterations) {\n"
+        "f_Color = vec4(0.0);\n"
+        "return;\n"
+      "}\n"
+
+      "int last_bin = textureSize(u_Cdf, 0).x - 1;\n"
+      "float total = texelFetch(u_Cdf, ivec2(last_bin, 0), 0).r;\n"
+
+      // The iteration counts of a bin spread its share evenly.
+      "int bin = iterations / u_BinWidth;\n"
+      "float previous =\n"
+          "(bin > 0) ? texelFetch(u_Cdf, ivec2(bin - 1, 0), 0).r : 0.0;\n"
+      "float share = float(iterations % u_BinWidth + 1) / float(u_BinWidth);\n"
+      "float cdf = mix(previous, texelFetch(u_Cdf, ivec2(bin, 0), 0).r,\n"
+                      "share);\n"
+
+      "f_Color = vec4(HsvToRgb(vec3(cdf / total, 0.9, 1.0)), 1.0);\n"
+    "}\n";
+// clang-format on
@@ -0,0 +1,210 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "kernel.h"
+
+// Shaders of the hierarchical render, which fills the 8x8 pixel blocks whose
+// corners and edges all have the same iteration count without running the
+// kernel on their pixels.
+
+// clang-format off
+
+// Share of the cost of classifying a block paid by each of its pixels inside
+// the image, when recording the cost of the render.
+#define GM_GLSL_BLOCK_COST_FUNCTIONS_ \
+    "uniform sampler2D u_BlockCosts;\n" \
+    \
+    "float GetBlockPixelCost(ivec2 block) {\n" \
+      "ivec2 size = min(ivec2(8), u_ImageSize - block * 8);\n" \
+      "float block_cost = texelFetch(u_BlockCosts, block, 0).r;\n" \
+      "return block_cost / float(size.x * size.y);\n" \
+    "}\n"
+
+// Computes the iteration count of the block corners and the iterations
+// executed for them, rendered at 1/8 of the image resolution plus one texel
+// for the far corners of the last blocks.
+const char *const kGmBlockCornersFragmentShaderSource_ =
+    "#version 330 core\n"
+
+    GM_GLSL_KERNEL_FUNCTIONS_
+
+    "out ivec2 f_Corner;\n"
+
+    "void main() {\n"
+      "ivec2 corner = ivec2(gl_FragCoord.xy);\n"
+
+      "int executed_count;\n"
+      "int iterations =\n"
+          "ComputeIterationCount(PixelToPoint(corner * 8), executed_count);\n"
+      "f_Corner = ivec2(iterations, executed_count);\n"
+    "}\n";
+
+// Outputs the iteration count of the blocks whose corners and edge samples
+// agree, and -1 for the other blocks.  Rendered at 1/8 of the image resolution.
+const char *const kGmClassifyBlocksFragmentShaderSource_ =
+    "#version 330 core\n"
+
+    GM_GLSL_KERNEL_FUNCTIONS_
+
+    "layout (location = 0) out int f_IterationCount;\n"
+
+    // Iterations executed for the corners and edge samples of the block.
+    "layout (location = 1) out vec2 f_Cost;\n"
+
+    "uniform isampler2D u_Corners;\n"
+
+    "int GetCorner(ivec2 corner) {\n"
+      "return texelFetch(u_Corners, corner, 0).r;\n"
+    "}\n"
+
+    "float GetCornerCost(ivec2 corner) {\n"
+      "return float(texelFetch(u_Corners, corner, 0).g);\n"
+    "}\n"
+
+    // Each block owns its bottom left corner, the blocks of the last column
+    // and row also owning the far corners.
+    "float GetCornersCost(ivec2 block) {\n"
+      "ivec2 last_block = textureSize(u_Corners, 0) - 2;\n"
+      "float cost = GetCornerCost(block);\n"
+
+      "if (block.x == last_block.x) {\n"
+        "cost += GetCornerCost(block + ivec2(1, 0));\n"
+      "}\n"
+
+      "if (block.y == last_block.y) {\n"
+        "cost += GetCornerCost(block + ivec2(0, 1));\n"
+      "}\n"
+
+      "if (block == last_block) {\n"
+        "cost += GetCornerCost(block + ivec2(1, 1));\n"
+      "}\n"
+
+      "return cost;\n"
+    "}\n"
+
+    "bool IsUniformEdge(ivec2 start, ivec2 direction, int iterations,\n"
+                       "inout float cost) {\n"
+      "for (int i = 2; i < 8; i += 2) {\n"
+        "int executed_count;\n"
+        "int sample_iterations = ComputeIterationCount(\n"
+            "PixelToPoint(start + direction * i), executed_count);\n"
+
+        "cost += float(executed_count);\n"
+        "if (sample_iterations != iterations) {\n"
+          "return false;\n"
+        "}\n"
+      "}\n"
+
+      "return true;\n"
+    "}\n"
+
+    "void main() {\n"
+      "ivec2 block = ivec2(gl_FragCoord.xy);\n"
+
+      "int iterations = GetCorner(block);\n"
+      "float cost = GetCornersCost(block);\n"
+      "f_IterationCount = -1;\n"
+
+      "if ((GetCorner(block + ivec2(1, 0)) != iterations) ||\n"
+          "(GetCorner(block + ivec2(0, 1)) != iterations) ||\n"
+          "(GetCorner(block + ivec2(1, 1)) != iterations)) {\n"
+        "f_Cost = vec2(cost, 0.0);\n"
+        "return;\n"
+      "}\n"
+
+      // Edges are only sampled once the corners agree.
+      "ivec2 origin = block * 8;\n"
+      "if (IsUniformEdge(origin, ivec2(1, 0), iterations, cost) &&\n"
+          "IsUniformEdge(origin, ivec2(0, 1), iterations, cost) &&\n"
+          "IsUniformEdge(origin + ivec2(8, 0), ivec2(0, 1), iterations,\n"
+                        "cost) &&\n"
+          "IsUniformEdge(origin + ivec2(0, 8), ivec2(1, 0), iterations,\n"
+                        "cost)) {\n"
+        "f_IterationCount = iterations;\n"
+      "}\n"
+
+      "f_Cost = vec2(cost, 0.0);\n"
+    "}\n";
+
+// Draws one instance of the quad per block, collapsing the instances of the
+// blocks which are not uniform so that they don't produce any fragment.
+const char *const kGmFillBlocksVertexShaderSource_ =
+    "#version 330 core\n"
+
+    "layout (location = 0) in vec2 a_Position;\n"
+
+    "flat out int v_IterationCount;\n"
+    "flat out float v_PixelCost;\n"
+
+    "uniform ivec2 u_ImageSize;\n"
+    "uniform isampler2D u_Blocks;\n"
+
+    GM_GLSL_BLOCK_COST_FUNCTIONS_
+
+    "void main() {\n"
+      "int columns = textureSize(u_Blocks, 0).x;\n"
+      "ivec2 block = ivec2(gl_InstanceID % columns, gl_InstanceID / columns);\n"
+
+      "v_IterationCount = texelFetch(u_Blocks, block, 0).r;\n"
+      "v_PixelCost = GetBlockPixelCost(block);\n"
+      "if (v_IterationCount < 0) {\n"
+        "gl_Position = vec4(0.0, 0.0, 0.0, 1.0);\n"
+        "return;\n"
+      "}\n"
+
+      "vec2 pixel = (vec2(block) + (a_Position * 0.5 + 0.5)) * 8.0;\n"
+      "gl_Position = vec4(pixel / vec2(u_ImageSize) * 2.0 - 1.0, 0.0, 1.0);\n"
+    "}\n";
+
+// Runs the kernel on the pixels of the blocks which were not filled.  These
+// blocks are masked by the stencil test, which some implementations only run
+// after the fragment shader, so the shader also skips them itself.
+const char *const kGmRemainingPixelsFragmentShaderSource_ =
+    "#version 330 core\n"
+
+    GM_GLSL_KERNEL_FUNCTIONS_
+    GM_GLSL_COLOR_FUNCTIONS_
+    GM_GLSL_BLOCK_COST_FUNCTIONS_
+
+    "layout (location = 0) out vec4 f_Color;\n"
+    "layout (location = 1) out vec2 f_Cost;\n"
+
+    "uniform isampler2D u_Blocks;\n"
+
+    "void main() {\n"
+      "ivec2 pixel = ivec2(gl_FragCoord.xy);\n"
+
+      "if (texelFetch(u_Blocks, pixel / 8, 0).r >= 0) {\n"
+        "f_Color = vec4(0.0);\n"
+        "f_Cost = vec2(0.0);\n"
+        "return;\n"
+      "}\n"
+
+      "int executed_count;\n"
+      "int iterations =\n"
+          "ComputeIterationCount(PixelToPoint(pixel), executed_count);\n"
+      "f_Color = IterationCountToColor(iterations);\n"
+      "f_Cost = vec2(float(executed_count) + GetBlockPixelCost(pixel / 8),\n"
+                    "float(iterations));\n"
+    "}\n";
+
+const char *const kGmFillBlocksFragmentShaderSource_ =
+    "#version 330 core\n"
+
+    "uniform int u_MaxIterations;\n"
+
+    GM_GLSL_COLOR_FUNCTIONS_
+
+    "flat in int v_IterationCount;\n"
+    "flat in float v_PixelCost;\n"
+
+    "layout (location = 0) out vec4 f_Color;\n"
+    "layout (location = 1) out vec2 f_Cost;\n"
+
+    "void main() {\n"
+      "f_Color = IterationCountToColor(v_IterationCount);\n"
+      "f_Cost = vec2(v_PixelCost, float(v_IterationCount));\n"
+    "}\n";
+// clang-format on
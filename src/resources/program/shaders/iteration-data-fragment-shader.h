@@ -0,0 +1,29 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "kernel.h"
+
+// clang-format off
+const char *const kGmIterationDataFragmentShaderSource_ =
+    "#version 330 core\n"
+
+    GM_GLSL_KERNEL_FUNCTIONS_
+
+    // Iteration count and squared magnitude of the last point of the orbit.
+    "out vec2 f_Data;\n"
+
+    // Pixel of the full size image drawn at the bottom left of the
+    // frame-buffer, which holds a strip of tiles.
+    "uniform ivec2 u_PixelOffset;\n"
+
+    "void main() {\n"
+      "vec2 c = PixelToPoint(ivec2(gl_FragCoord.xy) + u_PixelOffset);\n"
+
+      "float squared_magnitude;\n"
+      "int i = ComputeIterationData(c, squared_magnitude);\n"
+
+      "f_Data = vec2(float(i), squared_magnitude);\n"
+    "}\n";
+// clang-format on
@@ -0,0 +1,111 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+// GLSL functions shared by the shaders computing the Mandelbrot set, inserted
+// right after the version directive.  Their uniforms are set by
+// `gmSetKernelUniforms_`.
+
+// clang-format off
+#define GM_GLSL_KERNEL_FUNCTIONS_ \
+    "uniform ivec2 u_ImageSize;\n" \
+    \
+    /* Bottom left corner and size of the viewport in the complex plane. */ \
+    "uniform vec2 u_ViewportOrigin;\n" \
+    "uniform vec2 u_ViewportSize;\n" \
+    \
+    "uniform int u_MaxIterations;\n" \
+    \
+    "vec2 ComplexMultiply(vec2 a, vec2 b) {\n" \
+      "return vec2(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);\n" \
+    "}\n" \
+    \
+    "vec2 ComplexSquare(vec2 z) {\n" \
+      "return ComplexMultiply(z, z);\n" \
+    "}\n" \
+    \
+    "float ComplexSquareMag(vec2 z) {\n" \
+      "return z.x * z.x + z.y * z.y;\n" \
+    "}\n" \
+    \
+    /* The point sampled by the center of a pixel of the full size image. */ \
+    "vec2 PixelToPoint(ivec2 pixel) {\n" \
+      "vec2 uv = (vec2(pixel) + 0.5) / vec2(u_ImageSize);\n" \
+      "return u_ViewportOrigin + uv * u_ViewportSize;\n" \
+    "}\n" \
+    \
+    /* Iterates by blocks of 4 iterations, only testing the escape at the */ \
+    /* end of each block.  The block in which the orbit escaped is iterated */ \
+    /* again one iteration at a time from its start, so that the result is */ \
+    /* the same as testing every iteration.  The iterations keep the */ \
+    /* expression of the complex square, which drivers contract into the */ \
+    /* same fused multiply-adds as before.  Orbits start at `z`, which is */ \
+    /* `c` for the Mandelbrot set and the pixel's point for Julia sets. */ \
+    /* The executed count includes the block iterated twice, for costs. */ \
+    "int ComputeOrbitData(vec2 z, vec2 c, out float squared_magnitude,\n" \
+                         "out int executed_count) {\n" \
+      "int i = 0;\n" \
+      "int rolled_back_count = 0;\n" \
+      "for (; (u_MaxIterations - i >= 4) && (ComplexSquareMag(z) < 16.0);\n" \
+           "i += 4) {\n" \
+        "vec2 block_z = z;\n" \
+        \
+        "z = ComplexSquare(z) + c;\n" \
+        "z = ComplexSquare(z) + c;\n" \
+        "z = ComplexSquare(z) + c;\n" \
+        "z = ComplexSquare(z) + c;\n" \
+        \
+        "if (!(ComplexSquareMag(z) < 16.0)) {\n" \
+          "z = block_z;\n" \
+          "rolled_back_count = 4;\n" \
+          "break;\n" \
+        "}\n" \
+      "}\n" \
+      \
+      "for (; (i < u_MaxIterations) && (ComplexSquareMag(z) < 16.0); ++i) {\n" \
+        "z = ComplexSquare(z) + c;\n" \
+      "}\n" \
+      \
+      "squared_magnitude = ComplexSquareMag(z);\n" \
+      "executed_count = i + rolled_back_count;\n" \
+      "return i;\n" \
+    "}\n" \
+    \
+    "int ComputeIterationData(vec2 c, out float squared_magnitude) {\n" \
+      "int executed_count;\n" \
+      "return ComputeOrbitData(c, c, squared_magnitude, executed_count);\n" \
+    "}\n" \
+    \
+    "int ComputeIterationCount(vec2 c, out int executed_count) {\n" \
+      "float squared_magnitude;\n" \
+      "return ComputeOrbitData(c, c, squared_magnitude, executed_count);\n" \
+    "}\n" \
+    \
+    "int ComputeIterationCount(vec2 c) {\n" \
+      "int executed_count;\n" \
+      "return ComputeIterationCount(c, executed_count);\n" \
+    "}\n"
+
+#define GM_GLSL_COLOR_FUNCTIONS_ \
+    "vec3 HsvToRgb(vec3 hsv) {\n" \
+      "vec4 K = vec4(1.0, 2.0 / 3.0, 1.0 / 3.0, 3.0);\n" \
+      "vec3 p = abs(fract(hsv.xxx + K.xyz) * 6.0 - K.www);\n" \
+      "return hsv.z * mix(K.xxx, clamp(p - K.xxx, 0.0, 1.0), hsv.y);\n" \
+    "}\n" \
+    \
+    "vec3 IterToRgb(int iterations) {\n" \
+      "int h_deg = iterations % 360;\n" \
+      "vec3 hsv = vec3(float(h_deg) / 360.0, 0.9, 1.0);\n" \
+      "return HsvToRgb(hsv);\n" \
+    "}\n" \
+    \
+    /* Points inside the set are black. */ \
+    "vec4 IterationCountToColor(int iterations) {\n" \
+      "if (iterations == u_MaxIterations) {\n" \
+        "return vec4(0.0);\n" \
+      "}\n" \
+      \
+      "return vec4(IterToRgb(iterations), 1.0);\n" \
+    "}\n"
+// clang-format on
@@ -0,0 +1,20 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+// Discards the fragments outside of the region, so that only the pixels inside
+// it are marked in the stencil buffer.
+
+// clang-format off
+const char *const kGmRegionFragmentShaderSource_ =
+    "#version 330 core\n"
+
+    "uniform sampler2D u_Coverage;\n"
+
+    "void main() {\n"
+      "if (texelFetch(u_Coverage, ivec2(gl_FragCoord.xy), 0).r == 0.0) {\n"
+        "discard;\n"
+      "}\n"
+    "}\n";
+// clang-format on
@@ -3,5 +3,11 @@
 
 #pragma once
 
+#include "batch-shaders.h"
+#include "compose-fragment-shader.h"
+#include "equalization-shaders.h"
 #include "fragment-shader.h"
+#include "hierarchical-shaders.h"
+#include "iteration-data-fragment-shader.h"
+#include "region-fragment-shader.h"
 #include "vertex-shader.h"
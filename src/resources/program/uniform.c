@@ -0,0 +1,28 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "uniform.h"
+
+#include <glad/glad.h>
+
+#include "gm/gm.h"
+#include "program.h"
+
+void gmSetUniformInt_(const gmProgram_ *program, const char *name, int value) {
+  glUniform1i(glGetUniformLocation(*program, name), value);
+}
+
+void gmSetUniformIntSize_(const gmProgram_ *program, const char *name,
+                          const gmIntSize *value) {
+  glUniform2i(glGetUniformLocation(*program, name), value->w, value->h);
+}
+
+void gmSetUniformInt2_(const gmProgram_ *program, const char *name, int x,
+                       int y) {
+  glUniform2i(glGetUniformLocation(*program, name), x, y);
+}
+
+void gmSetUniformFloat2_(const gmProgram_ *program, const char *name, float x,
+                         float y) {
+  glUniform2f(glGetUniformLocation(*program, name), x, y);
+}
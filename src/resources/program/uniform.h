@@ -0,0 +1,21 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "gm/gm.h"
+#include "program.h"
+
+// The uniform setters below apply to the specified program, which has to be
+// the program currently in use.
+
+void gmSetUniformInt_(const gmProgram_ *program, const char *name, int value);
+
+void gmSetUniformIntSize_(const gmProgram_ *program, const char *name,
+                          const gmIntSize *value);
+
+void gmSetUniformInt2_(const gmProgram_ *program, const char *name, int x,
+                       int y);
+
+void gmSetUniformFloat2_(const gmProgram_ *program, const char *name, float x,
+                         float y);
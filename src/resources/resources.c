@@ -3,8 +3,12 @@
 
 #include "resources.h"
 
+#include <string.h>  // For memset.
+
 #include "frame-buffer/frame-buffer.h"
 #include "gm/error.h"
+#include "gm/iterations.h"
+#include "image-config.h"
 #include "model/model.h"
 #include "program/program.h"
 #include "setup.h"
@@ -13,18 +17,34 @@ gmError gmCreateRenderData_(GM_OUT_PARAM gmRenderData_ *render_data);
 
 gmError gmCreateRenderFrameBuffers_(
     GM_OUT_PARAM gmRenderFrameBuffers_ *render_frame_buffers,
-    const gmImageConfig *image_config);
+    const gmImageConfig *image_config, int record_costs);
+
+gmError gmCreateAlgorithmResources_(GM_OUT_PARAM gmResources_ *resources,
+                                    const gmImageConfig *image_config,
+                                    int record_costs);
 
 void gmDeleteRenderData_(const gmRenderData_ *render_data);
 
+void gmDeleteRenderFrameBuffers_(
+    const gmRenderFrameBuffers_ *render_frame_buffers);
+
 gmError gmCreateResources_(GM_OUT_PARAM gmResources_ *resources,
-                           const gmImageConfig *image_config) {
+                           const gmImageConfig *image_config,
+                           int record_costs) {
   gmError error;
 
   error = gmCreateRenderData_(&resources->render_data);
   if (!error) {
     error = gmCreateRenderFrameBuffers_(&resources->render_frame_buffers,
-                                        image_config);
+                                        image_config, record_costs);
+    if (!error) {
+      error = gmCreateAlgorithmResources_(resources, image_config,
+                                          record_costs);
+      if (error) {
+        gmDeleteRenderFrameBuffers_(&resources->render_frame_buffers);
+      }
+    }
+
     if (error) {
       gmDeleteRenderData_(&resources->render_data);
     }
@@ -33,10 +53,16 @@ gmError gmCreateResources_(GM_OUT_PARAM gmResources_ *resources,
   return error;
 }
 
+// These files contain the shader sources.
+#include "program/shaders/shaders.h"
+
 gmError gmCreateRenderData_(GM_OUT_PARAM gmRenderData_ *render_data) {
   gmError error;
 
-  error = gmCreateProgram_(&render_data->program);
+  const gmProgramSources_ kSources = {.vertex = kGmVertexShaderSource_,
+                                      .fragment = kGmFragmentShaderSource_};
+
+  error = gmCreateProgram_(&render_data->program, &kSources);
   if (!error) {
     error = gmCreateQuadModel_(&render_data->quad);
     if (error) {
@@ -49,15 +75,41 @@ gmError gmCreateRenderData_(GM_OUT_PARAM gmRenderData_ *render_data) {
 
 gmError gmCreateRenderFrameBuffers_(
     GM_OUT_PARAM gmRenderFrameBuffers_ *render_frame_buffers,
-    const gmImageConfig *image_config) {
+    const gmImageConfig *image_config, int record_costs) {
   gmError error;
 
   error = gmCreateSampledFrameBuffer_(&render_frame_buffers->render,
                                       &image_config->size,
                                       image_config->sample_count);
+
+  const int kIsHierarchical =
+      gmGetGlAlgorithm_(image_config) == gmGlAlgorithm_Hierarchical;
+
+  // Hierarchical renders mark the filled blocks in the stencil buffer, and
+  // renders with a region the pixels inside it.
+  if (!error && (kIsHierarchical || gmHasRegion_(image_config))) {
+    error = gmAttachStencilBuffer_(&render_frame_buffers->render,
+                                   &image_config->size);
+  }
+
+  const int kIsEqualized =
+      gmGetColoringMode_(image_config) == gmColoringMode_Equalized;
+
+  // Equalized renders read the iteration counts from the cost buffer.
+  if (!error && (record_costs || kIsEqualized)) {
+    error = gmAttachCostBuffer_(&render_frame_buffers->render,
+                                &image_config->size);
+  }
+
   if (!error) {
     error =
         gmCreateFrameBuffer_(&render_frame_buffers->final, &image_config->size);
+    if (!error && record_costs) {
+      // The costs are resolved into the final frame-buffer to be read back.
+      error = gmAttachCostBuffer_(&render_frame_buffers->final,
+                                  &image_config->size);
+    }
+
     if (error) {
       gmDeleteFrameBuffer_(&render_frame_buffers->render);
     }
@@ -66,17 +118,429 @@ gmError gmCreateRenderFrameBuffers_(
   return error;
 }
 
+gmError gmCreateProgressiveResources_(
+    GM_OUT_PARAM gmProgressiveResources_ *progressive,
+    const gmImageConfig *image_config, int record_costs);
+
+gmError gmCreateHierarchicalResources_(
+    GM_OUT_PARAM gmHierarchicalResources_ *hierarchical,
+    const gmImageConfig *image_config, int record_costs);
+
+gmError gmCreateEqualizationResources_(
+    GM_OUT_PARAM gmEqualizationResources_ *equalization,
+    const gmImageConfig *image_config);
+
+gmError gmCreateRegionResources_(GM_OUT_PARAM gmRegionResources_ *region,
+                                 const gmImageConfig *image_config);
+
+void gmDeleteProgressiveResources_(
+    const gmProgressiveResources_ *progressive);
+
+void gmDeleteHierarchicalResources_(
+    const gmHierarchicalResources_ *hierarchical);
+
+void gmDeleteEqualizationResources_(
+    const gmEqualizationResources_ *equalization);
+
+gmError gmCreateAlgorithmResources_(GM_OUT_PARAM gmResources_ *resources,
+                                    const gmImageConfig *image_config,
+                                    int record_costs) {
+  gmError error;
+
+  error = gmCreateProgressiveResources_(&resources->progressive, image_config,
+                                        record_costs);
+  if (!error) {
+    error = gmCreateHierarchicalResources_(&resources->hierarchical,
+                                           image_config, record_costs);
+    if (!error) {
+      error = gmCreateEqualizationResources_(&resources->equalization,
+                                             image_config);
+      if (!error) {
+        error = gmCreateRegionResources_(&resources->region, image_config);
+        if (error) {
+          gmDeleteEqualizationResources_(&resources->equalization);
+        }
+      }
+
+      if (error) {
+        gmDeleteHierarchicalResources_(&resources->hierarchical);
+      }
+    }
+
+    if (error) {
+      gmDeleteProgressiveResources_(&resources->progressive);
+    }
+  }
+
+  return error;
+}
+
+gmError gmCreatePassFrameBuffers_(
+    GM_OUT_PARAM gmFrameBuffer_ *pass_frame_buffers, const gmIntSize *size,
+    int record_costs);
+
+gmError gmCreateProgressiveResources_(
+    GM_OUT_PARAM gmProgressiveResources_ *progressive,
+    const gmImageConfig *image_config, int record_costs) {
+  gmError error = gmError_Success;
+
+  // Deleting resources with an id of 0 does nothing.
+  memset(progressive, 0, sizeof(gmProgressiveResources_));
+
+  if (image_config->preview.func) {
+    const gmProgramSources_ kSources = {
+        .vertex = kGmVertexShaderSource_,
+        .fragment = kGmComposeFragmentShaderSource_};
+
+    error = gmCreateProgram_(&progressive->compose_program, &kSources);
+    if (!error) {
+      error = gmCreatePassFrameBuffers_(progressive->pass_frame_buffers,
+                                        &image_config->size, record_costs);
+      if (error) {
+        gmDeleteProgram_(&progressive->compose_program);
+      }
+    }
+  }
+
+  return error;
+}
+
+gmError gmCreatePassFrameBuffers_(
+    GM_OUT_PARAM gmFrameBuffer_ *pass_frame_buffers, const gmIntSize *size,
+    int record_costs) {
+  gmError error = gmError_Success;
+
+  size_t created_count = 0;
+  for (; created_count < GM_PROGRESSIVE_PASS_COUNT_; ++created_count) {
+    gmIntSize pass_size;
+    gmGetProgressivePassSize_(&pass_size, size, created_count);
+
+    error = gmCreateTextureFrameBuffer_(&pass_frame_buffers[created_count],
+                                        &pass_size, gmTextureFormat_Rgb_);
+    if (!error && record_costs) {
+      error = gmAttachCostBuffer_(&pass_frame_buffers[created_count],
+                                  &pass_size);
+    }
+
+    if (error) {
+      break;  // The failed frame-buffer already deleted itself.
+    }
+  }
+
+  if (error) {
+    for (size_t i = 0; i < created_count; ++i) {
+      gmDeleteFrameBuffer_(&pass_frame_buffers[i]);
+    }
+  }
+
+  return error;
+}
+
+void gmGetProgressivePassSize_(GM_OUT_PARAM gmIntSize *pass_size,
+                               const gmIntSize *image_size, size_t pass_index) {
+  const int kStep = 8 >> pass_index;
+
+  // Rounded up so that the last pixels are part of every pass.
+  pass_size->w = (image_size->w + kStep - 1) / kStep;
+  pass_size->h = (image_size->h + kStep - 1) / kStep;
+}
+
+gmError gmCreateHierarchicalPrograms_(
+    GM_OUT_PARAM gmHierarchicalResources_ *hierarchical);
+
+gmError gmCreateBlockFrameBuffers_(
+    GM_OUT_PARAM gmHierarchicalResources_ *hierarchical,
+    const gmIntSize *image_size, int record_costs);
+
+void gmDeleteHierarchicalPrograms_(
+    const gmHierarchicalResources_ *hierarchical);
+
+gmError gmCreateHierarchicalResources_(
+    GM_OUT_PARAM gmHierarchicalResources_ *hierarchical,
+    const gmImageConfig *image_config, int record_costs) {
+  gmError error = gmError_Success;
+
+  // Deleting resources with an id of 0 does nothing.
+  memset(hierarchical, 0, sizeof(gmHierarchicalResources_));
+
+  if (gmGetGlAlgorithm_(image_config) == gmGlAlgorithm_Hierarchical) {
+    error = gmCreateHierarchicalPrograms_(hierarchical);
+    if (!error) {
+      error = gmCreateBlockFrameBuffers_(hierarchical, &image_config->size,
+                                         record_costs);
+      if (error) {
+        gmDeleteHierarchicalPrograms_(hierarchical);
+      }
+    }
+  }
+
+  return error;
+}
+
+gmError gmCreateHierarchicalPrograms_(
+    GM_OUT_PARAM gmHierarchicalResources_ *hierarchical) {
+  gmError error;
+
+  const gmProgramSources_ kBlockCornersSources = {
+      .vertex = kGmVertexShaderSource_,
+      .fragment = kGmBlockCornersFragmentShaderSource_};
+
+  const gmProgramSources_ kClassifyBlocksSources = {
+      .vertex = kGmVertexShaderSource_,
+      .fragment = kGmClassifyBlocksFragmentShaderSource_};
+
+  const gmProgramSources_ kFillBlocksSources = {
+      .vertex = kGmFillBlocksVertexShaderSource_,
+      .fragment = kGmFillBlocksFragmentShaderSource_};
+
+  const gmProgramSources_ kRemainingPixelsSources = {
+      .vertex = kGmVertexShaderSource_,
+      .fragment = kGmRemainingPixelsFragmentShaderSource_};
+
+  error = gmCreateProgram_(&hierarchical->block_corners_program,
+                           &kBlockCornersSources);
+  if (!error) {
+    error = gmCreateProgram_(&hierarchical->classify_blocks_program,
+                             &kClassifyBlocksSources);
+    if (!error) {
+      error = gmCreateProgram_(&hierarchical->fill_blocks_program,
+                               &kFillBlocksSources);
+      if (!error) {
+        error = gmCreateProgram_(&hierarchical->remaining_pixels_program,
+                                 &kRemainingPixelsSources);
+        if (error) {
+          gmDeleteProgram_(&hierarchical->fill_blocks_program);
+        }
+      }
+
+      if (error) {
+        gmDeleteProgram_(&hierarchical->classify_blocks_program);
+      }
+    }
+
+    if (error) {
+      gmDeleteProgram_(&hierarchical->block_corners_program);
+    }
+  }
+
+  return error;
+}
+
+gmError gmCreateBlockFrameBuffers_(
+    GM_OUT_PARAM gmHierarchicalResources_ *hierarchical,
+    const gmIntSize *image_size, int record_costs) {
+  gmError error;
+
+  gmIntSize grid_size;
+  gmGetBlockGridSize_(&grid_size, image_size);
+
+  // The far corners of the last blocks need one more texel.  Their iterations
+  // executed go along with their iteration count when recording costs.
+  const gmIntSize kCornersSize = {.w = grid_size.w + 1, .h = grid_size.h + 1};
+
+  error = gmCreateTextureFrameBuffer_(
+      &hierarchical->block_corners_frame_buffer, &kCornersSize,
+      record_costs ? gmTextureFormat_Int2_ : gmTextureFormat_Int_);
+  if (!error) {
+    error = gmCreateTextureFrameBuffer_(&hierarchical->blocks_frame_buffer,
+                                        &grid_size, gmTextureFormat_Int_);
+    if (!error && record_costs) {
+      // Receives the iterations spent classifying each block.
+      error = gmAttachCostBuffer_(&hierarchical->blocks_frame_buffer,
+                                  &grid_size);
+    }
+
+    if (error) {
+      gmDeleteFrameBuffer_(&hierarchical->block_corners_frame_buffer);
+    }
+  }
+
+  return error;
+}
+
+void gmGetBlockGridSize_(GM_OUT_PARAM gmIntSize *grid_size,
+                         const gmIntSize *image_size) {
+  // Rounded up, the last blocks being partially outside of the image.
+  grid_size->w = (image_size->w + 7) / 8;
+  grid_size->h = (image_size->h + 7) / 8;
+}
+
+gmError gmCreateEqualizationPrograms_(
+    GM_OUT_PARAM gmEqualizationResources_ *equalization);
+
+gmError gmCreateEqualizationFrameBuffers_(
+    GM_OUT_PARAM gmEqualizationResources_ *equalization,
+    const gmImageConfig *image_config);
+
+void gmDeleteEqualizationPrograms_(
+    const gmEqualizationResources_ *equalization);
+
+gmError gmCreateEqualizationResources_(
+    GM_OUT_PARAM gmEqualizationResources_ *equalization,
+    const gmImageConfig *image_config) {
+  gmError error = gmError_Success;
+
+  // Deleting resources with an id of 0 does nothing.
+  memset(equalization, 0, sizeof(gmEqualizationResources_));
+
+  if (gmGetColoringMode_(image_config) == gmColoringMode_Equalized) {
+    error = gmCreateEqualizationPrograms_(equalization);
+    if (!error) {
+      error = gmCreateEqualizationFrameBuffers_(equalization, image_config);
+      if (error) {
+        gmDeleteEqualizationPrograms_(equalization);
+      }
+    }
+  }
+
+  return error;
+}
+
+gmError gmCreateEqualizationPrograms_(
+    GM_OUT_PARAM gmEqualizationResources_ *equalization) {
+  gmError error;
+
+  const gmProgramSources_ kHistogramSources = {
+      .vertex = kGmHistogramVertexShaderSource_,
+      .fragment = kGmHistogramFragmentShaderSource_};
+
+  const gmProgramSources_ kPrefixSumSources = {
+      .vertex = kGmVertexShaderSource_,
+      .fragment = kGmPrefixSumFragmentShaderSource_};
+
+  const gmProgramSources_ kPaletteSources = {
+      .vertex = kGmVertexShaderSource_,
+      .fragment = kGmPaletteFragmentShaderSource_};
+
+  error =
+      gmCreateProgram_(&equalization->histogram_program, &kHistogramSources);
+  if (!error) {
+    error = gmCreateProgram_(&equalization->prefix_sum_program,
+                             &kPrefixSumSources);
+    if (!error) {
+      error =
+          gmCreateProgram_(&equalization->palette_program, &kPaletteSources);
+      if (error) {
+        gmDeleteProgram_(&equalization->prefix_sum_program);
+      }
+    }
+
+    if (error) {
+      gmDeleteProgram_(&equalization->histogram_program);
+    }
+  }
+
+  return error;
+}
+
+gmError gmCreateEqualizationFrameBuffers_(
+    GM_OUT_PARAM gmEqualizationResources_ *equalization,
+    const gmImageConfig *image_config) {
+  gmError error;
+
+  // Only the first bin frame-buffer holds the rows of the histogram, the prefix
+  // sums being computed on a single row.
+  const gmIntSize kHistogramSize = {
+      .w = (int)gmGetEqualizationBinCount_(image_config),
+      .h = (int)gmGetEqualizationRowCount_(image_config)};
+  const gmIntSize kBinsSize = {.w = kHistogramSize.w, .h = 1};
+
+  error = gmCreateTextureFrameBuffer_(&equalization->counts_frame_buffer,
+                                      &image_config->size,
+                                      gmTextureFormat_Float2_);
+  if (!error) {
+    error =
+        gmCreateTextureFrameBuffer_(&equalization->bin_frame_buffers[0],
+                                    &kHistogramSize, gmTextureFormat_Float_);
+    if (!error) {
+      error = gmCreateTextureFrameBuffer_(&equalization->bin_frame_buffers[1],
+                                          &kBinsSize, gmTextureFormat_Float_);
+      if (error) {
+        gmDeleteFrameBuffer_(&equalization->bin_frame_buffers[0]);
+      }
+    }
+
+    if (error) {
+      gmDeleteFrameBuffer_(&equalization->counts_frame_buffer);
+    }
+  }
+
+  return error;
+}
+
+void gmDeleteEqualizationPrograms_(
+    const gmEqualizationResources_ *equalization) {
+  gmDeleteProgram_(&equalization->histogram_program);
+  gmDeleteProgram_(&equalization->prefix_sum_program);
+  gmDeleteProgram_(&equalization->palette_program);
+}
+
+gmError gmCreateRegionResources_(GM_OUT_PARAM gmRegionResources_ *region,
+                                 const gmImageConfig *image_config) {
+  gmError error = gmError_Success;
+
+  // Deleting resources with an id of 0 does nothing.
+  memset(region, 0, sizeof(gmRegionResources_));
+
+  if (gmHasRegion_(image_config)) {
+    const gmProgramSources_ kSources = {
+        .vertex = kGmVertexShaderSource_,
+        .fragment = kGmRegionFragmentShaderSource_};
+
+    error = gmCreateProgram_(&region->program, &kSources);
+    if (!error) {
+      error = gmCreateTextureFrameBuffer_(&region->coverage_frame_buffer,
+                                          &image_config->size,
+                                          gmTextureFormat_Byte_);
+      if (error) {
+        gmDeleteProgram_(&region->program);
+      }
+    }
+  }
+
+  return error;
+}
+
+void gmDeleteHierarchicalPrograms_(
+    const gmHierarchicalResources_ *hierarchical) {
+  gmDeleteProgram_(&hierarchical->block_corners_program);
+  gmDeleteProgram_(&hierarchical->classify_blocks_program);
+  gmDeleteProgram_(&hierarchical->fill_blocks_program);
+  gmDeleteProgram_(&hierarchical->remaining_pixels_program);
+}
+
 void gmDeleteRenderData_(const gmRenderData_ *render_data) {
   gmDeleteModel_(&render_data->quad);
   gmDeleteProgram_(&render_data->program);
 }
 
-void gmDeleteRenderFrameBuffers_(
-    const gmRenderFrameBuffers_ *render_frame_buffers);
+void gmDeleteRegionResources_(const gmRegionResources_ *region);
 
 void gmDeleteResources_(const gmResources_ *resources) {
   gmDeleteRenderData_(&resources->render_data);
   gmDeleteRenderFrameBuffers_(&resources->render_frame_buffers);
+  gmDeleteProgressiveResources_(&resources->progressive);
+  gmDeleteHierarchicalResources_(&resources->hierarchical);
+  gmDeleteEqualizationResources_(&resources->equalization);
+  gmDeleteRegionResources_(&resources->region);
+}
+
+int gmCanReuseResources_(const gmImageConfig *created_image_config,
+                         const gmImageConfig *image_config) {
+  const gmIntSize *const kCreatedSize = &created_image_config->size;
+  const gmIntSize *const kSize = &image_config->size;
+
+  // The settings read when creating the resources.
+  return (kCreatedSize->w == kSize->w) && (kCreatedSize->h == kSize->h) &&
+         (created_image_config->sample_count == image_config->sample_count) &&
+         (!created_image_config->preview.func == !image_config->preview.func) &&
+         (gmGetGlAlgorithm_(created_image_config) ==
+          gmGetGlAlgorithm_(image_config)) &&
+         (gmGetColoringMode_(created_image_config) ==
+          gmGetColoringMode_(image_config)) &&
+         (gmGetEqualizationBinCount_(created_image_config) ==
+          gmGetEqualizationBinCount_(image_config)) &&
+         (gmHasRegion_(created_image_config) == gmHasRegion_(image_config));
 }
 
 void gmDeleteRenderFrameBuffers_(
@@ -84,3 +548,114 @@ void gmDeleteRenderFrameBuffers_(
   gmDeleteFrameBuffer_(&render_frame_buffers->final);
   gmDeleteFrameBuffer_(&render_frame_buffers->render);
 }
+
+void gmDeleteProgressiveResources_(
+    const gmProgressiveResources_ *progressive) {
+  gmDeleteProgram_(&progressive->compose_program);
+
+  for (size_t i = 0; i < GM_PROGRESSIVE_PASS_COUNT_; ++i) {
+    gmDeleteFrameBuffer_(&progressive->pass_frame_buffers[i]);
+  }
+}
+
+void gmDeleteHierarchicalResources_(
+    const gmHierarchicalResources_ *hierarchical) {
+  gmDeleteHierarchicalPrograms_(hierarchical);
+  gmDeleteFrameBuffer_(&hierarchical->block_corners_frame_buffer);
+  gmDeleteFrameBuffer_(&hierarchical->blocks_frame_buffer);
+}
+
+void gmDeleteEqualizationResources_(
+    const gmEqualizationResources_ *equalization) {
+  gmDeleteEqualizationPrograms_(equalization);
+  gmDeleteFrameBuffer_(&equalization->counts_frame_buffer);
+  gmDeleteFrameBuffer_(&equalization->bin_frame_buffers[0]);
+  gmDeleteFrameBuffer_(&equalization->bin_frame_buffers[1]);
+}
+
+void gmDeleteRegionResources_(const gmRegionResources_ *region) {
+  gmDeleteProgram_(&region->program);
+  gmDeleteFrameBuffer_(&region->coverage_frame_buffer);
+}
+
+gmError gmCreateIterationResources_(
+    GM_OUT_PARAM gmIterationResources_ *resources) {
+  gmError error;
+
+  const gmProgramSources_ kSources = {
+      .vertex = kGmVertexShaderSource_,
+      .fragment = kGmIterationDataFragmentShaderSource_};
+
+  const gmIntSize kStripSize = {
+      .w = GM_ITERATION_FILE_TILE_SIZE * GM_ITERATION_STRIP_TILE_COUNT_,
+      .h = GM_ITERATION_FILE_TILE_SIZE};
+
+  error = gmCreateProgram_(&resources->program, &kSources);
+  if (!error) {
+    error = gmCreateQuadModel_(&resources->quad);
+    if (!error) {
+      error = gmCreateTextureFrameBuffer_(&resources->strip_frame_buffer,
+                                          &kStripSize, gmTextureFormat_Float2_);
+      if (error) {
+        gmDeleteModel_(&resources->quad);
+      }
+    }
+
+    if (error) {
+      gmDeleteProgram_(&resources->program);
+    }
+  }
+
+  return error;
+}
+
+void gmDeleteIterationResources_(const gmIterationResources_ *resources) {
+  gmDeleteModel_(&resources->quad);
+  gmDeleteProgram_(&resources->program);
+  gmDeleteFrameBuffer_(&resources->strip_frame_buffer);
+}
+
+gmError gmCreateBatchResources_(GM_OUT_PARAM gmBatchResources_ *resources,
+                                const gmIntSize *image_size,
+                                gm_uint layer_count) {
+  gmError error;
+
+  const gmProgramSources_ kSources = {
+      .vertex = kGmBatchVertexShaderSource_,
+      .geometry = kGmBatchGeometryShaderSource_,
+      .fragment = kGmBatchFragmentShaderSource_};
+
+  resources->layer_count = layer_count;
+
+  error = gmCreateProgram_(&resources->program, &kSources);
+  if (!error) {
+    // The block is bound to the uniform buffer binding point 0.
+    glUniformBlockBinding(
+        resources->program,
+        glGetUniformBlockIndex(resources->program, "Images"), 0);
+
+    error = gmCreateQuadModel_(&resources->quad);
+    if (!error) {
+      error = gmCreateLayeredFrameBuffer_(&resources->layers_frame_buffer,
+                                          image_size, layer_count);
+      if (!error) {
+        gmCreateBuffers_(1, &resources->images_buffer);
+      } else {
+        gmDeleteModel_(&resources->quad);
+      }
+    }
+
+    if (error) {
+      gmDeleteProgram_(&resources->program);
+    }
+  }
+
+  return error;
+}
+
+void gmDeleteBatchResources_(const gmBatchResources_ *resources) {
+  gmDeleteModel_(&resources->quad);
+  gmDeleteProgram_(&resources->program);
+  gmDeleteFrameBuffer_(&resources->layers_frame_buffer);
+  gmDeleteBuffers_(1, &resources->images_buffer);
+}
@@ -8,6 +8,7 @@
 #include "frame-buffer/frame-buffer.h"
 #include "gm/error.h"
 #include "gm/gm.h"
+#include "model/buffer.h"
 #include "model/model.h"
 #include "program/program.h"
 #include "setup.h"
@@ -22,12 +23,167 @@ typedef struct gmRenderFrameBuffers_ {
   gmFrameBuffer_ final;
 } gmRenderFrameBuffers_;
 
+#define GM_PROGRESSIVE_PASS_COUNT_ 4
+
+/**
+ * Only created for progressive renders, every id is set to 0 otherwise.
+ */
+typedef struct gmProgressiveResources_ {
+  gmProgram_ compose_program;
+
+  /**
+   * The pass of index `i` computes one pixel every `8 >> i` pixels.
+   */
+  gmFrameBuffer_ pass_frame_buffers[GM_PROGRESSIVE_PASS_COUNT_];
+} gmProgressiveResources_;
+
+/**
+ * Only created for hierarchical renders, every id is set to 0 otherwise.
+ */
+typedef struct gmHierarchicalResources_ {
+  gmProgram_ block_corners_program;
+  gmProgram_ classify_blocks_program;
+  gmProgram_ fill_blocks_program;
+  gmProgram_ remaining_pixels_program;
+
+  /**
+   * Iteration counts of the block corners.
+   */
+  gmFrameBuffer_ block_corners_frame_buffer;
+
+  /**
+   * Iteration counts of the uniform blocks, -1 for the other blocks.
+   */
+  gmFrameBuffer_ blocks_frame_buffer;
+} gmHierarchicalResources_;
+
+/**
+ * Only created for equalized renders, every id is set to 0 otherwise.
+ */
+typedef struct gmEqualizationResources_ {
+  gmProgram_ histogram_program;
+  gmProgram_ prefix_sum_program;
+  gmProgram_ palette_program;
+
+  /**
+   * Iteration counts of the pixels, resolved from the cost buffer of the
+   * render frame-buffer.
+   */
+  gmFrameBuffer_ counts_frame_buffer;
+
+  /**
+   * Histogram of the iteration counts, in rows added up by the first pass of
+   * its prefix sums, which are computed by passes going from one frame-buffer
+   * to the other.
+   */
+  gmFrameBuffer_ bin_frame_buffers[2];
+} gmEqualizationResources_;
+
+/**
+ * Only created for renders with a region, every id is set to 0 otherwise.
+ */
+typedef struct gmRegionResources_ {
+  /**
+   * Marks the pixels inside the region in the stencil buffer.
+   */
+  gmProgram_ program;
+
+  /**
+   * Coverage of the region, uploaded before each render.
+   */
+  gmFrameBuffer_ coverage_frame_buffer;
+} gmRegionResources_;
+
+/**
+ * Calculates the size of the block grid of a hierarchical render.
+ */
+void gmGetBlockGridSize_(GM_OUT_PARAM gmIntSize *grid_size,
+                         const gmIntSize *image_size);
+
+/**
+ * Calculates the size of the image computed by the progressive pass of the
+ * specified index.
+ */
+void gmGetProgressivePassSize_(GM_OUT_PARAM gmIntSize *pass_size,
+                               const gmIntSize *image_size, size_t pass_index);
+
 typedef struct gmResources_ {
   gmRenderData_ render_data;
   gmRenderFrameBuffers_ render_frame_buffers;
+  gmProgressiveResources_ progressive;
+  gmHierarchicalResources_ hierarchical;
+  gmEqualizationResources_ equalization;
+  gmRegionResources_ region;
 } gmResources_;
 
+/**
+ * @param record_costs Whether to attach cost buffers to the frame-buffers
+ * rendered to, see `gmAttachCostBuffer_`.
+ */
 gmError gmCreateResources_(GM_OUT_PARAM gmResources_ *resources,
-                           const gmImageConfig *image_config);
+                           const gmImageConfig *image_config, int record_costs);
 
 void gmDeleteResources_(const gmResources_ *resources);
+
+/**
+ * @return Whether the resources created for the first image config can render
+ * the second one, both recording costs or not.
+ */
+int gmCanReuseResources_(const gmImageConfig *created_image_config,
+                         const gmImageConfig *image_config);
+
+/**
+ * Number of tiles of the strip rendered at once by iteration renders.
+ */
+#define GM_ITERATION_STRIP_TILE_COUNT_ 16
+
+/**
+ * Resources of the renders writing iteration files, which do not need the
+ * full size frame-buffers.
+ */
+typedef struct gmIterationResources_ {
+  gmModel_ quad;
+  gmProgram_ program;
+
+  /**
+   * Holds the data of a strip of tiles.
+   */
+  gmFrameBuffer_ strip_frame_buffer;
+} gmIterationResources_;
+
+gmError gmCreateIterationResources_(
+    GM_OUT_PARAM gmIterationResources_ *resources);
+
+void gmDeleteIterationResources_(const gmIterationResources_ *resources);
+
+/**
+ * Images rendered by a single batch draw, at most.
+ */
+#define GM_MAX_BATCH_LAYER_COUNT_ 256
+
+/**
+ * Resources of the batch renders, which render several images of the same
+ * size at once in the layers of a frame-buffer.
+ */
+typedef struct gmBatchResources_ {
+  gmModel_ quad;
+  gmProgram_ program;
+  gmFrameBuffer_ layers_frame_buffer;
+
+  /**
+   * Uniform buffer of the parameters of the images rendered by a draw.
+   */
+  gmBuffer_ images_buffer;
+
+  gm_uint layer_count;
+} gmBatchResources_;
+
+/**
+ * @param layer_count Images rendered at once, up to
+ * `GM_MAX_BATCH_LAYER_COUNT_`.
+ */
+gmError gmCreateBatchResources_(GM_OUT_PARAM gmBatchResources_ *resources,
+                                const gmIntSize *image_size,
+                                gm_uint layer_count);
+
+void gmDeleteBatchResources_(const gmBatchResources_ *resources);
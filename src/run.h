@@ -0,0 +1,68 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "context/context.h"
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "profile/profile.h"
+#include "resources/resources.h"
+#include "setup.h"
+
+/**
+ * OpenGL objects kept by a thread running several renders.  The context is
+ * created by the first render needing it, the resources of the last render
+ * being reused by the next renders they can render.
+ */
+typedef struct gmRenderState_ {
+  /**
+   * Not owned by the state.
+   */
+  gmLazyContext_ *context;
+
+  /**
+   * Only valid when `has_resources` is set, along with the settings they were
+   * created with.
+   */
+  gmResources_ resources;
+  gmImageConfig resources_image_config;
+  int resources_record_costs;
+  int has_resources;
+
+  /**
+   * Trace of the render running with the state, NULL when it is not traced.
+   */
+  gmTrace *trace;
+
+  /**
+   * Iterations per second of the OpenGL backend measured in the context by the
+   * first render with a time budget, 0 until then.
+   */
+  double gl_iteration_rate;
+
+  /**
+   * Profile of the host loaded by the first render, which the next renders
+   * reuse while they read the same file with the same host key.  NULL until
+   * loaded, `profile` being only valid when `has_profile` is set.
+   */
+  char *profile_filepath;
+  int profile_has_gl_renderer;
+  gmProfile_ profile;
+  int has_profile;
+} gmRenderState_;
+
+void gmInitRenderState_(GM_OUT_PARAM gmRenderState_ *state,
+                        gmLazyContext_ *context);
+
+/**
+ * Deletes the resources and the profile of the state, the context is left as
+ * is.
+ */
+void gmDeleteRenderState_(const gmRenderState_ *state);
+
+/**
+ * Same as `gmRun`, rendering with the OpenGL objects of the specified state.
+ * The context is not current anymore when this function returns.
+ */
+gmError gmRunWithState_(const gmConfig *config, gmRenderState_ *state);
@@ -0,0 +1,204 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#include "trace.h"
+
+#include <glad/glad.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "clock.h"
+#include "gm/error.h"
+#include "gm/gm.h"
+#include "setup.h"
+
+/**
+ * Track of the GPU events, the threads being numbered from 1.
+ */
+#define GM_GPU_TRACE_THREAD_ID_ 0
+
+typedef struct gmTraceEvent_ {
+  const char *name;
+  int thread_id;
+
+  /**
+   * Seconds of the CPU clock.
+   */
+  double start_time;
+  double duration;
+} gmTraceEvent_;
+
+struct gmTrace {
+  FILE *file;
+
+  /**
+   * Events are written relatively to the time the trace was opened.
+   */
+  double open_time;
+
+  /**
+   * Number of the calling thread, stored as a pointer once it has one.
+   */
+  pthread_key_t thread_key;
+
+  // Protects the members below, events being recorded from any thread.
+  pthread_mutex_t mutex;
+
+  gmTraceEvent_ *events;
+  size_t event_count;
+  size_t event_capacity;
+  int thread_count;
+};
+
+gmError gmOpenTrace(gmTrace **trace, const char *filepath) {
+  FILE *const kFile = fopen(filepath, "w");
+  if (!kFile) {
+    return gmError_TraceWriteFailed;
+  }
+
+  gmTrace *const kTrace = calloc(1, sizeof(gmTrace));
+  kTrace->file = kFile;
+  kTrace->open_time = gmGetTime_();
+
+  pthread_key_create(&kTrace->thread_key, NULL);
+  pthread_mutex_init(&kTrace->mutex, NULL);
+
+  *trace = kTrace;
+  return gmError_Success;
+}
+
+int gmWriteTraceEvents_(const gmTrace *trace);
+
+gmError gmCloseTrace(gmTrace *trace) {
+  int failed = !gmWriteTraceEvents_(trace);
+  failed |= fclose(trace->file) != 0;
+
+  pthread_mutex_destroy(&trace->mutex);
+  pthread_key_delete(trace->thread_key);
+  free(trace->events);
+  free(trace);
+
+  return !failed ? gmError_Success : gmError_TraceWriteFailed;
+}
+
+/**
+ * Writes the events in the trace event format of Chrome, as complete events
+ * timed in microseconds.
+ */
+int gmWriteTraceEvents_(const gmTrace *trace) {
+  int failed =
+      fprintf(trace->file,
+              "{\"traceEvents\":[\n"
+              "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+              "\"args\":{\"name\":\"GPU\"}}",
+              GM_GPU_TRACE_THREAD_ID_) < 0;
+
+  for (size_t i = 0; (i < trace->event_count) && !failed; ++i) {
+    const gmTraceEvent_ *const kEvent = &trace->events[i];
+    failed = fprintf(trace->file,
+                     ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+                     "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+                     kEvent->name,
+                     kEvent->thread_id == GM_GPU_TRACE_THREAD_ID_ ? "gpu"
+                                                                  : "cpu",
+                     (kEvent->start_time - trace->open_time) * 1e6,
+                     kEvent->duration * 1e6, kEvent->thread_id) < 0;
+  }
+
+  return !failed && (fputs("\n],\"displayTimeUnit\":\"ms\"}\n",
+                           trace->file) >= 0);
+}
+
+double gmBeginTraceEvent_(const gmTrace *trace) {
+  return trace ? gmGetTime_() : 0.0;
+}
+
+void gmAddTraceEvent_(gmTrace *trace, const char *name, int thread_id,
+                      double start_time, double duration);
+
+void gmEndTraceEvent_(gmTrace *trace, const char *name, double start_time) {
+  if (!trace) {
+    return;
+  }
+
+  const double kEndTime = gmGetTime_();
+
+  // Threads are numbered in the order of their first event.
+  int thread_id = (int)(intptr_t)pthread_getspecific(trace->thread_key);
+  if (!thread_id) {
+    pthread_mutex_lock(&trace->mutex);
+    thread_id = ++trace->thread_count;
+    pthread_mutex_unlock(&trace->mutex);
+
+    pthread_setspecific(trace->thread_key, (void *)(intptr_t)thread_id);
+  }
+
+  gmAddTraceEvent_(trace, name, thread_id, start_time, kEndTime - start_time);
+}
+
+void gmAddTraceEvent_(gmTrace *trace, const char *name, int thread_id,
+                      double start_time, double duration) {
+  pthread_mutex_lock(&trace->mutex);
+
+  if (trace->event_count == trace->event_capacity) {
+    trace->event_capacity =
+        trace->event_capacity ? 2 * trace->event_capacity : 256;
+    trace->events = realloc(trace->events,
+                            trace->event_capacity * sizeof(gmTraceEvent_));
+  }
+
+  const gmTraceEvent_ kEvent = {.name = name,
+                                .thread_id = thread_id,
+                                .start_time = start_time,
+                                .duration = duration};
+  trace->events[trace->event_count++] = kEvent;
+
+  pthread_mutex_unlock(&trace->mutex);
+}
+
+void gmBeginGpuTraceEvent_(GM_OUT_PARAM gmGpuTraceEvent_ *event,
+                           const gmTrace *trace) {
+  if (!trace) {
+    return;
+  }
+
+  glGenQueries(2, event->queries);
+  glQueryCounter(event->queries[0], GL_TIMESTAMP);
+}
+
+void gmEndGpuTraceEvent_(const gmTrace *trace, gmGpuTraceEvent_ *event,
+                         const char *name) {
+  if (!trace) {
+    return;
+  }
+
+  glQueryCounter(event->queries[1], GL_TIMESTAMP);
+  event->name = name;
+}
+
+void gmResolveGpuTraceEvent_(gmTrace *trace, const gmGpuTraceEvent_ *event) {
+  if (!trace) {
+    return;
+  }
+
+  GLuint64 start_timestamp;
+  glGetQueryObjectui64v(event->queries[0], GL_QUERY_RESULT, &start_timestamp);
+
+  GLuint64 end_timestamp;
+  glGetQueryObjectui64v(event->queries[1], GL_QUERY_RESULT, &end_timestamp);
+
+  // The GPU is idle, so its current time and the CPU time are taken at about
+  // the same moment.
+  GLint64 gpu_time;
+  glGetInteger64v(GL_TIMESTAMP, &gpu_time);
+  const double kCpuTime = gmGetTime_();
+
+  glDeleteQueries(2, event->queries);
+
+  const double kStartTime =
+      kCpuTime - (double)(gpu_time - (GLint64)start_timestamp) * 1e-9;
+  gmAddTraceEvent_(trace, event->name, GM_GPU_TRACE_THREAD_ID_, kStartTime,
+                   (double)(end_timestamp - start_timestamp) * 1e-9);
+}
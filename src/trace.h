@@ -0,0 +1,51 @@
+// Copyright (c) Amaël Marquez.  Licensed under the MIT License.
+// See the LICENSE file at the root of the repository for all the details.
+
+#pragma once
+
+#include "gm/gm.h"
+#include "resources/id.h"
+#include "setup.h"
+
+// The functions below do nothing when the trace is NULL, the events of
+// untraced renders costing a branch each.  Event names are string literals,
+// which are written as is.
+
+/**
+ * @return The time the event starts, to be passed to `gmEndTraceEvent_`.
+ */
+double gmBeginTraceEvent_(const gmTrace *trace);
+
+/**
+ * Records the event of the calling thread, from its start to now.
+ */
+void gmEndTraceEvent_(gmTrace *trace, const char *name, double start_time);
+
+/**
+ * Timestamp queries around the commands of an event on the GPU.
+ */
+typedef struct gmGpuTraceEvent_ {
+  gmId_ queries[2];
+  const char *name;
+} gmGpuTraceEvent_;
+
+/**
+ * Queries the GPU time before the commands which follow.
+ */
+void gmBeginGpuTraceEvent_(GM_OUT_PARAM gmGpuTraceEvent_ *event,
+                           const gmTrace *trace);
+
+/**
+ * Queries the GPU time after the commands issued since the event began, without
+ * waiting for them.
+ */
+void gmEndGpuTraceEvent_(const gmTrace *trace, gmGpuTraceEvent_ *event,
+                         const char *name);
+
+/**
+ * Records the event on the GPU track of the trace, its times converted to the
+ * CPU clock, and deletes its queries.  Called once the GPU is done with the
+ * commands of the event, like after reading back their results, so that the
+ * queries are read without stalling.
+ */
+void gmResolveGpuTraceEvent_(gmTrace *trace, const gmGpuTraceEvent_ *event);